@@ -0,0 +1,112 @@
+/**
+ * @file allocator.c
+ * @brief Implementation of the tagged allocation counters
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "allocator.h"
+
+typedef struct {
+    atomic_long live_bytes;
+    atomic_long peak_bytes;
+    atomic_long allocations;
+    atomic_long live_blocks;
+} Counter;
+
+/* One per tag, and the last one for all of them */
+static Counter counters[MEM_TAG_COUNT + 1];
+
+static const char* tag_names[MEM_TAG_COUNT] = {
+    "hash slots", "hash cells", "hash keys", "term table", "occurrences", "ordinals",
+    "posting sets", "arraylist headers", "arraylist data", "bk-tree", "perfect hash", "scratch",
+    "trigrams", "line tables"
+};
+
+static void raise_peak(Counter* counter, long live) {
+    long peak = atomic_load_explicit(&counter->peak_bytes, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&counter->peak_bytes, &peak, live,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/* Add bytes and blocks (either may be negative) to a tag and to the total */
+static void account(MemTag tag, long bytes, long blocks, long allocations) {
+    Counter* targets[2];
+    int t;
+    targets[0] = &counters[tag];
+    targets[1] = &counters[MEM_TAG_COUNT];
+    for (t = 0; t < 2; t++) {
+        long live = atomic_fetch_add_explicit(&targets[t]->live_bytes, bytes, memory_order_relaxed) + bytes;
+        if (blocks != 0) {
+            atomic_fetch_add_explicit(&targets[t]->live_blocks, blocks, memory_order_relaxed);
+        }
+        if (allocations != 0) {
+            atomic_fetch_add_explicit(&targets[t]->allocations, allocations, memory_order_relaxed);
+        }
+        if (bytes > 0) {
+            raise_peak(targets[t], live);
+        }
+    }
+}
+
+void* mem_malloc(MemTag tag, size_t size) {
+    void* ptr = malloc(size);
+    if (ptr != NULL) {
+        account(tag, (long)size, 1, 1);
+    }
+    return ptr;
+}
+
+void* mem_calloc(MemTag tag, size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr != NULL) {
+        account(tag, (long)(count * size), 1, 1);
+    }
+    return ptr;
+}
+
+void* mem_realloc(MemTag tag, void* ptr, size_t old_size, size_t new_size) {
+    void* moved = realloc(ptr, new_size);
+    if (moved != NULL) {
+        account(tag, (long)new_size - (long)(ptr != NULL ? old_size : 0), ptr == NULL, moved != ptr);
+    }
+    return moved;
+}
+
+char* mem_strdup(MemTag tag, const char* text) {
+    size_t size = strlen(text) + 1;
+    char* copy = mem_malloc(tag, size);
+    if (copy != NULL) {
+        memcpy(copy, text, size);
+    }
+    return copy;
+}
+
+void mem_free(MemTag tag, void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    free(ptr);
+    account(tag, -(long)size, -1, 0);
+}
+
+static void read_counter(const Counter* counter, MemStats* stats) {
+    stats->live_bytes = atomic_load_explicit(&counter->live_bytes, memory_order_relaxed);
+    stats->peak_bytes = atomic_load_explicit(&counter->peak_bytes, memory_order_relaxed);
+    stats->allocations = atomic_load_explicit(&counter->allocations, memory_order_relaxed);
+    stats->live_blocks = atomic_load_explicit(&counter->live_blocks, memory_order_relaxed);
+}
+
+void mem_stats(MemTag tag, MemStats* stats) {
+    read_counter(&counters[tag], stats);
+}
+
+void mem_total(MemStats* stats) {
+    read_counter(&counters[MEM_TAG_COUNT], stats);
+}
+
+const char* mem_tag_name(MemTag tag) {
+    return tag >= 0 && tag < MEM_TAG_COUNT ? tag_names[tag] : "?";
+}
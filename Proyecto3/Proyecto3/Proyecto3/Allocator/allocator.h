@@ -0,0 +1,91 @@
+/**
+ * @file allocator.h
+ * @brief Tagged allocations: live bytes, peak bytes and allocation counts per category
+ *
+ * Index structures allocate through mem_malloc / mem_calloc / mem_realloc / mem_strdup
+ * with the category (MemTag) the block belongs to, and free with mem_free and the size
+ * they allocated. Blocks carry no header: the structures already know their sizes
+ * (capacities, string lengths), so the counters cost nothing in memory and a few atomic
+ * adds in time.
+ *
+ * Counters are process wide and safe to update from several threads. They only see
+ * what was requested: malloc's own rounding and headers are not counted.
+ */
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stdlib.h>
+
+/**
+ * @enum MemTag
+ * @brief What a block is used for
+ */
+typedef enum {
+    MEM_TABLE_SLOTS,        /* HashTable arrays of Celda* (and the table struct) */
+    MEM_TABLE_CELLS,        /* Celda structs */
+    MEM_TABLE_KEYS,         /* keys copied by HTPut */
+    MEM_TERMS,              /* term table: posting list headers, word offsets, word arena, free ids,
+                               the index struct and the document names */
+    MEM_OCCURRENCES,        /* Occurrence nodes and OccurrenceList headers */
+    MEM_ORDINALS,           /* U32Vector buffers: token ordinals of a term in a document */
+    MEM_POSTING_SETS,       /* compressed ordinals: PostingSet, containers, arrays and bitmaps */
+    MEM_ARRAYLIST_HEADERS,  /* ArrayList structs */
+    MEM_ARRAYLIST_DATA,     /* ArrayList buffers: token offsets of every document, ... */
+    MEM_FUZZY,              /* BK-tree nodes and their terms */
+    MEM_PERFECT_HASH,       /* frozen dictionary */
+    MEM_SCRATCH,            /* U64Vector buffers of searches */
+    MEM_TRIGRAMS,           /* trigram indexes: trigrams, block counts, list starts and lists */
+    MEM_LINE_TABLES,        /* line start offsets of mapped documents */
+    MEM_TAG_COUNT
+} MemTag;
+
+/**
+ * @struct MemStats
+ * @brief Counters of one tag (or of all of them, see mem_total)
+ *
+ * @param live_bytes Bytes allocated and not freed yet
+ * @param peak_bytes Highest live_bytes seen
+ * @param allocations Blocks allocated (a realloc that moves a block counts once more)
+ * @param live_blocks Blocks allocated and not freed yet
+ */
+typedef struct {
+    long live_bytes;
+    long peak_bytes;
+    long allocations;
+    long live_blocks;
+} MemStats;
+
+void* mem_malloc(MemTag tag, size_t size);
+void* mem_calloc(MemTag tag, size_t count, size_t size);
+
+/**
+ * @brief realloc of a block of old_size bytes (0 if ptr is NULL)
+ *
+ * @return The block, or NULL if allocation failed (ptr is left as it was)
+ */
+void* mem_realloc(MemTag tag, void* ptr, size_t old_size, size_t new_size);
+
+char* mem_strdup(MemTag tag, const char* text);
+
+/**
+ * @brief Free a block allocated with the same tag; size is what was last asked for it
+ */
+void mem_free(MemTag tag, void* ptr, size_t size);
+
+/**
+ * @brief Counters of a tag
+ */
+void mem_stats(MemTag tag, MemStats* stats);
+
+/**
+ * @brief Counters of all tags together (the peak is of the sum, not the sum of peaks)
+ */
+void mem_total(MemStats* stats);
+
+/**
+ * @brief Short name of a tag for reports, e.g. "hash slots"
+ */
+const char* mem_tag_name(MemTag tag);
+
+#endif /* ALLOCATOR_H */
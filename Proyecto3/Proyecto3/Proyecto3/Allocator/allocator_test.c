@@ -0,0 +1,121 @@
+/**
+ * @file allocator_test.c
+ * @brief Checks the counters of the tagged allocator, alone and through ArrayList and vectors
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "allocator.h"
+#include "../ArrayList/arraylist.h"
+#include "../Vector/vector.h"
+
+#define THREADS 4
+#define ROUNDS 10000
+
+static void* churn(void* arg) {
+    int i;
+    (void)arg;
+    for (i = 0; i < ROUNDS; i++) {
+        void* block = mem_malloc(MEM_SCRATCH, 24);
+        mem_free(MEM_SCRATCH, block, 24);
+    }
+    return NULL;
+}
+
+int main() {
+    MemStats stats, total, before;
+    char* text;
+    void* block;
+    ArrayList* list;
+    U32Vector vector;
+    pthread_t threads[THREADS];
+    long value = 7;
+    int i;
+
+    /* Each tag counts its own blocks, the total all of them */
+    block = mem_malloc(MEM_TABLE_CELLS, 100);
+    text = mem_strdup(MEM_TABLE_KEYS, "quijote");
+    mem_stats(MEM_TABLE_CELLS, &stats);
+    assert(stats.live_bytes == 100 && stats.peak_bytes == 100 && stats.allocations == 1 && stats.live_blocks == 1);
+    mem_stats(MEM_TABLE_KEYS, &stats);
+    assert(stats.live_bytes == 8 && strcmp(text, "quijote") == 0);
+    mem_total(&total);
+    assert(total.live_bytes == 108 && total.allocations == 2 && total.live_blocks == 2);
+
+    /* realloc moves the live bytes; the peak stays */
+    block = mem_realloc(MEM_TABLE_CELLS, block, 100, 400);
+    block = mem_realloc(MEM_TABLE_CELLS, block, 400, 50);
+    mem_stats(MEM_TABLE_CELLS, &stats);
+    assert(stats.live_bytes == 50 && stats.peak_bytes == 400 && stats.live_blocks == 1);
+    mem_free(MEM_TABLE_CELLS, block, 50);
+    mem_free(MEM_TABLE_KEYS, text, 8);
+    mem_free(MEM_TABLE_KEYS, NULL, 8);
+    mem_total(&total);
+    assert(total.live_bytes == 0 && total.live_blocks == 0 && total.peak_bytes == 408);
+
+    /* calloc zeroes and counts count * size */
+    block = mem_calloc(MEM_SCRATCH, 10, sizeof(long));
+    for (i = 0; i < 10; i++) {
+        assert(((long*)block)[i] == 0);
+    }
+    mem_stats(MEM_SCRATCH, &stats);
+    assert(stats.live_bytes == 10 * (long)sizeof(long));
+    mem_free(MEM_SCRATCH, block, 10 * sizeof(long));
+
+    /* ArrayList: header and buffer apart, capacity (not size) is what is allocated */
+    list = arraylist_create(4, sizeof(long));
+    for (i = 0; i < 5; i++) {
+        arraylist_add(list, &value);
+    }
+    mem_stats(MEM_ARRAYLIST_HEADERS, &stats);
+    assert(stats.live_bytes == (long)sizeof(ArrayList));
+    mem_stats(MEM_ARRAYLIST_DATA, &stats);
+    assert(stats.live_bytes == 8 * (long)sizeof(long));
+    arraylist_trim_to_size(list);
+    mem_stats(MEM_ARRAYLIST_DATA, &stats);
+    assert(stats.live_bytes == 5 * (long)sizeof(long));
+    arraylist_destroy(list);
+    mem_stats(MEM_ARRAYLIST_DATA, &stats);
+    assert(stats.live_bytes == 0);
+
+    /* Vectors: nothing while inline, shrink gives back the spare capacity */
+    u32vec_init(&vector);
+    for (i = 0; i < 4; i++) {
+        u32vec_push(&vector, (uint32_t)i);
+    }
+    mem_stats(MEM_ORDINALS, &stats);
+    assert(stats.live_bytes == 0);
+    for (i = 4; i < 9; i++) {
+        u32vec_push(&vector, (uint32_t)i);
+    }
+    mem_stats(MEM_ORDINALS, &stats);
+    assert(stats.live_bytes == 16 * (long)sizeof(uint32_t));
+    assert(u32vec_shrink(&vector) == 7 * sizeof(uint32_t) && vector.capacity == 9);
+    assert(u32vec_shrink(&vector) == 0);
+    vector.size = 3;
+    assert(u32vec_shrink(&vector) == 9 * sizeof(uint32_t) && vector.capacity == 0);
+    for (i = 0; i < 3; i++) {
+        assert(u32vec_get(&vector, i) == (uint32_t)i);
+    }
+    mem_stats(MEM_ORDINALS, &stats);
+    assert(stats.live_bytes == 0 && stats.live_blocks == 0);
+
+    /* Several threads at once: nothing is lost */
+    mem_stats(MEM_SCRATCH, &before);
+    for (i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, churn, NULL);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    mem_stats(MEM_SCRATCH, &stats);
+    assert(stats.live_bytes == 0 && stats.live_blocks == 0);
+    assert(stats.allocations == before.allocations + THREADS * ROUNDS);
+    assert(stats.peak_bytes <= before.peak_bytes + THREADS * 24);
+
+    assert(strcmp(mem_tag_name(MEM_TABLE_SLOTS), "hash slots") == 0);
+    printf("All allocator tests passed.\n");
+    return 0;
+}
@@ -6,7 +6,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "arraylist.h"
+#include "../Allocator/allocator.h"
 
 /* Default initial capacity if not specified */
 #define DEFAULT_CAPACITY 10
@@ -48,6 +51,236 @@ void arraylist_sort(ArrayList* list, Comparator cmp) {
     free(tmp);
 }
 
+/* Radix sort de claves de 64 bits: un byte por pasada */
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+#define RADIX_INSERTION_MAX 32
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+static void insertion_sort_u64(uint64_t* values, size_t count) {
+    size_t i, j;
+    for (i = 1; i < count; ++i) {
+        uint64_t v = values[i];
+        for (j = i; j > 0 && values[j - 1] > v; --j) {
+            values[j] = values[j - 1];
+        }
+        values[j] = v;
+    }
+}
+
+/* Bytes donde no todas las claves son iguales; los demas no necesitan pasada */
+static int radix_digits(const uint64_t* values, size_t count, int* digits) {
+    uint64_t any = 0, all = ~(uint64_t)0, differ;
+    size_t i;
+    int d, n = 0;
+    for (i = 0; i < count; ++i) {
+        any |= values[i];
+        all &= values[i];
+    }
+    differ = any ^ all;
+    for (d = 0; d < RADIX_PASSES; ++d) {
+        if ((differ >> (d * RADIX_BITS)) & (RADIX_BUCKETS - 1)) digits[n++] = d;
+    }
+    return n;
+}
+
+/* Un solo hilo: los histogramas de todos los bytes salen de una lectura, el orden no los cambia */
+static void radix_serial(uint64_t* values, uint64_t* scratch, size_t count, const int* digits, int digit_count) {
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+    uint64_t *src = values, *dst = scratch, *swap;
+    size_t i, sum, c;
+    int p, b;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < count; ++i) {
+        for (p = 0; p < digit_count; ++p) {
+            counts[p][(values[i] >> (digits[p] * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+    for (p = 0; p < digit_count; ++p) {
+        int shift = digits[p] * RADIX_BITS;
+        for (b = 0, sum = 0; b < RADIX_BUCKETS; ++b) {
+            c = counts[p][b];
+            counts[p][b] = sum;
+            sum += c;
+        }
+        for (i = 0; i < count; ++i) {
+            dst[counts[p][(src[i] >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != values) memcpy(values, src, count * sizeof(uint64_t));
+}
+
+/* Varios hilos: cada uno cuenta y reparte su tramo; el lugar de su parte de cada balde
+   sale de los histogramas de todos (balde por balde, hilo por hilo), asi sigue siendo estable */
+typedef struct {
+    uint64_t* values;
+    uint64_t* scratch;
+    size_t count;
+    int digits[RADIX_PASSES];
+    int digit_count;
+    int threads;                               /* fijado antes de abrir la compuerta */
+    size_t counts[ARRAYLIST_SORT_MAX_THREADS][RADIX_BUCKETS];
+    pthread_barrier_t barrier;
+    pthread_mutex_t lock;
+    pthread_cond_t open;
+    int started;
+} ParallelSort;
+
+typedef struct {
+    ParallelSort* sort;
+    int id;
+} SortWorker;
+
+static void* radix_worker(void* arg) {
+    SortWorker* worker = arg;
+    ParallelSort* sort = worker->sort;
+    uint64_t *src, *dst, *swap;
+    size_t offsets[RADIX_BUCKETS];
+    size_t begin, end, i, running;
+    int p, b, t;
+
+    /* los hilos que llegan a crearse esperan a saber cuantos son */
+    pthread_mutex_lock(&sort->lock);
+    while (!sort->started) pthread_cond_wait(&sort->open, &sort->lock);
+    pthread_mutex_unlock(&sort->lock);
+
+    begin = sort->count * worker->id / sort->threads;
+    end = sort->count * (worker->id + 1) / sort->threads;
+    src = sort->values;
+    dst = sort->scratch;
+    for (p = 0; p < sort->digit_count; ++p) {
+        int shift = sort->digits[p] * RADIX_BITS;
+        size_t* mine = sort->counts[worker->id];
+        memset(mine, 0, sizeof(sort->counts[0]));
+        for (i = begin; i < end; ++i) mine[(src[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+        pthread_barrier_wait(&sort->barrier);
+
+        running = 0;
+        for (b = 0; b < RADIX_BUCKETS; ++b) {
+            for (t = 0; t < sort->threads; ++t) {
+                if (t == worker->id) offsets[b] = running;
+                running += sort->counts[t][b];
+            }
+        }
+        for (i = begin; i < end; ++i) {
+            dst[offsets[(src[i] >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        /* nadie vuelve a contar hasta que todos repartieron */
+        pthread_barrier_wait(&sort->barrier);
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return NULL;
+}
+
+static void radix_parallel(uint64_t* values, uint64_t* scratch, size_t count, const int* digits, int digit_count, int threads) {
+    ParallelSort* sort;
+    SortWorker workers[ARRAYLIST_SORT_MAX_THREADS];
+    pthread_t handles[ARRAYLIST_SORT_MAX_THREADS];
+    int created = 0, t;
+
+    sort = malloc(sizeof(ParallelSort));
+    if (!sort) {
+        radix_serial(values, scratch, count, digits, digit_count);
+        return;
+    }
+    sort->values = values;
+    sort->scratch = scratch;
+    sort->count = count;
+    memcpy(sort->digits, digits, digit_count * sizeof(int));
+    sort->digit_count = digit_count;
+    sort->started = 0;
+    pthread_mutex_init(&sort->lock, NULL);
+    pthread_cond_init(&sort->open, NULL);
+
+    for (t = 1; t < threads; ++t) {
+        workers[created + 1].sort = sort;
+        workers[created + 1].id = created + 1;
+        if (pthread_create(&handles[created + 1], NULL, radix_worker, &workers[created + 1]) != 0) break;
+        created++;
+    }
+
+    /* el hilo que llama es el trabajador 0 */
+    sort->threads = created + 1;
+    pthread_barrier_init(&sort->barrier, NULL, (unsigned)sort->threads);
+    pthread_mutex_lock(&sort->lock);
+    sort->started = 1;
+    pthread_cond_broadcast(&sort->open);
+    pthread_mutex_unlock(&sort->lock);
+    workers[0].sort = sort;
+    workers[0].id = 0;
+    radix_worker(&workers[0]);
+    for (t = 1; t <= created; ++t) pthread_join(handles[t], NULL);
+
+    if (digit_count % 2) memcpy(values, scratch, count * sizeof(uint64_t));
+    pthread_barrier_destroy(&sort->barrier);
+    pthread_cond_destroy(&sort->open);
+    pthread_mutex_destroy(&sort->lock);
+    free(sort);
+}
+
+/**
+ * @brief Sort unsigned 64-bit keys ascending with an LSD radix sort
+ */
+void arraylist_sort_u64(uint64_t* values, size_t count, uint64_t* scratch, int threads) {
+    int digits[RADIX_PASSES];
+    int digit_count;
+    uint64_t* owned = NULL;
+
+    if (!values || count < 2) return;
+    if (count <= RADIX_INSERTION_MAX) {
+        insertion_sort_u64(values, count);
+        return;
+    }
+    digit_count = radix_digits(values, count, digits);
+    if (digit_count == 0) return;  /* todas iguales */
+
+    if (!scratch) {
+        scratch = owned = malloc(count * sizeof(uint64_t));
+        if (!scratch) {
+            /* sin memoria extra, un ordenamiento en el lugar */
+            qsort(values, count, sizeof(uint64_t), compare_u64);
+            return;
+        }
+    }
+
+    if (threads <= 0) {
+        threads = 1;
+        if (count >= ARRAYLIST_PARALLEL_SORT_MIN) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = cpus > 1 ? (int)cpus : 1;
+        }
+    }
+    if (threads > ARRAYLIST_SORT_MAX_THREADS) threads = ARRAYLIST_SORT_MAX_THREADS;
+    if ((size_t)threads > count / RADIX_BUCKETS) threads = 1;  /* tramos demasiado chicos */
+
+    if (threads > 1) {
+        radix_parallel(values, scratch, count, digits, digit_count, threads);
+    } else {
+        radix_serial(values, scratch, count, digits, digit_count);
+    }
+    free(owned);
+}
+
+/**
+ * @brief Sort an ArrayList of 8-byte unsigned keys with arraylist_sort_u64
+ */
+int arraylist_sort_integers(ArrayList* list) {
+    if (!list || list->element_size != sizeof(uint64_t)) return 0;
+    arraylist_sort_u64((uint64_t*)list->data, list->size, NULL, 0);
+    return 1;
+}
+
 /**
  * @brief Create a new ArrayList with the specified capacity
  */
@@ -65,15 +298,15 @@ ArrayList* arraylist_create(size_t initial_capacity, size_t element_size) {
     }
     
     /* Allocate memory for the ArrayList structure */
-    list = (ArrayList*)malloc(sizeof(ArrayList));
+    list = (ArrayList*)mem_malloc(MEM_ARRAYLIST_HEADERS, sizeof(ArrayList));
     if (list == NULL) {
         return NULL;
     }
     
     /* Allocate memory for the data array */
-    list->data = malloc(initial_capacity * element_size);
+    list->data = mem_malloc(MEM_ARRAYLIST_DATA, initial_capacity * element_size);
     if (list->data == NULL) {
-        free(list);
+        mem_free(MEM_ARRAYLIST_HEADERS, list, sizeof(ArrayList));
         return NULL;
     }
     
@@ -95,11 +328,11 @@ void arraylist_destroy(ArrayList* list) {
     
     /* Free the data array if it exists */
     if (list->data != NULL) {
-        free(list->data);
+        mem_free(MEM_ARRAYLIST_DATA, list->data, list->capacity * list->element_size);
     }
     
     /* Free the ArrayList structure itself */
-    free(list);
+    mem_free(MEM_ARRAYLIST_HEADERS, list, sizeof(ArrayList));
 }
 
 /**
@@ -284,7 +517,8 @@ int arraylist_ensure_capacity(ArrayList* list, size_t min_capacity) {
     }
     
     /* Allocate new memory */
-    new_data = realloc(list->data, min_capacity * list->element_size);
+    new_data = mem_realloc(MEM_ARRAYLIST_DATA, list->data, list->capacity * list->element_size,
+                           min_capacity * list->element_size);
     if (new_data == NULL) {
         return 0;
     }
@@ -312,7 +546,8 @@ int arraylist_trim_to_size(ArrayList* list) {
     new_capacity = list->size > 0 ? list->size : DEFAULT_CAPACITY;
     
     /* Allocate new memory */
-    new_data = realloc(list->data, new_capacity * list->element_size);
+    new_data = mem_realloc(MEM_ARRAYLIST_DATA, list->data, list->capacity * list->element_size,
+                           new_capacity * list->element_size);
     if (new_data == NULL) {
         return 0;
     }
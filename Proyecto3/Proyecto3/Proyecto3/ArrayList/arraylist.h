@@ -7,6 +7,7 @@
 #define ARRAYLIST_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
 /**
  * @struct ArrayList
@@ -130,4 +131,33 @@ int arraylist_trim_to_size(ArrayList* list);
 typedef int (*Comparator)(const void* a, const void* b);
 void arraylist_sort(ArrayList* list, Comparator cmp);
 
+/* Arrays with at least this many keys are sorted by several threads */
+#define ARRAYLIST_PARALLEL_SORT_MIN ((size_t)1 << 19)
+
+/* Most threads used by a parallel sort */
+#define ARRAYLIST_SORT_MAX_THREADS 8
+
+/**
+ * @brief Sort unsigned 64-bit keys ascending with an LSD radix sort
+ *
+ * Only the bytes where the keys differ get a pass, so small keys (ordinals, doc ids,
+ * values packed with a few tag bits) take as many passes as they have bytes.
+ *
+ * @param values The keys to sort
+ * @param count Number of keys
+ * @param scratch Buffer of count keys to use, or NULL to allocate one
+ * @param threads Threads to use, or 0 to use up to ARRAYLIST_SORT_MAX_THREADS
+ *                when count reaches ARRAYLIST_PARALLEL_SORT_MIN
+ */
+void arraylist_sort_u64(uint64_t* values, size_t count, uint64_t* scratch, int threads);
+
+/**
+ * @brief Sort an ArrayList of 8-byte unsigned keys (non-negative long, size_t,
+ *        or integers packed in void*) with arraylist_sort_u64
+ *
+ * @param list The ArrayList to sort
+ * @return 1 if sorted, 0 if its elements aren't 8 bytes wide
+ */
+int arraylist_sort_integers(ArrayList* list);
+
 #endif /* ARRAYLIST_H */
\ No newline at end of file
@@ -0,0 +1,249 @@
+/**
+ * @file bktree.c
+ * @brief Implementation of the BKTree functions
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "bktree.h"
+#include "../Allocator/allocator.h"
+
+/* Rows up to this length live on the stack, longer strings use the heap */
+#define STACK_ROW 64
+
+static int min3(int a, int b, int c) {
+    int m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+/**
+ * @brief Compute the Levenshtein distance between two strings
+ */
+int levenshtein_distance(const char* a, const char* b, int max_distance) {
+    int stack_rows[2 * STACK_ROW];
+    int *prev, *cur, *heap = NULL;
+    int la = (int)strlen(a);
+    int lb = (int)strlen(b);
+    int i, j, result;
+
+    /* The length difference is a lower bound of the distance */
+    if (max_distance >= 0 && abs(la - lb) > max_distance) {
+        return max_distance + 1;
+    }
+
+    if (lb + 1 <= STACK_ROW) {
+        prev = stack_rows;
+        cur = stack_rows + STACK_ROW;
+    } else {
+        heap = malloc(2 * (lb + 1) * sizeof(int));
+        if (heap == NULL) {
+            return max_distance >= 0 ? max_distance + 1 : la + lb;
+        }
+        prev = heap;
+        cur = heap + lb + 1;
+    }
+
+    for (j = 0; j <= lb; j++) prev[j] = j;
+
+    for (i = 1; i <= la; i++) {
+        int row_min;
+        int* tmp;
+
+        cur[0] = i;
+        row_min = cur[0];
+        for (j = 1; j <= lb; j++) {
+            int cost = (a[i - 1] == b[j - 1]) ? 0 : 1;
+            cur[j] = min3(prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost);
+            if (cur[j] < row_min) row_min = cur[j];
+        }
+
+        /* No cell of this row is within the bound, so the final value can't be either */
+        if (max_distance >= 0 && row_min > max_distance) {
+            free(heap);
+            return max_distance + 1;
+        }
+
+        tmp = prev;
+        prev = cur;
+        cur = tmp;
+    }
+
+    result = prev[lb];
+    free(heap);
+    if (max_distance >= 0 && result > max_distance) {
+        return max_distance + 1;
+    }
+    return result;
+}
+
+static BKNode* create_node(const char* term, int distance) {
+    BKNode* node = mem_malloc(MEM_FUZZY, sizeof(BKNode));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->term = mem_strdup(MEM_FUZZY, term);
+    if (node->term == NULL) {
+        mem_free(MEM_FUZZY, node, sizeof(BKNode));
+        return NULL;
+    }
+    node->distance = distance;
+    node->first_child = NULL;
+    node->next_sibling = NULL;
+    return node;
+}
+
+static void destroy_node(BKNode* node) {
+    while (node != NULL) {
+        BKNode* next = node->next_sibling;
+        destroy_node(node->first_child);
+        mem_free(MEM_FUZZY, node->term, strlen(node->term) + 1);
+        mem_free(MEM_FUZZY, node, sizeof(BKNode));
+        node = next;
+    }
+}
+
+/**
+ * @brief Create a new empty BKTree
+ */
+BKTree* bktree_create(void) {
+    BKTree* tree = mem_malloc(MEM_FUZZY, sizeof(BKTree));
+    if (tree == NULL) {
+        return NULL;
+    }
+    tree->root = NULL;
+    tree->size = 0;
+    return tree;
+}
+
+/**
+ * @brief Free the tree and every term stored in it
+ */
+void bktree_destroy(BKTree* tree) {
+    if (tree == NULL) {
+        return;
+    }
+    destroy_node(tree->root);
+    mem_free(MEM_FUZZY, tree, sizeof(BKTree));
+}
+
+/**
+ * @brief Add a copy of a term to the tree
+ */
+int bktree_add(BKTree* tree, const char* term) {
+    BKNode* node;
+
+    if (tree == NULL || term == NULL) {
+        return 0;
+    }
+
+    if (tree->root == NULL) {
+        tree->root = create_node(term, 0);
+        if (tree->root == NULL) {
+            return 0;
+        }
+        tree->size = 1;
+        return 1;
+    }
+
+    /* Walk down following the child at the same distance until there is none */
+    node = tree->root;
+    while (1) {
+        int d = levenshtein_distance(term, node->term, -1);
+        BKNode* child;
+
+        if (d == 0) {
+            return 1; /* Already present */
+        }
+
+        for (child = node->first_child; child != NULL; child = child->next_sibling) {
+            if (child->distance == d) break;
+        }
+
+        if (child == NULL) {
+            child = create_node(term, d);
+            if (child == NULL) {
+                return 0;
+            }
+            child->next_sibling = node->first_child;
+            node->first_child = child;
+            tree->size++;
+            return 1;
+        }
+        node = child;
+    }
+}
+
+/* Insert a match keeping out sorted by distance and at most max_out long */
+static void add_match(BKMatch* out, int* count, int max_out, const char* term, int distance) {
+    int i;
+
+    if (*count == max_out) {
+        if (max_out == 0 || out[max_out - 1].distance <= distance) return;
+        (*count)--; /* Drop the farthest match */
+    }
+
+    i = *count;
+    while (i > 0 && out[i - 1].distance > distance) {
+        out[i] = out[i - 1];
+        i--;
+    }
+    out[i].term = term;
+    out[i].distance = distance;
+    (*count)++;
+}
+
+static void search_node(const BKNode* node, const char* query, int max_distance,
+                        BKMatch* out, int* count, int max_out) {
+    const BKNode* child;
+    int d, radius, farthest = 0;
+
+    /* Past max_distance + farthest child no child can be in range either, so the
+       exact distance is never needed beyond that bound */
+    for (child = node->first_child; child != NULL; child = child->next_sibling) {
+        if (child->distance > farthest) farthest = child->distance;
+    }
+    d = levenshtein_distance(query, node->term, max_distance + farthest);
+    if (d <= max_distance) {
+        add_match(out, count, max_out, node->term, d);
+    }
+
+    /* Once out is full only strictly closer matches can get in */
+    radius = max_distance;
+    if (*count == max_out && max_out > 0 && out[max_out - 1].distance - 1 < radius) {
+        radius = out[max_out - 1].distance - 1;
+    }
+
+    /* Triangle inequality: only children whose distance is within d +- radius can match */
+    for (child = node->first_child; child != NULL; child = child->next_sibling) {
+        if (child->distance >= d - radius && child->distance <= d + radius) {
+            search_node(child, query, radius, out, count, max_out);
+            if (*count == max_out && max_out > 0 && out[max_out - 1].distance - 1 < radius) {
+                radius = out[max_out - 1].distance - 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Find every term within max_distance of the query
+ */
+int bktree_search(const BKTree* tree, const char* query, int max_distance, BKMatch* out, int max_out) {
+    int count = 0;
+
+    if (tree == NULL || query == NULL || out == NULL || max_out <= 0 || tree->root == NULL) {
+        return 0;
+    }
+
+    search_node(tree->root, query, max_distance, out, &count, max_out);
+    return count;
+}
+
+/**
+ * @brief Get the number of terms stored in the tree
+ */
+size_t bktree_size(const BKTree* tree) {
+    if (tree == NULL) {
+        return 0;
+    }
+    return tree->size;
+}
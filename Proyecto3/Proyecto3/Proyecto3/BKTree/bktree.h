@@ -0,0 +1,101 @@
+/**
+ * @file bktree.h
+ * @brief Burkhard-Keller tree over strings using Levenshtein distance
+ *
+ * Used by the inverted index to answer edit-distance bounded lookups over
+ * the term dictionary without scanning every key.
+ */
+
+#ifndef BKTREE_H
+#define BKTREE_H
+
+#include <stdlib.h>
+
+/**
+ * @struct BKNode
+ * @brief A node of the tree, children are kept as a sibling list
+ *
+ * @param term The string stored in this node (owned by the node)
+ * @param distance Edit distance between this term and its parent's term
+ * @param first_child First child of this node
+ * @param next_sibling Next child of this node's parent
+ */
+typedef struct _BKNode {
+    char* term;
+    int distance;
+    struct _BKNode* first_child;
+    struct _BKNode* next_sibling;
+} BKNode;
+
+/**
+ * @struct BKTree
+ * @brief Root of the tree plus the number of terms stored
+ */
+typedef struct {
+    BKNode* root;
+    size_t size;
+} BKTree;
+
+/**
+ * @struct BKMatch
+ * @brief A term found by bktree_search and its distance to the query
+ */
+typedef struct {
+    const char* term;
+    int distance;
+} BKMatch;
+
+/**
+ * @brief Compute the Levenshtein distance between two strings
+ *
+ * @param a First string
+ * @param b Second string
+ * @param max_distance Stop early once the distance is known to exceed it (negative = no bound)
+ * @return The distance, or max_distance + 1 if it is larger than max_distance
+ */
+int levenshtein_distance(const char* a, const char* b, int max_distance);
+
+/**
+ * @brief Create a new empty BKTree
+ *
+ * @return A pointer to the new tree, or NULL if allocation failed
+ */
+BKTree* bktree_create(void);
+
+/**
+ * @brief Free the tree and every term stored in it
+ *
+ * @param tree The tree to free
+ */
+void bktree_destroy(BKTree* tree);
+
+/**
+ * @brief Add a copy of a term to the tree (duplicates are ignored)
+ *
+ * @param tree The tree to add to
+ * @param term The term to add
+ * @return 1 if successful or already present, 0 if allocation failed
+ */
+int bktree_add(BKTree* tree, const char* term);
+
+/**
+ * @brief Find every term within max_distance of the query
+ *
+ * Matches are written to out sorted by distance (ties keep tree order). When
+ * there are more than max_out matches only the closest max_out are kept.
+ *
+ * @param tree The tree to search
+ * @param query The string to look up
+ * @param max_distance Largest edit distance accepted
+ * @param out Array receiving the matches
+ * @param max_out Capacity of out
+ * @return The number of matches written to out
+ */
+int bktree_search(const BKTree* tree, const char* query, int max_distance, BKMatch* out, int max_out);
+
+/**
+ * @brief Get the number of terms stored in the tree
+ */
+size_t bktree_size(const BKTree* tree);
+
+#endif /* BKTREE_H */
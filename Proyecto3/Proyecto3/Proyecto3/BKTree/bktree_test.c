@@ -0,0 +1,66 @@
+/**
+ * @file bktree_test.c
+ * @brief Checks the BKTree against a brute force search
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "bktree.h"
+
+static const char* words[] = {
+    "caballero", "caballeros", "caballo", "caballos", "quijote", "quijada",
+    "sancho", "mancha", "manchas", "lugar", "hidalgo", "hidalga", "rocinante",
+    "dulcinea", "toboso", "escudero", "escuderos", "aventura", "aventuras"
+};
+
+int main() {
+    BKTree* tree;
+    BKMatch matches[32];
+    int word_count = sizeof(words) / sizeof(words[0]);
+    int i, n, d, expected;
+
+    /* Distances */
+    assert(levenshtein_distance("", "", -1) == 0);
+    assert(levenshtein_distance("abc", "", -1) == 3);
+    assert(levenshtein_distance("caualleros", "caballeros", -1) == 1);
+    assert(levenshtein_distance("quixote", "quijote", -1) == 1);
+    assert(levenshtein_distance("kitten", "sitting", -1) == 3);
+    assert(levenshtein_distance("kitten", "sitting", 1) == 2); /* bounded: max + 1 */
+
+    tree = bktree_create();
+    assert(tree != NULL);
+    for (i = 0; i < word_count; i++) {
+        assert(bktree_add(tree, words[i]) == 1);
+    }
+    assert(bktree_add(tree, "sancho") == 1); /* duplicate ignored */
+    assert(bktree_size(tree) == (size_t)word_count);
+
+    /* Every query must find exactly what a brute force scan finds */
+    for (d = 0; d <= 3; d++) {
+        for (i = 0; i < word_count; i++) {
+            int j;
+            expected = 0;
+            for (j = 0; j < word_count; j++) {
+                if (levenshtein_distance(words[i], words[j], d) <= d) expected++;
+            }
+            n = bktree_search(tree, words[i], d, matches, 32);
+            assert(n == expected);
+            for (j = 1; j < n; j++) assert(matches[j - 1].distance <= matches[j].distance);
+        }
+    }
+
+    /* Misspelled queries */
+    n = bktree_search(tree, "caualleros", 1, matches, 32);
+    assert(n == 1 && strcmp(matches[0].term, "caballeros") == 0 && matches[0].distance == 1);
+    n = bktree_search(tree, "quixote", 2, matches, 32);
+    assert(n == 1 && strcmp(matches[0].term, "quijote") == 0);
+
+    /* A small output keeps only the closest matches */
+    n = bktree_search(tree, "caballeros", 2, matches, 1);
+    assert(n == 1 && strcmp(matches[0].term, "caballeros") == 0 && matches[0].distance == 0);
+
+    bktree_destroy(tree);
+    printf("All BKTree tests passed successfully.\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "InvertedIndex.h"
+
+#define QUERIES_PER_THREAD 400
+#define MAX_THREADS 64
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+/* Consultas mezcladas: proximidad (palabras separadas por comas) y frases (entre comillas) */
+static const char* queries[] = {
+    "quijote,sancho", "Dulcinea,Toboso", "caballero,andante", "escudero,sancho,rucio",
+    "\"en un lugar de la Mancha\"", "\"el ingenioso hidalgo\"", "isla,tesoro", "capitan,barco",
+    "lobos,monte", "\"don Juan Manuel\"", "MANCHA,hidalgo", "venta,ventero,castillo",
+    "gobernador,insula", "\"dijo Sancho\"", "libros,caballerias", "mar,playa,arena"
+};
+static const int query_count = sizeof(queries) / sizeof(queries[0]);
+
+typedef struct {
+    const InvertedIndex* idx;
+    int first_query;
+    long matches;      /* total de matches consumidos, para comparar con la referencia */
+} Worker;
+
+/* Ejecuta una consulta completa (todos los matches y sus resaltados) y devuelve cuantos hubo */
+static long run_query(const InvertedIndex* idx, const char* text) {
+    char buffer[256];
+    char* words[MAX_QUERY_WORDS];
+    int word_count = 0;
+    SearchCursor* cursor;
+
+    strncpy(buffer, text, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    if (buffer[0] == '"') {
+        char* phrase = buffer + 1;
+        phrase[strcspn(phrase, "\"")] = '\0';
+        words[word_count++] = phrase;
+        cursor = II_PhraseOpen(idx, phrase);
+    } else {
+        char* save = NULL;
+        for (char* tok = strtok_r(buffer, ",", &save); tok && word_count < MAX_QUERY_WORDS; tok = strtok_r(NULL, ",", &save)) {
+            words[word_count++] = tok;
+        }
+        cursor = II_SearchOpen(idx, words, word_count, DEFAULT_WORD_WINDOW);
+    }
+
+    long found = 0;
+    printData result;
+    TextSpan spans[64];
+    while (II_SearchNext(cursor, &result)) {
+        II_MatchSpans(idx, &result, words, word_count, spans, 64);
+        found++;
+    }
+    II_SearchClose(cursor);
+    return found;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    for (int q = 0; q < QUERIES_PER_THREAD; ++q) {
+        w->matches += run_query(w->idx, queries[(w->first_query + q) % query_count]);
+    }
+    return NULL;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    const char* files[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    if (max_threads < 1 || max_threads > MAX_THREADS) max_threads = 8;
+
+    InvertedIndex* idx = II_Create();
+    for (int f = 0; f < 4; ++f) {
+        if (II_LoadFile(idx, files[f]) < 0) {
+            fprintf(stderr, "Failed to load file: %s\n", files[f]);
+            II_Destroy(idx);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Referencia de un solo hilo: cuantos matches da cada consulta */
+    long expected[sizeof(queries) / sizeof(queries[0])];
+    for (int q = 0; q < query_count; ++q) expected[q] = run_query(idx, queries[q]);
+
+    printf("\n%8s %12s %14s %10s\n", "threads", "queries", "queries/s", "speedup");
+    double base = 0;
+    for (int t = 1; t <= max_threads; t *= 2) {
+        pthread_t threads[MAX_THREADS];
+        Worker workers[MAX_THREADS];
+
+        double t0 = now_s();
+        for (int i = 0; i < t; ++i) {
+            workers[i] = (Worker){ idx, i * 3, 0 };
+            pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+        }
+        for (int i = 0; i < t; ++i) pthread_join(threads[i], NULL);
+        double elapsed = now_s() - t0;
+
+        /* Todas las consultas en paralelo tienen que dar lo mismo que la referencia */
+        for (int i = 0; i < t; ++i) {
+            long want = 0;
+            for (int q = 0; q < QUERIES_PER_THREAD; ++q) want += expected[(workers[i].first_query + q) % query_count];
+            if (workers[i].matches != want) {
+                fprintf(stderr, "thread %d: %ld matches, expected %ld\n", i, workers[i].matches, want);
+                return EXIT_FAILURE;
+            }
+        }
+
+        double qps = t * QUERIES_PER_THREAD / elapsed;
+        if (t == 1) base = qps;
+        printf("%8d %12d %14.0f %9.2fx\n", t, t * QUERIES_PER_THREAD, qps, qps / base);
+    }
+
+    II_Destroy(idx);
+    return EXIT_SUCCESS;
+}
@@ -1,12 +1,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "FileManager.h"
+#include "Allocator/allocator.h"
 
-#define BOOKS_PATH "libros/"
+#define SNIPPET_IOV_BATCH 64   // iovecs acumulados antes de cada writev
+#define HIGHLIGHT_ON  "\033[1;31m"
+#define HIGHLIGHT_OFF "\033[0m"
 
-FILE* open_file(const char* path) {
+// Devuelve libros/ + path en memoria nueva (liberar con free), NULL si falla
+static char* build_path(const char* path) {
     // Buffer para la ruta completa: libros/ + path + '\0'
     size_t len_prefix = strlen(BOOKS_PATH);
     size_t len_path   = strlen(path);
@@ -20,6 +29,12 @@ FILE* open_file(const char* path) {
     memcpy(fullpath, BOOKS_PATH, len_prefix);
     memcpy(fullpath + len_prefix, path,      len_path);
     fullpath[len_prefix + len_path] = '\0';
+    return fullpath;
+}
+
+FILE* open_file(const char* path) {
+    char* fullpath = build_path(path);
+    if (!fullpath) return NULL;
 
     // Intentar abrir
     FILE* file = fopen(fullpath, "r");
@@ -82,4 +97,218 @@ int find_line_by_position(FILE* file, long position) {
     return -1;
 }
 
+char** get_lines(FILE* file, int start_line, int end_line) {
+    if (start_line > end_line || start_line < 1) {
+        printf("Invalid range: start_line (%d) should be <= end_line (%d) and >= 1.\n", start_line, end_line);
+        return NULL;
+    }
+
+    int count = end_line - start_line + 1;
+    char** lines = calloc(count + 1, sizeof(char*));
+    if (!lines) return NULL;
+
+    fseek(file, 0, SEEK_SET);
+    int current_line = 1;
+    int stored = 0;
+    int ch;
+    while (current_line <= end_line && (ch = fgetc(file)) != EOF) {
+        int keep = current_line >= start_line;
+        size_t len = 0, cap = 128;
+        char* line = keep ? malloc(cap) : NULL;
+        if (keep && !line) break;
+
+        // las lineas se leen completas, sin importar su largo
+        while (ch != EOF && ch != '\n') {
+            if (line && len + 1 >= cap) {
+                char* bigger = realloc(line, cap * 2);
+                if (!bigger) {
+                    free(line);
+                    free_lines(lines);
+                    return NULL;
+                }
+                line = bigger;
+                cap *= 2;
+            }
+            if (line) line[len++] = (char)ch;
+            ch = fgetc(file);
+        }
+
+        if (line) {
+            if (len > 0 && line[len - 1] == '\r') len--;
+            line[len] = '\0';
+            lines[stored++] = line;
+        }
+        current_line++;
+    }
+    return lines;
+}
+
+void free_lines(char** lines) {
+    if (!lines) return;
+    for (int i = 0; lines[i]; ++i) free(lines[i]);
+    free(lines);
+}
+
+MappedFile* map_file(const char* path) {
+    char* fullpath = build_path(path);
+    if (!fullpath) return NULL;
+
+    int fd = open(fullpath, O_RDONLY);
+    if (fd < 0) {
+        perror(fullpath);
+        free(fullpath);
+        return NULL;
+    }
+    free(fullpath);
+
+    struct stat st;
+    MappedFile* file = calloc(1, sizeof(MappedFile));
+    if (!file || fstat(fd, &st) < 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    file->size = (size_t)st.st_size;
+    if (file->size > 0) {
+        void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("mmap");
+            free(file);
+            close(fd);
+            return NULL;
+        }
+        file->data = data;
+    }
+    close(fd);  // el mapeo sigue valido sin el descriptor
+
+    // tabla de lineas: offset donde empieza cada linea
+    file->line_starts = mem_malloc(MEM_LINE_TABLES, 1024 * sizeof(long));
+    if (!file->line_starts) {
+        unmap_file(file);
+        return NULL;
+    }
+    file->line_capacity = 1024;
+    file->line_starts[file->line_count++] = 0;
+    const char* p = file->data;
+    const char* end = file->data + file->size;
+    while (p && p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        p++;
+        if (p == end) break;  // el ultimo '\n' no abre una linea nueva
+        if (file->line_count == file->line_capacity) {
+            long* bigger = mem_realloc(MEM_LINE_TABLES, file->line_starts, file->line_capacity * sizeof(long),
+                                       file->line_capacity * 2 * sizeof(long));
+            if (!bigger) {
+                unmap_file(file);
+                return NULL;
+            }
+            file->line_starts = bigger;
+            file->line_capacity *= 2;
+        }
+        file->line_starts[file->line_count++] = p - file->data;
+    }
+    return file;
+}
+
+void unmap_file(MappedFile* file) {
+    if (!file) return;
+    if (file->data) munmap((void*)file->data, file->size);
+    mem_free(MEM_LINE_TABLES, file->line_starts, file->line_capacity * sizeof(long));
+    free(file);
+}
 
+int line_of_offset(const MappedFile* file, long offset) {
+    if (!file || offset < 0 || (size_t)offset >= file->size) return -1;
+
+    // ultima linea cuyo inicio es <= offset
+    int low = 0, high = file->line_count - 1;
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (file->line_starts[mid] <= offset) low = mid;
+        else high = mid - 1;
+    }
+    return low + 1;
+}
+
+// Vista de la linea n (1-based) sin el fin de linea
+static LineView line_view(const MappedFile* file, int n) {
+    long begin = file->line_starts[n - 1];
+    long end = n < file->line_count ? file->line_starts[n] : (long)file->size;
+    if (end > begin && file->data[end - 1] == '\n') end--;
+    if (end > begin && file->data[end - 1] == '\r') end--;
+    return (LineView){ file->data + begin, (size_t)(end - begin) };
+}
+
+int get_line_views(const MappedFile* file, int start_line, int end_line, LineView* out, int max_out) {
+    if (!file || !out || start_line < 1 || start_line > end_line) return 0;
+    if (end_line > file->line_count) end_line = file->line_count;
+
+    int count = 0;
+    for (int n = start_line; n <= end_line && count < max_out; ++n) {
+        out[count++] = line_view(file, n);
+    }
+    return count;
+}
+
+// writev de todos los iovecs acumulados, reintentando escrituras parciales
+static void flush_iov(int fd, struct iovec* iov, int* count) {
+    struct iovec* cur = iov;
+    int left = *count;
+    while (left > 0) {
+        ssize_t written = writev(fd, cur, left);
+        if (written < 0) break;
+        while (left > 0 && (size_t)written >= cur->iov_len) {
+            written -= cur->iov_len;
+            cur++;
+            left--;
+        }
+        if (left > 0) {
+            cur->iov_base = (char*)cur->iov_base + written;
+            cur->iov_len -= written;
+        }
+    }
+    *count = 0;
+}
+
+static void push_iov(int fd, struct iovec* iov, int* count, const char* base, size_t len) {
+    if (len == 0) return;
+    if (*count == SNIPPET_IOV_BATCH) flush_iov(fd, iov, count);
+    iov[*count].iov_base = (void*)base;
+    iov[*count].iov_len = len;
+    (*count)++;
+}
+
+void write_snippet(int fd, const MappedFile* file, int start_line, int end_line,
+                   const TextSpan* highlights, int highlight_count) {
+    if (!file || start_line < 1 || start_line > end_line) return;
+    if (end_line > file->line_count) end_line = file->line_count;
+
+    struct iovec iov[SNIPPET_IOV_BATCH];
+    int count = 0;
+    int h = 0;
+    for (int n = start_line; n <= end_line; ++n) {
+        LineView line = line_view(file, n);
+        long begin = line.text - file->data;
+        long end = begin + (long)line.length;
+        long cursor = begin;
+
+        // saltar resaltados anteriores a esta linea
+        while (h < highlight_count && highlights[h].offset + highlights[h].length <= begin) h++;
+
+        for (int k = h; k < highlight_count && highlights[k].offset < end; ++k) {
+            long from = highlights[k].offset > cursor ? highlights[k].offset : cursor;
+            long to = highlights[k].offset + highlights[k].length;
+            if (to > end) to = end;
+            if (to <= from) continue;
+
+            push_iov(fd, iov, &count, file->data + cursor, from - cursor);
+            push_iov(fd, iov, &count, HIGHLIGHT_ON, sizeof(HIGHLIGHT_ON) - 1);
+            push_iov(fd, iov, &count, file->data + from, to - from);
+            push_iov(fd, iov, &count, HIGHLIGHT_OFF, sizeof(HIGHLIGHT_OFF) - 1);
+            cursor = to;
+        }
+        push_iov(fd, iov, &count, file->data + cursor, end - cursor);
+        push_iov(fd, iov, &count, "\n", 1);
+    }
+    flush_iov(fd, iov, &count);
+}
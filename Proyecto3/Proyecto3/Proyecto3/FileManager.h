@@ -1,6 +1,39 @@
 #ifndef FILEMANAGER_H
 #define FILEMANAGER_H
 #include <stdio.h>
+#include <stddef.h>
+
+/* Directorio de los libros: open_file y map_file reciben nombres relativos a el */
+#define BOOKS_PATH "libros/"
+
+/**
+ * Documento mapeado en memoria (solo lectura) con su tabla de lineas.
+ * La linea n (1-based) empieza en data + line_starts[n - 1].
+ */
+typedef struct _MappedFile {
+    const char* data;
+    size_t size;
+    long* line_starts;
+    int line_count;
+    int line_capacity;   // lugares reservados en line_starts
+} MappedFile;
+
+/**
+ * Vista de una linea dentro de un MappedFile: puntero + largo, sin copiar
+ * y sin el fin de linea ('\n' o "\r\n").
+ */
+typedef struct _LineView {
+    const char* text;
+    size_t length;
+} LineView;
+
+/**
+ * Rango de bytes de un documento (por ejemplo una palabra a resaltar).
+ */
+typedef struct _TextSpan {
+    long offset;
+    long length;
+} TextSpan;
 
 /**
  * Print lines [start_line…end_line] de un FILE* abierto.
@@ -16,7 +49,39 @@ FILE* open_file(const char* path);
 
 /* obtiene las lineas completas (string) desde start_line hasta end_line, ambos incluidos
  * y devuelve un puntero a un array de punteros a char (array de strings)
+ * El array termina con NULL (las lineas vacias son "") y se libera con free_lines.
  */
 char** get_lines(FILE* file, int start_line, int end_line);
 
-#endif
\ No newline at end of file
+/* Libera el resultado de get_lines */
+void free_lines(char** lines);
+
+/**
+ * Mapea libros/<path> en memoria y construye su tabla de lineas.
+ * Devuelve NULL si no se pudo abrir o mapear.
+ */
+MappedFile* map_file(const char* path);
+
+/* Desmapea el archivo y libera la tabla de lineas */
+void unmap_file(MappedFile* file);
+
+/**
+ * Devuelve el número de línea (1-based) que contiene el byte offset
+ * (busqueda binaria en la tabla de lineas), o -1 si esta fuera del archivo.
+ */
+int line_of_offset(const MappedFile* file, long offset);
+
+/**
+ * Llena out con vistas de las lineas [start_line…end_line] sin copiar el texto.
+ * Devuelve la cantidad de vistas escritas (como maximo max_out).
+ */
+int get_line_views(const MappedFile* file, int start_line, int end_line, LineView* out, int max_out);
+
+/**
+ * Escribe las lineas [start_line…end_line] en fd con writev, directamente desde
+ * el mapeo, resaltando los rangos dados (ordenados por offset).
+ */
+void write_snippet(int fd, const MappedFile* file, int start_line, int end_line,
+                   const TextSpan* highlights, int highlight_count);
+
+#endif
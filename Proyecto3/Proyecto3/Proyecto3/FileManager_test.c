@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "FileManager.h"
+
+/* Compara la tabla de lineas del mapeo con la lectura secuencial via FILE* */
+int main(int argc, char** argv) {
+    const char* filename = argc > 1 ? argv[1] : "lobo.txt";
+
+    MappedFile* map = map_file(filename);
+    FILE* f = open_file(filename);
+    assert(map != NULL && f != NULL);
+    assert(map->line_count > 0);
+
+    // line_of_offset (busqueda binaria) == find_line_by_position (recorrido con fgetc)
+    for (long offset = 0; offset < (long)map->size; offset += 997) {
+        fseek(f, 0, SEEK_SET);
+        assert(line_of_offset(map, offset) == find_line_by_position(f, offset));
+    }
+    assert(line_of_offset(map, (long)map->size) == -1);
+    assert(line_of_offset(map, -1) == -1);
+
+    // get_lines (copia) y get_line_views (sin copia) devuelven el mismo texto
+    int first = map->line_count / 2;
+    int last = first + 40;
+    char** lines = get_lines(f, first, last);
+    LineView views[41];
+    int n = get_line_views(map, first, last, views, 41);
+    assert(lines != NULL && n == 41);
+    for (int i = 0; i < n; ++i) {
+        assert(lines[i] != NULL);
+        assert(strlen(lines[i]) == views[i].length);
+        assert(memcmp(lines[i], views[i].text, views[i].length) == 0);
+        assert(views[i].text >= map->data && views[i].text < map->data + map->size);
+    }
+    assert(lines[n] == NULL);
+    free_lines(lines);
+
+    // la ultima linea tambien se puede pedir, rangos fuera del archivo se recortan
+    n = get_line_views(map, map->line_count, map->line_count + 10, views, 41);
+    assert(n == 1);
+    assert(get_line_views(map, 5, 4, views, 41) == 0);
+
+    fclose(f);
+    unmap_file(map);
+    printf("All FileManager tests passed successfully.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+#include "BKTree/bktree.h"
+
+#define REPETITIONS 20
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Brute force baseline: compare the query against every key stored in the table */
+static int linear_scan(_HashTable* ht, const char* query, int max_distance) {
+    int found = 0;
+    int pos = 0;
+    char* clave;
+    while (HTNext(ht, &pos, &clave, NULL)) {
+        if (levenshtein_distance(query, clave, max_distance) <= max_distance) {
+            found++;
+        }
+    }
+    return found;
+}
+
+int main(int argc, char** argv) {
+    const char* filename = argc > 1 ? argv[1] : "DonQuijote.txt";
+    const char* queries[] = { "caualleros", "quixote", "dulzinea", "rozinante", "escudero",
+                              "hidalgo", "mancha", "vizcaino", "encantadores", "sanco" };
+    int query_count = sizeof(queries) / sizeof(queries[0]);
+
+    InvertedIndex* idx = II_Create();
+    if (II_LoadFile(idx, filename) < 0) {
+        fprintf(stderr, "Failed to load file: %s\n", filename);
+        II_Destroy(idx);
+        return EXIT_FAILURE;
+    }
+    printf("Dictionary: %d terms\n\n", HTSize(idx->table));
+
+    for (int d = 1; d <= FUZZY_MAX_DISTANCE; ++d) {
+        double tree_us = 0, scan_us = 0;
+        int tree_hits = 0, scan_hits = 0;
+
+        for (int r = 0; r < REPETITIONS; ++r) {
+            for (int q = 0; q < query_count; ++q) {
+                BKMatch matches[4096];
+                double t0 = now_us();
+                int n = bktree_search(idx->terms_tree, queries[q], d, matches, 4096);
+                double t1 = now_us();
+                int m = linear_scan(idx->table, queries[q], d);
+                double t2 = now_us();
+
+                tree_us += t1 - t0;
+                scan_us += t2 - t1;
+                if (r == 0) { tree_hits += n; scan_hits += m; }
+            }
+        }
+
+        int runs = REPETITIONS * query_count;
+        printf("distance %d: bktree %8.1f us/query, linear scan %8.1f us/query (%.1fx), matches %d vs %d\n",
+               d, tree_us / runs, scan_us / runs, scan_us / tree_us, tree_hits, scan_hits);
+    }
+
+    printf("\nBest candidates:\n");
+    for (int q = 0; q < query_count; ++q) {
+        termCandidate cands[FUZZY_MAX_CANDIDATES];
+        int n = II_FuzzyLookup(idx, queries[q], FUZZY_MAX_DISTANCE, cands, 3);
+        printf("  %-14s", queries[q]);
+        for (int i = 0; i < n; ++i) printf(" %s(d=%d, f=%d)", cands[i].term, cands[i].distance, cands[i].frequency);
+        printf("\n");
+    }
+
+    II_Destroy(idx);
+    return EXIT_SUCCESS;
+}
@@ -3,63 +3,34 @@
 #include "HashTable.h"
 #include "boolean.h"
 #include "confirm.h"
+#include "Allocator/allocator.h"
 
 /* Crea un HashTable, devuelve el puntero a la estructura creada*/
 HashTable HTCreate() {
-    _HashTable* table = malloc(sizeof(_HashTable));
+    return HTCreateWithCapacity(INITIAL_CAPACITY);
+}
+
+/* Crea un HashTable con la capacidad inicial dada*/
+HashTable HTCreateWithCapacity(int capacidad) {
+    _HashTable* table = mem_malloc(MEM_TABLE_SLOTS, sizeof(_HashTable));
     CONFIRM_RETVAL(table != NULL, NULL);
 
-    table->cap = INITIAL_CAPACITY;
+    table->cap = capacidad > 0 ? capacidad : INITIAL_CAPACITY;
     table->tam = 0;
-    table->arr = calloc(table->cap, sizeof(Celda*));
+    table->arr = mem_calloc(MEM_TABLE_SLOTS, table->cap, sizeof(Celda*));
     CONFIRM_RETVAL(table->arr != NULL, NULL);
+    table->old_arr = NULL;
+    table->old_cap = 0;
+    table->migrate_pos = 0;
+    table->incremental = TRUE;
+    table->resizes = 0;
 
     return table;
 }
 
-/**
- * Resize the table when load factor exceeds threshold.
- */
-static BOOLEAN _resize(HashTable p) {
-    int oldCap = p->cap;
-    int newCap = oldCap * 2 + 1;
-    Celda** oldArr = p->arr;
-    int oldSize = p->tam;
-
-    Celda** newArr = calloc(newCap, sizeof(Celda*));
-    CONFIRM_RETVAL(newArr != NULL, FALSE);
-
-    p->arr = newArr;
-    p->cap = newCap;
-    p->tam = 0;
-    
-    // reinsert existing entries
-    int idx;
-    for (idx = 0; idx < oldCap; idx++) {
-        Celda* cell = oldArr[idx];
-        if (cell != NULL && cell != TOMBSTONE) {
-            // Insert into new table with same key and value
-            BOOLEAN result = HTPut(p, cell->clave, cell->valor);
-            
-            // Clean up old cell
-            free(cell->clave);
-            free(cell);
-            
-            if (!result) {
-                // Restore old state on failure
-                free(p->arr);
-                p->arr = oldArr;
-                p->cap = oldCap;
-                p->tam = oldSize;
-                return FALSE;
-            }
-        } else if (cell == TOMBSTONE) {
-            // we'll just skip tombstones
-        }
-    }
-    free(oldArr);
-    
-    return TRUE;
+void HTSetIncrementalResize(HashTable p, BOOLEAN enabled) {
+    CONFIRM_RETURN(p != NULL);
+    p->incremental = enabled;
 }
 
 /**
@@ -90,6 +61,16 @@ long _stringLong(char* clave) {
     return (long)value;
 }
 
+/*
+funcion privada de ayuda
+posicion del intento i para una clave ya convertida con _stringLong
+*/
+static int _slot(unsigned long key, int cap, int i) {
+    unsigned long initial_position = key % cap;
+    unsigned long offset = (unsigned long)i * i;
+    return (int)((initial_position + offset) % cap);
+}
+
 /*
 funcion privada de ayuda
 devuelve el hash para cada intento de insercion/busqueda
@@ -97,28 +78,119 @@ devuelve el hash para cada intento de insercion/busqueda
 int _hash(HashTable hash_table, char* clave, int i) {
     // to avoid negatives, we use unsigned long for the hash generation
     unsigned long key = (unsigned long)_stringLong(clave);
-    int current_capacity = hash_table->cap;
+    return _slot(key, hash_table->cap, i);
+}
 
-    unsigned long initial_position = key % current_capacity;
-    unsigned long offset = (unsigned long)i * i;
-    return (int)((initial_position + offset) % current_capacity);
+/* Busca la clave en uno de los arreglos, devuelve su posicion o -1 */
+static int _lookup(Celda** arr, int cap, unsigned long key, char* clave) {
+    int i;
+    for (i = 0; i < cap; i++) {
+        int idx = _slot(key, cap, i);
+        Celda* cell = arr[idx];
+
+        if (cell == NULL) return -1;
+        if (cell != TOMBSTONE && strcmp(cell->clave, clave) == 0) return idx;
+    }
+    return -1;
+}
+
+/* Posiciones que _lookup revisa buscando la clave en uno de los arreglos */
+static int _probes(Celda** arr, int cap, unsigned long key, char* clave) {
+    int i;
+    for (i = 0; i < cap; i++) {
+        Celda* cell = arr[_slot(key, cap, i)];
+
+        if (cell == NULL) return i + 1;
+        if (cell != TOMBSTONE && strcmp(cell->clave, clave) == 0) return i + 1;
+    }
+    return cap;
+}
+
+/* Mueve hasta `buckets` posiciones de old_arr al arreglo nuevo (las celdas se mueven, no se copian).
+   Las posiciones migradas quedan como TOMBSTONE para no cortar las cadenas de sondeo
+   de las claves que todavia no se movieron */
+static void _migrate(HashTable p, int buckets) {
+    if (p->old_arr == NULL) return;
+
+    int end = p->migrate_pos + buckets;
+    if (end > p->old_cap) end = p->old_cap;
+    for (; p->migrate_pos < end; p->migrate_pos++) {
+        Celda* cell = p->old_arr[p->migrate_pos];
+        if (cell == NULL || cell == TOMBSTONE) continue;
+
+        unsigned long key = (unsigned long)_stringLong(cell->clave);
+        int i;
+        for (i = 0; i < p->cap; i++) {
+            int idx = _slot(key, p->cap, i);
+            if (p->arr[idx] == NULL || p->arr[idx] == TOMBSTONE) {
+                p->arr[idx] = cell;
+                break;
+            }
+        }
+        p->old_arr[p->migrate_pos] = TOMBSTONE;
+    }
+
+    if (p->migrate_pos == p->old_cap) {
+        mem_free(MEM_TABLE_SLOTS, p->old_arr, p->old_cap * sizeof(Celda*));
+        p->old_arr = NULL;
+        p->old_cap = 0;
+        p->migrate_pos = 0;
+    }
+}
+
+/**
+ * Grow the table to newCap (load factor exceeded, or HTReserve).
+ * The new array starts empty and old_arr is drained by _migrate: all at once, or a few
+ * buckets per write in incremental mode, so no single HTPut pays for the whole table.
+ */
+static BOOLEAN _resize(HashTable p, int newCap) {
+    // a resize still in progress is finished before starting the next one
+    _migrate(p, p->old_cap);
+
+    Celda** newArr = mem_calloc(MEM_TABLE_SLOTS, newCap, sizeof(Celda*));
+    CONFIRM_RETVAL(newArr != NULL, FALSE);
+
+    p->old_arr = p->arr;
+    p->old_cap = p->cap;
+    p->migrate_pos = 0;
+    p->arr = newArr;
+    p->cap = newCap;
+
+    if (!p->incremental) {
+        _migrate(p, p->old_cap);
+    }
+    return TRUE;
 }
 
 /* Agrega el valor con la clave dada en el hash table */
 BOOLEAN HTPut(HashTable p, char* clave, void* valor) {
     CONFIRM_RETVAL(p != NULL && clave != NULL, FALSE);
+    unsigned long key = (unsigned long)_stringLong(clave);
+
+    // while resizing, every write moves a few more buckets to the new array
+    _migrate(p, REHASH_STEP);
 
     // resize if load factor exceeded
     double load = (double)(p->tam + 1) / p->cap;
     if (load > REHASH_THRESHOLD) {
-        CONFIRM_RETVAL(_resize(p), FALSE);
+        CONFIRM_RETVAL(_resize(p, p->cap * 2 + 1), FALSE);
+        p->resizes++;
+    }
+
+    // a key not migrated yet is updated where it is (after a resize that is every key)
+    if (p->old_arr != NULL) {
+        int oldIdx = _lookup(p->old_arr, p->old_cap, key, clave);
+        if (oldIdx >= 0) {
+            p->old_arr[oldIdx]->valor = valor;
+            return TRUE;
+        }
     }
 
     // probe to find slot or existing key
     int firstTombstone = -1;
     int i;
     for (i = 0; i < p->cap; i++) {
-        int idx = _hash(p, clave, i);
+        int idx = _slot(key, p->cap, i);
         Celda* cell = p->arr[idx];
 
         if (cell == TOMBSTONE) {
@@ -129,10 +201,10 @@ BOOLEAN HTPut(HashTable p, char* clave, void* valor) {
             int insertIdx = (firstTombstone >= 0 ? firstTombstone : idx);
 
             // insert new cell
-            Celda* newCell = malloc(sizeof(Celda));
+            Celda* newCell = mem_malloc(MEM_TABLE_CELLS, sizeof(Celda));
             CONFIRM_RETVAL(newCell != NULL, FALSE);
 
-            newCell->clave = strdup(clave);
+            newCell->clave = mem_strdup(MEM_TABLE_KEYS, clave);
             CONFIRM_RETVAL(newCell->clave != NULL, FALSE);
 
             newCell->valor = valor;
@@ -149,19 +221,49 @@ BOOLEAN HTPut(HashTable p, char* clave, void* valor) {
     return FALSE;  // table full (shouldn't happen after resize)
 }
 
+/* Primo >= n, el sondeo cuadratico reparte mejor con capacidad prima */
+static int _nextPrime(int n) {
+    if (n <= 2) return 2;
+    if (n % 2 == 0) n++;
+    while (1) {
+        int d;
+        for (d = 3; d * d <= n && n % d != 0; d += 2) {
+        }
+        if (d * d > n) return n;
+        n += 2;
+    }
+}
+
+/* Agranda la tabla para `elementos` claves */
+BOOLEAN HTReserve(HashTable p, int elementos) {
+    CONFIRM_RETVAL(p != NULL && elementos >= 0, FALSE);
+
+    int needed = (int)(elementos / REHASH_THRESHOLD) + 1;
+    if (needed <= p->cap) return TRUE;
+    return _resize(p, _nextPrime(needed));
+}
+
+/* Migra lo que quede del arreglo anterior */
+void HTFinishResize(HashTable p) {
+    CONFIRM_RETURN(p != NULL);
+    _migrate(p, p->old_cap);
+}
+
 /* Obtiene el valor asociado a la clave dentro del HashTable */
 BOOLEAN HTGet(HashTable p, char* clave, void** retval) {
     CONFIRM_RETVAL(p != NULL && clave != NULL && retval != NULL, FALSE);
+    unsigned long key = (unsigned long)_stringLong(clave);
 
-    int i;
-    for (i = 0; i < p->cap; i++) {
-        int idx = _hash(p, clave, i);
-        Celda* cell = p->arr[idx];
-
-        if (cell == NULL) return FALSE;
-
-        if (cell != TOMBSTONE && strcmp(cell->clave, clave) == 0) {
-            *retval = cell->valor;
+    // lookups never migrate, so concurrent readers only read the table
+    int idx = _lookup(p->arr, p->cap, key, clave);
+    if (idx >= 0) {
+        *retval = p->arr[idx]->valor;
+        return TRUE;
+    }
+    if (p->old_arr != NULL) {
+        idx = _lookup(p->old_arr, p->old_cap, key, clave);
+        if (idx >= 0) {
+            *retval = p->old_arr[idx]->valor;
             return TRUE;
         }
     }
@@ -171,24 +273,24 @@ BOOLEAN HTGet(HashTable p, char* clave, void** retval) {
 /* Remueve el valor asociado a la clave pasada */
 BOOLEAN HTRemove(HashTable p, char* clave) {
     CONFIRM_RETVAL(p != NULL && clave != NULL, FALSE);
-    
-    int i;
-    for (i = 0; i < p->cap; i++) {
-        int idx = _hash(p, clave, i);
+    unsigned long key = (unsigned long)_stringLong(clave);
 
-        Celda* cell = p->arr[idx];
-        if (cell == NULL) break;
-
-        if (cell != TOMBSTONE && strcmp(cell->clave, clave) == 0) {
-            // Free the cell and mark as tombstone
-            free(cell->clave);
-            free(cell);
-            p->arr[idx] = TOMBSTONE;
-            p->tam--;
-            return TRUE;
-        }
+    _migrate(p, REHASH_STEP);
+
+    Celda** arr = p->arr;
+    int idx = _lookup(p->arr, p->cap, key, clave);
+    if (idx < 0 && p->old_arr != NULL) {
+        arr = p->old_arr;
+        idx = _lookup(p->old_arr, p->old_cap, key, clave);
     }
-    return FALSE;
+    if (idx < 0) return FALSE;
+
+    // Free the cell and mark as tombstone
+    mem_free(MEM_TABLE_KEYS, arr[idx]->clave, strlen(arr[idx]->clave) + 1);
+    mem_free(MEM_TABLE_CELLS, arr[idx], sizeof(Celda));
+    arr[idx] = TOMBSTONE;
+    p->tam--;
+    return TRUE;
 }
 
 /* Devuelve TRUE si el HashTable contiene la clave*/
@@ -197,28 +299,61 @@ BOOLEAN HTContains(HashTable p, char* clave) {
     return HTGet(p, clave, &tmp);
 }
 
+int HTProbes(HashTable p, char* clave) {
+    CONFIRM_RETVAL(p != NULL && clave != NULL, 0);
+    unsigned long key = (unsigned long)_stringLong(clave);
+
+    int probes = _probes(p->arr, p->cap, key, clave);
+    if (p->old_arr != NULL && _lookup(p->arr, p->cap, key, clave) < 0) {
+        probes += _probes(p->old_arr, p->old_cap, key, clave);
+    }
+    return probes;
+}
+
 // Devuelve la cantidad de elementos (tamanho) cargados en el HashTable
 BOOLEAN HTSize(HashTable p) {
     CONFIRM_RETVAL(p != NULL, 0);
     return p->tam;
 }
 
-/* Destruye la estructura*/
-BOOLEAN HTDestroy(HashTable p) {
-    CONFIRM_RETVAL(p != NULL, FALSE);
+/* Recorre los elementos de arr y luego los de old_arr */
+BOOLEAN HTNext(HashTable p, int* pos, char** clave, void** valor) {
+    CONFIRM_RETVAL(p != NULL && pos != NULL, FALSE);
+
+    while (*pos < p->cap + p->old_cap) {
+        int i = (*pos)++;
+        Celda* cell = i < p->cap ? p->arr[i] : p->old_arr[i - p->cap];
+        if (cell != NULL && cell != TOMBSTONE) {
+            if (clave != NULL) *clave = cell->clave;
+            if (valor != NULL) *valor = cell->valor;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
 
+static void _freeCells(Celda** arr, int cap) {
     int i;
-    for (i = 0; i < p->cap; i++) {
-        Celda* cell = p->arr[i];
+    for (i = 0; i < cap; i++) {
+        Celda* cell = arr[i];
         if (cell != NULL && cell != TOMBSTONE) {
-            free(cell->clave);
-            free(cell);
+            mem_free(MEM_TABLE_KEYS, cell->clave, strlen(cell->clave) + 1);
+            mem_free(MEM_TABLE_CELLS, cell, sizeof(Celda));
         } else if (cell == TOMBSTONE) {
             // Don't need to free anything for tombstones, so just skip them
         }
     }
+}
+
+/* Destruye la estructura*/
+BOOLEAN HTDestroy(HashTable p) {
+    CONFIRM_RETVAL(p != NULL, FALSE);
+
+    _freeCells(p->arr, p->cap);
+    _freeCells(p->old_arr, p->old_cap);
 
-    free(p->arr);
-    free(p);
+    mem_free(MEM_TABLE_SLOTS, p->arr, p->cap * sizeof(Celda*));
+    mem_free(MEM_TABLE_SLOTS, p->old_arr, p->old_cap * sizeof(Celda*));
+    mem_free(MEM_TABLE_SLOTS, p, sizeof(_HashTable));
     return TRUE;
 }
\ No newline at end of file
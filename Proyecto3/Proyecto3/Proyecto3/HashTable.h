@@ -5,6 +5,7 @@
 #define INITIAL_CAPACITY 257  // default initial capacity for HashTable (Prime Number)
 #define REHASH_THRESHOLD 0.7  // load factor threshold to trigger resize
 #define TOMBSTONE ((Celda*)-1)
+#define REHASH_STEP 16        // buckets migrated per HTPut/HTRemove while an incremental resize is running
 
 
 /*
@@ -22,8 +23,13 @@ typedef struct _celda {
 
 typedef struct __HashTable{
 	Celda** arr; /*arreglo de void*  */
-	int tam;
+	int tam;     /* elementos en arr y old_arr juntos */
 	int cap;
+	Celda** old_arr;   /* arreglo anterior mientras dura un resize incremental, sino NULL */
+	int old_cap;
+	int migrate_pos;   /* siguiente bucket de old_arr a migrar */
+	BOOLEAN incremental;
+	int resizes;       /* veces que HTPut hizo crecer la tabla por superar REHASH_THRESHOLD */
 }_HashTable;
 
 typedef _HashTable* HashTable;
@@ -31,6 +37,18 @@ typedef _HashTable* HashTable;
 /* Crea un HashTable, devuelve el puntero a la estructura creada*/
 HashTable HTCreate();
 
+/* Crea un HashTable con la capacidad inicial dada (INITIAL_CAPACITY si es <= 0)*/
+HashTable HTCreateWithCapacity(int capacidad);
+
+/* Agranda la tabla de una vez para que entren `elementos` claves sin superar REHASH_THRESHOLD,
+   asi una carga de tamanho conocido no pasa por todos los resize intermedios.
+   Devuelve TRUE si tuvo exito (o si ya habia lugar), sino FALSE*/
+BOOLEAN HTReserve(HashTable p, int elementos);
+
+/* Termina de una vez el resize incremental en curso (si hay uno), por ejemplo al final de
+   una carga: HTGet no migra, asi que sin esto las busquedas seguirian mirando los dos arreglos*/
+void HTFinishResize(HashTable p);
+
 /* Agrega el valor con la clave dada en el hash table, en el caso de repetir la clave se sobreescriben los datos
    Devuelve TRUE si tuvo exito, sino FALSE*/
 BOOLEAN HTPut(HashTable p, char* clave, void* valor);
@@ -46,9 +64,23 @@ BOOLEAN HTRemove(HashTable p, char* clave);
 /* Devuelve TRUE si el HashTable contiene la clave*/
 BOOLEAN HTContains(HashTable p, char* clave);
 
+/* Devuelve cuantas posiciones revisa HTGet buscando la clave (este o no), contando
+   las del arreglo anterior durante un resize incremental*/
+int HTProbes(HashTable p, char* clave);
+
 /* Devuelve la cantidad de elementos (tamanho) cargados en el HashTable*/
 BOOLEAN HTSize(HashTable p);
 
+/* Elige como crece la tabla: con TRUE (por defecto) el arreglo nuevo se llena de a
+   REHASH_STEP buckets en cada HTPut/HTRemove y las busquedas consultan ambos arreglos;
+   con FALSE se migra todo de una vez al superar REHASH_THRESHOLD */
+void HTSetIncrementalResize(HashTable p, BOOLEAN enabled);
+
+/* Recorre los elementos: empezar con *pos = 0 y llamar mientras devuelva TRUE;
+   cada llamada deja la clave y el valor del siguiente elemento en clave/valor.
+   No se debe modificar la tabla durante el recorrido */
+BOOLEAN HTNext(HashTable p, int* pos, char** clave, void** valor);
+
 /* Destruye la estructura*/
 BOOLEAN HTDestroy(HashTable p);
 
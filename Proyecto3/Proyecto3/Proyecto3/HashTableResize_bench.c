@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "HashTable.h"
+
+/*
+ * Latencia por insercion de HTPut sobre un flujo de claves distintas, con el resize
+ * de una vez (toda la tabla se migra dentro de un HTPut) y con el resize incremental
+ * (REHASH_STEP buckets por operacion).
+ *
+ *   HashTableResize_bench [keys]      (por defecto 10M)
+ */
+
+#define DEFAULT_KEYS 10000000L
+#define SLOW_INSERT_NS 1000000L   /* inserciones de mas de 1 ms */
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static long now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static int compare_longs(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char* label, BOOLEAN incremental, long key_count, long* latencies) {
+    HashTable ht = HTCreate();
+    HTSetIncrementalResize(ht, incremental);
+
+    char key[32];
+    long slow = 0, worst_at = 0;
+    long start = now_ns();
+    for (long i = 0; i < key_count; ++i) {
+        snprintf(key, sizeof(key), "w%09ld", i);
+        long t0 = now_ns();
+        HTPut(ht, key, NULL);
+        latencies[i] = now_ns() - t0;
+        if (latencies[i] > SLOW_INSERT_NS) slow++;
+        if (latencies[i] > latencies[worst_at]) worst_at = i;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    int final_cap = ht->cap;
+    HTDestroy(ht);
+
+    long worst = latencies[worst_at];
+    qsort(latencies, key_count, sizeof(long), compare_longs);
+    printf("%-12s %8.2f s  mean %6.0f ns  p99 %6ld ns  p99.99 %8ld ns  max %10ld ns (insert #%ld)  >1ms: %ld  cap %d\n",
+           label, seconds, seconds * 1e9 / key_count,
+           latencies[key_count * 99 / 100], latencies[key_count * 9999 / 10000],
+           worst, worst_at, slow, final_cap);
+}
+
+int main(int argc, char** argv) {
+    long key_count = argc > 1 ? atol(argv[1]) : DEFAULT_KEYS;
+    if (key_count <= 0) {
+        printf("Usage: %s [keys]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    long* latencies = malloc(key_count * sizeof(long));
+    if (!latencies) {
+        fprintf(stderr, "No hay memoria para %ld latencias\n", key_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("%ld claves distintas, REHASH_STEP = %d\n", key_count, REHASH_STEP);
+    run("de una vez", FALSE, key_count, latencies);
+    run("incremental", TRUE, key_count, latencies);
+
+    free(latencies);
+    return EXIT_SUCCESS;
+}
@@ -3,217 +3,1127 @@
     #include <string.h>
     #include <ctype.h>
     #include <stdint.h>
+    #include <math.h>
+    #include <time.h>
     #include "InvertedIndex.h"
     #include "HashTable.h"
     #include "ArrayList/arraylist.h"
     #include "Occurrence/occurrence.h"
-    #include "FileManager.h"  // provides open_file, print_lines, find_line_by_position
+    #include "Allocator/allocator.h"
+    #include "FileManager.h"  // provides open_file, map_file, line_of_offset
+    #include "Stem.h"
 
 
 
-    int compare_positions(const void* a, const void* b) {
-        long pa = (long)(uintptr_t)a;
-        long pb = (long)(uintptr_t)b;
-        return (pa < pb) ? -1 : (pa > pb);
+    // The table stores id + 1, a value of 0 would be a NULL pointer. A frozen index asks the
+    // perfect hash for the only slot key can be in and compares the word stored there
+    static TermId find_term(const InvertedIndex* idx, const char* key) {
+        if (idx->frozen_terms) {
+            uint32_t slot = PH_Lookup(idx->frozen_terms, key);
+            if (slot == PH_NONE || strcmp(idx->terms.words + idx->terms.word_offsets[slot], key) != 0) return TERM_NONE;
+            return slot;
+        }
+        void* val = NULL;
+        if (!HTGet(idx->table, (char*)key, &val)) return TERM_NONE;
+        return (TermId)((intptr_t)val - 1);
     }
 
-    static void add_word_occurrence(InvertedIndex* idx, const char* word, int file_id, long position) {
-        void* val = NULL;
+    static OccurrenceList* lookup_postings(const InvertedIndex* idx, const char* key) {
+        TermId term = find_term(idx, key);
+        return term == TERM_NONE ? NULL : &idx->terms.postings[term];
+    }
 
-        if (HTContains(idx->table, (char*)word)) {
-            HTGet(idx->table, (char*)word, &val);
-            OccurrenceList* list = (OccurrenceList*)val;
-            AddPositionToDocument(list, file_id, position);
+    // Move both arrays to blocks of capacity ids. Both are allocated before either is
+    // replaced, so on failure the table and its accounting are left as they were
+    static BOOLEAN resize_terms(TermTable* terms, TermId capacity) {
+        OccurrenceList* postings = mem_malloc(MEM_TERMS, capacity * sizeof(OccurrenceList));
+        uint32_t* offsets = mem_malloc(MEM_TERMS, capacity * sizeof(uint32_t));
+        if (!postings || !offsets) {
+            mem_free(MEM_TERMS, postings, capacity * sizeof(OccurrenceList));
+            mem_free(MEM_TERMS, offsets, capacity * sizeof(uint32_t));
+            return FALSE;
+        }
+        TermId kept = terms->count < capacity ? terms->count : capacity;
+        if (kept > 0) {
+            memcpy(postings, terms->postings, kept * sizeof(OccurrenceList));
+            memcpy(offsets, terms->word_offsets, kept * sizeof(uint32_t));
+        }
+        mem_free(MEM_TERMS, terms->postings, terms->capacity * sizeof(OccurrenceList));
+        mem_free(MEM_TERMS, terms->word_offsets, terms->capacity * sizeof(uint32_t));
+        terms->postings = postings;
+        terms->word_offsets = offsets;
+        terms->capacity = capacity;
+        return TRUE;
+    }
 
-        } else {
-            // create new occurrence list
-            OccurrenceList* list = malloc(sizeof(OccurrenceList));
-            list->first = NULL;
-            list->last = NULL;
-            list->count = 0;
-
-            // first occurrence
-            Occurrence* occ = malloc(sizeof(Occurrence));
-            occ->doc_id = file_id;
-            occ->positions_list = arraylist_create(11, sizeof(void*));
-            if (occ->positions_list == NULL) {
-                fprintf(stderr, "ERROR: arraylist_create devolvió NULL\n");
-                exit(1);
-            }
-            if (occ->positions_list->data == NULL) {
-                fprintf(stderr, "ERROR: arraylist_create data=NULL\n");
+    // Room for capacity ids; the lists move, nothing points into the array between loads
+    static BOOLEAN reserve_terms(TermTable* terms, TermId capacity) {
+        if (capacity <= terms->capacity) return TRUE;
+        return resize_terms(terms, capacity);
+    }
+
+    // Give back the ids the vocabulary estimate reserved and the file didn't use
+    // (without memory for the copies the larger arrays are kept)
+    static void trim_terms(TermTable* terms) {
+        if (terms->count == 0 || terms->count == terms->capacity) return;
+        resize_terms(terms, terms->count);
+    }
+
+    // Copy a key to the end of the word arena; returns its offset
+    static uint32_t append_word(TermTable* terms, const char* key, size_t length) {
+        if (terms->words_size + length > terms->words_capacity) {
+            size_t capacity = terms->words_capacity ? terms->words_capacity * 2 : 4096;
+            while (capacity < terms->words_size + length) capacity *= 2;
+            char* words = mem_realloc(MEM_TERMS, terms->words, terms->words_capacity, capacity);
+            if (!words) {
+                fprintf(stderr, "ERROR: sin memoria para el diccionario\n");
                 exit(1);
             }
+            terms->words = words;
+            terms->words_capacity = capacity;
+        }
+        memcpy(terms->words + terms->words_size, key, length);
+        terms->words_size += length;
+        return (uint32_t)(terms->words_size - length);
+    }
+
+    // Id of a dictionary key, interned (a free id, or the next one) the first time it is seen.
+    // key is word itself or, with stemming, its stem; fuzzy lookups suggest words, not stems
+    static TermId intern_term(InvertedIndex* idx, const char* key, const char* word) {
+        TermId term = find_term(idx, key);
+        if (term != TERM_NONE) return term;
 
-            void* tmp = (void*)(uintptr_t)position;
-            if (&tmp == NULL) {
-                fprintf(stderr, "ERROR: posición nula\n");
+        TermTable* terms = &idx->terms;
+        size_t length = strlen(key) + 1;
+        if (termvec_size(&terms->free_ids) > 0) {
+            term = termvec_get(&terms->free_ids, --terms->free_ids.size);
+            // a free id's word is dead, the new one takes its place when it fits
+            char* old = terms->words + terms->word_offsets[term];
+            if (strlen(old) + 1 >= length) memcpy(old, key, length);
+            else terms->word_offsets[term] = append_word(terms, key, length);
+        } else {
+            if (terms->count == terms->capacity &&
+                !reserve_terms(terms, terms->capacity ? terms->capacity * 2 : INITIAL_TERM_CAPACITY)) {
+                fprintf(stderr, "ERROR: sin memoria para el diccionario\n");
                 exit(1);
             }
-            arraylist_add(occ->positions_list, &tmp);
-            occ->next = NULL;
-            list->first = occ;
-            list->last = occ;
-            list->count = 1;
+            term = terms->count++;
+            terms->word_offsets[term] = append_word(terms, key, length);
+        }
+        InitOccurrenceList(&terms->postings[term]);
 
-            // insert into hashtable
-            char* key = strdup(word);
-            HTPut(idx->table, key, list);
+        // HTPut keeps its own copy of the key
+        HTPut(idx->table, (char*)key, (void*)(intptr_t)(term + 1));
+        bktree_add(idx->terms_tree, word);
+        return term;
+    }
 
+    // Postings only keep the ordinal, token_offsets maps it back to the byte offset
+    static void add_word_occurrence(InvertedIndex* idx, TermId term, int file_id, long ordinal) {
+        if (!AddTokenToDocument(&idx->terms.postings[term], file_id, ordinal)) {
+            fprintf(stderr, "ERROR: AddTokenToDocument falló\n");
+            exit(1);
         }
     }
 
+    static void free_terms(TermTable* terms) {
+        mem_free(MEM_TERMS, terms->postings, terms->capacity * sizeof(OccurrenceList));
+        mem_free(MEM_TERMS, terms->word_offsets, terms->capacity * sizeof(uint32_t));
+        mem_free(MEM_TERMS, terms->words, terms->words_capacity);
+    }
+
     InvertedIndex* II_Create() {
-        InvertedIndex* idx = malloc(sizeof(InvertedIndex));
-        idx->table = HTCreate(1024);
-        for (int i = 0; i < MAX_OPEN_FILES; ++i) idx->opened_files[i] = NULL;
+        InvertedIndex* idx = mem_malloc(MEM_TERMS, sizeof(InvertedIndex));
+        idx->table = HTCreateWithCapacity(INITIAL_TERM_CAPACITY);
+        idx->terms_tree = bktree_create();
+        memset(&idx->terms, 0, sizeof(idx->terms));
+        termvec_init(&idx->terms.free_ids);
+        idx->frozen_terms = NULL;
+        for (int i = 0; i < MAX_OPEN_FILES; ++i) {
+            idx->opened_files[i] = NULL;
+            idx->documents[i] = NULL;
+            idx->file_names[i] = NULL;
+            idx->token_offsets[i] = NULL;
+            idx->trigrams[i] = NULL;
+        }
         idx->last_file_index = -1;
+        idx->index_short_words = FALSE;
+        idx->presize = TRUE;
+        idx->token_table_grows = 0;
+        idx->hybrid_postings = TRUE;
+        idx->load_tokenizers = 0;
+        memset(&idx->last_load, 0, sizeof(idx->last_load));
+        idx->trigram_index = FALSE;
+        idx->stemming = FALSE;
         return idx;
     }
 
     void II_Destroy(InvertedIndex* idx) {
         if (!idx) return;
 
-        for (int i = 0; i < idx->table->cap; ++i) {
-            Celda* cell = idx->table->arr[i];
-            if (cell != NULL && cell != TOMBSTONE) {
-                FreeOccurrenceList((OccurrenceList*)cell->valor);
-            }
-        }
+        for (TermId t = 0; t < idx->terms.count; ++t) ClearOccurrenceList(&idx->terms.postings[t]);
+        free_terms(&idx->terms);
+        termvec_free(&idx->terms.free_ids);
 
-        HTDestroy(idx->table);
+        if (idx->table) HTDestroy(idx->table);
+        PH_Destroy(idx->frozen_terms);
+        bktree_destroy(idx->terms_tree);
 
         for (int f = 0; f <= idx->last_file_index; ++f) {
             if (idx->opened_files[f]) {
                 fclose(idx->opened_files[f]);
             }
+            unmap_file(idx->documents[f]);
+            if (idx->file_names[f]) mem_free(MEM_TERMS, idx->file_names[f], strlen(idx->file_names[f]) + 1);
+            arraylist_destroy(idx->token_offsets[f]);
+            TG_Destroy(idx->trigrams[f]);
         }
 
-        free(idx);
+        mem_free(MEM_TERMS, idx, sizeof(InvertedIndex));
     }
 
-    int II_LoadFile(InvertedIndex* idx, const char* fileName) {
-        if (idx->last_file_index + 1 >= MAX_OPEN_FILES) return -1;
+    void II_SetIndexShortWords(InvertedIndex* idx, BOOLEAN enabled) {
+        if (idx) idx->index_short_words = enabled;
+    }
 
-        FILE* f = open_file(fileName);
-        if (!f) return -1;
+    void II_SetPresize(InvertedIndex* idx, BOOLEAN enabled) {
+        if (idx) idx->presize = enabled;
+    }
 
-        int id = ++idx->last_file_index;
-        idx->opened_files[id] = f;
+    void II_SetHybridPostings(InvertedIndex* idx, BOOLEAN enabled) {
+        if (idx) idx->hybrid_postings = enabled;
+    }
 
+    void II_SetLoadPipeline(InvertedIndex* idx, int tokenizers) {
+        if (!idx) return;
+        if (tokenizers > PIPELINE_MAX_TOKENIZERS) tokenizers = PIPELINE_MAX_TOKENIZERS;
+        idx->load_tokenizers = tokenizers > 0 ? tokenizers : 0;
+    }
+
+    void II_SetTrigramIndex(InvertedIndex* idx, BOOLEAN enabled) {
+        if (idx) idx->trigram_index = enabled;
+    }
+
+    void II_SetStemming(InvertedIndex* idx, BOOLEAN enabled) {
+        if (idx) idx->stemming = enabled;
+    }
+
+    size_t II_PostingsMemory(const InvertedIndex* idx) {
+        if (!idx) return 0;
+        size_t bytes = (size_t)idx->terms.capacity * sizeof(OccurrenceList);
+        for (TermId t = 0; t < idx->terms.count; ++t) {
+            for (const Occurrence* cur = idx->terms.postings[t].first; cur; cur = cur->next) bytes += GetOccurrenceMemory(cur);
+        }
+        return bytes;
+    }
+
+    // The postings of a file are complete once it is loaded: move them to PostingSets.
+    // Documents are appended in order, so the file's occurrence is the last of every list
+    // (unless the file was reloaded after others were loaded)
+    static void freeze_postings(InvertedIndex* idx, int id) {
+        for (TermId t = 0; t < idx->terms.count; ++t) {
+            OccurrenceList* list = &idx->terms.postings[t];
+            Occurrence* occurrence = list->last;
+            if (occurrence && occurrence->doc_id > id) occurrence = FindOccurrenceByDocId(list, id);
+            if (occurrence && occurrence->doc_id == id) FreezeOccurrence(occurrence);  // stays unfrozen on failure
+        }
+    }
+
+    // Drop every posting of file id; terms left without postings leave the dictionary and
+    // their ids are handed out again (the BK-tree keeps them, fuzzy lookups skip terms
+    // without postings)
+    static void remove_postings(InvertedIndex* idx, int id) {
+        TermTable* terms = &idx->terms;
+        for (TermId t = 0; t < terms->count; ++t) {
+            OccurrenceList* list = &terms->postings[t];
+            if (!RemoveDocument(list, id) || list->count > 0) continue;
+            // HTRemove frees the table's copy of the key
+            HTRemove(idx->table, terms->words + terms->word_offsets[t]);
+            if (!termvec_push(&terms->free_ids, t)) {
+                fprintf(stderr, "ERROR: sin memoria para el diccionario\n");
+                exit(1);
+            }
+        }
+    }
+
+    // One token of file id: its offset goes to the token table, its word to the postings
+    static void index_token(InvertedIndex* idx, int id, ArrayList* tokens, const char* word,
+                            long offset, long length, long ordinal) {
+        if (tokens->size == tokens->capacity) idx->token_table_grows++;
+        arraylist_add(tokens, &offset);
+        if (length < WORD_MIN_LENGTH && !idx->index_short_words) return;
+        if (!idx->stemming) {
+            add_word_occurrence(idx, intern_term(idx, word, word), id, ordinal);
+            return;
+        }
+        char stem[MAX_WORD_LENGTH + 1];
+        strcpy(stem, word);
+        ST_Stem(stem);
+        add_word_occurrence(idx, intern_term(idx, stem, word), id, ordinal);
+    }
+
+    // Tokenize on the calling thread, straight from the mapping
+    static void load_serial(InvertedIndex* idx, int id, const MappedFile* doc, ArrayList* tokens) {
+        char word[MAX_WORD_LENGTH + 1];
+        int len = 0;
         long pos = 0;
         long word_start = -1;
-        printf("Cargando archivo id=%d…\n", id);
+        long ordinal = 0;  // every alphabetic run is a token, indexed or not
         int ch;
-        while ((ch = fgetc(f)) != EOF) {
-            long pos = ftell(f) - 1;
+        do {
+            // EOF closes the last word
+            ch = (size_t)pos < doc->size ? (unsigned char)doc->data[pos] : EOF;
 
-            if (isalpha(ch)) {
-                if (word_start < 0) word_start = pos;
-            } else {
-                if (word_start >= 0 && pos - word_start >= WORD_MIN_LENGTH) {
-                    long len = pos - word_start;
-                    char* word = malloc(len + 1);
-                    fseek(f, word_start, SEEK_SET);
-                    fread(word, 1, len, f);
-                    word[len] = '\0';
-
-                    for (long i = 0; i < len; ++i) word[i] = tolower((unsigned char)word[i]);
-                    add_word_occurrence(idx, word, id, word_start);
-                    free(word);
-                    fseek(f, pos + 1, SEEK_SET);
+            if (ch != EOF && isalpha(ch)) {
+                if (word_start < 0) {
+                    word_start = pos;
+                    len = 0;
                 }
+                if (len < MAX_WORD_LENGTH) word[len++] = tolower(ch);
+            } else if (word_start >= 0) {
+                word[len] = '\0';
+                index_token(idx, id, tokens, word, word_start, pos - word_start, ordinal++);
                 word_start = -1;
             }
             pos++;
+        } while (ch != EOF);
+    }
+
+    // Indexer stage of a pipelined load: batches arrive in file order
+    typedef struct _LoadState {
+        InvertedIndex* idx;
+        int id;
+        ArrayList* tokens;
+        long ordinal;
+        long batches;
+    } LoadState;
+
+    static void index_batch(const TokenBatch* batch, void* context) {
+        LoadState* state = context;
+        state->batches++;
+        for (size_t i = 0; i < batch->count; ++i) {
+            const TokenRecord* record = &batch->records[i];
+            index_token(state->idx, state->id, state->tokens, batch->words + record->word,
+                        record->offset, (long)record->length, state->ordinal++);
+        }
+    }
+
+    long II_EstimateTokens(size_t bytes) {
+        return (long)(bytes / BYTES_PER_TOKEN);
+    }
+
+    long II_EstimateVocabulary(long tokens) {
+        if (tokens <= 0) return 0;
+        return (long)(HEAPS_K * pow((double)tokens, HEAPS_BETA));
+    }
+
+    // Open and map a file, with its token table sized for it; FALSE (nothing kept) on error
+    static BOOLEAN open_document(InvertedIndex* idx, const char* fileName, FILE** f, MappedFile** doc, ArrayList** tokens) {
+        *f = open_file(fileName);
+        if (!*f) return FALSE;
+        *doc = map_file(fileName);
+
+        // with presizing the token table and the dictionary are allocated once for the whole file
+        size_t token_capacity = 1024;
+        if (idx->presize && *doc) {
+            long loaded = 0;
+            for (int i = 0; i <= idx->last_file_index; ++i) loaded += (long)arraylist_size(idx->token_offsets[i]);
+            long expected = II_EstimateTokens((*doc)->size);
+            long vocabulary = II_EstimateVocabulary(loaded + expected);
+            HTReserve(idx->table, (int)vocabulary);
+            reserve_terms(&idx->terms, (TermId)vocabulary);  // on failure ids grow one doubling at a time
+            token_capacity = (size_t)expected + 1;
+        }
+        *tokens = arraylist_create(token_capacity, sizeof(long));
+        if (!*doc || !*tokens) {
+            fclose(*f);
+            unmap_file(*doc);
+            arraylist_destroy(*tokens);
+            return FALSE;
         }
+        return TRUE;
+    }
+
+    // Tokenize file id (already opened into its slot) into the postings and its token table
+    static void index_document(InvertedIndex* idx, int id) {
+        FILE* f = idx->opened_files[id];
+        const MappedFile* doc = idx->documents[id];
+        ArrayList* tokens = idx->token_offsets[id];
+        BOOLEAN serial = idx->load_tokenizers <= 0;
+        if (!serial) {
+            LoadState state = { idx, id, tokens, 0, 0 };
+            if (PL_Tokenize(fileno(f), doc->size, idx->load_tokenizers, MAX_WORD_LENGTH,
+                            index_batch, &state, &idx->last_load) < 0) {
+                // a pipeline that never started leaves the file to the serial loader
+                if (state.batches == 0) serial = TRUE;
+                else fprintf(stderr, "ERROR: lectura incompleta de '%s'\n", idx->file_names[id]);
+            }
+        }
+        if (serial) load_serial(idx, id, doc, tokens);
+
+        // the estimate errs on the large side, give back what wasn't used
+        arraylist_trim_to_size(tokens);
+        trim_terms(&idx->terms);
+        // lookups don't migrate: a resize still running would leave them probing two arrays
+        HTFinishResize(idx->table);
+        if (idx->hybrid_postings) freeze_postings(idx, id);
+
+        // without memory for it the document is scanned by substring searches
+        TG_Destroy(idx->trigrams[id]);
+        idx->trigrams[id] = idx->trigram_index ? TG_Build(doc->data, doc->size) : NULL;
+    }
+
+    int II_LoadFile(InvertedIndex* idx, const char* fileName) {
+        if (idx->frozen_terms || idx->last_file_index + 1 >= MAX_OPEN_FILES) return -1;
+
+        FILE* f;
+        MappedFile* doc;
+        ArrayList* tokens;
+        if (!open_document(idx, fileName, &f, &doc, &tokens)) return -1;
+        char* name = mem_strdup(MEM_TERMS, fileName);
+        if (!name) {
+            fclose(f);
+            unmap_file(doc);
+            arraylist_destroy(tokens);
+            return -1;
+        }
+
+        int id = ++idx->last_file_index;
+        idx->opened_files[id] = f;
+        idx->documents[id] = doc;
+        idx->file_names[id] = name;
+        idx->token_offsets[id] = tokens;
+
+        printf("Cargando archivo id=%d…\n", id);
+        index_document(idx, id);
         return id;
     }
 
-    void normalize_words(char* words[], int word_count) {
-        for (int w = 0; w < word_count; ++w) {
-            char *word = words[w];
-            size_t len = strlen(word);
-            for (size_t i = 0; i < len; ++i) {
-                word[i] = tolower((unsigned char)word[i]);
+    int II_FindFile(const InvertedIndex* idx, const char* fileName) {
+        if (!idx || !fileName) return -1;
+        for (int id = 0; id <= idx->last_file_index; ++id) {
+            if (strcmp(idx->file_names[id], fileName) == 0) return id;
+        }
+        return -1;
+    }
+
+    int II_ReloadFile(InvertedIndex* idx, const char* fileName) {
+        if (idx->frozen_terms) return -1;
+        int id = II_FindFile(idx, fileName);
+        if (id < 0) return II_LoadFile(idx, fileName);
+
+        // the new contents are opened first, so a failure leaves the old ones indexed
+        FILE* f;
+        MappedFile* doc;
+        ArrayList* tokens;
+        if (!open_document(idx, fileName, &f, &doc, &tokens)) return -1;
+
+        remove_postings(idx, id);
+        fclose(idx->opened_files[id]);
+        unmap_file(idx->documents[id]);
+        arraylist_destroy(idx->token_offsets[id]);
+        idx->opened_files[id] = f;
+        idx->documents[id] = doc;
+        idx->token_offsets[id] = tokens;
+
+        printf("Recargando archivo id=%d…\n", id);
+        index_document(idx, id);
+        return id;
+    }
+
+    int II_Freeze(InvertedIndex* idx) {
+        if (!idx) return -1;
+        if (idx->frozen_terms) return 0;
+
+        TermTable* terms = &idx->terms;
+        TermId live = terms->count - (TermId)termvec_size(&terms->free_ids);
+        const char** keys = malloc(((size_t)live + 1) * sizeof(char*));
+        TermId* ids = malloc(((size_t)live + 1) * sizeof(TermId));
+        uint32_t* slots = malloc(((size_t)live + 1) * sizeof(uint32_t));
+        OccurrenceList* postings = mem_malloc(MEM_TERMS, ((size_t)live + 1) * sizeof(OccurrenceList));
+        uint32_t* offsets = mem_malloc(MEM_TERMS, ((size_t)live + 1) * sizeof(uint32_t));
+        size_t words_capacity = terms->words_size + 1;
+        char* words = mem_malloc(MEM_TERMS, words_capacity);
+        PerfectHash* hash = NULL;
+        if (keys && ids && slots && postings && offsets && words) {
+            TermId n = 0;
+            for (TermId t = 0; t < terms->count; ++t) {
+                if (terms->postings[t].count == 0) continue;
+                keys[n] = terms->words + terms->word_offsets[t];
+                ids[n++] = t;
+            }
+            hash = PH_Build(keys, live, slots);
+        }
+        if (!hash) {
+            free(keys);
+            free(ids);
+            free(slots);
+            mem_free(MEM_TERMS, postings, ((size_t)live + 1) * sizeof(OccurrenceList));
+            mem_free(MEM_TERMS, offsets, ((size_t)live + 1) * sizeof(uint32_t));
+            mem_free(MEM_TERMS, words, words_capacity);
+            return -1;
+        }
+
+        // ids become slots; the words are packed in slot order, without the dead ones
+        for (TermId i = 0; i < live; ++i) {
+            postings[slots[i]] = terms->postings[ids[i]];
+            offsets[slots[i]] = ids[i];   // the old id until the words are packed
+        }
+        size_t size = 0;
+        for (TermId s = 0; s < live; ++s) {
+            const char* word = terms->words + terms->word_offsets[offsets[s]];
+            size_t length = strlen(word) + 1;
+            memcpy(words + size, word, length);
+            offsets[s] = (uint32_t)size;
+            size += length;
+        }
+        // the dead words of reloads are not kept
+        char* packed = size > 0 ? mem_realloc(MEM_TERMS, words, words_capacity, size) : NULL;
+        if (packed) {
+            words = packed;
+            words_capacity = size;
+        }
+        free_terms(terms);
+        terms->postings = postings;
+        terms->word_offsets = offsets;
+        terms->words = words;
+        terms->words_size = size;
+        terms->words_capacity = words_capacity;
+        terms->count = live;
+        terms->capacity = live + 1;
+        termvec_free(&terms->free_ids);
+
+        HTDestroy(idx->table);
+        idx->table = NULL;
+        idx->frozen_terms = hash;
+        free(keys);
+        free(ids);
+        free(slots);
+        return 0;
+    }
+
+    size_t II_DictionaryMemory(const InvertedIndex* idx) {
+        if (!idx) return 0;
+        size_t bytes = idx->terms.words_capacity + (size_t)idx->terms.capacity * sizeof(uint32_t) +
+                       termvec_heap_bytes(&idx->terms.free_ids);
+        if (idx->frozen_terms) return bytes + PH_Memory(idx->frozen_terms);
+
+        bytes += ((size_t)idx->table->cap + (idx->table->old_arr ? (size_t)idx->table->old_cap : 0)) * sizeof(Celda*);
+        int pos = 0;
+        char* key;
+        while (HTNext(idx->table, &pos, &key, NULL)) bytes += sizeof(Celda) + strlen(key) + 1;
+        return bytes;
+    }
+
+    void II_MemoryReport(const InvertedIndex* idx, MemoryReport* report) {
+        memset(report, 0, sizeof(*report));
+        for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) mem_stats((MemTag)tag, &report->tags[tag]);
+        mem_total(&report->total);
+        if (!idx) return;
+
+        const TermTable* terms = &idx->terms;
+        if (idx->table) {
+            int slots = idx->table->cap + (idx->table->old_arr ? idx->table->old_cap : 0);
+            report->slack[MEM_TABLE_SLOTS] = (size_t)(slots - HTSize(idx->table)) * sizeof(Celda*);
+        }
+        report->slack[MEM_TERMS] = (size_t)(terms->capacity - terms->count) * (sizeof(OccurrenceList) + sizeof(uint32_t)) +
+                                   (terms->words_capacity - terms->words_size);
+        if (termvec_heap_bytes(&terms->free_ids) > 0) {
+            report->slack[MEM_TERMS] += termvec_heap_bytes(&terms->free_ids) - termvec_size(&terms->free_ids) * sizeof(TermId);
+        }
+        for (TermId t = 0; t < terms->count; ++t) {
+            for (const Occurrence* cur = terms->postings[t].first; cur; cur = cur->next) {
+                report->slack[MEM_ORDINALS] += GetOccurrenceSlack(cur);
+            }
+        }
+        for (int f = 0; f <= idx->last_file_index; ++f) {
+            const ArrayList* tokens = idx->token_offsets[f];
+            if (tokens) report->slack[MEM_ARRAYLIST_DATA] += (tokens->capacity - tokens->size) * tokens->element_size;
+        }
+        for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) report->total_slack += report->slack[tag];
+    }
+
+    size_t II_Compact(InvertedIndex* idx) {
+        if (!idx) return 0;
+        size_t released = 0;
+        TermTable* terms = &idx->terms;
+        for (TermId t = 0; t < terms->count; ++t) {
+            for (Occurrence* cur = terms->postings[t].first; cur; cur = cur->next) released += TrimOccurrence(cur);
+        }
+        for (int f = 0; f <= idx->last_file_index; ++f) {
+            ArrayList* tokens = idx->token_offsets[f];
+            if (!tokens) continue;
+            size_t before = tokens->capacity;
+            if (arraylist_trim_to_size(tokens) && tokens->capacity < before) {
+                released += (before - tokens->capacity) * tokens->element_size;
+            }
+        }
+
+        TermId capacity = terms->capacity;
+        trim_terms(terms);
+        released += (size_t)(capacity - terms->capacity) * (sizeof(OccurrenceList) + sizeof(uint32_t));
+        if (terms->words_size > 0 && terms->words_size < terms->words_capacity) {
+            char* words = mem_realloc(MEM_TERMS, terms->words, terms->words_capacity, terms->words_size);
+            if (words) {
+                released += terms->words_capacity - terms->words_size;
+                terms->words = words;
+                terms->words_capacity = terms->words_size;
+            }
+        }
+        released += termvec_shrink(&terms->free_ids);
+        return released;
+    }
+
+    // Lowercase copy of a query word into dest (MAX_WORD_LENGTH + 1 bytes), truncated like
+    // the loader truncates tokens. The caller's string is never modified
+    static void normalize_word(char* dest, const char* word) {
+        int len = 0;
+        while (word[len] && len < MAX_WORD_LENGTH) {
+            dest[len] = tolower((unsigned char)word[len]);
+            len++;
+        }
+        dest[len] = '\0';
+    }
+
+    // Dictionary key of a query word: normalized and, if the index is stemmed, stemmed
+    static void term_key(const InvertedIndex* idx, char* dest, const char* word) {
+        normalize_word(dest, word);
+        if (idx->stemming) ST_Stem(dest);
+    }
+
+    // Move every cursor to the first document >= doc that all of them contain.
+    // Returns that document or -1 when one of the cursors is exhausted
+    static int align_cursors(PostingCursor* cursors, int n, int doc) {
+        while (1) {
+            int next = doc;
+            for (int i = 0; i < n && next >= 0; ++i) {
+                int d = CursorSeekDocument(&cursors[i], doc);
+                if (d < 0 || d > next) next = d;
             }
+            if (next == doc || next < 0) return next;
+            doc = next;
         }
     }
-        
-    printData* II_Search(InvertedIndex* idx, char* words[], int word_count, int* out_count) {
-        normalize_words(words, word_count);
-        // retrieve lists
-        OccurrenceList** lists = malloc(sizeof(*lists) * word_count);
+
+    static long now_ns(void) {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec * 1000000000L + t.tv_nsec;
+    }
+
+    // Fill a result with the lines holding the tokens first_ord and last_ord of doc
+    static printData resolve_lines(const InvertedIndex* idx, int doc, long first_ord, long last_ord) {
+        ArrayList* tokens = idx->token_offsets[doc];
+        long first = *(long*)arraylist_get(tokens, first_ord);
+        long last = *(long*)arraylist_get(tokens, last_ord);
+
+        // binary searches on the line table, the text is never read
+        int first_line = line_of_offset(idx->documents[doc], first);
+        int last_line = line_of_offset(idx->documents[doc], last);
+        return (printData){ doc, first_line, last_line };
+    }
+
+    // Look for ordinals start + rel[i] in every cursor, all cursors on the same document.
+    // Returns the ordinal where the phrase starts or -1 when the document has no match
+    static long match_phrase(PostingCursor* cursors, const long* rel, int n) {
+        long start = CursorOrdinal(&cursors[0]) - rel[0];
+        int i = 0, matched = 0;
+        if (start < 0) start = 0;  // leading gaps need tokens before the first term
+
+        while (matched < n) {
+            if (!CursorSeekOrdinal(&cursors[i], start + rel[i])) return -1;
+            long got = CursorOrdinal(&cursors[i]);
+            if (got == start + rel[i]) {
+                matched++;
+            } else {
+                // realign the phrase on this term and check the others again
+                start = got - rel[i];
+                matched = 1;
+                if (start < 0) { start = 0; matched = 0; }
+            }
+            i = (i + 1) % n;
+        }
+        return start;
+    }
+
+    // resolve_lines for the current document of a search, timed when it is explained
+    static printData resolve_match(SearchCursor* cursor, long first_ord, long last_ord) {
+        if (!cursor->explain) return resolve_lines(cursor->idx, cursor->doc, first_ord, last_ord);
+        long start = now_ns();
+        printData lines = resolve_lines(cursor->idx, cursor->doc, first_ord, last_ord);
+        cursor->explain->lines_ns += now_ns() - start;
+        return lines;
+    }
+
+    static SearchCursor* open_words(const InvertedIndex* idx, char* words[], int word_count, int window,
+                                    SearchExplain* explain) {
+        if (!idx || word_count <= 0 || word_count > MAX_QUERY_WORDS) return NULL;
+
+        long start = explain ? now_ns() : 0;
+        SearchCursor* cursor = calloc(1, sizeof(SearchCursor));
+        if (!cursor) return NULL;
+        cursor->idx = idx;
+        cursor->term_count = word_count;
+        cursor->window = window;
+        cursor->explain = explain;
+
+        // retrieve lists, every word is required
         for (int i = 0; i < word_count; ++i) {
-            void* val = NULL;
-            if (HTContains(idx->table, words[i])) HTGet(idx->table, words[i], &val);
-            lists[i] = (OccurrenceList*)val;
+            char key[MAX_WORD_LENGTH + 1];
+            term_key(idx, key, words[i]);
+            OccurrenceList* list = lookup_postings(idx, key);
+            if (list == NULL) cursor->doc = -1;
+            OpenPostingCursor(&cursor->cursors[i], list);
         }
+        if (explain) explain->lookup_ns += now_ns() - start;
+        return cursor;
+    }
 
-        // prepare results
-        printData* results = malloc(sizeof(printData) * (idx->last_file_index + 1));
-        int res_count = 0;
-
-        for (int doc = 0; doc <= idx->last_file_index; ++doc) {
-            ArrayList* all_pos = arraylist_create(11, sizeof(void*));
-
-            int w, j;
-            for (w = 0; w < word_count; ++w) {
-                Occurrence* cur = lists[w] ? lists[w]->first : NULL;
-                while (cur) {
-                    if (cur->doc_id == doc) {
-                        for (j = 0; j < arraylist_size(cur->positions_list); ++j) {
-                            void* tmp;
-                            memcpy(&tmp, arraylist_get(cur->positions_list, j), sizeof(void*));
-                            arraylist_add(all_pos, &tmp);
-                        }
-                    }
-                    cur = cur->next;
-                }
+    SearchCursor* II_SearchOpen(const InvertedIndex* idx, char* words[], int word_count, int window) {
+        return open_words(idx, words, word_count, window, NULL);
+    }
+
+    SearchCursor* II_PhraseOpen(const InvertedIndex* idx, const char* phrase) {
+        if (!idx || !phrase) return NULL;
+
+        SearchCursor* cursor = calloc(1, sizeof(SearchCursor));
+        if (!cursor) return NULL;
+        cursor->idx = idx;
+
+        // tokenize the phrase like II_LoadFile does, remembering each term's ordinal in the phrase
+        int n = 0;
+        long width = 0;
+        const char* p = phrase;
+        while (*p && n < MAX_PHRASE_WORDS) {
+            if (!isalpha((unsigned char)*p)) { p++; continue; }
+
+            char word[MAX_WORD_LENGTH + 1];
+            int len = 0;
+            const char* begin = p;
+            while (isalpha((unsigned char)*p)) {
+                if (len < MAX_WORD_LENGTH) word[len++] = tolower((unsigned char)*p);
+                p++;
             }
+            word[len] = '\0';
+            if (idx->stemming) ST_Stem(word);
 
+            // unindexed short words are left as one-token gaps
+            if (p - begin >= WORD_MIN_LENGTH || idx->index_short_words) {
+                OccurrenceList* list = lookup_postings(idx, word);
+                if (list == NULL) cursor->doc = -1;  // a word that never occurs: no match anywhere
+                OpenPostingCursor(&cursor->cursors[n], list);
+                cursor->rel[n++] = width;
+            }
+            width++;
+        }
+        if (n == 0) cursor->doc = -1;
+        cursor->term_count = n;
+        cursor->width = width;
+        return cursor;
+    }
 
-            if (arraylist_size(all_pos) < word_count) { arraylist_destroy(all_pos); continue; }
-            arraylist_sort(all_pos, compare_positions);
-            int start = 0;
-            long first_line = -1, last_line = -1;
-            int end;
-            for (end = 0; end < arraylist_size(all_pos); ++end) {
-                void *vp_end, *vp_start;
-                memcpy(&vp_end, arraylist_get(all_pos, end), sizeof(void*));
-                long pos_end = (long)(uintptr_t)vp_end;
-
-                while (start < end) {
-                    memcpy(&vp_start, arraylist_get(all_pos, start), sizeof(void*));
-                    long pos_start = (long)(uintptr_t)vp_start;
-                    if (pos_end - pos_start > CONTEXT_WINDOW) {
-                        start++;
-                    } else {
-                        break;
-                    }
-                }
-                
-                if (end - start + 1 >= word_count) {
-                    void* vp0; void* vp1;
-                    memcpy(&vp0, arraylist_get(all_pos, start), sizeof(void*));
-                    memcpy(&vp1, arraylist_get(all_pos, end),   sizeof(void*));
-                    long p0 = (long)(uintptr_t)vp0;
-                    long p1 = (long)(uintptr_t)vp1;
-
-                    FILE* docf = idx->opened_files[doc];
-                    fseek(docf, 0, SEEK_SET);
-                    first_line = find_line_by_position(idx->opened_files[doc], p0);
-                    fseek(docf, 0, SEEK_SET);
-                    last_line  = find_line_by_position(idx->opened_files[doc], p1);
+    void II_SearchClose(SearchCursor* cursor) {
+        if (!cursor) return;
+        postings_destroy(cursor->phrase_hits);
+        u64vec_free(&cursor->all_pos);
+        u64vec_free(&cursor->sort_scratch);
+        free(cursor);
+    }
+
+    // Leave the current document, the next II_SearchNext aligns on the following one
+    static void skip_document(SearchCursor* cursor) {
+        if (cursor->doc >= 0) cursor->doc++;
+        cursor->doc_ready = FALSE;
+        postings_destroy(cursor->phrase_hits);
+        cursor->phrase_hits = NULL;
+        cursor->phrase_sets = FALSE;
+    }
+
+    // With every term of the phrase frozen in the current document, the phrase starts are one
+    // intersection away: the rarest term's ordinals shifted against each of the others. FALSE
+    // leaves the document to match_phrase (unfrozen terms, single words, out of memory)
+    static BOOLEAN intersect_phrase(SearchCursor* cursor) {
+        if (cursor->term_count < 2) return FALSE;
+        int rarest = 0;
+        for (int w = 0; w < cursor->term_count; ++w) {
+            const PostingSet* set = cursor->cursors[w].current->ordinal_set;
+            if (!set) return FALSE;
+            if (postings_count(set) < postings_count(cursor->cursors[rarest].current->ordinal_set)) rarest = w;
+        }
+
+        PostingSet* hits = NULL;
+        const PostingSet* current = cursor->cursors[rarest].current->ordinal_set;
+        for (int w = 0; w < cursor->term_count; ++w) {
+            if (w == rarest) continue;
+            PostingSet* next = postings_and(current, cursor->cursors[w].current->ordinal_set,
+                                            cursor->rel[w] - cursor->rel[rarest]);
+            postings_destroy(hits);
+            if (!next) return FALSE;
+            current = hits = next;
+            if (postings_count(hits) == 0) break;
+        }
+        cursor->phrase_hits = hits;
+        cursor->phrase_shift = cursor->rel[rarest];
+        postings_iter_open(&cursor->phrase_next, hits);
+        return TRUE;
+    }
+
+    // Gather the ordinals of every word in the current document, tagged with the word index
+    static void gather_document(SearchCursor* cursor) {
+        U64Vector* all_pos = &cursor->all_pos;
+        size_t total = 0;
+        u64vec_clear(all_pos);
+        for (int w = 0; w < cursor->term_count; ++w) total += GetOrdinalCount(cursor->cursors[w].current);
+        // out of memory: no windows in this document
+        if (!u64vec_reserve(all_pos, total) || !u64vec_reserve(&cursor->sort_scratch, total)) total = 0;
+        for (int w = 0; w < cursor->term_count && total > 0; ++w) {
+            PostingCursor ordinals = cursor->cursors[w];  // on the first ordinal of the document
+            do {
+                u64vec_push(all_pos, ((uint64_t)CursorOrdinal(&ordinals) << QUERY_WORD_BITS) | (uint64_t)w);
+            } while (CursorNextOrdinal(&ordinals));
+        }
+        arraylist_sort_u64(u64vec_data(all_pos), u64vec_size(all_pos), u64vec_data(&cursor->sort_scratch), 0);
+        cursor->next_entry = 0;
+    }
+
+    // Sliding window over ordinals, from where the previous window ended: shortest span
+    // starting at the left that holds every word
+    static BOOLEAN next_window(SearchCursor* cursor, printData* out) {
+        const uint64_t* entries = u64vec_cdata(&cursor->all_pos);
+        size_t size = u64vec_size(&cursor->all_pos);
+        int counts[MAX_QUERY_WORDS] = { 0 };
+        int present = 0;
+        size_t start = cursor->next_entry;
+        size_t first = start;
+
+        for (size_t end = start; end < size; ++end) {
+            long ord_end = (long)(entries[end] >> QUERY_WORD_BITS);
+            if (counts[entries[end] & QUERY_WORD_MASK]++ == 0) present++;
+
+            // drop entries that are too far away or repeated words that only widen the window
+            while (start < end) {
+                long ord_start = (long)(entries[start] >> QUERY_WORD_BITS);
+                int w = (int)(entries[start] & QUERY_WORD_MASK);
+                if (ord_end - ord_start > cursor->window || counts[w] > 1) {
+                    if (--counts[w] == 0) present--;
+                    start++;
+                } else {
                     break;
                 }
             }
-            if (first_line > 0) {
-                results[res_count++] = (printData){ doc, first_line, last_line };
+
+            if (present == cursor->term_count) {
+                long ord_start = (long)(entries[start] >> QUERY_WORD_BITS);
+                *out = resolve_match(cursor, ord_start, ord_end);
+                cursor->next_entry = end + 1;  // windows never overlap
+                if (cursor->explain) cursor->explain->windows += (long)(end + 1 - first);
+                return TRUE;
             }
-            arraylist_destroy(all_pos);
         }
-        free(lists);
-        *out_count = res_count;
+        cursor->next_entry = size;
+        if (cursor->explain) cursor->explain->windows += (long)(size - first);
+        return FALSE;
+    }
+
+    // Next occurrence of the phrase, resuming right after the previous one
+    static BOOLEAN next_phrase(SearchCursor* cursor, printData* out) {
+        if (cursor->phrase_sets) {
+            // leading short words may place a start before the first token
+            while (cursor->phrase_next.value >= 0 && cursor->phrase_next.value < cursor->phrase_shift) {
+                postings_iter_next(&cursor->phrase_next);
+            }
+            if (cursor->phrase_next.value < 0) return FALSE;
+            long start = cursor->phrase_next.value - cursor->phrase_shift;
+            if (start + cursor->width > (long)arraylist_size(cursor->idx->token_offsets[cursor->doc])) return FALSE;
+
+            *out = resolve_match(cursor, start, start + cursor->width - 1);
+            postings_iter_next(&cursor->phrase_next);
+            return TRUE;
+        }
+
+        long start = match_phrase(cursor->cursors, cursor->rel, cursor->term_count);
+        if (start < 0) return FALSE;
+        if (start + cursor->width > (long)arraylist_size(cursor->idx->token_offsets[cursor->doc])) return FALSE;
+
+        *out = resolve_match(cursor, start, start + cursor->width - 1);
+        if (!CursorSeekOrdinal(&cursor->cursors[0], start + cursor->rel[0] + 1)) skip_document(cursor);
+        return TRUE;
+    }
+
+    BOOLEAN II_SearchNext(SearchCursor* cursor, printData* out) {
+        if (!cursor || !out) return FALSE;
+
+        SearchExplain* explain = cursor->explain;
+        while (cursor->doc >= 0) {
+            long start = explain ? now_ns() : 0;
+            if (!cursor->doc_ready) {
+                cursor->doc = align_cursors(cursor->cursors, cursor->term_count, cursor->doc);
+                if (explain) {
+                    long aligned = now_ns();
+                    explain->merge_ns += aligned - start;
+                    start = aligned;
+                }
+                if (cursor->doc < 0) return FALSE;
+                if (explain) explain->candidates++;
+                if (cursor->width == 0) gather_document(cursor);
+                else cursor->phrase_sets = intersect_phrase(cursor);
+                cursor->doc_ready = TRUE;
+            }
+
+            long lines_ns = explain ? explain->lines_ns : 0;
+            BOOLEAN found = cursor->width > 0 ? next_phrase(cursor, out) : next_window(cursor, out);
+            if (explain) explain->window_ns += now_ns() - start - (explain->lines_ns - lines_ns);
+            if (found) return TRUE;
+            skip_document(cursor);
+        }
+        return FALSE;
+    }
+
+    // Eager searches keep the first match of every document
+    static printData* first_per_document(const InvertedIndex* idx, SearchCursor* cursor, int* out_count) {
+        printData* results = malloc(sizeof(printData) * (idx->last_file_index + 1));
+        *out_count = 0;
+        printData match;
+        while (results && II_SearchNext(cursor, &match)) {
+            results[(*out_count)++] = match;
+            skip_document(cursor);
+        }
+        II_SearchClose(cursor);
         return results;
     }
+
+    printData* II_Search(const InvertedIndex* idx, char* words[], int word_count, int* out_count) {
+        return II_SearchWithin(idx, words, word_count, DEFAULT_WORD_WINDOW, out_count);
+    }
+
+    printData* II_SearchWithin(const InvertedIndex* idx, char* words[], int word_count, int window, int* out_count) {
+        return first_per_document(idx, II_SearchOpen(idx, words, word_count, window), out_count);
+    }
+
+    printData* II_SearchPhrase(const InvertedIndex* idx, const char* phrase, int* out_count) {
+        return first_per_document(idx, II_PhraseOpen(idx, phrase), out_count);
+    }
+
+    // First token whose offset is >= offset (binary search on the sorted token table)
+    static long first_token_at(const ArrayList* tokens, long offset) {
+        const long* offsets = (const long*)tokens->data;
+        long low = 0, high = (long)tokens->size;
+        while (low < high) {
+            long mid = low + (high - low) / 2;
+            if (offsets[mid] < offset) low = mid + 1;
+            else high = mid;
+        }
+        return low;
+    }
+
+    // Bytes of the token starting at offset (the stem of a key can't give its length)
+    static long token_length(const MappedFile* doc, long offset) {
+        long end = offset;
+        while ((size_t)end < doc->size && isalpha((unsigned char)doc->data[end])) end++;
+        return end - offset;
+    }
+
+    static int compare_spans(const void* a, const void* b) {
+        long oa = ((const TextSpan*)a)->offset;
+        long ob = ((const TextSpan*)b)->offset;
+        return (oa < ob) ? -1 : (oa > ob);
+    }
+
+    int II_MatchSpans(const InvertedIndex* idx, const printData* result, char* words[], int word_count,
+                      TextSpan* out, int max_out) {
+        if (!idx || !result || result->doc_id < 0 || result->doc_id > idx->last_file_index) return 0;
+
+        const MappedFile* doc = idx->documents[result->doc_id];
+        const ArrayList* tokens = idx->token_offsets[result->doc_id];
+        if (result->first_occurrence_line < 1 || result->last_occurrence_line > doc->line_count) return 0;
+
+        // ordinals of the tokens inside the displayed lines
+        long line_begin = doc->line_starts[result->first_occurrence_line - 1];
+        long line_end = result->last_occurrence_line < doc->line_count
+                        ? doc->line_starts[result->last_occurrence_line] : (long)doc->size;
+        long ord_lo = first_token_at(tokens, line_begin);
+        long ord_hi = first_token_at(tokens, line_end);  // exclusive
+
+        int count = 0;
+        for (int w = 0; w < word_count; ++w) {
+            const char* p = words[w];
+            while (*p) {
+                if (!isalpha((unsigned char)*p)) { p++; continue; }
+
+                char word[MAX_WORD_LENGTH + 1];
+                int len = 0;
+                const char* begin = p;
+                while (isalpha((unsigned char)*p)) {
+                    if (len < MAX_WORD_LENGTH) word[len++] = tolower((unsigned char)*p);
+                    p++;
+                }
+                word[len] = '\0';
+                if (p - begin < WORD_MIN_LENGTH && !idx->index_short_words) continue;
+                if (idx->stemming) ST_Stem(word);
+
+                PostingCursor cursor;
+                OpenPostingCursor(&cursor, lookup_postings(idx, word));
+                if (CursorSeekDocument(&cursor, result->doc_id) != result->doc_id) continue;
+                if (!CursorSeekOrdinal(&cursor, ord_lo)) continue;
+
+                for (long ordinal = CursorOrdinal(&cursor); ordinal >= 0 && count < max_out;
+                     ordinal = CursorNextOrdinal(&cursor) ? CursorOrdinal(&cursor) : -1) {
+                    if (ordinal >= ord_hi) break;
+
+                    long offset = ((const long*)tokens->data)[ordinal];
+                    out[count++] = (TextSpan){ offset, token_length(doc, offset) };
+                }
+            }
+        }
+
+        qsort(out, count, sizeof(TextSpan), compare_spans);
+        return count;
+    }
+
+    // number of ordinals of every document
+    static int term_frequency(const OccurrenceList* list) {
+        int total = 0;
+        for (Occurrence* cur = list ? list->first : NULL; cur; cur = cur->next) {
+            total += (int)GetOrdinalCount(cur);
+        }
+        return total;
+    }
+
+    const OccurrenceList* II_Postings(const InvertedIndex* idx, const char* word) {
+        if (!idx || !word) return NULL;
+        char key[MAX_WORD_LENGTH + 1];
+        term_key(idx, key, word);
+        return lookup_postings(idx, key);
+    }
+
+    long II_TermCount(const InvertedIndex* idx, const char* word) {
+        return term_frequency(II_Postings(idx, word));
+    }
+
+    printData* II_Explain(const InvertedIndex* idx, char* words[], int word_count, int window, int* out_count,
+                          SearchExplain* explain) {
+        if (!explain) return II_SearchWithin(idx, words, word_count, window, out_count);
+        memset(explain, 0, sizeof(*explain));
+        printData* results = first_per_document(idx, open_words(idx, words, word_count, window, explain), out_count);
+        explain->results = *out_count;
+        if (!idx || word_count <= 0 || word_count > MAX_QUERY_WORDS) return results;
+
+        // what each word cost to find, outside the timed search
+        explain->term_count = word_count;
+        for (int i = 0; i < word_count; ++i) {
+            TermExplain* term = &explain->terms[i];
+            term_key(idx, term->key, words[i]);
+            term->probes = idx->frozen_terms ? 1 : HTProbes(idx->table, term->key);
+            const OccurrenceList* list = lookup_postings(idx, term->key);
+            term->postings = term_frequency(list);
+            term->documents = list ? list->count : 0;
+        }
+        return results;
+    }
+
+    TermId II_TermId(const InvertedIndex* idx, const char* word) {
+        if (!idx || !word) return TERM_NONE;
+        char key[MAX_WORD_LENGTH + 1];
+        term_key(idx, key, word);
+        return find_term(idx, key);
+    }
+
+    const OccurrenceList* II_TermPostings(const InvertedIndex* idx, TermId term) {
+        if (!idx || term >= idx->terms.count || idx->terms.postings[term].count == 0) return NULL;
+        return &idx->terms.postings[term];
+    }
+
+    const char* II_TermWord(const InvertedIndex* idx, TermId term) {
+        if (!II_TermPostings(idx, term)) return NULL;
+        return idx->terms.words + idx->terms.word_offsets[term];
+    }
+
+    printData II_ResolveLines(const InvertedIndex* idx, int doc, long first_ord, long last_ord) {
+        return resolve_lines(idx, doc, first_ord, last_ord);
+    }
+
+    int II_SurfaceForm(const InvertedIndex* idx, int doc, long ordinal, char* out, int size) {
+        if (!idx || doc < 0 || doc > idx->last_file_index || !out || size <= 0) return -1;
+        const ArrayList* tokens = idx->token_offsets[doc];
+        if (ordinal < 0 || (size_t)ordinal >= arraylist_size(tokens)) return -1;
+
+        long offset = ((const long*)tokens->data)[ordinal];
+        long length = token_length(idx->documents[doc], offset);
+        int copied = length < size - 1 ? (int)length : size - 1;
+        memcpy(out, idx->documents[doc]->data + offset, copied);
+        out[copied] = '\0';
+        return (int)length;
+    }
+
+    long II_SubstringSearch(const InvertedIndex* idx, const char* text, SubstringHit* out, long max_out) {
+        if (!idx || !text || text[0] == '\0' || strlen(text) > TRIGRAM_MAX_PATTERN) return -1;
+        if (max_out < 0) max_out = 0;
+        long* offsets = malloc((size_t)(max_out > 0 ? max_out : 1) * sizeof(long));
+        if (!offsets) return -1;
+
+        long total = 0;
+        for (int d = 0; d <= idx->last_file_index; ++d) {
+            long room = total < max_out ? max_out - total : 0;
+            const MappedFile* doc = idx->documents[d];
+            long found = TG_Search(idx->trigrams[d], doc->data, doc->size, text, offsets, room, NULL);
+            for (long i = 0; i < found && i < room; ++i) {
+                out[total + i].doc_id = d;
+                out[total + i].offset = offsets[i];
+            }
+            total += found;
+        }
+        free(offsets);
+        return total;
+    }
+
+    int II_FuzzyLookup(const InvertedIndex* idx, const char* word, int max_distance, termCandidate* out, int max_out) {
+        if (!idx || !word || !out || max_out <= 0) return 0;
+        if (max_distance < 1) max_distance = 1;
+        if (max_distance > FUZZY_MAX_DISTANCE) max_distance = FUZZY_MAX_DISTANCE;
+
+        // the tree only holds lowercase words (not stems)
+        char key[MAX_WORD_LENGTH + 1];
+        normalize_word(key, word);
+
+        // ask for more matches than needed so ties can be broken by frequency
+        BKMatch matches[FUZZY_MAX_CANDIDATES * 8];
+        int found = bktree_search(idx->terms_tree, key, max_distance, matches, FUZZY_MAX_CANDIDATES * 8);
+
+        int count = 0;
+        for (int m = 0; m < found; ++m) {
+            // terms of a reloaded file that it no longer has stay in the tree
+            char match_key[MAX_WORD_LENGTH + 1];
+            term_key(idx, match_key, matches[m].term);
+            const OccurrenceList* postings = lookup_postings(idx, match_key);
+            if (!postings) continue;
+            termCandidate cand = { matches[m].term, matches[m].distance, term_frequency(postings) };
+
+            // insertion sort by (distance asc, frequency desc), keeping the best max_out
+            int i = count < max_out ? count++ : max_out;
+            while (i > 0 && (out[i - 1].distance > cand.distance ||
+                             (out[i - 1].distance == cand.distance && out[i - 1].frequency < cand.frequency))) {
+                if (i < max_out) out[i] = out[i - 1];
+                i--;
+            }
+            if (i < max_out) out[i] = cand;
+        }
+        return count;
+    }
+
+    int II_CorrectWords(const InvertedIndex* idx, char* words[], int word_count, int max_distance, char* corrected[]) {
+        int replaced = 0;
+        for (int w = 0; w < word_count; ++w) {
+            corrected[w] = words[w];
+
+            char key[MAX_WORD_LENGTH + 1];
+            term_key(idx, key, words[w]);
+            if (find_term(idx, key) != TERM_NONE) continue;
+
+            termCandidate best;
+            if (II_FuzzyLookup(idx, words[w], max_distance, &best, 1) == 1) {
+                corrected[w] = (char*)best.term;
+                replaced++;
+            }
+        }
+        return replaced;
+    }
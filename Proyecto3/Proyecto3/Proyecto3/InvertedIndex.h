@@ -2,12 +2,33 @@
 #define INVERTED_INDEX_H
 
 #include "HashTable.h"
+#include "ArrayList/arraylist.h"
 #include "Occurrence/occurrence.h"
+#include "BKTree/bktree.h"
+#include "FileManager.h"
+#include "Pipeline.h"
+#include "Trigram.h"
+#include "PerfectHash.h"
+#include "Allocator/allocator.h"
 #include <stdio.h>
 
 #define MAX_OPEN_FILES 5
 #define WORD_MIN_LENGTH 4
-#define CONTEXT_WINDOW 100  // max chars between words
+#define MAX_WORD_LENGTH 64    // longer tokens are indexed by their first MAX_WORD_LENGTH letters
+#define MAX_PHRASE_WORDS 32    // must not exceed MAX_QUERY_WORDS
+#define DEFAULT_WORD_WINDOW 16  // max distance in tokens between the first and last word of a match
+#define QUERY_WORD_BITS 6        // search packs (ordinal, word index) in one 64-bit value
+#define QUERY_WORD_MASK ((1UL << QUERY_WORD_BITS) - 1)
+#define MAX_QUERY_WORDS (1 << QUERY_WORD_BITS)
+#define FUZZY_MAX_DISTANCE 2     // largest edit distance accepted by fuzzy lookups
+#define FUZZY_MAX_CANDIDATES 8   // candidates kept per misspelled word
+#define INITIAL_TERM_CAPACITY 1031  // dictionary buckets before any file is loaded (prime)
+
+// Heaps' law V = K * N^BETA (distinct terms after N tokens), fitted on the books in libros/.
+// Sizes are estimated before loading so the dictionary and token tables are allocated once
+#define HEAPS_K 21.0
+#define HEAPS_BETA 0.53
+#define BYTES_PER_TOKEN 5         // a bit under the measured 5.4-5.8, so estimates err on the large side
 
 // For search results: document id and line range
 typedef struct _printData {
@@ -16,22 +37,262 @@ typedef struct _printData {
     int last_occurrence_line;
 } printData;
 
+// One occurrence of a substring (II_SubstringSearch)
+typedef struct _SubstringHit {
+    int doc_id;
+    long offset;       // byte offset in the document
+} SubstringHit;
+
+// A dictionary term close to a (possibly misspelled) query word
+typedef struct _termCandidate {
+    const char* term;  // owned by the index, valid until II_Destroy
+    int distance;      // edit distance to the query word
+    int frequency;     // total occurrences of the term in all documents
+} termCandidate;
+
+#define TERM_NONE UINT32_MAX       // TermId of a word that isn't in the dictionary
+
+// Dense term ids: a word (or stem) gets the next id the first time it is indexed, and the
+// postings of all terms live in one array indexed by id, so walking every term reads
+// contiguous headers instead of chasing hash table cells
+typedef struct _TermTable {
+    OccurrenceList* postings;   // header of every id below count (empty for free ids)
+    uint32_t* word_offsets;     // id -> its word in words
+    char* words;                // NUL-terminated words in the order they were interned
+    size_t words_size;
+    size_t words_capacity;
+    TermId count;               // ids handed out
+    TermId capacity;            // of postings and word_offsets
+    TermIdVector free_ids;      // ids a reload left without postings, handed out again first
+} TermTable;
+
 // Main index structure
 typedef struct _InvertedIndex {
-    HashTable table;                    // maps word -> OccurrenceList*
-    FILE* opened_files[MAX_OPEN_FILES];  // raw FILE* handles
+    HashTable table;                    // maps word -> term id + 1 (see II_TermId), NULL once frozen
+    TermTable terms;                    // postings and word of every term id
+    PerfectHash* frozen_terms;          // replaces table after II_Freeze: word -> term id
+    BKTree* terms_tree;                 // every key of table (with stemming, the first word that gave each key), for fuzzy lookups
+    FILE* opened_files[MAX_OPEN_FILES];  // raw FILE* handles (shared file position: never used by queries)
+    MappedFile* documents[MAX_OPEN_FILES];  // read-only mapping + line table of each file
+    char* file_names[MAX_OPEN_FILES];    // name each file was loaded with (relative to BOOKS_PATH)
     int last_file_index;                 // index of most recently added file
+    ArrayList* token_offsets[MAX_OPEN_FILES];  // per document: token ordinal -> byte offset (long)
+    BOOLEAN index_short_words;           // also index words shorter than WORD_MIN_LENGTH (ordinals only)
+    BOOLEAN presize;                     // size tables from the file size before loading (default TRUE)
+    long token_table_grows;              // reallocations of token_offsets while loading
+    BOOLEAN hybrid_postings;             // freeze each loaded file's ordinals into PostingSets (default TRUE)
+    int load_tokenizers;                 // tokenizer threads of the load pipeline, 0 loads on the calling thread
+    PipelineStats last_load;             // stages of the last pipelined load
+    BOOLEAN trigram_index;               // build a substring index of each file loaded from now on
+    TrigramIndex* trigrams[MAX_OPEN_FILES];  // per document, NULL if it was loaded without one
+    BOOLEAN stemming;                    // words (indexed and queried) are keyed by their Spanish stem
 } InvertedIndex;
 
+// One word of an explained search (II_Explain)
+typedef struct _TermExplain {
+    char key[MAX_WORD_LENGTH + 1];   // dictionary key it was looked up with
+    int probes;                      // hash table slots visited finding it (1 once frozen)
+    long postings;                   // occurrences in all documents
+    int documents;                   // documents holding it (document frequency)
+} TermExplain;
+
+// Plan and cost breakdown of II_Explain; times are nanoseconds
+typedef struct _SearchExplain {
+    int term_count;
+    TermExplain terms[MAX_QUERY_WORDS];
+    long candidates;      // documents holding every word
+    long windows;         // windows the sliding window evaluated (one per ordinal it reached)
+    long results;
+    long lookup_ns;       // normalizing the words and finding their postings
+    long merge_ns;        // moving the posting cursors to the documents they share
+    long window_ns;       // gathering and sorting the ordinals of a candidate, sliding the window
+    long lines_ns;        // turning matched ordinals into line numbers
+} SearchExplain;
+
+// State of a lazy search (II_SearchOpen / II_PhraseOpen); everything here belongs to the query
+typedef struct _SearchCursor {
+    const InvertedIndex* idx;
+    int term_count;                          // postings walked by cursors
+    PostingCursor cursors[MAX_QUERY_WORDS];
+    int window;                              // proximity: max tokens between first and last word
+    long rel[MAX_QUERY_WORDS];               // phrase: ordinal of each term inside the phrase
+    long width;                              // phrase: tokens spanned, 0 for proximity searches
+    int doc;                                 // document being scanned, -1 once exhausted
+    BOOLEAN doc_ready;                       // cursors are aligned on doc (and all_pos filled)
+    U64Vector all_pos;                       // proximity: sorted (ordinal, word) entries of doc
+    U64Vector sort_scratch;                  // radix sort buffer for all_pos
+    size_t next_entry;                       // proximity: where the window scan resumes
+    BOOLEAN phrase_sets;                     // phrase: doc is read from phrase_next, not match_phrase
+    PostingSet* phrase_hits;                 // phrase: intersection of the frozen ordinals of doc
+    PostingIterator phrase_next;             // phrase: next hit, the phrase starts phrase_shift before it
+    long phrase_shift;
+    SearchExplain* explain;                  // counters and phase times, NULL unless explained
+} SearchCursor;
+
+/*
+ * Concurrency: II_Create, II_SetIndexShortWords, II_SetPresize, II_SetHybridPostings, II_SetLoadPipeline, II_SetTrigramIndex, II_SetStemming, II_LoadFile, II_ReloadFile, II_Freeze, II_Compact and II_Destroy modify the index
+ * and need exclusive access. Every function taking a const InvertedIndex* is the read-only
+ * query path: it never writes to the index nor to the caller's words, keeps its state in
+ * the SearchCursor or on the stack, and reads documents through their read-only mappings,
+ * so any number of threads can run queries on the same loaded index without locks.
+ * A SearchCursor itself belongs to one thread at a time.
+ */
+
 // Initialize a new inverted index
 InvertedIndex* II_Create();
 // Clean up and free all memory
 void II_Destroy(InvertedIndex* idx);
 
-// Load a file into the index; returns file ID or -1 on error
+// Index words shorter than WORD_MIN_LENGTH in files loaded from now on
+// (postings only keep ordinals, offsets come from token_offsets)
+void II_SetIndexShortWords(InvertedIndex* idx, BOOLEAN enabled);
+
+// Turn presizing from the file size on or off for files loaded from now on
+void II_SetPresize(InvertedIndex* idx, BOOLEAN enabled);
+
+// Turn freezing of postings into compressed PostingSets on or off for files loaded from now on.
+// Phrases over frozen postings are matched with set intersections; unfrozen ones keep the
+// inline ordinal vectors they are built with
+void II_SetHybridPostings(InvertedIndex* idx, BOOLEAN enabled);
+
+// Load files from now on through a reader -> tokenizers -> indexer pipeline (see Pipeline.h)
+// with this many tokenizer threads, or on the calling thread with 0 (default). The index is
+// the same either way; last_load keeps the stage times of the last pipelined load
+void II_SetLoadPipeline(InvertedIndex* idx, int tokenizers);
+
+// Build a trigram index (see Trigram.h) of the raw text of files loaded from now on, so
+// substring searches only verify the blocks that can hold a match
+void II_SetTrigramIndex(InvertedIndex* idx, BOOLEAN enabled);
+
+// Key words by their Spanish stem (see Stem.h), in the documents and in every query, so
+// "caballero", "caballeros" share one postings list. Set it before loading the first file:
+// the keys already in the index are not stemmed again
+void II_SetStemming(InvertedIndex* idx, BOOLEAN enabled);
+
+// Bytes allocated by the postings: lists, occurrences and their ordinals (and offsets)
+size_t II_PostingsMemory(const InvertedIndex* idx);
+
+// Estimated tokens in a file of the given size
+long II_EstimateTokens(size_t bytes);
+
+// Estimated distinct indexed terms after reading the given number of tokens (Heaps' law)
+long II_EstimateVocabulary(long tokens);
+
+// Load a file into the index; returns file ID or -1 on error (or if the index is frozen)
 int II_LoadFile(InvertedIndex* idx, const char* fileName);
 
+// ID of the file loaded with this name, -1 if there is none
+int II_FindFile(const InvertedIndex* idx, const char* fileName);
+
+// Index the current contents of a file again, under the same ID: its old postings and
+// tokens are dropped (terms only it had leave the dictionary) instead of being appended
+// twice. A file that isn't loaded yet is loaded with II_LoadFile. Returns the file ID, or
+// -1 on error, in which case the file keeps the contents it was indexed with
+int II_ReloadFile(InvertedIndex* idx, const char* fileName);
+
+// Make the index read-only: the dictionary becomes a minimal perfect hash of the final
+// vocabulary (see PerfectHash.h) and the hash table is freed. Term ids are renumbered to
+// the hash slots, so they stay dense. Loads and reloads fail from then on. Returns 0, or
+// -1 if the hash can't be built (the index keeps working as before)
+int II_Freeze(InvertedIndex* idx);
+
+// Bytes of the dictionary: the hash table (buckets, cells and their keys) or, once frozen,
+// the perfect hash, plus the words and word offsets of the term table
+size_t II_DictionaryMemory(const InvertedIndex* idx);
+
+// Heap by category (II_MemoryReport): the counters of the tagged allocator, which cover the
+// whole process, and the slack of one index in each category
+typedef struct _MemoryReport {
+    MemStats tags[MEM_TAG_COUNT];
+    MemStats total;
+    size_t slack[MEM_TAG_COUNT];   // allocated but unused: empty hash slots, spare term ids and
+                                   // arena, vector and ArrayList capacity past their size
+    size_t total_slack;
+} MemoryReport;
+
+void II_MemoryReport(const InvertedIndex* idx, MemoryReport* report);
+
+// Give the slack back, except the empty hash slots the load factor needs: ordinal vectors
+// shrink to their ordinals (inline when they fit), token offsets to their size
+// (arraylist_trim_to_size), the term table to its ids and words. Returns the bytes released
+size_t II_Compact(InvertedIndex* idx);
+
 // Search for an array of words; returns array of printData and sets out_count
-printData* II_Search(InvertedIndex* idx, char* words[], int word_count, int* out_count);
+// Same as II_SearchWithin with DEFAULT_WORD_WINDOW
+printData* II_Search(const InvertedIndex* idx, char* words[], int word_count, int* out_count);
+
+// Search for documents where all the words appear with at most window tokens between the
+// first and the last one (the window runs on ordinals; byte offsets are only used to find
+// the lines to display). Returns one printData per document and sets out_count
+printData* II_SearchWithin(const InvertedIndex* idx, char* words[], int word_count, int window, int* out_count);
+
+// II_SearchWithin, filling explain with what each word cost to find and where the time
+// went. The timers only run for explained searches
+printData* II_Explain(const InvertedIndex* idx, char* words[], int word_count, int window, int* out_count,
+                      SearchExplain* explain);
+
+// Search for an exact phrase (tokenized like the documents): the words must appear on
+// consecutive token ordinals. Unindexed short words match any single token.
+// Returns one printData per document (first match) and sets out_count
+printData* II_SearchPhrase(const InvertedIndex* idx, const char* phrase, int* out_count);
+
+// Lazy search: matches are produced one window at a time by II_SearchNext, so work is only
+// done for the results actually consumed. Returns NULL on invalid arguments
+SearchCursor* II_SearchOpen(const InvertedIndex* idx, char* words[], int word_count, int window);
+
+// Lazy version of II_SearchPhrase, consumed with II_SearchNext
+SearchCursor* II_PhraseOpen(const InvertedIndex* idx, const char* phrase);
+
+// Write the next match (document order, then text order, never overlapping) into out.
+// Returns FALSE once there are no more matches
+BOOLEAN II_SearchNext(SearchCursor* cursor, printData* out);
+
+// Free a cursor returned by II_SearchOpen or II_PhraseOpen
+void II_SearchClose(SearchCursor* cursor);
+
+// Postings of a query word (lowercased, truncated and stemmed like the loader does), NULL if it never occurs
+const OccurrenceList* II_Postings(const InvertedIndex* idx, const char* word);
+
+// Occurrences of a query word in all documents
+long II_TermCount(const InvertedIndex* idx, const char* word);
+
+// Term id of a query word (normalized like II_Postings), TERM_NONE if it never occurs.
+// Ids below terms.count are dense; one a reload emptied has no postings until it is reused
+TermId II_TermId(const InvertedIndex* idx, const char* word);
+
+// Postings of a term id, NULL if the id is free or out of range. Like every pointer into
+// the term table it is valid until the next load or reload
+const OccurrenceList* II_TermPostings(const InvertedIndex* idx, TermId term);
+
+// Dictionary key of a term id (the stem with stemming), NULL if the id is free or out of range
+const char* II_TermWord(const InvertedIndex* idx, TermId term);
+
+// Line range covered by tokens first_ord..last_ord of a document
+printData II_ResolveLines(const InvertedIndex* idx, int doc, long first_ord, long last_ord);
+
+// Token ordinal of a document as it is written in the text ("Caballeros" for the stem
+// "caballer"), NUL-terminated in out (truncated to size - 1 bytes). Returns its length in
+// the text, or -1 if the document or the ordinal doesn't exist
+int II_SurfaceForm(const InvertedIndex* idx, int doc, long ordinal, char* out, int size);
+
+// Byte ranges of the query words inside the lines of a result, sorted by offset, for
+// highlighting. Each item of words is tokenized like the documents (a phrase works too)
+int II_MatchSpans(const InvertedIndex* idx, const printData* result, char* words[], int word_count,
+                  TextSpan* out, int max_out);
+
+// Occurrences of text anywhere in the documents, inside words too ("ote" in "Quijote"),
+// ASCII letters without case, in document then offset order. Documents with a trigram
+// index only verify their candidate blocks, the others are scanned. Writes the first
+// max_out hits to out and returns the total, or -1 if text is empty or longer than
+// TRIGRAM_MAX_PATTERN
+long II_SubstringSearch(const InvertedIndex* idx, const char* text, SubstringHit* out, long max_out);
+
+// Find dictionary terms within max_distance (1..FUZZY_MAX_DISTANCE) edits of word,
+// closest first and most frequent first among equals; returns how many were written to out
+int II_FuzzyLookup(const InvertedIndex* idx, const char* word, int max_distance, termCandidate* out, int max_out);
+
+// Replace every word that has no postings by its best fuzzy candidate.
+// corrected[i] ends up pointing to words[i] or to an index-owned term; returns the number of substitutions
+int II_CorrectWords(const InvertedIndex* idx, char* words[], int word_count, int max_distance, char* corrected[]);
 
 #endif
\ No newline at end of file
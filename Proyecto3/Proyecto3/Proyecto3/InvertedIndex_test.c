@@ -17,12 +17,11 @@ extern void GlobalReportarError(char* pszFile, int  iLine) {
 }
 
 void print_all_keys(_HashTable* ht) {
-    // Recorremos todas las posiciones del array
-    for (int i = 0; i < ht->cap; ++i) {
-        Celda* cel = ht->arr[i];
-        if (cel != NULL && cel->clave != NULL) {
-            printf("Clave en índice %d: %s\n", i, cel->clave);
-        }
+    // Recorremos todas las claves cargadas
+    int pos = 0;
+    char* clave;
+    while (HTNext(ht, &pos, &clave, NULL)) {
+        printf("Clave en posición %d: %s\n", pos - 1, clave);
     }
 }
 
@@ -85,7 +84,19 @@ int main() {
         }
     }
 
-    
+    free(results);
+
+    // Exact phrase: consecutive token ordinals, short words are one-token gaps
+    const char* phrase = "en un lugar de la Mancha";
+    results = II_SearchPhrase(idx, phrase, &result_count);
+    printf("Frase \"%s\": %d resultado(s)\n", phrase, result_count);
+    for (int i = 0; i < result_count; ++i) {
+        printf("Documento %d: líneas %d a %d\n",
+               results[i].doc_id,
+               results[i].first_occurrence_line,
+               results[i].last_occurrence_line);
+    }
+
     // Clean up
     free(results);
     II_Destroy(idx);
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "Server.h"
+
+/*
+ * Generador de carga para el modo servidor (Main --serve): reproduce un log de consultas
+ * (una por linea, misma sintaxis del protocolo) desde varias conexiones a la vez y
+ * reporta throughput y latencias vistas por el cliente.
+ *
+ *   LoadClient <socket|port> <query_log> [--concurrency N] [--repeat R]
+ */
+
+#define MAX_CONNECTIONS 256
+#define MAX_LOG_LINES 100000
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+/* Lectura por lineas de una conexion */
+typedef struct {
+    int fd;
+    char buffer[8192];
+    size_t start;
+    size_t length;
+} Connection;
+
+typedef struct {
+    const char* address;
+    char** lines;
+    int line_count;
+    int first;          /* la conexion i manda las lineas i, i + C, i + 2C... */
+    int step;
+    int repeat;
+    long* latencies_ns; /* una por consulta enviada */
+    long sent;
+    long matches;
+    long errors;
+    BOOLEAN failed;
+} Replayer;
+
+static long now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* Copia en line la siguiente linea recibida (sin '\n'); devuelve FALSE si se cerro la conexion */
+static BOOLEAN read_line(Connection* conn, char* line, size_t max) {
+    while (1) {
+        char* newline = memchr(conn->buffer + conn->start, '\n', conn->length);
+        if (newline) {
+            size_t len = (size_t)(newline - (conn->buffer + conn->start));
+            size_t copy = len < max - 1 ? len : max - 1;
+            memcpy(line, conn->buffer + conn->start, copy);
+            line[copy] = '\0';
+            conn->start += len + 1;
+            conn->length -= len + 1;
+            return TRUE;
+        }
+        if (conn->start > 0) {
+            memmove(conn->buffer, conn->buffer + conn->start, conn->length);
+            conn->start = 0;
+        }
+        if (conn->length == sizeof(conn->buffer)) conn->length = 0;  /* linea demasiado larga: se descarta */
+        ssize_t got = recv(conn->fd, conn->buffer + conn->length, sizeof(conn->buffer) - conn->length, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return FALSE;
+        conn->length += (size_t)got;
+    }
+}
+
+static BOOLEAN send_line(int fd, const char* text) {
+    size_t len = strlen(text);
+    char buffer[SERVER_LINE_MAX + 1];
+    if (len >= SERVER_LINE_MAX) len = SERVER_LINE_MAX - 1;
+    memcpy(buffer, text, len);
+    buffer[len++] = '\n';
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t sent = send(fd, buffer + done, len - done, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return FALSE;
+        done += (size_t)sent;
+    }
+    return TRUE;
+}
+
+static void* replay(void* arg) {
+    Replayer* r = arg;
+    Connection* conn = calloc(1, sizeof(Connection));
+    if (!conn) {
+        r->failed = TRUE;
+        return NULL;
+    }
+    conn->fd = SV_Connect(r->address);
+    if (conn->fd < 0) {
+        r->failed = TRUE;
+        free(conn);
+        return NULL;
+    }
+
+    char line[256];
+    for (int round = 0; round < r->repeat && !r->failed; ++round) {
+        for (int i = r->first; i < r->line_count; i += r->step) {
+            long start = now_ns();
+            if (!send_line(conn->fd, r->lines[i])) { r->failed = TRUE; break; }
+
+            /* la respuesta termina en "END n" o es un "ERR ..." */
+            while (1) {
+                if (!read_line(conn, line, sizeof(line))) { r->failed = TRUE; break; }
+                if (strncmp(line, "END", 3) == 0) break;
+                if (strncmp(line, "ERR", 3) == 0) { r->errors++; break; }
+                r->matches++;
+            }
+            if (r->failed) break;
+            r->latencies_ns[r->sent++] = now_ns() - start;
+        }
+    }
+
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+static int compare_longs(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static char** read_log(const char* path, int* count) {
+    FILE* file = fopen(path, "r");
+    if (!file) return NULL;
+    char** lines = malloc(MAX_LOG_LINES * sizeof(char*));
+    char buffer[SERVER_LINE_MAX];
+    *count = 0;
+    while (lines && *count < MAX_LOG_LINES && fgets(buffer, sizeof(buffer), file)) {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (buffer[0] == '\0' || buffer[0] == '#') continue;
+        lines[(*count)++] = strdup(buffer);
+    }
+    fclose(file);
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    int concurrency = 4;
+    int repeat = 1;
+    const char* positional[2];
+    int positional_count = 0;
+
+    for (int a = 1; a < argc; ++a) {
+        if (strcmp(argv[a], "--concurrency") == 0 && a + 1 < argc) concurrency = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--repeat") == 0 && a + 1 < argc) repeat = atoi(argv[++a]);
+        else if (positional_count < 2) positional[positional_count++] = argv[a];
+    }
+    if (positional_count < 2 || concurrency <= 0 || concurrency > MAX_CONNECTIONS || repeat <= 0) {
+        printf("Usage: %s <socket|port> <query_log> [--concurrency N (1-%d)] [--repeat R]\n", argv[0], MAX_CONNECTIONS);
+        return EXIT_FAILURE;
+    }
+
+    int line_count;
+    char** lines = read_log(positional[1], &line_count);
+    if (!lines || line_count == 0) {
+        fprintf(stderr, "No se pudo leer consultas de '%s'\n", positional[1]);
+        return EXIT_FAILURE;
+    }
+
+    Replayer replayers[MAX_CONNECTIONS];
+    pthread_t threads[MAX_CONNECTIONS];
+    for (int t = 0; t < concurrency; ++t) {
+        replayers[t] = (Replayer){ positional[0], lines, line_count, t, concurrency, repeat, NULL, 0, 0, 0, FALSE };
+        replayers[t].latencies_ns = malloc(((size_t)(line_count / concurrency + 1) * repeat) * sizeof(long));
+    }
+
+    long start = now_ns();
+    for (int t = 0; t < concurrency; ++t) pthread_create(&threads[t], NULL, replay, &replayers[t]);
+    for (int t = 0; t < concurrency; ++t) pthread_join(threads[t], NULL);
+    double seconds = (now_ns() - start) / 1e9;
+
+    /* todas las latencias juntas para sacar percentiles exactos */
+    long total = 0, matches = 0, errors = 0;
+    int failed = 0;
+    for (int t = 0; t < concurrency; ++t) {
+        total += replayers[t].sent;
+        matches += replayers[t].matches;
+        errors += replayers[t].errors;
+        failed += replayers[t].failed;
+    }
+    long* all = malloc((total > 0 ? total : 1) * sizeof(long));
+    long k = 0;
+    for (int t = 0; t < concurrency; ++t) {
+        memcpy(all + k, replayers[t].latencies_ns, replayers[t].sent * sizeof(long));
+        k += replayers[t].sent;
+        free(replayers[t].latencies_ns);
+    }
+    qsort(all, total, sizeof(long), compare_longs);
+
+    printf("%d conexiones, %ld consultas en %.2f s: %.1f consultas/s\n", concurrency, total, seconds, total / seconds);
+    if (total > 0) {
+        printf("latencia (us): p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+               all[total / 2] / 1e3, all[total * 9 / 10] / 1e3, all[total * 99 / 100] / 1e3, all[total - 1] / 1e3);
+    }
+    printf("%ld matches recibidos, %ld consultas con error, %d conexiones fallidas\n", matches, errors, failed);
+
+    /* lo que mide el servidor (incluye la espera en la cola) */
+    Connection* conn = calloc(1, sizeof(Connection));
+    conn->fd = SV_Connect(positional[0]);
+    if (conn->fd >= 0 && send_line(conn->fd, "STATS")) {
+        char line[256];
+        if (read_line(conn, line, sizeof(line))) printf("servidor: %s\n", line);
+    }
+    if (conn->fd >= 0) close(conn->fd);
+    free(conn);
+
+    free(all);
+    for (int i = 0; i < line_count; ++i) free(lines[i]);
+    free(lines);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
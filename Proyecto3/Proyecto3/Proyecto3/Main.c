@@ -2,12 +2,72 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "confirm.h"
 #include "HashTable.h"
 #include "InvertedIndex.h"
 #include "FileManager.h"
+#include "Server.h"
+#include "Query.h"
+#include "Shard.h"
+#include "Rank.h"
+#include "Spimi.h"
+#include "Watch.h"
 #include "tui.c"
 
+#define MAX_HIGHLIGHTS 256
+#define RESULTS_PER_PAGE 5
+#define SHARD_RESULTS 20
+#define SUBSTRING_RESULTS 100
+
+typedef struct _WatchState WatchState;
+static BOOLEAN wait_next_page(WatchState* watch);
+
+/* Adaptadores para recorrer los dos tipos de cursor con page_results */
+static BOOLEAN next_search(void* cursor, printData* out) {
+	return II_SearchNext(cursor, out);
+}
+
+static BOOLEAN next_query(void* cursor, printData* out) {
+	return QY_Next(cursor, out);
+}
+
+/* Muestra los resultados de a una pagina, pidiendo cada match al cursor recien
+   cuando hace falta. Devuelve la cantidad de resultados mostrados */
+static int page_results(WatchState* watch, InvertedIndex* idx, void* cursor, BOOLEAN (*next)(void*, printData*),
+						char* words[], int word_count) {
+	printData result;
+	int shown = 0;
+
+	while (1) {
+		// la siguiente pagina solo se calcula si el usuario la pide
+		if (shown > 0 && shown % RESULTS_PER_PAGE == 0 && !wait_next_page(watch)) break;
+		if (!next(cursor, &result)) {
+			if (shown > 0 && shown % RESULTS_PER_PAGE == 0) printf("\nNo hay más resultados.\n");
+			break;
+		}
+		shown++;
+
+		printf("\nResultado %d - Documento %d: líneas %d a %d\n",
+			shown,
+			result.doc_id,
+			result.first_occurrence_line,
+			result.last_occurrence_line);
+		printf("--- Contenido aproximado: ---\n");
+		// las lineas salen directo del mapeo, con las palabras resaltadas
+		TextSpan spans[MAX_HIGHLIGHTS];
+		int span_count = II_MatchSpans(idx, &result, words, word_count, spans, MAX_HIGHLIGHTS);
+		fflush(stdout);
+		write_snippet(STDOUT_FILENO, idx->documents[result.doc_id],
+					  result.first_occurrence_line,
+					  result.last_occurrence_line,
+					  spans, span_count);
+		printf("------------------------------\n");
+	}
+	return shown;
+}
+
 /* Implementado una vez por programa para establecer como manejar errores */
 extern void GlobalReportarError(char* pszFile, int  iLine) {
 
@@ -21,37 +81,435 @@ extern void GlobalReportarError(char* pszFile, int  iLine) {
 
 }
 
-int main(int argc, char** argv) {
-	if (argc != 2) {
-        printf("Usage: %s <file>\n", argv[0]);
-        return EXIT_FAILURE;
-    }
+/* "top: palabras": los RANK_DEFAULT_K pasajes con mejor BM25, con block-max WAND. Con AND
+   entre las palabras deben estar todas. El indice de pasajes se arma con la primera consulta */
+static void show_top_passages(WatchState* watch, InvertedIndex* idx, RankedIndex** rank, char* text) {
+	char* words[RANK_MAX_TERMS];
+	int word_count = 0;
+	RankMode mode = RANK_OR;
+	for (char* tok = strtok(text, " ,"); tok && word_count < RANK_MAX_TERMS; tok = strtok(NULL, " ,")) {
+		if (strcmp(tok, "AND") == 0) mode = RANK_AND;
+		else if (strcmp(tok, "OR") != 0) words[word_count++] = tok;
+	}
 
+	if (*rank == NULL) *rank = RK_FromIndex(idx, RANK_PASSAGE_TOKENS);
+	if (*rank == NULL) {
+		printf("\nNo se pudo armar el índice de pasajes.\n");
+		return;
+	}
+	RankHit hits[RANK_DEFAULT_K];
+	RankStats stats;
+	int count = RK_TopK(*rank, words, word_count, mode, RANK_BLOCK_MAX_WAND, RANK_DEFAULT_K, hits, &stats);
+	if (count == 0) {
+		printf("\nNo se encontraron resultados para los términos especificados.\n");
+		return;
+	}
+	printf("\n%ld de %ld pasajes puntuados\n", stats.scored, RK_DocumentCount(*rank));
+	for (int i = 0; i < count; ++i) {
+		if (i > 0 && i % RESULTS_PER_PAGE == 0 && !wait_next_page(watch)) break;
+		printData lines = RK_PassageLines(*rank, idx, hits[i].doc);
+		printf("\nResultado %d - Documento %d: puntaje %.3f, líneas %d a %d\n",
+			i + 1, lines.doc_id, hits[i].score, lines.first_occurrence_line, lines.last_occurrence_line);
+		printf("--- Contenido aproximado: ---\n");
+		TextSpan spans[MAX_HIGHLIGHTS];
+		int span_count = II_MatchSpans(idx, &lines, words, word_count, spans, MAX_HIGHLIGHTS);
+		fflush(stdout);
+		write_snippet(STDOUT_FILENO, idx->documents[lines.doc_id],
+					  lines.first_occurrence_line, lines.last_occurrence_line, spans, span_count);
+		printf("------------------------------\n");
+	}
+}
+
+/* "sub: texto": apariciones del texto en cualquier parte, tambien dentro de palabras
+   ("ote" en "Quijote"). Con --trigrams solo se revisan los bloques que pueden contenerlo */
+static void show_substring(WatchState* watch, InvertedIndex* idx, char* text) {
+	while (*text == ' ') text++;
+	SubstringHit hits[SUBSTRING_RESULTS];
+	long total = II_SubstringSearch(idx, text, hits, SUBSTRING_RESULTS);
+	if (total < 0) {
+		printf("\nEl texto debe tener entre 1 y %d caracteres.\n", TRIGRAM_MAX_PATTERN);
+		return;
+	}
+	if (total == 0) {
+		printf("\nNo se encontraron resultados para los términos especificados.\n");
+		return;
+	}
+	printf("\n%ld apariciones\n", total);
+	for (long i = 0; i < total && i < SUBSTRING_RESULTS; ++i) {
+		if (i > 0 && i % RESULTS_PER_PAGE == 0 && !wait_next_page(watch)) break;
+		const MappedFile* doc = idx->documents[hits[i].doc_id];
+		int line = line_of_offset(doc, hits[i].offset);
+		printf("\nResultado %ld - Documento %d: línea %d\n", i + 1, hits[i].doc_id, line);
+		printf("--- Contenido aproximado: ---\n");
+		TextSpan span = { hits[i].offset, (long)strlen(text) };
+		fflush(stdout);
+		write_snippet(STDOUT_FILENO, doc, line, line, &span, 1);
+		printf("------------------------------\n");
+	}
+}
+
+/* "explain: palabras": la busqueda por cercania de siempre, con lo que costo cada parte.
+   Por palabra, las posiciones que reviso el diccionario y el tamano de su lista; por etapa,
+   cuantos documentos y ventanas se miraron y el tiempo de cada una */
+static void show_explain(InvertedIndex* idx, char* text) {
+	if (!QY_IsWordList(text)) {
+		printf("\nexplain: solo explica búsquedas por cercanía (palabras separadas por comas), sin frases ni AND OR NOT.\n");
+		return;
+	}
+	char* words[MAX_QUERY_WORDS];
+	int window = DEFAULT_WORD_WINDOW;
+	int word_count = QY_SplitWords(text, words, MAX_QUERY_WORDS, &window);
+	if (word_count <= 0) {
+		printf("\nIndique entre 1 y %d palabras separadas por comas.\n", MAX_QUERY_WORDS);
+		return;
+	}
+
+	SearchExplain explain;
+	int count = 0;
+	printData* results = II_Explain(idx, words, word_count, window, &count, &explain);
+	printf("\n%-21s %8s %10s %11s\n", "término", "sondeos", "postings", "documentos");
+	for (int i = 0; i < explain.term_count; ++i) {
+		const TermExplain* term = &explain.terms[i];
+		printf("%-20s %8d %10ld %11d\n", term->key, term->probes, term->postings, term->documents);
+	}
+	printf("\n%ld documentos candidatos, %ld ventanas, %ld resultados (distancia %d)\n",
+		explain.candidates, explain.windows, explain.results, window);
+	printf("búsqueda %ld ns, merge %ld ns, ventanas %ld ns, líneas %ld ns\n",
+		explain.lookup_ns, explain.merge_ns, explain.window_ns, explain.lines_ns);
+	for (int i = 0; i < count; ++i) {
+		printf("Documento %d: líneas %d a %d\n", results[i].doc_id,
+			results[i].first_occurrence_line, results[i].last_occurrence_line);
+	}
+	free(results);
+}
+
+/* "memory()": memoria del proceso por categoria (en uso, pico, asignaciones) y lo que el
+   indice tiene reservado sin usar; "compact()" primero lo devuelve con II_Compact */
+static void show_memory(InvertedIndex* idx, BOOLEAN compact) {
+	if (compact) printf("\n%zu KB devueltos\n", II_Compact(idx) >> 10);
+
+	MemoryReport report;
+	II_MemoryReport(idx, &report);
+	printf("\n%-18s %12s %12s %13s %13s\n", "categoría", "en uso (KB)", "pico (KB)", "asignaciones", "sin usar (KB)");
+	for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) {
+		const MemStats* stats = &report.tags[tag];
+		printf("%-17s %12ld %12ld %13ld %13zu\n", mem_tag_name((MemTag)tag),
+			stats->live_bytes >> 10, stats->peak_bytes >> 10, stats->allocations, report.slack[tag] >> 10);
+	}
+	printf("%-17s %12ld %12ld %13ld %13zu\n", "total",
+		report.total.live_bytes >> 10, report.total.peak_bytes >> 10, report.total.allocations, report.total_slack >> 10);
+}
+
+/* Modo con shards: cada consulta va a todos los procesos y se muestran los documentos
+   ordenados por puntaje. Las lineas se leen del archivo recien al mostrarlas */
+static int run_sharded(const char* file_names[], int file_count, int shard_count, int timeout_ms, BOOLEAN short_words) {
+	ShardSet* set = SH_Start(file_names, file_count, shard_count, short_words);
+	if (set == NULL) {
+		fprintf(stderr, "No se pudieron iniciar los shards\n");
+		return EXIT_FAILURE;
+	}
+	printf("%d archivos repartidos en %d shards\n", file_count, SH_ShardCount(set));
+
+	while (1) {
+		show_title();
+		printf("exit() para salir; los documentos salen ordenados por puntaje (BM25)\n");
+		char buffer[100];
+		ask_words(buffer);
+		if (strcmp(buffer, "exit()") == 0) {
+			printf("\nSaliendo...\n");
+			break;
+		}
+
+		ShardHit hits[SHARD_RESULTS];
+		ShardReport report;
+		int count = SH_Search(set, buffer, timeout_ms, hits, SHARD_RESULTS, &report);
+		for (int s = 0; s < report.shard_count; ++s) {
+			if (report.status[s] == SHARD_TIMEOUT) printf("\nShard %d: sin respuesta en %d ms, resultados parciales\n", s, timeout_ms);
+			if (report.status[s] == SHARD_DOWN) printf("\nShard %d: caído, resultados parciales\n", s);
+		}
+		if (count < 0) {
+			printf("\nConsulta fallida: %s\n\n", report.error);
+			continue;
+		}
+		if (count == 0) printf("\nNo se encontraron resultados para los términos especificados.\n");
+
+		for (int i = 0; i < count; ++i) {
+			if (i > 0 && i % RESULTS_PER_PAGE == 0 && !ask_next_page()) break;
+			printf("\nResultado %d de %ld - %s (shard %d): puntaje %.3f, %d coincidencias, la primera en líneas %d a %d\n",
+				i + 1, report.documents, file_names[hits[i].file], hits[i].shard, hits[i].score,
+				hits[i].matches, hits[i].first_line, hits[i].last_line);
+			MappedFile* file = map_file(file_names[hits[i].file]);
+			if (file != NULL) {
+				printf("--- Contenido aproximado: ---\n");
+				fflush(stdout);
+				write_snippet(STDOUT_FILENO, file, hits[i].first_line, hits[i].last_line, NULL, 0);
+				printf("------------------------------\n");
+				unmap_file(file);
+			}
+		}
+		printf("\n\n");
+	}
+
+	SH_Stop(set);
+	return EXIT_SUCCESS;
+}
+
+/* Lo necesario para volver a cargar los archivos, tambien desde el RELOAD del servidor */
+typedef struct _LoadOptions {
+	const char** file_names;
+	int file_count;
+	BOOLEAN short_words;
+	int load_threads;
+	BOOLEAN trigrams;
+	BOOLEAN stemming;
+	BOOLEAN freeze;
+	pthread_mutex_t files_lock;   // con --watch se agregan archivos mientras un rebuild los lee
+} LoadOptions;
+
+/* Arma un indice nuevo con todos los archivos; NULL si alguno no se pudo cargar */
+static InvertedIndex* load_index(void* context) {
+	LoadOptions* options = context;
 	InvertedIndex* idx = II_Create();
-    if (!idx) {
-        fprintf(stderr, "II_Create devolvió NULL\n");
-        return EXIT_FAILURE;
-    }
-    if (!idx->table) {
-        fprintf(stderr, "idx->table es NULL\n");
-        return EXIT_FAILURE;
-    }
+	if (!idx || !idx->table) {
+		fprintf(stderr, "No se pudo crear el índice\n");
+		II_Destroy(idx);
+		return NULL;
+	}
+
+	// los nombres ya agregados no cambian, alcanza con leer cuantos hay
+	pthread_mutex_lock(&options->files_lock);
+	int file_count = options->file_count;
+	pthread_mutex_unlock(&options->files_lock);
 
-	int file_id = II_LoadFile(idx, argv[1]);
-    if (file_id < 0) {
-        fprintf(stderr, "Error cargando fichero '%s'\n", argv[1]);
-        II_Destroy(idx);
+	II_SetIndexShortWords(idx, options->short_words);
+	II_SetLoadPipeline(idx, options->load_threads);
+	II_SetTrigramIndex(idx, options->trigrams);
+	II_SetStemming(idx, options->stemming);
+	for (int f = 0; f < file_count; ++f) {
+		if (II_LoadFile(idx, options->file_names[f]) < 0) {
+			fprintf(stderr, "Error cargando fichero '%s'\n", options->file_names[f]);
+			II_Destroy(idx);
+			return NULL;
+		}
+		if (options->load_threads > 0) PL_PrintStats(stdout, &idx->last_load);
+	}
+	// solo lectura: el diccionario pasa a un hash perfecto; si no se puede, queda la tabla hash
+	if (options->freeze && II_Freeze(idx) < 0) fprintf(stderr, "No se pudo congelar el diccionario\n");
+	return idx;
+}
+
+/* Estado del modo --watch: interactivo, cada archivo cambiado se reindexa en el mismo
+   indice, sin recargar los demas; con --serve las consultas no toman locks, asi que los
+   cambios se publican con un rebuild en otro hilo (SN_Rebuild) */
+struct _WatchState {
+	InvertedIndex* idx;           // interactivo
+	pthread_rwlock_t lock;        // interactivo: la consulta en curso contra la recarga
+	BOOLEAN changed;              // interactivo: el indice de pasajes de "top:" quedo viejo
+	long version;                 // interactivo: recargas hechas, una pagina vieja no sigue
+	IndexHandle* handle;          // servidor
+	LoadOptions* options;         // servidor: la lista de archivos de los rebuilds
+};
+
+/* Entre paginas se suelta el lock: mientras el usuario decide, el watcher puede reindexar.
+   Si lo hizo, el cursor y los resultados de la consulta ya no valen y se deja de paginar */
+static BOOLEAN wait_next_page(WatchState* watch) {
+	long version = watch->version;
+	pthread_rwlock_unlock(&watch->lock);
+	BOOLEAN more = ask_next_page();
+	pthread_rwlock_rdlock(&watch->lock);
+	if (more && watch->version != version) {
+		printf("\nLos libros cambiaron mientras tanto; repita la búsqueda.\n");
+		return FALSE;
+	}
+	return more;
+}
+
+static void on_book_event(const char* name, WatchEvent event, void* context) {
+	WatchState* watch = context;
+	if (event == WATCH_REMOVED) {
+		printf("\n[watch] '%s' ya no está en %s; se mantiene lo indexado\n", name, BOOKS_PATH);
+		fflush(stdout);
+		return;
+	}
+
+	if (watch->handle == NULL) {
+		pthread_rwlock_wrlock(&watch->lock);
+		int id = II_ReloadFile(watch->idx, name);
+		if (id >= 0) {
+			watch->changed = TRUE;
+			watch->version++;
+		}
+		pthread_rwlock_unlock(&watch->lock);
+		if (id >= 0) printf("\n[watch] '%s' indexado como documento %d\n", name, id);
+		else printf("\n[watch] no se pudo indexar '%s' (hasta %d archivos)\n", name, MAX_OPEN_FILES);
+		fflush(stdout);
+		return;
+	}
+
+	LoadOptions* options = watch->options;
+	BOOLEAN listed = FALSE;
+	pthread_mutex_lock(&options->files_lock);
+	for (int f = 0; f < options->file_count && !listed; ++f) listed = strcmp(options->file_names[f], name) == 0;
+	char* added = NULL;
+	if (!listed && options->file_count < MAX_OPEN_FILES && (added = strdup(name)) != NULL) {
+		options->file_names[options->file_count++] = added;
+	}
+	pthread_mutex_unlock(&options->files_lock);
+	if (!listed && added == NULL) {
+		printf("\n[watch] no se pudo agregar '%s' (hasta %d archivos)\n", name, MAX_OPEN_FILES);
+		fflush(stdout);
+		return;
+	}
+
+	// un rebuild que ya estaba corriendo puede no haber visto el cambio: se espera y se arma otro
+	while (SN_Rebuild(watch->handle) < 0) {
+		SnapshotStats stats;
+		SN_GetStats(watch->handle, &stats);
+		if (!stats.rebuilding) break;
+		SN_WaitRebuild(watch->handle);
+	}
+}
+
+/* Modo --build-index: indice en disco con SPIMI, sin pasar de memory_mb MB de postings en
+   memoria (los archivos no tienen el limite de MAX_OPEN_FILES) */
+static int build_disk_index(const char* path, const char* file_names[], int file_count, long memory_mb, BOOLEAN short_words) {
+	SpimiBuilder* builder = SP_Create(NULL, (size_t)memory_mb << 20);
+	if (builder == NULL) {
+		fprintf(stderr, "No se pudo crear el indice\n");
+		return EXIT_FAILURE;
+	}
+	SP_SetIndexShortWords(builder, short_words);
+	for (int f = 0; f < file_count; ++f) {
+		if (SP_AddFile(builder, file_names[f]) < 0) {
+			fprintf(stderr, "Error indexando fichero '%s'\n", file_names[f]);
+			SP_Destroy(builder);
+			return EXIT_FAILURE;
+		}
+	}
+	SpimiStats stats;
+	int result = SP_Finish(builder, path, &stats);
+	SP_Destroy(builder);
+	if (result < 0) {
+		fprintf(stderr, "No se pudo escribir el indice '%s'\n", path);
+		return EXIT_FAILURE;
+	}
+	printf("%d documentos, %ld tokens, %ld terminos en '%s' (%.1f MB)\n", stats.documents, stats.tokens, stats.terms,
+		path, stats.index_bytes / 1048576.0);
+	printf("indexado en %.1f ms con %d runs (pico de %zu KB), merge en %.1f ms y %d pasadas\n", stats.index_ms,
+		stats.runs, stats.peak_memory >> 10, stats.merge_ms, stats.merge_passes);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	const char* file_names[SHARD_MAX_FILES];
+	int file_count = 0;
+	BOOLEAN fuzzy = FALSE;
+	BOOLEAN short_words = FALSE;
+	BOOLEAN bad_usage = FALSE;
+	ServerConfig server = { NULL, SERVER_DEFAULT_WORKERS, SERVER_DEFAULT_QUEUE };
+	int shard_count = 0;
+	int shard_timeout_ms = SHARD_DEFAULT_TIMEOUT_MS;
+	int load_threads = 0;
+	const char* index_path = NULL;
+	BOOLEAN watch_books = FALSE;
+	BOOLEAN trigrams = FALSE;
+	BOOLEAN stemming = FALSE;
+	BOOLEAN freeze = FALSE;
+	long memory_mb = SPIMI_DEFAULT_BUDGET >> 20;
+	for (int a = 1; a < argc; ++a) {
+		if (strcmp(argv[a], "--fuzzy") == 0) fuzzy = TRUE;
+		else if (strcmp(argv[a], "--short-words") == 0) short_words = TRUE;
+		else if (strcmp(argv[a], "--serve") == 0 && a + 1 < argc) server.address = argv[++a];
+		else if (strcmp(argv[a], "--workers") == 0 && a + 1 < argc) server.workers = atoi(argv[++a]);
+		else if (strcmp(argv[a], "--queue") == 0 && a + 1 < argc) server.queue_capacity = atoi(argv[++a]);
+		else if (strcmp(argv[a], "--shards") == 0 && a + 1 < argc) shard_count = atoi(argv[++a]);
+		else if (strcmp(argv[a], "--timeout") == 0 && a + 1 < argc) shard_timeout_ms = atoi(argv[++a]);
+		else if (strcmp(argv[a], "--load-threads") == 0 && a + 1 < argc) load_threads = atoi(argv[++a]);
+		else if (strcmp(argv[a], "--build-index") == 0 && a + 1 < argc) index_path = argv[++a];
+		else if (strcmp(argv[a], "--memory-mb") == 0 && a + 1 < argc) memory_mb = atol(argv[++a]);
+		else if (strcmp(argv[a], "--watch") == 0) watch_books = TRUE;
+		else if (strcmp(argv[a], "--trigrams") == 0) trigrams = TRUE;
+		else if (strcmp(argv[a], "--stem") == 0) stemming = TRUE;
+		else if (strcmp(argv[a], "--freeze") == 0) freeze = TRUE;
+		else if (argv[a][0] != '-' && file_count < SHARD_MAX_FILES) file_names[file_count++] = argv[a];
+		else bad_usage = TRUE;
+	}
+	// un solo indice admite MAX_OPEN_FILES archivos; con shards, MAX_OPEN_FILES por shard
+	if (shard_count < 0 || shard_count > SHARD_MAX_SHARDS) bad_usage = TRUE;
+	if (load_threads < 0 || load_threads > PIPELINE_MAX_TOKENIZERS) bad_usage = TRUE;
+	if (memory_mb < 1) bad_usage = TRUE;
+	if ((watch_books || stemming || freeze) && (shard_count > 0 || index_path != NULL)) bad_usage = TRUE;
+	// un indice congelado no se recarga: con --watch hace falta --serve, que arma uno nuevo
+	if (freeze && watch_books && server.address == NULL) bad_usage = TRUE;
+	if (index_path == NULL && file_count > (shard_count > 0 ? shard_count : 1) * MAX_OPEN_FILES) bad_usage = TRUE;
+	if (file_count == 0 || bad_usage) {
+        printf("Usage: %s [--fuzzy] [--short-words] [--load-threads N] [--serve <socket|port> [--workers N] [--queue N]] "
+               "[--shards N [--timeout MS]] [--build-index <path> [--memory-mb N]] [--watch] [--trigrams] [--stem] [--freeze] <file>...\n", argv[0]);
+        printf("  hasta %d archivos, o %d por shard con --shards (1..%d)\n", MAX_OPEN_FILES, MAX_OPEN_FILES, SHARD_MAX_SHARDS);
+        printf("  --load-threads: tokenizadores del pipeline de carga (1..%d), 0 carga en un hilo\n", PIPELINE_MAX_TOKENIZERS);
+        printf("  --build-index: escribe un indice en disco (hasta %d archivos) usando como maximo --memory-mb MB (%zu)\n",
+               SHARD_MAX_FILES, SPIMI_DEFAULT_BUDGET >> 20);
+        printf("  --trigrams: indice de trigramas para las busquedas \"sub: texto\" dentro de palabras\n");
+        printf("  --stem: indexa y busca por la raiz de cada palabra (caballero, caballeros, ...)\n");
+        printf("  --freeze: al terminar de cargar, el diccionario pasa a un hash perfecto de solo lectura\n");
+        printf("  --watch: reindexa los archivos de %s que cambian y agrega los nuevos, sin reiniciar\n", BOOKS_PATH);
         return EXIT_FAILURE;
     }
 
-	char buffer[100];
-    char* terms[20];
+	if (index_path != NULL) return build_disk_index(index_path, file_names, file_count, memory_mb, short_words);
+
+	if (shard_count > 0) return run_sharded(file_names, file_count, shard_count, shard_timeout_ms, short_words);
+
+	LoadOptions options = { file_names, file_count, short_words, load_threads, trigrams, stemming, freeze, PTHREAD_MUTEX_INITIALIZER };
+	int listed_files = file_count;
+	InvertedIndex* idx = load_index(&options);
+	if (idx == NULL) return EXIT_FAILURE;
+
+	WatchState watch = { idx, PTHREAD_RWLOCK_INITIALIZER, FALSE, 0, NULL, &options };
+	Watcher* watcher = NULL;
+
+	// modo servidor: se consulta por el socket hasta SIGINT o SHUTDOWN; RELOAD vuelve a cargar
+	// los archivos en otro hilo y el indice nuevo reemplaza al anterior sin cortar las consultas
+	if (server.address != NULL) {
+		ServerStats stats;
+		IndexHandle* handle = SN_Create(idx, load_index, &options);
+		if (handle == NULL) {
+			II_Destroy(idx);
+			return EXIT_FAILURE;
+		}
+		watch.handle = handle;
+		if (watch_books && (watcher = WT_Start(BOOKS_PATH, WATCH_DEBOUNCE_MS, on_book_event, &watch)) == NULL) {
+			fprintf(stderr, "No se pudo vigilar '%s'\n", BOOKS_PATH);
+		}
+		printf("Sirviendo consultas en %s (%d workers, cola de %d)\n", server.address, server.workers, server.queue_capacity);
+		fflush(stdout);
+		int result = SV_RunHandle(handle, &server, &stats);
+		WT_Stop(watcher);
+		for (int f = listed_files; f < options.file_count; ++f) free((char*)options.file_names[f]);
+		if (result != 0) {
+			fprintf(stderr, "No se pudo escuchar en '%s'\n", server.address);
+			SN_Destroy(handle);
+			return EXIT_FAILURE;
+		}
+		printf("%ld consultas (%ld con error) en %.1f s: %.1f consultas/s, latencia media %.1f us, p50 <= %.0f us, p99 <= %.0f us, max %.1f us\n",
+			stats.requests, stats.errors, stats.elapsed_seconds,
+			stats.elapsed_seconds > 0 ? stats.requests / stats.elapsed_seconds : 0,
+			stats.mean_latency_us, stats.p50_latency_us, stats.p99_latency_us, stats.max_latency_us);
+		SN_Destroy(handle);
+		return EXIT_SUCCESS;
+	}
+
+	if (watch_books && (watcher = WT_Start(BOOKS_PATH, WATCH_DEBOUNCE_MS, on_book_event, &watch)) == NULL) {
+		fprintf(stderr, "No se pudo vigilar '%s'\n", BOOKS_PATH);
+	}
+
     int term_count;
-    printData *results;
-    int result_count;
+	RankedIndex *rank = NULL;
 	while (1){
 		show_title();
-		printf("exit() para salir\n");
+		printf("exit() para salir, ~N limita la distancia a N palabras, AND OR NOT NEAR/N y ( ) combinan palabras\n");
+		printf("top: palabras muestra los pasajes con mejor puntaje (BM25), sub: texto lo busca también dentro de palabras\n");
+		printf("explain: palabras muestra lo que costó cada etapa de la búsqueda, memory() y compact() la memoria del índice\n");
 		char buffer[100];
 		ask_words(buffer);
 
@@ -60,56 +518,146 @@ int main(int argc, char** argv) {
             break;
         }
 
+		if (strcmp(buffer, "memory()") == 0 || strcmp(buffer, "compact()") == 0) {
+			// compactar mueve los buffers de ordinales: con --watch se espera a que no haya recargas
+			BOOLEAN compact = buffer[0] == 'c';
+			if (compact) pthread_rwlock_wrlock(&watch.lock);
+			else pthread_rwlock_rdlock(&watch.lock);
+			show_memory(idx, compact);
+			pthread_rwlock_unlock(&watch.lock);
+			printf("\n\n");
+			continue;
+		}
+
+		// con --watch un archivo no se reindexa en medio de una consulta (si entre paginas)
+		pthread_rwlock_rdlock(&watch.lock);
+		if (watch.changed) {
+			RK_Destroy(rank);
+			rank = NULL;
+			watch.changed = FALSE;
+		}
+
+		if (strncmp(buffer, "top:", 4) == 0) {
+			show_top_passages(&watch, idx, &rank, buffer + 4);
+			pthread_rwlock_unlock(&watch.lock);
+			printf("\n\n");
+			continue;
+		}
+
+		if (strncmp(buffer, "sub:", 4) == 0) {
+			show_substring(&watch, idx, buffer + 4);
+			pthread_rwlock_unlock(&watch.lock);
+			printf("\n\n");
+			continue;
+		}
+
+		if (strncmp(buffer, "explain:", 8) == 0) {
+			show_explain(idx, buffer + 8);
+			pthread_rwlock_unlock(&watch.lock);
+			printf("\n\n");
+			continue;
+		}
+
 		char *terms[20];
+		char *query[20];
 		term_count = 0;
-		char *tok = strtok(buffer, ",");
-		while (tok && term_count < 20) {
-			// recortamos espacios iniciales/finales
-			while (*tok == ' ') tok++;
-			char *end = tok + strlen(tok) - 1;
-			while (end > tok && *end == ' ') *end-- = '\0';
 
-			// duplicamos en un buffer modifiable que incluye '\0'
-			terms[term_count] = malloc(strlen(tok) + 1);
-			strcpy(terms[term_count], tok);
-			term_count++;
+		SearchCursor *search = NULL;
+		QueryNode *plan = NULL;
+		QueryCursor *boolean_search = NULL;
+		char *phrase = NULL;
+		int highlight_count = 0;
+		if (buffer[0] == '"') {
+			// "frase exacta": se resuelve con los ordinales de los tokens
+			phrase = buffer + 1;
+			phrase[strcspn(phrase, "\"")] = '\0';
+			search = II_PhraseOpen(idx, phrase);
+		} else if (QY_IsBoolean(buffer)) {
+			// consulta booleana: se planifica (terminos raros primero) y se evalua de a un match
+			char error[QUERY_ERROR_LENGTH];
+			QueryNode *parsed = QY_Parse(buffer, DEFAULT_WORD_WINDOW, error, sizeof(error));
+			if (parsed == NULL) {
+				pthread_rwlock_unlock(&watch.lock);
+				printf("\nConsulta inválida: %s\n\n", error);
+				continue;
+			}
+			plan = QY_Plan(idx, parsed);
+			boolean_search = QY_Open(idx, plan);
+			if (boolean_search == NULL) {
+				QY_Free(plan);
+				pthread_rwlock_unlock(&watch.lock);
+				printf("\nNo se pudo evaluar la consulta.\n\n");
+				continue;
+			}
+			highlight_count = QY_Terms(plan, query, 20);
+		} else {
+			int window = DEFAULT_WORD_WINDOW;
+			char *tok = strtok(buffer, ",");
+			while (tok && term_count < 20) {
+				// recortamos espacios iniciales/finales
+				while (*tok == ' ') tok++;
+				char *end = tok + strlen(tok) - 1;
+				while (end > tok && *end == ' ') *end-- = '\0';
+
+				// "~N" fija la distancia maxima en palabras para esta consulta
+				if (tok[0] == '~' && atoi(tok + 1) > 0) {
+					window = atoi(tok + 1);
+					tok = strtok(NULL, ",");
+					continue;
+				}
 
-			tok = strtok(NULL, ",");
+				// duplicamos en un buffer modifiable que incluye '\0'
+				terms[term_count] = malloc(strlen(tok) + 1);
+				strcpy(terms[term_count], tok);
+				term_count++;
+
+				tok = strtok(NULL, ",");
+			}
+
+			// with --fuzzy, misspelled words are replaced by their closest dictionary term
+			if (fuzzy) {
+				II_CorrectWords(idx, terms, term_count, FUZZY_MAX_DISTANCE, query);
+				for (int i = 0; i < term_count; ++i) {
+					if (query[i] != terms[i]) show_correction(terms[i], query[i]);
+				}
+			} else {
+				for (int i = 0; i < term_count; ++i) query[i] = terms[i];
+			}
+
+			search = II_SearchOpen(idx, query, term_count, window);
+			highlight_count = term_count;
 		}
 
-		result_count = 0;
-		results = II_Search(idx, terms, term_count, &result_count);
+		int shown;
+		if (boolean_search != NULL) {
+			shown = page_results(&watch, idx, boolean_search, next_query, query, highlight_count);
+			QY_Close(boolean_search);
+			QY_Free(plan);
+		} else {
+			shown = page_results(&watch, idx, search, next_search, phrase != NULL ? &phrase : query, phrase != NULL ? 1 : highlight_count);
+			II_SearchClose(search);
+		}
 
-		if (result_count == 0) {
+		if (shown == 0) {
 			printf("\nNo se encontraron resultados para los términos especificados.\n");
-		} else {
-			printf("\nResultados encontrados (%d):\n", result_count);
-			for (int i = 0; i < result_count; ++i) {
-				printf("Documento %d: líneas %d a %d\n",
-					results[i].doc_id,
-					results[i].first_occurrence_line,
-					results[i].last_occurrence_line);
-				printf("--- Contenido aproximado: ---\n");
-				FILE *f = idx->opened_files[results[i].doc_id];
-				fseek(f, 0, SEEK_SET);
-				print_lines(f,
-							results[i].first_occurrence_line,
-							results[i].last_occurrence_line);
-				printf("------------------------------\n");
+			for (int i = 0; i < term_count; ++i) {
+				termCandidate candidates[FUZZY_MAX_CANDIDATES];
+				int n = II_FuzzyLookup(idx, query[i], FUZZY_MAX_DISTANCE, candidates, FUZZY_MAX_CANDIDATES);
+				if (n > 0 && candidates[0].distance > 0) show_suggestions(query[i], candidates, n);
 			}
 		}
 
         for (int i = 0; i < term_count; ++i) {
             free(terms[i]);
         }
-
-        free(results);
+		pthread_rwlock_unlock(&watch.lock);
 
         printf("\n\n");
 	}
 	
 
-	for (int i = 0; i < term_count; ++i) free(terms[i]);
+	WT_Stop(watcher);
+	RK_Destroy(rank);
     II_Destroy(idx);
 
     return EXIT_SUCCESS;
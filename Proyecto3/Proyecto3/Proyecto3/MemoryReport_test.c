@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "InvertedIndex.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static int search_count(const InvertedIndex* idx, char* words[], int count, printData* first) {
+    int found;
+    printData* results = II_Search(idx, words, count, &found);
+    if (found > 0) *first = results[0];
+    free(results);
+    return found;
+}
+
+static void assert_nothing_live(void) {
+    MemoryReport report;
+    II_MemoryReport(NULL, &report);
+    for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) {
+        assert(report.tags[tag].live_bytes == 0 && report.tags[tag].live_blocks == 0);
+    }
+    assert(report.total.live_bytes == 0 && report.total_slack == 0);
+}
+
+int main(void) {
+    // Sin congelar los ordinales quedan vectores con lugar de sobra
+    InvertedIndex* idx = II_Create();
+    II_SetHybridPostings(idx, FALSE);
+    assert(II_LoadFile(idx, "DonQuijote.txt") == 0 && II_LoadFile(idx, "lobo.txt") == 1);
+    assert(II_ReloadFile(idx, "lobo.txt") == 1);
+
+    MemoryReport report;
+    II_MemoryReport(idx, &report);
+    // una celda y una clave por palabra del diccionario
+    assert(report.tags[MEM_TABLE_CELLS].live_blocks == HTSize(idx->table));
+    assert(report.tags[MEM_TABLE_KEYS].live_blocks == HTSize(idx->table));
+    assert(report.tags[MEM_TABLE_CELLS].live_bytes == (long)(HTSize(idx->table) * sizeof(Celda)));
+    assert(report.tags[MEM_OCCURRENCES].live_bytes > 0 && report.tags[MEM_FUZZY].live_bytes > 0);
+    assert(report.tags[MEM_ARRAYLIST_HEADERS].live_blocks == 2);
+    // una tabla de lineas por documento mapeado, y sin trigramas no hay indices de trigramas
+    assert(report.tags[MEM_LINE_TABLES].live_blocks == 2);
+    assert(report.tags[MEM_TRIGRAMS].live_bytes == 0);
+    assert(report.tags[MEM_PERFECT_HASH].live_bytes == 0);
+    assert(report.slack[MEM_ORDINALS] > 0 && report.slack[MEM_TABLE_SLOTS] > 0);
+    for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) {
+        assert(report.tags[tag].peak_bytes >= report.tags[tag].live_bytes);
+        assert(report.slack[tag] <= (size_t)report.tags[tag].live_bytes);
+    }
+    assert(report.total.live_bytes > report.tags[MEM_OCCURRENCES].live_bytes);
+
+    // Compactar devuelve todo lo que sobraba menos los lugares vacios de la tabla hash
+    char* words[] = { "sancho", "rucio" };
+    printData before, after;
+    int found = search_count(idx, words, 2, &before);
+    long postings = II_TermCount(idx, "sancho");
+    size_t released = II_Compact(idx);
+    MemoryReport compacted;
+    II_MemoryReport(idx, &compacted);
+    assert(released > 0 && released == report.total_slack - compacted.total_slack);
+    assert(compacted.total_slack == compacted.slack[MEM_TABLE_SLOTS]);
+    assert(compacted.tags[MEM_ORDINALS].live_bytes ==
+           report.tags[MEM_ORDINALS].live_bytes - (long)report.slack[MEM_ORDINALS]);
+    assert(II_Compact(idx) == 0);
+
+    // y el indice contesta igual, y sigue cargando
+    assert(search_count(idx, words, 2, &after) == found && found > 0);
+    assert(memcmp(&before, &after, sizeof(printData)) == 0);
+    assert(II_TermCount(idx, "sancho") == postings);
+    assert(II_LoadFile(idx, "tesoro.txt") == 2 && II_TermCount(idx, "sancho") >= postings);
+    II_Destroy(idx);
+    assert_nothing_live();
+
+    // Congelado: la tabla hash desaparece del informe y aparece el hash perfecto
+    idx = II_Create();
+    II_SetTrigramIndex(idx, TRUE);
+    assert(II_LoadFile(idx, "lobo.txt") == 0 && II_Freeze(idx) == 0);
+    II_MemoryReport(idx, &report);
+    assert(report.tags[MEM_TABLE_SLOTS].live_bytes == 0 && report.tags[MEM_TABLE_CELLS].live_bytes == 0);
+    assert(report.tags[MEM_PERFECT_HASH].live_bytes == (long)PH_Memory(idx->frozen_terms));
+    assert(report.slack[MEM_TABLE_SLOTS] == 0);
+    assert(report.tags[MEM_TRIGRAMS].live_bytes == (long)TG_Memory(idx->trigrams[0]));
+    II_Compact(idx);
+    assert(II_TermCount(idx, "lobo") > 0);
+    II_Destroy(idx);
+    assert_nothing_live();
+
+    printf("MemoryReport tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -5,65 +5,76 @@
 
  #include <stdlib.h>
  #include "occurrence.h"
+ #include "../Allocator/allocator.h"
  
- /**
-  * Creates a new occurrence with initial position
-  */
- Occurrence* CreateOccurrence(int doc_id, int position) {
+ #define FREEZE_STACK_ORDINALS 64  // ordinals widened on the stack by FreezeOccurrence
+ 
+ /* Allocates an occurrence with an empty (inline) vector */
+ static Occurrence* NewOccurrence(int doc_id) {
      Occurrence* occurrence;
-     ArrayList* positions;
      
-     if (position < 0) {
+     occurrence = (Occurrence*)mem_malloc(MEM_OCCURRENCES, sizeof(Occurrence));
+     if (occurrence == NULL) {
          return NULL;
      }
      
-     // Create positions list
-     positions = arraylist_create(5, sizeof(int));
-     if (positions == NULL) {
-         return NULL;
-     }
+     occurrence->doc_id = doc_id;
+     u32vec_init(&occurrence->ordinals);
+     occurrence->ordinal_set = NULL;
+     occurrence->next = NULL;
      
-     // Add initial position
-     if (!arraylist_add(positions, &position)) {
-         arraylist_destroy(positions);
-         return NULL;
-     }
+     return occurrence;
+ }
+ 
+ /**
+  * Creates a new occurrence with initial position
+  */
+ Occurrence* CreateOccurrence(int doc_id, long position) {
+     Occurrence* occurrence;
      
-     // Create occurrence
-     occurrence = (Occurrence*)malloc(sizeof(Occurrence));
+     // Create occurrence, the first positions are stored inline
+     occurrence = NewOccurrence(doc_id);
      if (occurrence == NULL) {
-         arraylist_destroy(positions);
          return NULL;
      }
      
-     // Initialize occurrence
-     occurrence->doc_id = doc_id;
-     occurrence->positions_list = positions;
-     occurrence->next = NULL;
+     // Add initial position
+     if (!AddPositionToOccurrence(occurrence, position)) {
+         FreeOccurrence(occurrence);
+         return NULL;
+     }
      
      return occurrence;
  }
  
  /**
-  * Creates a new occurrence with existing positions list
+  * Creates a new occurrence with a copy of existing positions
   */
- Occurrence* CreateOccurrenceWithPositions(int doc_id, ArrayList* positions_list) {
+ Occurrence* CreateOccurrenceWithPositions(int doc_id, const long* positions, size_t count) {
      Occurrence* occurrence;
+     size_t i;
      
-     if (positions_list == NULL) {
+     if (positions == NULL && count > 0) {
          return NULL;
      }
      
      // Create occurrence
-     occurrence = (Occurrence*)malloc(sizeof(Occurrence));
+     occurrence = NewOccurrence(doc_id);
      if (occurrence == NULL) {
          return NULL;
      }
      
-     // Initialize occurrence
-     occurrence->doc_id = doc_id;
-     occurrence->positions_list = positions_list;
-     occurrence->next = NULL;
+     // Copy positions
+     if (!u32vec_reserve(&occurrence->ordinals, count)) {
+         FreeOccurrence(occurrence);
+         return NULL;
+     }
+     for (i = 0; i < count; i++) {
+         if (!AddPositionToOccurrence(occurrence, positions[i])) {
+             FreeOccurrence(occurrence);
+             return NULL;
+         }
+     }
      
      return occurrence;
  }
@@ -71,20 +82,9 @@
  /**
   * Adds a new position to an occurrence
   */
- int AddPositionToOccurrence(Occurrence* occurrence, int position) {
-     if (occurrence == NULL || position < 0) {
-         return 0;
-     }
-     
-     // Check if positions list exists
-     if (occurrence->positions_list == NULL) {
-         occurrence->positions_list = arraylist_create(5, sizeof(int));
-         if (occurrence->positions_list == NULL) {
-             return 0;
-         }
-     }
-     
-     return arraylist_add(occurrence->positions_list, &position);
+ int AddPositionToOccurrence(Occurrence* occurrence, long position) {
+     // Positions and token ordinals share the same storage
+     return AddTokenToOccurrence(occurrence, position);
  }
  
  /**
@@ -98,7 +98,7 @@
      }
      
      // Allocate memory for the list
-     list = (OccurrenceList*)malloc(sizeof(OccurrenceList));
+     list = (OccurrenceList*)mem_malloc(MEM_OCCURRENCES, sizeof(OccurrenceList));
      if (list == NULL) {
          return NULL;
      }
@@ -117,17 +117,20 @@
  OccurrenceList* CreateEmptyOccurrenceList(void) {
      OccurrenceList* list;
      
-     list = (OccurrenceList*)malloc(sizeof(OccurrenceList));
+     list = (OccurrenceList*)mem_malloc(MEM_OCCURRENCES, sizeof(OccurrenceList));
      if (list == NULL) {
          return NULL;
      }
      
+     InitOccurrenceList(list);
+     return list;
+ }
+ 
+ void InitOccurrenceList(OccurrenceList* list) {
      // Initialize as empty list
      list->first = NULL;
      list->last = NULL;
      list->count = 0;
-     
-     return list;
  }
  
  /**
@@ -180,7 +183,7 @@
  /**
   * Adds a position to an occurrence for a specific document
   */
- int AddPositionToDocument(OccurrenceList* list, int doc_id, int position) {
+ int AddPositionToDocument(OccurrenceList* list, int doc_id, long position) {
      Occurrence* occurrence;
      
      if (list == NULL || position < 0) {
@@ -230,8 +233,8 @@
      occurrence = FindOccurrenceByDocId(list, doc_id);
      
      // If found, return position count
-     if (occurrence != NULL && occurrence->positions_list != NULL) {
-         return (int)arraylist_size(occurrence->positions_list);
+     if (occurrence != NULL) {
+         return (int)u32vec_size(&occurrence->ordinals);
      }
      
      return 0;
@@ -270,6 +273,340 @@
      return 1;
  }
  
+ /**
+  * Creates a new token occurrence
+  */
+ Occurrence* CreateTokenOccurrence(int doc_id, long ordinal) {
+     Occurrence* occurrence;
+     
+     if (ordinal < 0) {
+         return NULL;
+     }
+     
+     occurrence = NewOccurrence(doc_id);
+     if (occurrence == NULL) {
+         return NULL;
+     }
+     
+     if (!AddTokenToOccurrence(occurrence, ordinal)) {
+         FreeOccurrence(occurrence);
+         return NULL;
+     }
+     
+     return occurrence;
+ }
+ 
+ /**
+  * Adds a token to an occurrence
+  */
+ int AddTokenToOccurrence(Occurrence* occurrence, long ordinal) {
+     if (occurrence == NULL || ordinal < 0 || ordinal > (long)UINT32_MAX) {
+         return 0;
+     }
+     
+     return u32vec_push(&occurrence->ordinals, (uint32_t)ordinal);
+ }
+ 
+ /**
+  * Adds a token to the occurrence of a specific document
+  */
+ int AddTokenToDocument(OccurrenceList* list, int doc_id, long ordinal) {
+     Occurrence* occurrence;
+     Occurrence** link;
+     
+     if (list == NULL || ordinal < 0) {
+         return 0;
+     }
+     
+     // Tokens arrive in document order, so the document is almost always the last one
+     occurrence = (list->last != NULL && list->last->doc_id == doc_id)
+                  ? list->last : FindOccurrenceByDocId(list, doc_id);
+     if (occurrence != NULL) {
+         return AddTokenToOccurrence(occurrence, ordinal);
+     }
+     
+     occurrence = CreateTokenOccurrence(doc_id, ordinal);
+     if (occurrence == NULL) {
+         return 0;
+     }
+     
+     if (list->last == NULL || list->last->doc_id < doc_id) {
+         return AddOccurrence(list, occurrence);
+     }
+     
+     // A document loaded again lands before the ones loaded after it
+     link = &list->first;
+     while ((*link)->doc_id < doc_id) {
+         link = &(*link)->next;
+     }
+     occurrence->next = *link;
+     *link = occurrence;
+     list->count++;
+     return 1;
+ }
+ 
+ /**
+  * Unlinks the occurrence of a document, keeping last valid
+  */
+ int RemoveDocument(OccurrenceList* list, int doc_id) {
+     Occurrence* previous = NULL;
+     Occurrence* current;
+     
+     if (list == NULL) {
+         return 0;
+     }
+     
+     current = list->first;
+     while (current != NULL && current->doc_id != doc_id) {
+         previous = current;
+         current = current->next;
+     }
+     if (current == NULL) {
+         return 0;
+     }
+     
+     if (previous == NULL) {
+         list->first = current->next;
+     } else {
+         previous->next = current->next;
+     }
+     if (list->last == current) {
+         list->last = previous;
+     }
+     list->count--;
+     current->next = NULL;
+     FreeOccurrence(current);
+     return 1;
+ }
+ 
+ /**
+  * Moves the ordinals to a compressed set when that saves memory
+  */
+ int FreezeOccurrence(Occurrence* occurrence) {
+     long small[FREEZE_STACK_ORDINALS];
+     long* values;
+     const uint32_t* ordinals;
+     PostingSet* set;
+     size_t count, i;
+     
+     if (occurrence == NULL) {
+         return 0;
+     }
+     count = u32vec_size(&occurrence->ordinals);
+     if (occurrence->ordinal_set != NULL || count == 0) {
+         return 1;
+     }
+     
+     // Inline ordinals cost nothing beyond the occurrence itself
+     if (u32vec_heap_bytes(&occurrence->ordinals) == 0) {
+         return 1;
+     }
+     
+     // PostingSets are built from longs: widen the ordinals, on the stack when they are few
+     values = count <= FREEZE_STACK_ORDINALS ? small : (long*)malloc(count * sizeof(long));
+     if (values == NULL) {
+         return 0;
+     }
+     ordinals = u32vec_cdata(&occurrence->ordinals);
+     for (i = 0; i < count; i++) {
+         values[i] = (long)ordinals[i];
+     }
+     set = postings_from_sorted(values, count);
+     if (values != small) {
+         free(values);
+     }
+     if (set == NULL) {
+         return 0;
+     }
+     
+     // Keep the vector when the set wouldn't be smaller
+     if (postings_memory(set) >= u32vec_heap_bytes(&occurrence->ordinals)) {
+         postings_destroy(set);
+         return 1;
+     }
+     
+     u32vec_free(&occurrence->ordinals);
+     occurrence->ordinal_set = set;
+     return 1;
+ }
+ 
+ /**
+  * Gets the number of ordinals of an occurrence
+  */
+ size_t GetOrdinalCount(const Occurrence* occurrence) {
+     if (occurrence == NULL) {
+         return 0;
+     }
+     if (occurrence->ordinal_set != NULL) {
+         return postings_count(occurrence->ordinal_set);
+     }
+     return u32vec_size(&occurrence->ordinals);
+ }
+ 
+ /**
+  * Gets the bytes allocated by an occurrence
+  */
+ size_t GetOccurrenceMemory(const Occurrence* occurrence) {
+     if (occurrence == NULL) {
+         return 0;
+     }
+     
+     // Inline vector storage is part of sizeof(Occurrence)
+     return sizeof(Occurrence) + u32vec_heap_bytes(&occurrence->ordinals) + postings_memory(occurrence->ordinal_set);
+ }
+ 
+ size_t GetOccurrenceSlack(const Occurrence* occurrence) {
+     if (occurrence == NULL || u32vec_heap_bytes(&occurrence->ordinals) == 0) {
+         return 0;
+     }
+     return u32vec_heap_bytes(&occurrence->ordinals) - u32vec_size(&occurrence->ordinals) * sizeof(uint32_t);
+ }
+ 
+ size_t TrimOccurrence(Occurrence* occurrence) {
+     if (occurrence == NULL) {
+         return 0;
+     }
+     return u32vec_shrink(&occurrence->ordinals);
+ }
+ 
+ /* Skips documents that have no ordinals recorded */
+ static void SkipEmptyDocuments(PostingCursor* cursor) {
+     while (cursor->current != NULL && GetOrdinalCount(cursor->current) == 0) {
+         cursor->current = cursor->current->next;
+     }
+     cursor->index = 0;
+     if (cursor->current != NULL && cursor->current->ordinal_set != NULL) {
+         postings_iter_open(&cursor->ordinals, cursor->current->ordinal_set);
+     }
+ }
+ 
+ /**
+  * Places a cursor on the first ordinal of the first document of a list
+  */
+ void OpenPostingCursor(PostingCursor* cursor, const OccurrenceList* list) {
+     if (cursor == NULL) {
+         return;
+     }
+     
+     cursor->current = list != NULL ? list->first : NULL;
+     SkipEmptyDocuments(cursor);
+ }
+ 
+ /**
+  * Gets the document the cursor is on
+  */
+ int CursorDocument(const PostingCursor* cursor) {
+     if (cursor == NULL || cursor->current == NULL) {
+         return -1;
+     }
+     
+     return cursor->current->doc_id;
+ }
+ 
+ /**
+  * Gets the ordinal the cursor is on
+  */
+ long CursorOrdinal(const PostingCursor* cursor) {
+     if (cursor == NULL || cursor->current == NULL) {
+         return -1;
+     }
+     if (cursor->current->ordinal_set != NULL) {
+         return cursor->ordinals.value;
+     }
+     if (cursor->index >= u32vec_size(&cursor->current->ordinals)) {
+         return -1;
+     }
+     
+     return (long)u32vec_get(&cursor->current->ordinals, cursor->index);
+ }
+ 
+ /**
+  * Advances the cursor to the first document with an ID >= doc_id
+  */
+ int CursorSeekDocument(PostingCursor* cursor, int doc_id) {
+     if (cursor == NULL || cursor->current == NULL) {
+         return -1;
+     }
+     
+     if (cursor->current->doc_id >= doc_id) {
+         return cursor->current->doc_id;
+     }
+     
+     while (cursor->current != NULL && cursor->current->doc_id < doc_id) {
+         cursor->current = cursor->current->next;
+     }
+     SkipEmptyDocuments(cursor);
+     
+     return CursorDocument(cursor);
+ }
+ 
+ /**
+  * Advances the cursor within its document to the first ordinal >= ordinal
+  */
+ int CursorSeekOrdinal(PostingCursor* cursor, long ordinal) {
+     const uint32_t* ordinals;
+     size_t size, low, high, step;
+     
+     if (cursor == NULL || cursor->current == NULL) {
+         return 0;
+     }
+     if (cursor->current->ordinal_set != NULL) {
+         return postings_iter_seek(&cursor->ordinals, ordinal);
+     }
+     
+     ordinals = u32vec_cdata(&cursor->current->ordinals);
+     size = u32vec_size(&cursor->current->ordinals);
+     low = cursor->index;
+     if (low >= size) {
+         return 0;
+     }
+     if ((long)ordinals[low] >= ordinal) {
+         return 1;
+     }
+     
+     // Gallop forward until the target is bracketed, then binary search
+     step = 1;
+     high = low + step;
+     while (high < size && (long)ordinals[high] < ordinal) {
+         low = high;
+         step *= 2;
+         high = low + step;
+     }
+     if (high > size) {
+         high = size;
+     }
+     
+     // Invariant: ordinals[low] < ordinal, ordinals[high] >= ordinal (or high == size)
+     while (high - low > 1) {
+         size_t mid = low + (high - low) / 2;
+         if ((long)ordinals[mid] < ordinal) {
+             low = mid;
+         } else {
+             high = mid;
+         }
+     }
+     
+     cursor->index = high;
+     return high < size;
+ }
+ 
+ /**
+  * Advances the cursor to the next ordinal of its document
+  */
+ int CursorNextOrdinal(PostingCursor* cursor) {
+     if (cursor == NULL || cursor->current == NULL) {
+         return 0;
+     }
+     if (cursor->current->ordinal_set != NULL) {
+         return postings_iter_next(&cursor->ordinals);
+     }
+     if (cursor->index >= u32vec_size(&cursor->current->ordinals)) {
+         return 0;
+     }
+     
+     return ++cursor->index < u32vec_size(&cursor->current->ordinals);
+ }
+ 
  /**
   * Frees all memory associated with an occurrence
   */
@@ -278,26 +615,32 @@
          return;
      }
      
-     // Free the positions list if it exists
-     if (occurrence->positions_list != NULL) {
-         arraylist_destroy(occurrence->positions_list);
-     }
+     // Free the vector if it spilled to the heap
+     u32vec_free(&occurrence->ordinals);
+     postings_destroy(occurrence->ordinal_set);
      
      // Free the occurrence itself
-     free(occurrence);
+     mem_free(MEM_OCCURRENCES, occurrence, sizeof(Occurrence));
  }
  
  /**
   * Frees all memory associated with an occurrence list
   */
  void FreeOccurrenceList(OccurrenceList* list) {
-     Occurrence* current;
-     Occurrence* next;
-     
      if (list == NULL) {
          return;
      }
      
+     ClearOccurrenceList(list);
+     
+     // Free the list itself
+     mem_free(MEM_OCCURRENCES, list, sizeof(OccurrenceList));
+ }
+ 
+ void ClearOccurrenceList(OccurrenceList* list) {
+     Occurrence* current;
+     Occurrence* next;
+     
      // Free all occurrences in the list
      current = list->first;
      while (current != NULL) {
@@ -305,7 +648,5 @@
          FreeOccurrence(current);
          current = next;
      }
-     
-     // Free the list itself
-     free(list);
+     InitOccurrenceList(list);
  }
\ No newline at end of file
@@ -7,14 +7,16 @@
  #define OCCURRENCE_H
  
  #include <stdlib.h>
- #include "../ArrayList/arraylist.h"
+ #include "../Vector/vector.h"
+ #include "../Postings/postings.h"
  
  /**
   * Represents a single occurrence of a word in a document
   */
  typedef struct _Occurrence {
      int doc_id;
-     ArrayList* positions_list;  // List of positions in the document
+     U32Vector ordinals;         // Positions (token ordinals) in the document, inline up to 4
+     PostingSet* ordinal_set;    // Ordinals once frozen (FreezeOccurrence), replacing the vector
      struct _Occurrence* next;
  } Occurrence;
  
@@ -27,23 +29,35 @@
      int count;
  } OccurrenceList;
  
+ /**
+  * Read-only cursor over the (document, ordinal) postings of an occurrence list.
+  * Documents are visited in list order, which is ascending doc_id order when
+  * documents are appended as they are loaded.
+  */
+ typedef struct _PostingCursor {
+     const Occurrence* current;  // Current document, NULL once exhausted
+     size_t index;               // Current entry of current->ordinals
+     PostingIterator ordinals;   // Current entry of current->ordinal_set, when frozen
+ } PostingCursor;
+ 
  /**
   * Creates a new occurrence
   * 
   * @param doc_id Document identifier
-  * @param position Initial position of the word in the document
+  * @param position Initial position (token ordinal) of the word in the document
   * @return A pointer to the new occurrence or NULL if memory allocation fails
   */
- Occurrence* CreateOccurrence(int doc_id, int position);
+ Occurrence* CreateOccurrence(int doc_id, long position);
  
  /**
-  * Creates a new occurrence with an existing list of positions
+  * Creates a new occurrence with a copy of existing positions
   * 
   * @param doc_id Document identifier
-  * @param positions_list Existing ArrayList of positions
+  * @param positions Positions of the word in the document
+  * @param count Number of positions
   * @return A pointer to the new occurrence or NULL if memory allocation fails
   */
- Occurrence* CreateOccurrenceWithPositions(int doc_id, ArrayList* positions_list);
+ Occurrence* CreateOccurrenceWithPositions(int doc_id, const long* positions, size_t count);
  
  /**
   * Adds a new position to an occurrence
@@ -52,7 +66,7 @@
   * @param position The position to add
   * @return 1 if successful, 0 if failed
   */
- int AddPositionToOccurrence(Occurrence* occurrence, int position);
+ int AddPositionToOccurrence(Occurrence* occurrence, long position);
  
  /**
   * Creates a new occurrence list with a single occurrence
@@ -69,6 +83,13 @@
   */
  OccurrenceList* CreateEmptyOccurrenceList(void);
  
+ /**
+  * Initializes a list stored by the caller (e.g. in an array) as empty
+  * 
+  * @param list The list to initialize
+  */
+ void InitOccurrenceList(OccurrenceList* list);
+ 
  /**
   * Adds an occurrence to an existing list
   * 
@@ -96,7 +117,7 @@
   * @param position The position to add
   * @return 1 if successful, 0 if failed
   */
- int AddPositionToDocument(OccurrenceList* list, int doc_id, int position);
+ int AddPositionToDocument(OccurrenceList* list, int doc_id, long position);
  
  /**
   * Gets the count of documents in the occurrence list
@@ -125,6 +146,132 @@
   */
  int MergeOccurrenceLists(OccurrenceList* dest, OccurrenceList* src);
  
+ /**
+  * Creates a new token occurrence. Byte offsets are not kept here: the index maps
+  * every token ordinal of a document to its offset
+  * 
+  * @param doc_id Document identifier
+  * @param ordinal Index of the token among all tokens of the document
+  * @return A pointer to the new occurrence or NULL if memory allocation fails
+  */
+ Occurrence* CreateTokenOccurrence(int doc_id, long ordinal);
+ 
+ /**
+  * Adds a token to an occurrence, ordinals (like positions) are stored in 32 bits
+  * 
+  * @param occurrence The occurrence to update
+  * @param ordinal Index of the token among all tokens of the document
+  * @return 1 if successful, 0 if failed (or the ordinal doesn't fit)
+  */
+ int AddTokenToOccurrence(Occurrence* occurrence, long ordinal);
+ 
+ /**
+  * Adds a token to the occurrence of a specific document
+  * If the document doesn't exist in the list yet, creates a new token occurrence,
+  * placed so the list stays in ascending doc_id order (a reloaded document goes back
+  * to its position)
+  * 
+  * @param list The list to update
+  * @param doc_id The document ID
+  * @param ordinal Index of the token among all tokens of the document
+  * @return 1 if successful, 0 if failed
+  */
+ int AddTokenToDocument(OccurrenceList* list, int doc_id, long ordinal);
+ 
+ /**
+  * Unlinks and frees the occurrence of a specific document
+  * 
+  * @param list The list to update
+  * @param doc_id The document ID to remove
+  * @return 1 if the document was in the list, 0 otherwise
+  */
+ int RemoveDocument(OccurrenceList* list, int doc_id);
+ 
+ /**
+  * Moves the ordinals of a fully loaded occurrence to a compressed PostingSet, if the
+  * set is smaller than the vector (ordinals that fit inline always stay there)
+  * 
+  * @param occurrence The occurrence to freeze (already frozen ones are left as they are)
+  * @return 1 if successful, 0 if failed (the occurrence is left unchanged)
+  */
+ int FreezeOccurrence(Occurrence* occurrence);
+ 
+ /**
+  * Gets the number of ordinals of an occurrence, frozen or not
+  * 
+  * @param occurrence The occurrence
+  * @return The number of ordinals
+  */
+ size_t GetOrdinalCount(const Occurrence* occurrence);
+ 
+ /**
+  * Gets the bytes allocated by an occurrence and its vector or set
+  * 
+  * @param occurrence The occurrence
+  * @return The size in bytes
+  */
+ size_t GetOccurrenceMemory(const Occurrence* occurrence);
+ 
+ /**
+  * Gets the bytes of the ordinal vector's heap buffer past its last ordinal
+  * 
+  * @param occurrence The occurrence
+  * @return The unused bytes (0 while the ordinals are inline or frozen)
+  */
+ size_t GetOccurrenceSlack(const Occurrence* occurrence);
+ 
+ /**
+  * Shrinks the ordinal vector's heap buffer to its ordinals (back inline if they fit)
+  * 
+  * @param occurrence The occurrence to trim
+  * @return The bytes given back
+  */
+ size_t TrimOccurrence(Occurrence* occurrence);
+ 
+ /**
+  * Places a cursor on the first ordinal of the first document of a list
+  * 
+  * @param cursor The cursor to initialize
+  * @param list The list to iterate (may be NULL, giving an exhausted cursor)
+  */
+ void OpenPostingCursor(PostingCursor* cursor, const OccurrenceList* list);
+ 
+ /**
+  * Gets the document the cursor is on
+  * 
+  * @return The document ID, or -1 if the cursor is exhausted
+  */
+ int CursorDocument(const PostingCursor* cursor);
+ 
+ /**
+  * Gets the ordinal the cursor is on
+  * 
+  * @return The ordinal, or -1 if the cursor is exhausted
+  */
+ long CursorOrdinal(const PostingCursor* cursor);
+ 
+ /**
+  * Advances the cursor to the first document with an ID >= doc_id
+  * 
+  * @return The document reached, or -1 if the cursor is exhausted
+  */
+ int CursorSeekDocument(PostingCursor* cursor, int doc_id);
+ 
+ /**
+  * Advances the cursor within its document to the first ordinal >= ordinal
+  * (galloping search, never moves backwards)
+  * 
+  * @return 1 if such an ordinal exists in the document, 0 otherwise
+  */
+ int CursorSeekOrdinal(PostingCursor* cursor, long ordinal);
+ 
+ /**
+  * Advances the cursor to the next ordinal of its document
+  * 
+  * @return 1 if the document has one, 0 otherwise
+  */
+ int CursorNextOrdinal(PostingCursor* cursor);
+ 
  /**
   * Frees all memory associated with an occurrence
   * 
@@ -139,4 +286,11 @@
   */
  void FreeOccurrenceList(OccurrenceList* list);
  
+ /**
+  * Frees the occurrences of a list and leaves it empty, without freeing the list itself
+  * 
+  * @param list The list to clear
+  */
+ void ClearOccurrenceList(OccurrenceList* list);
+ 
  #endif // OCCURRENCE_H
\ No newline at end of file
@@ -9,21 +9,17 @@
 /**
  * Helper function to print all positions for a document
  */
-void PrintPositions(const ArrayList* positions_list) {
+void PrintPositions(const U32Vector* positions) {
     size_t i;
-    int* position;
     
-    if (positions_list == NULL) {
+    if (u32vec_size(positions) == 0) {
         printf("No positions available\n");
         return;
     }
     
     printf("Positions: ");
-    for (i = 0; i < arraylist_size(positions_list); i++) {
-        position = (int*)arraylist_get(positions_list, i);
-        if (position != NULL) {
-            printf("%d ", *position);
-        }
+    for (i = 0; i < u32vec_size(positions); i++) {
+        printf("%lu ", (unsigned long)u32vec_get(positions, i));
     }
     printf("\n");
 }
@@ -48,7 +44,7 @@ void PrintOccurrenceList(const OccurrenceList* list) {
     current = list->first;
     while (current != NULL) {
         printf("Document ID: %d - ", current->doc_id);
-        PrintPositions(current->positions_list);
+        PrintPositions(&current->ordinals);
         current = current->next;
     }
     printf("\n");
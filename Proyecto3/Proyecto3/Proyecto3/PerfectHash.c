@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+#include "PerfectHash.h"
+#include "boolean.h"
+#include "Allocator/allocator.h"
+
+#define GOLDEN 0x9E3779B97F4A7C15ULL
+
+// Final mix of MurmurHash3: every input bit flips about half of the output bits
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Words are read 8 bytes at a time
+static uint64_t hash_key(const char* key, uint64_t seed) {
+    size_t length = strlen(key);
+    uint64_t h = seed ^ (length * GOLDEN);
+    for (; length >= 8; key += 8, length -= 8) {
+        uint64_t chunk;
+        memcpy(&chunk, key, 8);
+        h = (h ^ chunk) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    if (length > 0) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, key, length);
+        h = (h ^ chunk) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return mix64(h);
+}
+
+// Multiply-shift instead of a division: x * n / 2^32 for a 32-bit x is below n
+static inline uint32_t reduce(uint32_t x, uint32_t n) {
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static inline uint32_t bucket_of(uint64_t h, uint32_t bucket_count) {
+    return reduce((uint32_t)h, bucket_count);
+}
+
+static inline uint32_t position_of(uint64_t h, uint16_t pilot, uint32_t positions) {
+    return reduce((uint32_t)(mix64(h ^ (pilot * GOLDEN)) >> 32), positions);
+}
+
+static inline uint8_t fingerprint_of(uint64_t h) {
+    return (uint8_t)(h >> 56);
+}
+
+// Scratch of a build, reused between seeds
+typedef struct _BuildState {
+    uint64_t* hashes;          // per key
+    uint32_t* by_bucket;       // keys grouped by bucket
+    uint32_t* bucket_start;    // bucket_count + 1 offsets into by_bucket
+    uint32_t* placement;       // buckets, largest first
+    uint32_t* size_start;
+    uint32_t* positions;       // per key, before remapping
+    uint64_t* taken;           // bitmap of positions
+} BuildState;
+
+// Choose a pilot for every bucket with this seed; FALSE if some bucket has none
+static BOOLEAN place_buckets(PerfectHash* hash, const char* const keys[], BuildState* s) {
+    uint32_t count = hash->count, buckets = hash->bucket_count;
+    for (uint32_t i = 0; i < count; ++i) s->hashes[i] = hash_key(keys[i], hash->seed);
+
+    // counting sort of the keys by bucket, then of the buckets by size
+    memset(s->bucket_start, 0, (buckets + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i) s->bucket_start[bucket_of(s->hashes[i], buckets) + 1]++;
+    uint32_t largest = 0;
+    for (uint32_t b = 0; b < buckets; ++b) {
+        if (s->bucket_start[b + 1] > largest) largest = s->bucket_start[b + 1];
+        s->bucket_start[b + 1] += s->bucket_start[b];
+    }
+    uint32_t* fill = s->placement;   // borrowed as the write cursor of each bucket
+    memcpy(fill, s->bucket_start, buckets * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i) s->by_bucket[fill[bucket_of(s->hashes[i], buckets)]++] = i;
+
+    uint32_t* size_start = calloc(largest + 2, sizeof(uint32_t));
+    if (!size_start) return FALSE;
+    for (uint32_t b = 0; b < buckets; ++b) size_start[largest - (s->bucket_start[b + 1] - s->bucket_start[b]) + 1]++;
+    for (uint32_t k = 0; k <= largest; ++k) size_start[k + 1] += size_start[k];
+    for (uint32_t b = 0; b < buckets; ++b) {
+        s->placement[size_start[largest - (s->bucket_start[b + 1] - s->bucket_start[b])]++] = b;
+    }
+    free(size_start);
+
+    memset(s->taken, 0, ((size_t)hash->positions + 63) / 64 * sizeof(uint64_t));
+    for (uint32_t n = 0; n < buckets; ++n) {
+        uint32_t b = s->placement[n];
+        const uint32_t* members = s->by_bucket + s->bucket_start[b];
+        uint32_t size = s->bucket_start[b + 1] - s->bucket_start[b];
+        if (size == 0) break;   // the rest are empty too
+
+        // two keys with the same hash land together with every pilot
+        for (uint32_t i = 0; i < size; ++i) {
+            for (uint32_t j = i + 1; j < size; ++j) {
+                if (s->hashes[members[i]] == s->hashes[members[j]]) return FALSE;
+            }
+        }
+
+        BOOLEAN placed = FALSE;
+        for (uint32_t pilot = 0; pilot <= PH_MAX_PILOT && !placed; ++pilot) {
+            placed = TRUE;
+            for (uint32_t i = 0; i < size && placed; ++i) {
+                uint32_t p = position_of(s->hashes[members[i]], (uint16_t)pilot, hash->positions);
+                if (s->taken[p >> 6] >> (p & 63) & 1) placed = FALSE;
+                for (uint32_t j = 0; j < i && placed; ++j) placed = s->positions[members[j]] != p;
+                s->positions[members[i]] = p;
+            }
+            if (placed) hash->pilots[b] = (uint16_t)pilot;
+        }
+        if (!placed) return FALSE;
+        for (uint32_t i = 0; i < size; ++i) {
+            uint32_t p = s->positions[members[i]];
+            s->taken[p >> 6] |= 1ULL << (p & 63);
+        }
+    }
+    return TRUE;
+}
+
+PerfectHash* PH_Build(const char* const keys[], uint32_t count, uint32_t* slots) {
+    PerfectHash* hash = mem_calloc(MEM_PERFECT_HASH, 1, sizeof(PerfectHash));
+    if (!hash) return NULL;
+    hash->count = count;
+    hash->positions = count > 0 ? (uint32_t)(count / PH_LOAD_FACTOR) + 1 : 0;
+    hash->bucket_count = count / PH_KEYS_PER_BUCKET + 1;
+    hash->pilots = mem_calloc(MEM_PERFECT_HASH, hash->bucket_count, sizeof(uint16_t));
+    hash->remap = mem_calloc(MEM_PERFECT_HASH, hash->positions - count + 1, sizeof(uint32_t));
+    hash->fingerprints = mem_malloc(MEM_PERFECT_HASH, (size_t)count + 1);
+
+    BuildState s;
+    s.hashes = malloc(((size_t)count + 1) * sizeof(uint64_t));
+    s.by_bucket = malloc(((size_t)count + 1) * sizeof(uint32_t));
+    s.bucket_start = malloc(((size_t)hash->bucket_count + 1) * sizeof(uint32_t));
+    s.placement = malloc(((size_t)hash->bucket_count + 1) * sizeof(uint32_t));
+    s.positions = malloc(((size_t)count + 1) * sizeof(uint32_t));
+    s.taken = malloc(((size_t)hash->positions + 64) / 64 * sizeof(uint64_t));
+    BOOLEAN built = FALSE;
+    if (hash->pilots && hash->remap && hash->fingerprints && s.hashes && s.by_bucket && s.bucket_start &&
+        s.placement && s.positions && s.taken) {
+        for (int attempt = 0; attempt < PH_MAX_SEEDS && !built; ++attempt) {
+            hash->seed = mix64((uint64_t)attempt * GOLDEN + 1);
+            built = place_buckets(hash, keys, &s);
+        }
+    }
+
+    if (built) {
+        // keys placed past count move to the slots left free below it, in order
+        uint32_t free_slot = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t p = s.positions[i];
+            if (p >= count) {
+                while (s.taken[free_slot >> 6] >> (free_slot & 63) & 1) free_slot++;
+                hash->remap[p - count] = free_slot++;
+                p = hash->remap[p - count];
+            }
+            slots[i] = p;
+            hash->fingerprints[p] = fingerprint_of(s.hashes[i]);
+        }
+    }
+    free(s.hashes);
+    free(s.by_bucket);
+    free(s.bucket_start);
+    free(s.placement);
+    free(s.positions);
+    free(s.taken);
+    if (!built) {
+        PH_Destroy(hash);
+        return NULL;
+    }
+    return hash;
+}
+
+void PH_Destroy(PerfectHash* hash) {
+    if (!hash) return;
+    mem_free(MEM_PERFECT_HASH, hash->pilots, (size_t)hash->bucket_count * sizeof(uint16_t));
+    mem_free(MEM_PERFECT_HASH, hash->remap, (size_t)(hash->positions - hash->count + 1) * sizeof(uint32_t));
+    mem_free(MEM_PERFECT_HASH, hash->fingerprints, (size_t)hash->count + 1);
+    mem_free(MEM_PERFECT_HASH, hash, sizeof(PerfectHash));
+}
+
+uint32_t PH_Lookup(const PerfectHash* hash, const char* key) {
+    if (!hash || hash->count == 0) return PH_NONE;
+    uint64_t h = hash_key(key, hash->seed);
+    uint32_t p = position_of(h, hash->pilots[bucket_of(h, hash->bucket_count)], hash->positions);
+    if (p >= hash->count) p = hash->remap[p - hash->count];
+    return hash->fingerprints[p] == fingerprint_of(h) ? p : PH_NONE;
+}
+
+size_t PH_Memory(const PerfectHash* hash) {
+    if (!hash) return 0;
+    return sizeof(PerfectHash) + (size_t)hash->bucket_count * sizeof(uint16_t) +
+           (size_t)(hash->positions - hash->count + 1) * sizeof(uint32_t) + (size_t)hash->count + 1;
+}
@@ -0,0 +1,49 @@
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PH_KEYS_PER_BUCKET 5      // average keys sharing a pilot
+#define PH_LOAD_FACTOR 0.99       // keys / positions while placing buckets
+#define PH_MAX_PILOT UINT16_MAX   // a bucket with no free pilot below this restarts the build with another seed
+#define PH_MAX_SEEDS 16
+#define PH_NONE UINT32_MAX        // PH_Lookup of a key that is certainly not in the set
+
+/*
+ * Minimal perfect hash of a fixed set of distinct strings (hash and displace, as PTHash):
+ * every key gets its own slot in 0..count-1, with nothing stored per slot but a fingerprint.
+ *
+ * Keys are hashed once to 64 bits. The hash picks a bucket (PH_KEYS_PER_BUCKET keys on
+ * average) and each bucket stores a 16-bit pilot, chosen at build time, that moves all its
+ * keys to free positions: position = mix(hash ^ pilot) mod (count / PH_LOAD_FACTOR).
+ * Buckets are placed largest first, while there is still room. The few keys placed past
+ * count are remapped to the slots left free below it, which keeps the hash minimal.
+ *
+ * A lookup is one hash, one pilot read and one fingerprint read. The fingerprint (8 bits
+ * of the hash) rejects all but 1/256 of the keys outside the set. The caller confirms a
+ * hit against its own copy of the key at that slot.
+ */
+
+typedef struct _PerfectHash {
+    uint64_t seed;
+    uint32_t count;            // keys, and slots
+    uint32_t positions;        // count / PH_LOAD_FACTOR, before remapping
+    uint32_t bucket_count;
+    uint16_t* pilots;          // per bucket
+    uint32_t* remap;           // position - count -> free slot below count
+    uint8_t* fingerprints;     // per slot
+} PerfectHash;
+
+// Build the hash of count distinct keys and write the slot of keys[i] to slots[i].
+// Returns NULL if allocation fails or no seed works (equal keys never do)
+PerfectHash* PH_Build(const char* const keys[], uint32_t count, uint32_t* slots);
+void PH_Destroy(PerfectHash* hash);
+
+// Slot of key if it is in the set; any other key gets PH_NONE or, rarely, some slot
+uint32_t PH_Lookup(const PerfectHash* hash, const char* key);
+
+// Bytes allocated by the hash
+size_t PH_Memory(const PerfectHash* hash);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+
+/*
+ * Busquedas en el diccionario antes y despues de II_Freeze: la tabla hash (sondeo
+ * cuadratico, lapidas, factor de carga 0.7) contra el hash perfecto con huella. Mide el
+ * tiempo por busqueda de palabras que estan y de palabras que no, la memoria del
+ * diccionario y lo que tarda congelarlo.
+ *
+ *   PerfectHash_bench [file...]     (por defecto los cuatro libros de libros/)
+ */
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+#define ROUNDS 20
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+// Mejor de ROUNDS pasadas por todas las palabras, en ns por busqueda
+static double lookup_ns(const InvertedIndex* idx, char** words, int count, long* found) {
+    double best = -1;
+    for (int r = 0; r < ROUNDS; ++r) {
+        long hits = 0;
+        double start = now_ms();
+        for (int w = 0; w < count; ++w) hits += II_TermId(idx, words[w]) != TERM_NONE;
+        double elapsed = (now_ms() - start) * 1e6 / count;
+        if (best < 0 || elapsed < best) best = elapsed;
+        *found = hits;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const char* defaults[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    const char** files = argc > 1 ? (const char**)argv + 1 : defaults;
+    int file_count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    if (file_count > MAX_OPEN_FILES) file_count = MAX_OPEN_FILES;
+
+    InvertedIndex* idx = II_Create();
+    for (int f = 0; f < file_count; ++f) {
+        if (II_LoadFile(idx, files[f]) < 0) {
+            fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // palabras del diccionario en orden aleatorio, y las mismas con una letra cambiada
+    int count = HTSize(idx->table);
+    char** present = malloc(sizeof(char*) * count);
+    char** absent = malloc(sizeof(char*) * count);
+    int pos = 0, n = 0;
+    char* word;
+    while (HTNext(idx->table, &pos, &word, NULL)) present[n++] = strdup(word);
+    srand(7);
+    for (int i = count - 1; i > 0; --i) {
+        int j = rand() % (i + 1);
+        char* swap = present[i];
+        present[i] = present[j];
+        present[j] = swap;
+    }
+    for (int i = 0; i < count; ++i) {
+        absent[i] = strdup(present[i]);
+        absent[i][0] = absent[i][0] == 'q' ? 'k' : 'q';
+    }
+
+    long hits_table, misses_table, hits_frozen, misses_frozen;
+    double table_hit = lookup_ns(idx, present, count, &hits_table);
+    double table_miss = lookup_ns(idx, absent, count, &misses_table);
+    size_t table_memory = II_DictionaryMemory(idx);
+
+    double start = now_ms();
+    if (II_Freeze(idx) < 0) {
+        fprintf(stderr, "No se pudo congelar el diccionario\n");
+        return EXIT_FAILURE;
+    }
+    double freeze_ms = now_ms() - start;
+    double frozen_hit = lookup_ns(idx, present, count, &hits_frozen);
+    double frozen_miss = lookup_ns(idx, absent, count, &misses_frozen);
+    size_t frozen_memory = II_DictionaryMemory(idx);
+    if (hits_table != hits_frozen || misses_table != misses_frozen) {
+        fprintf(stderr, "Los diccionarios no coinciden\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t key_store = idx->terms.words_size + (size_t)count * sizeof(uint32_t);
+    printf("\n%d terminos, congelados en %.1f ms\n\n", count, freeze_ms);
+    printf("%-14s %12s %12s %14s %14s\n", "diccionario", "esta (ns)", "no esta (ns)", "memoria", "bits/termino");
+    printf("%-14s %12.1f %12.1f %11zu KB %14.1f\n", "tabla hash", table_hit, table_miss, table_memory >> 10,
+           (table_memory - key_store) * 8.0 / count);
+    printf("%-14s %12.1f %12.1f %11zu KB %14.1f\n", "hash perfecto", frozen_hit, frozen_miss, frozen_memory >> 10,
+           PH_Memory(idx->frozen_terms) * 8.0 / count);
+    printf("(bits/termino sin contar las palabras y sus offsets: %zu KB en los dos)\n", key_store >> 10);
+
+    for (int i = 0; i < count; ++i) {
+        free(present[i]);
+        free(absent[i]);
+    }
+    free(present);
+    free(absent);
+    II_Destroy(idx);
+    return EXIT_SUCCESS;
+}
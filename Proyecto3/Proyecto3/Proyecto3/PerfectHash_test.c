@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "InvertedIndex.h"
+#include "Rank.h"
+#include "PerfectHash.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+#define KEYS 100000
+
+static int count_matches(const InvertedIndex* idx, const char* phrase) {
+    SearchCursor* cursor = II_PhraseOpen(idx, phrase);
+    printData result;
+    int count = 0;
+    while (II_SearchNext(cursor, &result)) count++;
+    II_SearchClose(cursor);
+    return count;
+}
+
+int main(void) {
+    // Cada clave tiene su propio lugar entre 0 y count - 1
+    char (*names)[24] = malloc(sizeof(*names) * KEYS);
+    const char** keys = malloc(sizeof(char*) * KEYS);
+    uint32_t* slots = malloc(sizeof(uint32_t) * KEYS);
+    unsigned char* used = calloc(KEYS, 1);
+    for (int k = 0; k < KEYS; ++k) {
+        snprintf(names[k], sizeof(names[k]), "clave%d", k);
+        keys[k] = names[k];
+    }
+    PerfectHash* hash = PH_Build(keys, KEYS, slots);
+    assert(hash != NULL && hash->count == KEYS);
+    for (int k = 0; k < KEYS; ++k) {
+        assert(slots[k] < KEYS && !used[slots[k]]);
+        used[slots[k]] = 1;
+        assert(PH_Lookup(hash, keys[k]) == slots[k]);
+    }
+    // pocos bits por clave: pilotos, remapeo y huellas
+    assert(PH_Memory(hash) * 8.0 / KEYS < 12.0);
+
+    // La huella descarta casi todas las claves que no estan
+    int false_hits = 0;
+    char other[32];
+    for (int k = 0; k < KEYS; ++k) {
+        snprintf(other, sizeof(other), "otra%d", k);
+        false_hits += PH_Lookup(hash, other) != PH_NONE;
+    }
+    assert(false_hits < KEYS / 100);
+    PH_Destroy(hash);
+
+    // Claves repetidas no tienen hash perfecto; 0 y 1 clave si
+    const char* repeated[] = { "uno", "dos", "uno" };
+    assert(PH_Build(repeated, 3, slots) == NULL);
+    hash = PH_Build(keys, 0, slots);
+    assert(hash != NULL && PH_Lookup(hash, "clave0") == PH_NONE);
+    PH_Destroy(hash);
+    hash = PH_Build(keys, 1, slots);
+    assert(hash != NULL && slots[0] == 0 && PH_Lookup(hash, "clave0") == 0);
+    PH_Destroy(hash);
+    free(names);
+    free(keys);
+    free(slots);
+    free(used);
+
+    // Congelado, el indice contesta lo mismo que con la tabla hash
+    InvertedIndex* idx = II_Create();
+    assert(II_LoadFile(idx, "DonQuijote.txt") == 0);
+    TermId terms = (TermId)HTSize(idx->table);
+    char** words = malloc(sizeof(char*) * terms);
+    long* counts = malloc(sizeof(long) * terms);
+    int pos = 0, n = 0;
+    char* word;
+    while (HTNext(idx->table, &pos, &word, NULL)) {
+        words[n] = strdup(word);
+        counts[n++] = II_TermCount(idx, word);
+    }
+    int phrase = count_matches(idx, "caballero andante");
+    char* misspelled[] = { "cabalero" };
+    char* corrected[1];
+    assert(II_CorrectWords(idx, misspelled, 1, 2, corrected) == 1);
+    char* expected_correction = strdup(corrected[0]);
+    size_t table_memory = II_DictionaryMemory(idx);
+
+    assert(II_Freeze(idx) == 0 && idx->table == NULL && idx->frozen_terms != NULL);
+    assert(II_Freeze(idx) == 0);
+    assert(idx->terms.count == terms);
+    for (int w = 0; w < n; ++w) {
+        TermId id = II_TermId(idx, words[w]);
+        assert(id < terms && strcmp(II_TermWord(idx, id), words[w]) == 0);
+        assert(II_TermCount(idx, words[w]) == counts[w]);
+        free(words[w]);
+    }
+    assert(II_TermId(idx, "palabrainexistente") == TERM_NONE && II_Postings(idx, "zzzz") == NULL);
+    assert(II_TermCount(idx, "SANCHO") == II_TermCount(idx, "sancho") && II_TermCount(idx, "sancho") > 0);
+    assert(count_matches(idx, "caballero andante") == phrase);
+    // congelado, encontrar una palabra es mirar un solo lugar
+    SearchExplain explain;
+    int explain_count;
+    char* explained[] = { "sancho", "dulcinea" };
+    free(II_Explain(idx, explained, 2, 8, &explain_count, &explain));
+    assert(explain.terms[0].probes == 1 && explain.terms[1].probes == 1 && explain.results == explain_count);
+    assert(II_CorrectWords(idx, misspelled, 1, 2, corrected) == 1 && strcmp(corrected[0], expected_correction) == 0);
+    assert(II_DictionaryMemory(idx) < table_memory / 2);
+
+    // Solo lectura: no se cargan ni recargan archivos
+    assert(II_LoadFile(idx, "lobo.txt") == -1 && II_ReloadFile(idx, "DonQuijote.txt") == -1);
+    assert(idx->last_file_index == 0);
+
+    // El ranking se arma con los ids nuevos
+    RankedIndex* rank = RK_FromIndex(idx, RANK_PASSAGE_TOKENS);
+    RankHit hits[5];
+    char* query[] = { "dulcinea" };
+    assert(rank != NULL && RK_TopK(rank, query, 1, RANK_OR, RANK_BLOCK_MAX_WAND, 5, hits, NULL) == 5);
+    RK_Destroy(rank);
+
+    free(words);
+    free(counts);
+    free(expected_correction);
+    II_Destroy(idx);
+    printf("PerfectHash tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "Pipeline.h"
+
+#define SPIN_WAITS 32      // busy polls of a ring before yielding the CPU
+#define YIELD_WAITS 256    // yields before sleeping between polls
+#define SLEEP_NS 20000
+
+// A block of the file on its way through the pipeline: the reader fills data, the tokenizer
+// replaces it with the batch, the indexer frees it
+typedef struct _Block {
+    char* data;
+    size_t length;
+    long offset;            // file offset of data[0]
+    TokenBatch batch;
+} Block;
+
+// Bounded lock-free single-producer single-consumer queue; head and tail only grow
+typedef struct _SpscRing {
+    void* slots[PIPELINE_RING_SLOTS];
+    _Alignas(64) atomic_size_t head;   // next slot the consumer pops
+    _Alignas(64) atomic_size_t tail;   // next slot the producer fills
+} SpscRing;
+
+typedef struct _Pipeline {
+    int fd;
+    size_t size;
+    int tokenizers;
+    int max_word_length;
+    atomic_int failed;
+    SpscRing blocks[PIPELINE_MAX_TOKENIZERS];    // reader -> tokenizer t
+    SpscRing batches[PIPELINE_MAX_TOKENIZERS];   // tokenizer t -> indexer
+    StageStats reader;
+    StageStats tokenizer[PIPELINE_MAX_TOKENIZERS];
+    long blocks_read;
+} Pipeline;
+
+// Argument of a tokenizer thread
+typedef struct _TokenizerArg {
+    Pipeline* pipeline;
+    int id;
+} TokenizerArg;
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+// Poll, then yield, then sleep: a stage waiting on a slower one doesn't burn its core
+static void backoff(int* waits) {
+    if (++*waits <= SPIN_WAITS) return;
+    if (*waits <= SPIN_WAITS + YIELD_WAITS) {
+        sched_yield();
+        return;
+    }
+    struct timespec pause = { 0, SLEEP_NS };
+    nanosleep(&pause, NULL);
+}
+
+// Returns the milliseconds spent waiting for a free slot
+static double ring_push(SpscRing* ring, void* item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    double waited = 0;
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == PIPELINE_RING_SLOTS) {
+        double start = now_ms();
+        int waits = 0;
+        while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == PIPELINE_RING_SLOTS) backoff(&waits);
+        waited = now_ms() - start;
+    }
+    ring->slots[tail % PIPELINE_RING_SLOTS] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return waited;
+}
+
+// Adds the milliseconds spent waiting for an item to *waited
+static void* ring_pop(SpscRing* ring, double* waited) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (atomic_load_explicit(&ring->tail, memory_order_acquire) == head) {
+        double start = now_ms();
+        int waits = 0;
+        while (atomic_load_explicit(&ring->tail, memory_order_acquire) == head) backoff(&waits);
+        *waited += now_ms() - start;
+    }
+    void* item = ring->slots[head % PIPELINE_RING_SLOTS];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
+
+// Read all of [offset, offset + length), retrying short reads
+static int read_fully(int fd, char* buffer, size_t length, long offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, buffer, length, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        buffer += n;
+        length -= (size_t)n;
+        offset += n;
+    }
+    return 1;
+}
+
+// Reads the file in blocks cut after their last non-alphabetic byte (the partial token at
+// the end is carried to the next block), and deals them to the tokenizers in turn
+static void* reader_main(void* arg) {
+    Pipeline* pipeline = arg;
+    double start = now_ms(), waited = 0;
+    char* carry = NULL;
+    size_t carry_length = 0;
+    long offset = 0, sequence = 0;
+
+    posix_fadvise(pipeline->fd, 0, (off_t)pipeline->size, POSIX_FADV_SEQUENTIAL);
+    while ((size_t)offset < pipeline->size) {
+        size_t want = pipeline->size - (size_t)offset;
+        if (want > PIPELINE_BLOCK_SIZE) want = PIPELINE_BLOCK_SIZE;
+        // ask for the next block while this one is read and tokenized
+        if ((size_t)offset + want < pipeline->size) {
+            posix_fadvise(pipeline->fd, offset + (off_t)want, PIPELINE_BLOCK_SIZE, POSIX_FADV_WILLNEED);
+        }
+
+        Block* block = malloc(sizeof(Block));
+        char* data = malloc(carry_length + want);
+        if (!block || !data || !read_fully(pipeline->fd, data + carry_length, want, offset)) {
+            free(block);
+            free(data);
+            atomic_store(&pipeline->failed, 1);
+            break;
+        }
+        if (carry_length > 0) memcpy(data, carry, carry_length);
+        size_t total = carry_length + want;
+        long block_offset = offset - (long)carry_length;
+        offset += (long)want;
+
+        size_t cut = total;
+        if ((size_t)offset < pipeline->size) {
+            while (cut > 0 && isalpha((unsigned char)data[cut - 1])) cut--;
+        }
+        char* rest = realloc(carry, total - cut + 1);
+        if (!rest) {
+            free(block);
+            free(data);
+            atomic_store(&pipeline->failed, 1);
+            break;
+        }
+        carry = rest;
+        carry_length = total - cut;
+        if (carry_length > 0) memcpy(carry, data + cut, carry_length);
+        if (cut == 0) {
+            // a single token longer than the block: keep reading it
+            free(block);
+            free(data);
+            continue;
+        }
+
+        block->data = data;
+        block->length = cut;
+        block->offset = block_offset;
+        block->batch.sequence = sequence;
+        waited += ring_push(&pipeline->blocks[sequence % pipeline->tokenizers], block);
+        sequence++;
+    }
+
+    for (int t = 0; t < pipeline->tokenizers; ++t) waited += ring_push(&pipeline->blocks[t], NULL);
+    free(carry);
+    pipeline->blocks_read = sequence;
+    pipeline->reader.wait_ms = waited;
+    pipeline->reader.busy_ms = now_ms() - start - waited;
+    return NULL;
+}
+
+// Turns a block into its batch of tokens and normalized words
+static void tokenize_block(Pipeline* pipeline, Block* block) {
+    TokenBatch* batch = &block->batch;
+    const char* data = block->data;
+    size_t length = block->length;
+    // at most one token per two bytes, and each word fits in its token plus a NUL
+    size_t max_tokens = length / 2 + 1;
+
+    batch->count = 0;
+    batch->records = malloc(sizeof(TokenRecord) * max_tokens);
+    batch->words = malloc(length + max_tokens);
+    if (!batch->records || !batch->words) {
+        atomic_store(&pipeline->failed, 1);
+        return;
+    }
+
+    size_t pos = 0, word = 0;
+    while (pos < length) {
+        if (!isalpha((unsigned char)data[pos])) {
+            pos++;
+            continue;
+        }
+        size_t begin = pos;
+        uint32_t kept = 0;
+        TokenRecord* record = &batch->records[batch->count++];
+        record->offset = block->offset + (long)begin;
+        record->word = (uint32_t)word;
+        while (pos < length && isalpha((unsigned char)data[pos])) {
+            if (kept < (uint32_t)pipeline->max_word_length) {
+                batch->words[word + kept++] = (char)tolower((unsigned char)data[pos]);
+            }
+            pos++;
+        }
+        batch->words[word + kept] = '\0';
+        word += kept + 1;
+        record->length = (uint32_t)(pos - begin);
+    }
+}
+
+static void* tokenizer_main(void* arg) {
+    TokenizerArg* tokenizer = arg;
+    Pipeline* pipeline = tokenizer->pipeline;
+    int id = tokenizer->id;
+    double start = now_ms(), waited = 0;
+
+    for (;;) {
+        Block* block = ring_pop(&pipeline->blocks[id], &waited);
+        if (block) {
+            tokenize_block(pipeline, block);
+            free(block->data);
+            block->data = NULL;
+        }
+        waited += ring_push(&pipeline->batches[id], block);
+        if (!block) break;
+    }
+    pipeline->tokenizer[id].wait_ms = waited;
+    pipeline->tokenizer[id].busy_ms = now_ms() - start - waited;
+    return NULL;
+}
+
+int PL_Tokenize(int fd, size_t size, int tokenizers, int max_word_length,
+                PL_BatchHandler handler, void* context, PipelineStats* stats) {
+    if (fd < 0 || !handler || tokenizers < 1 || tokenizers > PIPELINE_MAX_TOKENIZERS) return -1;
+
+    Pipeline* pipeline = calloc(1, sizeof(Pipeline));
+    if (!pipeline) return -1;
+    pipeline->fd = fd;
+    pipeline->size = size;
+    pipeline->max_word_length = max_word_length;
+
+    double start = now_ms();
+    pthread_t tokenizer_threads[PIPELINE_MAX_TOKENIZERS];
+    TokenizerArg args[PIPELINE_MAX_TOKENIZERS];
+    int created = 0;
+    for (int t = 0; t < tokenizers; ++t) {
+        args[t].pipeline = pipeline;
+        args[t].id = t;
+        if (pthread_create(&tokenizer_threads[t], NULL, tokenizer_main, &args[t]) != 0) break;
+        created++;
+    }
+    // blocks are dealt among the tokenizers that did start
+    pipeline->tokenizers = created;
+    pthread_t reader_thread;
+    if (created == 0 || pthread_create(&reader_thread, NULL, reader_main, pipeline) != 0) {
+        for (int t = 0; t < created; ++t) {
+            ring_push(&pipeline->blocks[t], NULL);
+            pthread_join(tokenizer_threads[t], NULL);
+        }
+        free(pipeline);
+        return -1;
+    }
+
+    // indexer: batch b comes from tokenizer b % n, so they are handled in file order
+    double waited = 0, handling = 0;
+    long tokens = 0;
+    for (long sequence = 0;; ++sequence) {
+        Block* block = ring_pop(&pipeline->batches[sequence % created], &waited);
+        if (!block) break;
+        double begin = now_ms();
+        if (block->batch.records && block->batch.words) {
+            handler(&block->batch, context);
+            tokens += (long)block->batch.count;
+        }
+        handling += now_ms() - begin;
+        free(block->batch.records);
+        free(block->batch.words);
+        free(block);
+    }
+    pthread_join(reader_thread, NULL);
+    for (int t = 0; t < created; ++t) pthread_join(tokenizer_threads[t], NULL);
+
+    if (stats) {
+        memset(stats, 0, sizeof(PipelineStats));
+        stats->wall_ms = now_ms() - start;
+        stats->tokenizers = created;
+        stats->blocks = pipeline->blocks_read;
+        stats->tokens = tokens;
+        stats->reader = pipeline->reader;
+        for (int t = 0; t < created; ++t) stats->tokenizer[t] = pipeline->tokenizer[t];
+        stats->indexer.busy_ms = handling;
+        stats->indexer.wait_ms = waited;
+    }
+    int result = atomic_load(&pipeline->failed) ? -1 : 0;
+    free(pipeline);
+    return result;
+}
+
+static void print_stage(FILE* out, const char* name, const StageStats* stage, double wall_ms) {
+    fprintf(out, "  %-14s %8.1f ms ocupado %8.1f ms esperando  (%3.0f%%)\n", name, stage->busy_ms, stage->wait_ms,
+            wall_ms > 0 ? 100.0 * stage->busy_ms / wall_ms : 0.0);
+}
+
+void PL_PrintStats(FILE* out, const PipelineStats* stats) {
+    if (!out || !stats) return;
+    fprintf(out, "Pipeline: %ld bloques, %ld tokens en %.1f ms\n", stats->blocks, stats->tokens, stats->wall_ms);
+    print_stage(out, "lector", &stats->reader, stats->wall_ms);
+    for (int t = 0; t < stats->tokenizers; ++t) {
+        char name[32];
+        snprintf(name, sizeof(name), "tokenizador %d", t);
+        print_stage(out, name, &stats->tokenizer[t], stats->wall_ms);
+    }
+    print_stage(out, "indexador", &stats->indexer, stats->wall_ms);
+}
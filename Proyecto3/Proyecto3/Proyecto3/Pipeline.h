@@ -0,0 +1,73 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PIPELINE_BLOCK_SIZE (256 * 1024)  // bytes per pread; a block is cut after its last whole token
+#define PIPELINE_RING_SLOTS 4              // blocks/batches in flight per ring before the producer waits
+#define PIPELINE_MAX_TOKENIZERS 8
+
+/*
+ * Staged tokenization of one file:
+ *
+ *   reader --SPSC--> tokenizer 0 --SPSC--> indexer (the calling thread)
+ *          --SPSC--> tokenizer 1 --SPSC-->
+ *          ...
+ *
+ * The reader issues large preads (with sequential/readahead hints) and hands block b to
+ * tokenizer b % n; the indexer takes batch b from tokenizer b % n, so batches arrive in file
+ * order with no reordering. Every ring is a bounded lock-free single-producer
+ * single-consumer queue: a full ring makes its producer wait (backpressure), so at most
+ * PIPELINE_RING_SLOTS blocks are buffered per tokenizer. Only the calling thread runs the
+ * batch handler, which can thus update structures that aren't thread-safe.
+ *
+ * Tokens are maximal runs of alphabetic bytes, like in II_LoadFile; their words come
+ * lowercased and truncated to max_word_length.
+ */
+
+// One token of a batch
+typedef struct _TokenRecord {
+    long offset;        // byte offset of the token in the file
+    uint32_t length;    // bytes of the token in the file (before truncation)
+    uint32_t word;      // start of its normalized word (NUL-terminated) in TokenBatch.words
+} TokenRecord;
+
+// Tokens of one block, in file order
+typedef struct _TokenBatch {
+    long sequence;          // block number
+    size_t count;
+    TokenRecord* records;
+    char* words;
+} TokenBatch;
+
+// Time a stage spent working and waiting on its rings
+typedef struct _StageStats {
+    double busy_ms;
+    double wait_ms;         // input ring empty or output ring full
+} StageStats;
+
+typedef struct _PipelineStats {
+    double wall_ms;
+    int tokenizers;
+    long blocks;
+    long tokens;
+    StageStats reader;
+    StageStats tokenizer[PIPELINE_MAX_TOKENIZERS];
+    StageStats indexer;
+} PipelineStats;
+
+// Called on the calling thread for every batch, in file order
+typedef void (*PL_BatchHandler)(const TokenBatch* batch, void* context);
+
+// Tokenize size bytes of fd with tokenizers (1..PIPELINE_MAX_TOKENIZERS) threads.
+// Returns 0, or -1 if the pipeline could not start or a read failed (handler calls may
+// have happened already). stats may be NULL
+int PL_Tokenize(int fd, size_t size, int tokenizers, int max_word_length,
+                PL_BatchHandler handler, void* context, PipelineStats* stats);
+
+// Busy time and utilization (busy / wall) of every stage, one line each
+void PL_PrintStats(FILE* out, const PipelineStats* stats);
+
+#endif
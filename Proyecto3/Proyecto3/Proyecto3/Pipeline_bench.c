@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+
+/*
+ * Carga de los libros en un hilo contra el pipeline lector -> tokenizadores -> indexador
+ * con 1, 2 y 4 tokenizadores (el mejor de RUNS), y la utilizacion de cada etapa en la
+ * ultima carga del libro mas grande. Con palabras cortas, para que el indexador tenga
+ * todo el trabajo de insercion.
+ *
+ *   Pipeline_bench [file...]     (por defecto los cuatro libros de libros/)
+ */
+
+#define RUNS 5
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/* Mejor tiempo de cargar todos los archivos; deja en *largest las etapas del archivo mas grande */
+static double load(int tokenizers, const char* files[], int file_count, PipelineStats* largest) {
+    double best = -1;
+    for (int r = 0; r < RUNS; ++r) {
+        InvertedIndex* idx = II_Create();
+        II_SetIndexShortWords(idx, TRUE);
+        II_SetLoadPipeline(idx, tokenizers);
+        double start = now_ms();
+        long most = -1;
+        for (int f = 0; f < file_count; ++f) {
+            if (II_LoadFile(idx, files[f]) < 0) {
+                fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+                exit(EXIT_FAILURE);
+            }
+            if (tokenizers > 0 && idx->last_load.tokens > most) {
+                most = idx->last_load.tokens;
+                *largest = idx->last_load;
+            }
+        }
+        double elapsed = now_ms() - start;
+        if (best < 0 || elapsed < best) best = elapsed;
+        II_Destroy(idx);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const char* defaults[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    const char** files = argc > 1 ? (const char**)argv + 1 : defaults;
+    int file_count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    if (file_count > MAX_OPEN_FILES) file_count = MAX_OPEN_FILES;
+
+    int configs[] = { 0, 1, 2, 4 };
+    PipelineStats stats[4];
+    double times[4];
+    for (int c = 0; c < 4; ++c) times[c] = load(configs[c], files, file_count, &stats[c]);
+
+    printf("\n%-22s %10s\n", "carga", "tiempo");
+    printf("%-22s %7.1f ms\n", "un hilo", times[0]);
+    for (int c = 1; c < 4; ++c) {
+        char name[32];
+        snprintf(name, sizeof(name), "pipeline, %d tokeniz.", configs[c]);
+        printf("%-22s %7.1f ms\n", name, times[c]);
+    }
+    for (int c = 1; c < 4; ++c) {
+        printf("\n");
+        PL_PrintStats(stdout, &stats[c]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,660 @@
+/**
+ * @file postings.c
+ * @brief Implementation of the array / bitmap posting sets
+ */
+
+#include <string.h>
+#include "postings.h"
+#include "../Allocator/allocator.h"
+
+#define LOW_MASK (POSTINGS_CHUNK_SIZE - 1)
+#define GALLOP_RATIO 32   /* one side this many times shorter: gallop on the other instead of merging */
+#define SCRATCH_VALUES (2 * POSTINGS_ARRAY_MAX)   /* a union of two arrays; small enough to stay off mmap */
+
+/* Scratch space for building one chunk of a result */
+typedef struct {
+    uint16_t* values;     /* SCRATCH_VALUES entries */
+    uint64_t* bits;       /* POSTINGS_BITMAP_WORDS words */
+} Scratch;
+
+static int open_scratch(Scratch* scratch) {
+    scratch->values = malloc(SCRATCH_VALUES * sizeof(uint16_t));
+    scratch->bits = malloc(POSTINGS_BITMAP_WORDS * sizeof(uint64_t));
+    return scratch->values != NULL && scratch->bits != NULL;
+}
+
+static void close_scratch(Scratch* scratch) {
+    free(scratch->values);
+    free(scratch->bits);
+}
+
+static int bit_is_set(const uint64_t* bits, long bit) {
+    return (bits[bit >> 6] >> (bit & 63)) & 1;
+}
+
+static uint32_t count_bits(const uint64_t* bits) {
+    uint32_t count = 0;
+    int w;
+    for (w = 0; w < POSTINGS_BITMAP_WORDS; w++) {
+        count += (uint32_t)__builtin_popcountll(bits[w]);
+    }
+    return count;
+}
+
+/* ------------------------------------------------------------------ building */
+
+static size_t container_bytes(const PostingContainer* container) {
+    return container->kind == POSTINGS_BITMAP ? POSTINGS_BITMAP_WORDS * sizeof(uint64_t)
+                                              : container->count * sizeof(uint16_t);
+}
+
+static void free_container(const PostingContainer* container) {
+    mem_free(MEM_POSTING_SETS, container->data.array, container_bytes(container));
+}
+
+static int push_container(PostingSet* set, uint32_t* capacity, PostingContainer container) {
+    if (set->container_count == *capacity) {
+        uint32_t grown = *capacity ? *capacity * 2 : 4;
+        PostingContainer* containers = mem_realloc(MEM_POSTING_SETS, set->containers,
+                                                   *capacity * sizeof(PostingContainer),
+                                                   grown * sizeof(PostingContainer));
+        if (containers == NULL) {
+            return 0;
+        }
+        set->containers = containers;
+        *capacity = grown;
+    }
+    set->containers[set->container_count++] = container;
+    set->count += container.count;
+    return 1;
+}
+
+/* Append a chunk given as sorted low bits, as a bitmap if it has too many of them */
+static int emit_array(PostingSet* set, uint32_t* capacity, uint16_t key, const uint16_t* values, uint32_t count) {
+    PostingContainer container;
+    uint32_t i;
+
+    if (count == 0) {
+        return 1;
+    }
+    container.key = key;
+    container.count = count;
+    if (count > POSTINGS_ARRAY_MAX) {
+        container.kind = POSTINGS_BITMAP;
+        container.data.bitmap = mem_calloc(MEM_POSTING_SETS, POSTINGS_BITMAP_WORDS, sizeof(uint64_t));
+        if (container.data.bitmap == NULL) {
+            return 0;
+        }
+        for (i = 0; i < count; i++) {
+            container.data.bitmap[values[i] >> 6] |= 1ULL << (values[i] & 63);
+        }
+    } else {
+        container.kind = POSTINGS_ARRAY;
+        container.data.array = mem_malloc(MEM_POSTING_SETS, count * sizeof(uint16_t));
+        if (container.data.array == NULL) {
+            return 0;
+        }
+        memcpy(container.data.array, values, count * sizeof(uint16_t));
+    }
+    if (!push_container(set, capacity, container)) {
+        free_container(&container);
+        return 0;
+    }
+    return 1;
+}
+
+/* Append a chunk given as a bitmap, as an array if it has few enough values */
+static int emit_bitmap(PostingSet* set, uint32_t* capacity, uint16_t key, const uint64_t* bits, uint16_t* scratch) {
+    PostingContainer container;
+    uint32_t count = count_bits(bits);
+    int w;
+
+    if (count == 0) {
+        return 1;
+    }
+    if (count <= POSTINGS_ARRAY_MAX) {
+        uint32_t n = 0;
+        for (w = 0; w < POSTINGS_BITMAP_WORDS; w++) {
+            uint64_t word = bits[w];
+            while (word) {
+                scratch[n++] = (uint16_t)(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+        return emit_array(set, capacity, key, scratch, n);
+    }
+
+    container.key = key;
+    container.kind = POSTINGS_BITMAP;
+    container.count = count;
+    container.data.bitmap = mem_malloc(MEM_POSTING_SETS, POSTINGS_BITMAP_WORDS * sizeof(uint64_t));
+    if (container.data.bitmap == NULL) {
+        return 0;
+    }
+    memcpy(container.data.bitmap, bits, POSTINGS_BITMAP_WORDS * sizeof(uint64_t));
+    if (!push_container(set, capacity, container)) {
+        free_container(&container);
+        return 0;
+    }
+    return 1;
+}
+
+/* Give back the unused container slots; also done before destroying a set that failed to
+   build, so its containers are freed with the size they have */
+static PostingSet* finish(PostingSet* set, uint32_t capacity) {
+    if (set->container_count == 0) {
+        mem_free(MEM_POSTING_SETS, set->containers, capacity * sizeof(PostingContainer));
+        set->containers = NULL;
+    } else if (set->container_count < capacity) {
+        PostingContainer* trimmed = mem_realloc(MEM_POSTING_SETS, set->containers,
+                                                capacity * sizeof(PostingContainer),
+                                                set->container_count * sizeof(PostingContainer));
+        if (trimmed != NULL) {
+            set->containers = trimmed;
+        }
+    }
+    return set;
+}
+
+/* Append a chunk given as full values (all with the same key), without copying them to scratch */
+static int emit_values(PostingSet* set, uint32_t* capacity, uint16_t key, const long* values, uint32_t count) {
+    PostingContainer container;
+    uint32_t i;
+
+    container.key = key;
+    container.count = count;
+    if (count > POSTINGS_ARRAY_MAX) {
+        container.kind = POSTINGS_BITMAP;
+        container.data.bitmap = mem_calloc(MEM_POSTING_SETS, POSTINGS_BITMAP_WORDS, sizeof(uint64_t));
+        if (container.data.bitmap == NULL) {
+            return 0;
+        }
+        for (i = 0; i < count; i++) {
+            long low = values[i] & LOW_MASK;
+            container.data.bitmap[low >> 6] |= 1ULL << (low & 63);
+        }
+    } else {
+        container.kind = POSTINGS_ARRAY;
+        container.data.array = mem_malloc(MEM_POSTING_SETS, count * sizeof(uint16_t));
+        if (container.data.array == NULL) {
+            return 0;
+        }
+        for (i = 0; i < count; i++) {
+            container.data.array[i] = (uint16_t)(values[i] & LOW_MASK);
+        }
+    }
+    if (!push_container(set, capacity, container)) {
+        free_container(&container);
+        return 0;
+    }
+    return 1;
+}
+
+PostingSet* postings_from_sorted(const long* values, size_t count) {
+    PostingSet* set;
+    uint32_t capacity = 0;
+    size_t i = 0;
+
+    set = mem_calloc(MEM_POSTING_SETS, 1, sizeof(PostingSet));
+    if (set == NULL) {
+        return NULL;
+    }
+
+    while (i < count) {
+        long key = values[i] >> POSTINGS_CHUNK_BITS;
+        size_t end = i;
+        if (values[i] < 0 || values[i] > POSTINGS_MAX_VALUE) {
+            break;
+        }
+        while (end < count && values[end] >> POSTINGS_CHUNK_BITS == key) {
+            end++;
+        }
+        if (!emit_values(set, &capacity, (uint16_t)key, values + i, (uint32_t)(end - i))) {
+            break;
+        }
+        i = end;
+    }
+
+    if (i < count) {
+        postings_destroy(finish(set, capacity));
+        return NULL;
+    }
+    return finish(set, capacity);
+}
+
+void postings_destroy(PostingSet* set) {
+    uint32_t c;
+    if (set == NULL) {
+        return;
+    }
+    for (c = 0; c < set->container_count; c++) {
+        free_container(&set->containers[c]);
+    }
+    mem_free(MEM_POSTING_SETS, set->containers, set->container_count * sizeof(PostingContainer));
+    mem_free(MEM_POSTING_SETS, set, sizeof(PostingSet));
+}
+
+size_t postings_count(const PostingSet* set) {
+    return set != NULL ? set->count : 0;
+}
+
+size_t postings_memory(const PostingSet* set) {
+    size_t bytes;
+    uint32_t c;
+    if (set == NULL) {
+        return 0;
+    }
+    bytes = sizeof(PostingSet) + set->container_count * sizeof(PostingContainer);
+    for (c = 0; c < set->container_count; c++) {
+        bytes += container_bytes(&set->containers[c]);
+    }
+    return bytes;
+}
+
+void postings_container_counts(const PostingSet* set, size_t* arrays, size_t* bitmaps) {
+    uint32_t c;
+    for (c = 0; set != NULL && c < set->container_count; c++) {
+        if (set->containers[c].kind == POSTINGS_BITMAP) {
+            (*bitmaps)++;
+        } else {
+            (*arrays)++;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ lookups */
+
+/* First index >= from with values[index] >= target (galloping, then binary search) */
+static uint32_t gallop(const uint16_t* values, uint32_t count, uint32_t from, long target) {
+    uint32_t low = from, high, step = 1;
+    if (low >= count || values[low] >= target) {
+        return low;
+    }
+    high = low + step;
+    while (high < count && values[high] < target) {
+        low = high;
+        step *= 2;
+        high = low + step;
+    }
+    if (high > count) {
+        high = count;
+    }
+    /* values[low] < target, values[high] >= target (or high == count) */
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (values[mid] < target) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return high;
+}
+
+/* First container from 'from' with key >= key */
+static uint32_t find_container(const PostingSet* set, uint32_t from, long key) {
+    uint32_t low = from, high = set->container_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (set->containers[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int postings_contains(const PostingSet* set, long value) {
+    const PostingContainer* container;
+    uint32_t c;
+    long low;
+
+    if (set == NULL || value < 0 || value > POSTINGS_MAX_VALUE) {
+        return 0;
+    }
+    c = find_container(set, 0, value >> POSTINGS_CHUNK_BITS);
+    if (c == set->container_count || set->containers[c].key != value >> POSTINGS_CHUNK_BITS) {
+        return 0;
+    }
+    container = &set->containers[c];
+    low = value & LOW_MASK;
+    if (container->kind == POSTINGS_BITMAP) {
+        return bit_is_set(container->data.bitmap, low);
+    }
+    c = gallop(container->data.array, container->count, 0, low);
+    return c < container->count && container->data.array[c] == low;
+}
+
+/* Load the value at the iterator's place, or the next one, moving to later containers */
+static int iter_load(PostingIterator* it) {
+    while (it->set != NULL && it->container < it->set->container_count) {
+        const PostingContainer* container = &it->set->containers[it->container];
+        long base = (long)container->key << POSTINGS_CHUNK_BITS;
+
+        if (container->kind == POSTINGS_ARRAY) {
+            if (it->index < container->count) {
+                it->value = base + container->data.array[it->index];
+                return 1;
+            }
+        } else if (it->index < POSTINGS_CHUNK_SIZE) {
+            uint32_t w = it->index >> 6;
+            uint64_t word = container->data.bitmap[w] & (~0ULL << (it->index & 63));
+            while (1) {
+                if (word) {
+                    it->index = w * 64 + (uint32_t)__builtin_ctzll(word);
+                    it->value = base + it->index;
+                    return 1;
+                }
+                if (++w == POSTINGS_BITMAP_WORDS) {
+                    break;
+                }
+                word = container->data.bitmap[w];
+            }
+        }
+        it->container++;
+        it->index = 0;
+    }
+    it->value = -1;
+    return 0;
+}
+
+void postings_iter_open(PostingIterator* it, const PostingSet* set) {
+    it->set = set;
+    it->container = 0;
+    it->index = 0;
+    iter_load(it);
+}
+
+int postings_iter_next(PostingIterator* it) {
+    if (it->value < 0) {
+        return 0;
+    }
+    it->index++;
+    return iter_load(it);
+}
+
+int postings_iter_seek(PostingIterator* it, long target) {
+    const PostingContainer* container;
+    long key = target >> POSTINGS_CHUNK_BITS;
+
+    if (it->value < 0) {
+        return 0;
+    }
+    if (it->value >= target) {
+        return 1;
+    }
+    if (target > POSTINGS_MAX_VALUE) {
+        it->container = it->set->container_count;
+        return iter_load(it);
+    }
+
+    if (it->set->containers[it->container].key < key) {
+        it->container = find_container(it->set, it->container + 1, key);
+        it->index = 0;
+        if (it->container == it->set->container_count || it->set->containers[it->container].key > key) {
+            return iter_load(it);   /* every value there is past the target */
+        }
+    }
+    container = &it->set->containers[it->container];
+    if (container->kind == POSTINGS_ARRAY) {
+        it->index = gallop(container->data.array, container->count, it->index, target & LOW_MASK);
+    } else if (it->index < (uint32_t)(target & LOW_MASK)) {
+        it->index = (uint32_t)(target & LOW_MASK);
+    }
+    return iter_load(it);
+}
+
+/* ------------------------------------------------------------------ intersection kernels */
+
+/*
+ * Every kernel intersects a chunk of a with a chunk of b where a value with low bits l of
+ * the b chunk stands for low bits l + s of the a chunk (s folds the chunk keys and delta).
+ * Array outputs come out sorted; bitmap outputs are ORed into bits.
+ */
+
+static uint32_t and_array_array(const uint16_t* a, uint32_t na, const uint16_t* b, uint32_t nb, long s, uint16_t* out) {
+    uint32_t i, k, count = 0;
+
+    /* only a in [s, s + LOW_MASK] and b in [-s, LOW_MASK - s] can meet: when the shifted chunk
+       straddles two chunks of b this leaves a few values on one of the two calls */
+    i = gallop(a, na, 0, s);
+    na = gallop(a, na, i, s + LOW_MASK + 1);
+    k = gallop(b, nb, 0, -s);
+    nb = gallop(b, nb, k, LOW_MASK - s + 1);
+
+    if ((size_t)(na - i) * GALLOP_RATIO < nb - k) {
+        for (; i < na; i++) {
+            k = gallop(b, nb, k, a[i] - s);
+            if (k == nb) {
+                break;
+            }
+            if (b[k] + s == a[i]) {
+                out[count++] = a[i];
+            }
+        }
+    } else if ((size_t)(nb - k) * GALLOP_RATIO < na - i) {
+        for (; k < nb; k++) {
+            i = gallop(a, na, i, b[k] + s);
+            if (i == na) {
+                break;
+            }
+            if (a[i] == b[k] + s) {
+                out[count++] = a[i];
+            }
+        }
+    } else {
+        while (i < na && k < nb) {
+            long av = a[i], bv = b[k] + s;
+            if (av < bv) {
+                i++;
+            } else if (av > bv) {
+                k++;
+            } else {
+                out[count++] = a[i];
+                i++;
+                k++;
+            }
+        }
+    }
+    return count;
+}
+
+static uint32_t and_array_bitmap(const uint16_t* a, uint32_t na, const uint64_t* b, long s, uint16_t* out) {
+    uint32_t i, count = 0;
+    for (i = 0; i < na; i++) {
+        long bit = a[i] - s;
+        if (bit >= 0 && bit <= LOW_MASK && bit_is_set(b, bit)) {
+            out[count++] = a[i];
+        }
+    }
+    return count;
+}
+
+static void and_bitmap_array(const uint64_t* a, const uint16_t* b, uint32_t nb, long s, uint64_t* bits) {
+    uint32_t k;
+    for (k = 0; k < nb; k++) {
+        long bit = b[k] + s;
+        if (bit >= 0 && bit <= LOW_MASK && bit_is_set(a, bit)) {
+            bits[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+}
+
+/* 64 bits of a bitmap starting at bit start (anything outside the chunk reads as 0) */
+static uint64_t bits_at(const uint64_t* bitmap, long start) {
+    long word = start >> 6;   /* floor, also for negative starts */
+    int shift = (int)(start & 63);
+    uint64_t low = word >= 0 && word < POSTINGS_BITMAP_WORDS ? bitmap[word] : 0;
+    uint64_t high = word + 1 >= 0 && word + 1 < POSTINGS_BITMAP_WORDS ? bitmap[word + 1] : 0;
+    return shift == 0 ? low : (low >> shift) | (high << (64 - shift));
+}
+
+static void and_bitmap_bitmap(const uint64_t* a, const uint64_t* b, long s, uint64_t* bits) {
+    /* only the words of a that overlap [s, s + LOW_MASK] */
+    long w = s > 0 ? s >> 6 : 0;
+    long last = s + LOW_MASK < LOW_MASK ? (s + LOW_MASK) >> 6 : POSTINGS_BITMAP_WORDS - 1;
+    for (; w <= last; w++) {
+        if (a[w]) {
+            bits[w] |= a[w] & bits_at(b, (long)w * 64 - s);
+        }
+    }
+}
+
+PostingSet* postings_and(const PostingSet* a, const PostingSet* b, long delta) {
+    PostingSet* result;
+    Scratch scratch = { NULL, NULL };
+    uint32_t capacity = 0, c, first = 0;
+
+    result = mem_calloc(MEM_POSTING_SETS, 1, sizeof(PostingSet));
+    if (result == NULL || !open_scratch(&scratch)) {
+        mem_free(MEM_POSTING_SETS, result, sizeof(PostingSet));
+        close_scratch(&scratch);
+        return NULL;
+    }
+
+    for (c = 0; a != NULL && b != NULL && c < a->container_count; c++) {
+        const PostingContainer* ca = &a->containers[c];
+        long base = (long)ca->key << POSTINGS_CHUNK_BITS;
+        long low = base + delta, high = low + LOW_MASK;   /* what the chunk needs from b */
+        uint32_t count = 0, k;
+        int ok;
+
+        if (high < 0) {
+            continue;
+        }
+        while (first < b->container_count && ((long)b->containers[first].key << POSTINGS_CHUNK_BITS) + LOW_MASK < low) {
+            first++;
+        }
+        if (ca->kind == POSTINGS_BITMAP) {
+            memset(scratch.bits, 0, POSTINGS_BITMAP_WORDS * sizeof(uint64_t));
+        }
+
+        /* a shifted chunk overlaps at most two chunks of b */
+        for (k = first; k < b->container_count && ((long)b->containers[k].key << POSTINGS_CHUNK_BITS) <= high; k++) {
+            const PostingContainer* cb = &b->containers[k];
+            long s = ((long)cb->key << POSTINGS_CHUNK_BITS) - base - delta;
+            if (ca->kind == POSTINGS_ARRAY && cb->kind == POSTINGS_ARRAY) {
+                count += and_array_array(ca->data.array, ca->count, cb->data.array, cb->count, s, scratch.values + count);
+            } else if (ca->kind == POSTINGS_ARRAY) {
+                count += and_array_bitmap(ca->data.array, ca->count, cb->data.bitmap, s, scratch.values + count);
+            } else if (cb->kind == POSTINGS_ARRAY) {
+                and_bitmap_array(ca->data.bitmap, cb->data.array, cb->count, s, scratch.bits);
+            } else {
+                and_bitmap_bitmap(ca->data.bitmap, cb->data.bitmap, s, scratch.bits);
+            }
+        }
+
+        ok = ca->kind == POSTINGS_BITMAP ? emit_bitmap(result, &capacity, ca->key, scratch.bits, scratch.values)
+                                         : emit_array(result, &capacity, ca->key, scratch.values, count);
+        if (!ok) {
+            close_scratch(&scratch);
+            postings_destroy(finish(result, capacity));
+            return NULL;
+        }
+    }
+    close_scratch(&scratch);
+    return finish(result, capacity);
+}
+
+/* ------------------------------------------------------------------ union kernels */
+
+static uint32_t or_array_array(const uint16_t* a, uint32_t na, const uint16_t* b, uint32_t nb, uint16_t* out) {
+    uint32_t i = 0, k = 0, count = 0;
+    while (i < na && k < nb) {
+        if (a[i] < b[k]) {
+            out[count++] = a[i++];
+        } else if (a[i] > b[k]) {
+            out[count++] = b[k++];
+        } else {
+            out[count++] = a[i++];
+            k++;
+        }
+    }
+    while (i < na) {
+        out[count++] = a[i++];
+    }
+    while (k < nb) {
+        out[count++] = b[k++];
+    }
+    return count;
+}
+
+static void or_array_bitmap(const uint16_t* a, uint32_t na, const uint64_t* b, uint64_t* bits) {
+    uint32_t i;
+    memcpy(bits, b, POSTINGS_BITMAP_WORDS * sizeof(uint64_t));
+    for (i = 0; i < na; i++) {
+        bits[a[i] >> 6] |= 1ULL << (a[i] & 63);
+    }
+}
+
+static void or_bitmap_bitmap(const uint64_t* a, const uint64_t* b, uint64_t* bits) {
+    int w;
+    for (w = 0; w < POSTINGS_BITMAP_WORDS; w++) {
+        bits[w] = a[w] | b[w];
+    }
+}
+
+/* Append a copy of a container */
+static int emit_copy(PostingSet* set, uint32_t* capacity, const PostingContainer* container, uint16_t* scratch) {
+    return container->kind == POSTINGS_ARRAY
+           ? emit_array(set, capacity, container->key, container->data.array, container->count)
+           : emit_bitmap(set, capacity, container->key, container->data.bitmap, scratch);
+}
+
+PostingSet* postings_or(const PostingSet* a, const PostingSet* b) {
+    static const PostingSet empty = { 0, 0, NULL };
+    PostingSet* result;
+    Scratch scratch = { NULL, NULL };
+    uint32_t capacity = 0, i = 0, k = 0;
+    int ok = 1;
+
+    if (a == NULL) {
+        a = &empty;
+    }
+    if (b == NULL) {
+        b = &empty;
+    }
+    result = mem_calloc(MEM_POSTING_SETS, 1, sizeof(PostingSet));
+    if (result == NULL || !open_scratch(&scratch)) {
+        mem_free(MEM_POSTING_SETS, result, sizeof(PostingSet));
+        close_scratch(&scratch);
+        return NULL;
+    }
+
+    while (ok && (i < a->container_count || k < b->container_count)) {
+        const PostingContainer* ca = i < a->container_count ? &a->containers[i] : NULL;
+        const PostingContainer* cb = k < b->container_count ? &b->containers[k] : NULL;
+
+        if (cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            ok = emit_copy(result, &capacity, ca, scratch.values);
+            i++;
+        } else if (ca == NULL || cb->key < ca->key) {
+            ok = emit_copy(result, &capacity, cb, scratch.values);
+            k++;
+        } else {
+            if (ca->kind == POSTINGS_ARRAY && cb->kind == POSTINGS_ARRAY) {
+                /* at most 2 * POSTINGS_ARRAY_MAX values, emit_array turns it into a bitmap if needed */
+                uint32_t count = or_array_array(ca->data.array, ca->count, cb->data.array, cb->count, scratch.values);
+                ok = emit_array(result, &capacity, ca->key, scratch.values, count);
+            } else {
+                if (ca->kind == POSTINGS_ARRAY) {
+                    or_array_bitmap(ca->data.array, ca->count, cb->data.bitmap, scratch.bits);
+                } else if (cb->kind == POSTINGS_ARRAY) {
+                    or_array_bitmap(cb->data.array, cb->count, ca->data.bitmap, scratch.bits);
+                } else {
+                    or_bitmap_bitmap(ca->data.bitmap, cb->data.bitmap, scratch.bits);
+                }
+                ok = emit_bitmap(result, &capacity, ca->key, scratch.bits, scratch.values);
+            }
+            i++;
+            k++;
+        }
+    }
+    close_scratch(&scratch);
+    if (!ok) {
+        postings_destroy(finish(result, capacity));
+        return NULL;
+    }
+    return finish(result, capacity);
+}
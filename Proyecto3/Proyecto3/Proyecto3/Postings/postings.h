@@ -0,0 +1,148 @@
+/**
+ * @file postings.h
+ * @brief Compressed sets of token ordinals with a representation per density
+ *
+ * A PostingSet splits its values in chunks of 2^16 (by the high bits, roaring style) and
+ * stores every chunk in the container that is smaller for it: a sorted array of the
+ * 16 low bits (2 bytes per value) while the chunk holds up to POSTINGS_ARRAY_MAX values,
+ * a bitmap of the 65536 possible low bits (8 KB) once it holds more. Rare words end up
+ * as short arrays, words like "que" or "de" as bitmaps. Sets are immutable once built.
+ */
+
+#ifndef POSTINGS_H
+#define POSTINGS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define POSTINGS_CHUNK_BITS 16
+#define POSTINGS_CHUNK_SIZE (1L << POSTINGS_CHUNK_BITS)
+#define POSTINGS_ARRAY_MAX 4096                            /* where a bitmap gets smaller */
+#define POSTINGS_BITMAP_WORDS (POSTINGS_CHUNK_SIZE / 64)
+#define POSTINGS_MAX_VALUE 0xFFFFFFFFL
+
+/**
+ * @enum PostingContainerKind
+ * @brief How the values of one chunk are stored
+ */
+typedef enum {
+    POSTINGS_ARRAY,
+    POSTINGS_BITMAP
+} PostingContainerKind;
+
+/**
+ * @struct PostingContainer
+ * @brief The values of one chunk
+ *
+ * @param key High bits shared by the values of the chunk
+ * @param kind POSTINGS_ARRAY or POSTINGS_BITMAP
+ * @param count Number of values in the chunk
+ * @param array Sorted low bits (POSTINGS_ARRAY)
+ * @param bitmap POSTINGS_BITMAP_WORDS words, bit b set if low bits b are present (POSTINGS_BITMAP)
+ */
+typedef struct {
+    uint16_t key;
+    uint16_t kind;
+    uint32_t count;
+    union {
+        uint16_t* array;
+        uint64_t* bitmap;
+    } data;
+} PostingContainer;
+
+/**
+ * @struct PostingSet
+ * @brief Containers sorted by key, and the total number of values
+ */
+typedef struct {
+    size_t count;
+    uint32_t container_count;
+    PostingContainer* containers;
+} PostingSet;
+
+/**
+ * @struct PostingIterator
+ * @brief Read-only forward cursor over a set
+ *
+ * @param value Current value, -1 once exhausted
+ */
+typedef struct {
+    const PostingSet* set;
+    uint32_t container;
+    uint32_t index;          /* array: position in the array, bitmap: low bits of value */
+    long value;
+} PostingIterator;
+
+/**
+ * @brief Build a set from values sorted in increasing order without repetitions
+ *
+ * @return The set, or NULL if a value is out of 0..POSTINGS_MAX_VALUE or allocation failed
+ */
+PostingSet* postings_from_sorted(const long* values, size_t count);
+
+/**
+ * @brief Free a set and its containers
+ */
+void postings_destroy(PostingSet* set);
+
+/**
+ * @brief Number of values in the set
+ */
+size_t postings_count(const PostingSet* set);
+
+/**
+ * @brief Bytes allocated by the set
+ */
+size_t postings_memory(const PostingSet* set);
+
+/**
+ * @brief Add the number of containers of each kind to *arrays and *bitmaps
+ */
+void postings_container_counts(const PostingSet* set, size_t* arrays, size_t* bitmaps);
+
+/**
+ * @brief Check if the set holds value
+ */
+int postings_contains(const PostingSet* set, long value);
+
+/**
+ * @brief Place an iterator on the first value of a set (NULL gives an exhausted iterator)
+ */
+void postings_iter_open(PostingIterator* it, const PostingSet* set);
+
+/**
+ * @brief Advance to the first value >= target, never moving backwards
+ *
+ * @return 1 if there is such a value (in it->value), 0 once exhausted
+ */
+int postings_iter_seek(PostingIterator* it, long target);
+
+/**
+ * @brief Advance to the next value
+ *
+ * @return 1 if there is one (in it->value), 0 once exhausted
+ */
+int postings_iter_next(PostingIterator* it);
+
+/**
+ * @brief Values x of a such that x + delta is in b (plain intersection with delta 0)
+ *
+ * Phrases intersect the ordinals of their words shifted by their place in the phrase.
+ * Every pair of containers has its own kernel: array-array merges (galloping when one
+ * side is much shorter), array-bitmap probes bits, bitmap-bitmap ANDs whole words.
+ *
+ * @return The new set, or NULL if allocation failed
+ */
+PostingSet* postings_and(const PostingSet* a, const PostingSet* b, long delta);
+
+/**
+ * @brief Values in a or in b
+ *
+ * Array-array merges (into a bitmap if the chunk gets dense), array-bitmap sets bits,
+ * bitmap-bitmap ORs whole words.
+ *
+ * @return The new set, or NULL if allocation failed
+ */
+PostingSet* postings_or(const PostingSet* a, const PostingSet* b);
+
+#endif /* POSTINGS_H */
@@ -0,0 +1,134 @@
+/**
+ * @file postings_test.c
+ * @brief Checks posting sets and their kernels against plain boolean arrays
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "postings.h"
+
+#define RANGE 300000L   /* five chunks, the last one partial */
+
+static unsigned long seed = 42;
+
+static unsigned long next_random(void) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return seed >> 33;
+}
+
+/* Random set; density per chunk in thousandths, so one set can mix arrays and bitmaps */
+static PostingSet* random_set(char* present, const int* density, long* values) {
+    size_t count = 0;
+    long v;
+    for (v = 0; v < RANGE; v++) {
+        present[v] = (long)(next_random() % 1000) < density[v >> POSTINGS_CHUNK_BITS];
+        if (present[v]) {
+            values[count++] = v;
+        }
+    }
+    return postings_from_sorted(values, count);
+}
+
+/* Every value, in order, and nothing else */
+static void check_equal(const PostingSet* set, const char* present) {
+    PostingIterator it;
+    long v, expected = 0;
+    for (v = 0; v < RANGE; v++) {
+        expected += present[v];
+        assert(postings_contains(set, v) == present[v]);
+    }
+    assert(postings_count(set) == (size_t)expected);
+
+    postings_iter_open(&it, set);
+    for (v = 0; v < RANGE; v++) {
+        if (!present[v]) {
+            continue;
+        }
+        assert(it.value == v);
+        postings_iter_next(&it);
+    }
+    assert(it.value == -1);
+}
+
+static char present_a[RANGE], present_b[RANGE], expected[RANGE];
+static long values[RANGE];
+
+int main() {
+    /* thousandths per chunk: sparse arrays, arrays near the limit, bitmaps */
+    int sparse[] = { 2, 1, 5, 3, 0 };
+    int mixed[] = { 300, 2, 70, 500, 40 };
+    int dense[] = { 90, 600, 300, 80, 950 };
+    PostingSet *a, *b, *r;
+    PostingIterator it;
+    size_t arrays = 0, bitmaps = 0;
+    long deltas[] = { 0, 1, -1, 2, 63, -64, 65, 1000, -40000, 65536, -65537, 131071 };
+    long v, d;
+    int pass;
+
+    /* Construction picks the container by density */
+    a = postings_from_sorted(NULL, 0);
+    assert(a != NULL && postings_count(a) == 0);
+    postings_destroy(a);
+    a = random_set(present_a, mixed, values);
+    check_equal(a, present_a);
+    postings_container_counts(a, &arrays, &bitmaps);
+    assert(arrays == 2 && bitmaps == 3);
+    assert(postings_memory(a) < postings_count(a) * sizeof(long));
+    values[0] = -1;
+    assert(postings_from_sorted(values, 1) == NULL);
+
+    /* Seek never moves backwards and lands on the first value >= target */
+    postings_iter_open(&it, a);
+    for (v = 0; v < RANGE; v += 1 + (long)(next_random() % 3000)) {
+        long first = v;
+        while (first < RANGE && !present_a[first]) {
+            first++;
+        }
+        postings_iter_seek(&it, v);
+        assert(it.value == (first < RANGE ? first : -1));
+    }
+    postings_destroy(a);
+
+    /* Intersections (shifted) and unions, for every pair of densities */
+    for (pass = 0; pass < 9; pass++) {
+        const int* da = pass / 3 == 0 ? sparse : pass / 3 == 1 ? mixed : dense;
+        const int* db = pass % 3 == 0 ? sparse : pass % 3 == 1 ? mixed : dense;
+        a = random_set(present_a, da, values);
+        b = random_set(present_b, db, values);
+
+        for (d = 0; d < (long)(sizeof(deltas) / sizeof(deltas[0])); d++) {
+            for (v = 0; v < RANGE; v++) {
+                long shifted = v + deltas[d];
+                expected[v] = present_a[v] && shifted >= 0 && shifted < RANGE && present_b[shifted];
+            }
+            r = postings_and(a, b, deltas[d]);
+            check_equal(r, expected);
+            postings_destroy(r);
+        }
+
+        for (v = 0; v < RANGE; v++) {
+            expected[v] = present_a[v] || present_b[v];
+        }
+        r = postings_or(a, b);
+        check_equal(r, expected);
+        postings_destroy(r);
+
+        postings_destroy(a);
+        postings_destroy(b);
+    }
+
+    /* Empty operands */
+    memset(expected, 0, sizeof(expected));
+    a = random_set(present_a, dense, values);
+    r = postings_and(a, NULL, 0);
+    check_equal(r, expected);
+    postings_destroy(r);
+    r = postings_or(NULL, a);
+    check_equal(r, present_a);
+    postings_destroy(r);
+    postings_destroy(a);
+
+    printf("All postings tests passed successfully.\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+#include "Query.h"
+
+/*
+ * Indexa los libros (con palabras cortas, donde estan las listas mas largas) con las
+ * postings en vectores de ordinales y congeladas en PostingSets, y compara memoria de las postings,
+ * tiempo de carga y tiempo de consultas con palabras frecuentes (el mejor de RUNS).
+ * Al final, los kernels de interseccion y union contra el merge de dos arreglos ordenados,
+ * con palabras de los libros (solo arreglos: ninguna llega a 4096 de cada 65536 tokens) y con
+ * conjuntos sinteticos mas densos, donde aparecen los bitmaps.
+ *
+ *   Postings_bench [file...]     (por defecto los cuatro libros de libros/)
+ */
+
+#define RUNS 5
+#define KERNEL_RUNS 200
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static const char* queries[] = { "\"de la\"", "\"lo que\"", "\"en el\"", "para, como", "que AND para" };
+#define QUERIES (int)(sizeof(queries) / sizeof(queries[0]))
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static InvertedIndex* load(BOOLEAN hybrid, const char* files[], int file_count, double* best) {
+    InvertedIndex* idx = NULL;
+    *best = -1;
+    for (int r = 0; r < RUNS; ++r) {
+        if (idx) II_Destroy(idx);
+        idx = II_Create();
+        II_SetIndexShortWords(idx, TRUE);
+        II_SetHybridPostings(idx, hybrid);
+
+        double start = now_ms();
+        for (int f = 0; f < file_count; ++f) {
+            if (II_LoadFile(idx, files[f]) < 0) {
+                fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        double elapsed = now_ms() - start;
+        if (*best < 0 || elapsed < *best) *best = elapsed;
+    }
+    return idx;
+}
+
+/* Todos los resultados de la consulta; devuelve la cantidad y el mejor tiempo en *best */
+static int run_query(const InvertedIndex* idx, const char* query, double* best) {
+    char text[256], error[QUERY_ERROR_LENGTH];
+    int count = 0;
+    *best = -1;
+    for (int r = 0; r < RUNS; ++r) {
+        snprintf(text, sizeof(text), "%s", query);
+        double start = now_ms();
+        QueryStream* stream = QY_OpenText(idx, text, error, sizeof(error));
+        printData result;
+        count = 0;
+        while (stream && QY_StreamNext(stream, &result)) count++;
+        QY_StreamClose(stream);
+        double elapsed = now_ms() - start;
+        if (*best < 0 || elapsed < *best) *best = elapsed;
+    }
+    return count;
+}
+
+/* Los ordinales de una palabra en el documento 0, de vuelta a un arreglo */
+static long* ordinals_of(const InvertedIndex* idx, const char* word, size_t* count) {
+    const Occurrence* occurrence = FindOccurrenceByDocId(II_Postings(idx, word), 0);
+    long* ords = malloc(sizeof(long) * GetOrdinalCount(occurrence));
+    PostingCursor cursor;
+    OpenPostingCursor(&cursor, II_Postings(idx, word));
+    *count = 0;
+    do {
+        ords[(*count)++] = CursorOrdinal(&cursor);
+    } while (CursorNextOrdinal(&cursor));
+    return ords;
+}
+
+/* Merge de dos arreglos ordenados: x de a con x + delta en b, o la union */
+static size_t merge(const long* a, size_t na, const long* b, size_t nb, long delta, BOOLEAN both, long* out) {
+    size_t i = 0, j = 0, n = 0;
+    while (i < na && j < nb) {
+        long x = a[i] + (both ? delta : 0);
+        if (x < b[j]) {
+            if (!both) out[n++] = a[i];
+            i++;
+        } else if (x > b[j]) {
+            if (!both) out[n++] = b[j];
+            j++;
+        } else {
+            out[n++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    if (!both) {
+        while (i < na) out[n++] = a[i++];
+        while (j < nb) out[n++] = b[j++];
+    }
+    return n;
+}
+
+static void kernels(const char* first, const long* arr_a, size_t na, const char* second, const long* arr_b, size_t nb) {
+    PostingSet* a = postings_from_sorted(arr_a, na);
+    PostingSet* b = postings_from_sorted(arr_b, nb);
+    long* out = malloc(sizeof(long) * (na + nb));
+
+    double start = now_ms();
+    size_t and_merge = 0, or_merge = 0, and_sets = 0, or_sets = 0;
+    for (int r = 0; r < KERNEL_RUNS; ++r) and_merge = merge(arr_a, na, arr_b, nb, 1, TRUE, out);
+    double t_and_merge = (now_ms() - start) * 1e3 / KERNEL_RUNS;
+    start = now_ms();
+    for (int r = 0; r < KERNEL_RUNS; ++r) or_merge = merge(arr_a, na, arr_b, nb, 0, FALSE, out);
+    double t_or_merge = (now_ms() - start) * 1e3 / KERNEL_RUNS;
+    start = now_ms();
+    for (int r = 0; r < KERNEL_RUNS; ++r) {
+        PostingSet* result = postings_and(a, b, 1);
+        and_sets = postings_count(result);
+        postings_destroy(result);
+    }
+    double t_and_sets = (now_ms() - start) * 1e3 / KERNEL_RUNS;
+    start = now_ms();
+    for (int r = 0; r < KERNEL_RUNS; ++r) {
+        PostingSet* result = postings_or(a, b);
+        or_sets = postings_count(result);
+        postings_destroy(result);
+    }
+    double t_or_sets = (now_ms() - start) * 1e3 / KERNEL_RUNS;
+
+    size_t arrays_a = 0, bitmaps_a = 0, arrays_b = 0, bitmaps_b = 0;
+    postings_container_counts(a, &arrays_a, &bitmaps_a);
+    postings_container_counts(b, &arrays_b, &bitmaps_b);
+    printf("%-7s (%6zu, %zua/%zub) %-7s (%6zu, %zua/%zub)  AND+1 merge %7.1f us  sets %7.1f us (%zu/%zu)"
+           "  OR merge %7.1f us  sets %7.1f us (%zu/%zu)\n",
+           first, na, arrays_a, bitmaps_a, second, nb, arrays_b, bitmaps_b,
+           t_and_merge, t_and_sets, and_sets, and_merge, t_or_merge, t_or_sets, or_sets, or_merge);
+    postings_destroy(a);
+    postings_destroy(b);
+    free(out);
+}
+
+static void book_kernels(const InvertedIndex* idx, const char* first, const char* second) {
+    size_t na, nb;
+    long* arr_a = ordinals_of(idx, first, &na);
+    long* arr_b = ordinals_of(idx, second, &nb);
+    kernels(first, arr_a, na, second, arr_b, nb);
+    free(arr_a);
+    free(arr_b);
+}
+
+/* Un valor de cada `every` en promedio, sobre SYNTHETIC_RANGE */
+#define SYNTHETIC_RANGE 1000000L
+static long* synthetic(int every, unsigned long seed, size_t* count) {
+    long* values = malloc(sizeof(long) * SYNTHETIC_RANGE);
+    *count = 0;
+    for (long v = 0; v < SYNTHETIC_RANGE; ++v) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        if ((seed >> 33) % every == 0) values[(*count)++] = v;
+    }
+    return values;
+}
+
+static void synthetic_kernels(int every_a, int every_b) {
+    char first[16], second[16];
+    size_t na, nb;
+    long* arr_a = synthetic(every_a, 1, &na);
+    long* arr_b = synthetic(every_b, 2, &nb);
+    snprintf(first, sizeof(first), "1/%d", every_a);
+    snprintf(second, sizeof(second), "1/%d", every_b);
+    kernels(first, arr_a, na, second, arr_b, nb);
+    free(arr_a);
+    free(arr_b);
+}
+
+int main(int argc, char** argv) {
+    const char* defaults[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    const char** files = argc > 1 ? (const char**)argv + 1 : defaults;
+    int file_count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    if (file_count > MAX_OPEN_FILES) file_count = MAX_OPEN_FILES;
+
+    double load_plain, load_frozen;
+    InvertedIndex* plain = load(FALSE, files, file_count, &load_plain);
+    InvertedIndex* frozen = load(TRUE, files, file_count, &load_frozen);
+
+    size_t arrays = 0, bitmaps = 0;
+    for (TermId term = 0; term < frozen->terms.count; ++term) {
+        for (const Occurrence* cur = frozen->terms.postings[term].first; cur; cur = cur->next) {
+            size_t a = 0, b = 0;
+            postings_container_counts(cur->ordinal_set, &a, &b);
+            arrays += a;
+            bitmaps += b;
+        }
+    }
+
+    printf("\n%-16s %14s %10s\n", "postings", "memoria", "carga");
+    printf("%-16s %11.1f KB %7.1f ms\n", "vectores", II_PostingsMemory(plain) / 1024.0, load_plain);
+    printf("%-16s %11.1f KB %7.1f ms   (%zu arreglos, %zu bitmaps)\n\n", "PostingSet",
+           II_PostingsMemory(frozen) / 1024.0, load_frozen, arrays, bitmaps);
+
+    printf("%-16s %10s %12s %12s\n", "consulta", "resultados", "vectores", "PostingSet");
+    for (int q = 0; q < QUERIES; ++q) {
+        double t_plain, t_frozen;
+        int n_plain = run_query(plain, queries[q], &t_plain);
+        int n_frozen = run_query(frozen, queries[q], &t_frozen);
+        if (n_plain != n_frozen) {
+            fprintf(stderr, "'%s': %d resultados contra %d\n", queries[q], n_plain, n_frozen);
+            return EXIT_FAILURE;
+        }
+        printf("%-16s %10d %9.2f ms %9.2f ms\n", queries[q], n_plain, t_plain, t_frozen);
+    }
+
+    printf("\nKernels sobre %s\n", files[0]);
+    book_kernels(frozen, "de", "la");
+    book_kernels(frozen, "que", "no");
+    book_kernels(frozen, "de", "sancho");
+    book_kernels(frozen, "lo", "molinos");
+    printf("\nKernels sobre %ld valores sinteticos\n", SYNTHETIC_RANGE);
+    synthetic_kernels(4, 8);      // bitmap-bitmap
+    synthetic_kernels(4, 100);    // bitmap-arreglo
+    synthetic_kernels(30, 100);   // arreglo-arreglo
+    synthetic_kernels(100, 5000); // arreglo corto: galope
+
+    II_Destroy(plain);
+    II_Destroy(frozen);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+
+/*
+ * Carga los libros con y sin presizing (tamanho estimado con la ley de Heaps a partir
+ * del tamanho del archivo) y compara resizes del diccionario, crecimientos de la tabla
+ * de tokens y tiempo de carga (el mejor de RUNS).
+ *
+ *   Presize_bench [file...]     (por defecto los cuatro libros de libros/)
+ */
+
+#define RUNS 5
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static void run(const char* label, BOOLEAN presize, const char* files[], int file_count) {
+    double best = -1;
+    InvertedIndex* idx = NULL;
+
+    for (int r = 0; r < RUNS; ++r) {
+        if (idx) II_Destroy(idx);
+        idx = II_Create();
+        II_SetPresize(idx, presize);
+
+        double start = now_ms();
+        for (int f = 0; f < file_count; ++f) {
+            if (II_LoadFile(idx, files[f]) < 0) {
+                fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        double elapsed = now_ms() - start;
+        if (best < 0 || elapsed < best) best = elapsed;
+    }
+
+    printf("%-14s carga %8.1f ms  resizes del diccionario %2d  crecimientos de tablas de tokens %3ld  capacidad final %d\n",
+           label, best, idx->table->resizes, idx->token_table_grows, idx->table->cap);
+    II_Destroy(idx);
+}
+
+int main(int argc, char** argv) {
+    const char* defaults[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    const char** files = argc > 1 ? (const char**)argv + 1 : defaults;
+    int file_count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    if (file_count > MAX_OPEN_FILES) file_count = MAX_OPEN_FILES;
+
+    // estimacion contra lo que realmente queda en el indice, archivo por archivo
+    InvertedIndex* idx = II_Create();
+    long tokens = 0;
+    printf("%-24s %10s %10s %10s %10s\n", "archivo", "tokens est", "tokens", "vocab est", "vocab");
+    for (int f = 0; f < file_count; ++f) {
+        int id = II_LoadFile(idx, files[f]);
+        if (id < 0) {
+            fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+            return EXIT_FAILURE;
+        }
+        long expected = II_EstimateTokens(idx->documents[id]->size);
+        tokens += (long)arraylist_size(idx->token_offsets[id]);
+        printf("%-24s %10ld %10zu %10ld %10d\n", files[f], expected, arraylist_size(idx->token_offsets[id]),
+               II_EstimateVocabulary(tokens), HTSize(idx->table));
+    }
+    II_Destroy(idx);
+    printf("\n");
+
+    run("sin presizing", FALSE, files, file_count);
+    run("con presizing", TRUE, files, file_count);
+    return EXIT_SUCCESS;
+}
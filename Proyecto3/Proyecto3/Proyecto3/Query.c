@@ -0,0 +1,829 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "Query.h"
+#include "ArrayList/arraylist.h"
+
+// ---------------------------------------------------------------- lexer
+
+typedef enum _TokenKind {
+    TOKEN_WORD, TOKEN_AND, TOKEN_OR, TOKEN_NOT, TOKEN_NEAR, TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_END
+} TokenKind;
+
+typedef struct _Lexer {
+    const char* p;
+    TokenKind kind;                   // current token
+    char word[MAX_WORD_LENGTH + 1];   // TOKEN_WORD: lowercase word
+    int near_window;                  // TOKEN_NEAR: k, or the default window without "/k"
+    int window;                       // window of AND/NOT (and of NEAR without "/k")
+    int depth;
+    char* error;
+    size_t error_size;
+} Lexer;
+
+// Words are alphabetic runs, as in II_LoadFile; anything else but parentheses separates them
+static void next_token(Lexer* lx) {
+    while (*lx->p && !isalpha((unsigned char)*lx->p) && *lx->p != '(' && *lx->p != ')') lx->p++;
+
+    if (*lx->p == '\0') { lx->kind = TOKEN_END; return; }
+    if (*lx->p == '(') { lx->p++; lx->kind = TOKEN_LPAREN; return; }
+    if (*lx->p == ')') { lx->p++; lx->kind = TOKEN_RPAREN; return; }
+
+    const char* begin = lx->p;
+    int len = 0;
+    while (isalpha((unsigned char)*lx->p)) {
+        if (len < MAX_WORD_LENGTH) lx->word[len++] = *lx->p;
+        lx->p++;
+    }
+    lx->word[len] = '\0';
+    size_t run = (size_t)(lx->p - begin);
+
+    if (run == 3 && strncmp(begin, "AND", 3) == 0) { lx->kind = TOKEN_AND; return; }
+    if (run == 2 && strncmp(begin, "OR", 2) == 0) { lx->kind = TOKEN_OR; return; }
+    if (run == 3 && strncmp(begin, "NOT", 3) == 0) { lx->kind = TOKEN_NOT; return; }
+    if (run == 4 && strncmp(begin, "NEAR", 4) == 0) {
+        lx->kind = TOKEN_NEAR;
+        lx->near_window = lx->window;
+        if (*lx->p == '/' && isdigit((unsigned char)lx->p[1])) {
+            lx->near_window = (int)strtol(lx->p + 1, (char**)&lx->p, 10);
+        }
+        return;
+    }
+
+    for (int i = 0; i < len; ++i) lx->word[i] = tolower((unsigned char)lx->word[i]);
+    lx->kind = TOKEN_WORD;
+}
+
+// ---------------------------------------------------------------- tree
+
+static QueryNode* new_node(QueryKind kind) {
+    QueryNode* node = calloc(1, sizeof(QueryNode));
+    if (node) node->kind = kind;
+    return node;
+}
+
+static BOOLEAN add_child(QueryNode* parent, QueryNode* child) {
+    QueryNode** grown = realloc(parent->children, (parent->child_count + 1) * sizeof(QueryNode*));
+    if (!grown) return FALSE;
+    parent->children = grown;
+    parent->children[parent->child_count++] = child;
+    return TRUE;
+}
+
+void QY_Free(QueryNode* node) {
+    if (!node) return;
+    for (int i = 0; i < node->child_count; ++i) QY_Free(node->children[i]);
+    free(node->children);
+    free(node->term);
+    free(node);
+}
+
+// ---------------------------------------------------------------- parser
+
+static QueryNode* parse_or(Lexer* lx);
+
+static QueryNode* syntax_error(Lexer* lx, const char* message) {
+    if (lx->error && lx->error[0] == '\0') snprintf(lx->error, lx->error_size, "%s", message);
+    return NULL;
+}
+
+static QueryNode* parse_primary(Lexer* lx) {
+    if (lx->kind == TOKEN_WORD) {
+        QueryNode* node = new_node(QUERY_TERM);
+        if (!node || !(node->term = strdup(lx->word))) {
+            free(node);
+            return syntax_error(lx, "out of memory");
+        }
+        next_token(lx);
+        return node;
+    }
+    if (lx->kind == TOKEN_LPAREN) {
+        if (++lx->depth > QUERY_MAX_DEPTH) return syntax_error(lx, "too many nested parentheses");
+        next_token(lx);
+        QueryNode* inner = parse_or(lx);
+        if (!inner) return NULL;
+        if (lx->kind != TOKEN_RPAREN) {
+            QY_Free(inner);
+            return syntax_error(lx, "missing ')'");
+        }
+        lx->depth--;
+        next_token(lx);
+        return inner;
+    }
+    if (lx->kind == TOKEN_RPAREN) return syntax_error(lx, "unexpected ')'");
+    if (lx->kind == TOKEN_END) return syntax_error(lx, "expected a word at the end of the query");
+    return syntax_error(lx, "expected a word or '(' before an operator");
+}
+
+static QueryNode* parse_near(Lexer* lx) {
+    QueryNode* left = parse_primary(lx);
+    while (left && lx->kind == TOKEN_NEAR) {
+        int k = lx->near_window;
+        next_token(lx);
+        QueryNode* right = parse_primary(lx);
+        if (!right) {
+            QY_Free(left);
+            return NULL;
+        }
+        // a NEAR/k b NEAR/k c is one node with three operands
+        if (left->kind != QUERY_NEAR || left->window != k) {
+            QueryNode* near = new_node(QUERY_NEAR);
+            if (!near || !add_child(near, left)) {
+                QY_Free(near);
+                QY_Free(left);
+                QY_Free(right);
+                return syntax_error(lx, "out of memory");
+            }
+            near->window = k;
+            left = near;
+        }
+        if (!add_child(left, right)) {
+            QY_Free(left);
+            QY_Free(right);
+            return syntax_error(lx, "out of memory");
+        }
+    }
+    return left;
+}
+
+// Every NOT operand of a chain excludes from the conjunction of the others
+static QueryNode* parse_and(Lexer* lx) {
+    QueryNode* positive = new_node(QUERY_AND);
+    QueryNode* negative = new_node(QUERY_NOT);
+    if (!positive || !negative) {
+        QY_Free(positive);
+        QY_Free(negative);
+        return syntax_error(lx, "out of memory");
+    }
+    positive->window = lx->window;
+    negative->window = lx->window;
+
+    while (1) {
+        BOOLEAN excluded = FALSE;
+        if (lx->kind == TOKEN_AND) next_token(lx);
+        if (lx->kind == TOKEN_NOT) {
+            excluded = TRUE;
+            next_token(lx);
+        }
+        QueryNode* operand = parse_near(lx);
+        if (!operand || !add_child(excluded ? negative : positive, operand)) {
+            QY_Free(operand);
+            QY_Free(positive);
+            QY_Free(negative);
+            return operand ? syntax_error(lx, "out of memory") : NULL;
+        }
+        if (lx->kind != TOKEN_AND && lx->kind != TOKEN_NOT && lx->kind != TOKEN_WORD && lx->kind != TOKEN_LPAREN) break;
+    }
+
+    if (positive->child_count == 0) {
+        QY_Free(positive);
+        QY_Free(negative);
+        return syntax_error(lx, "NOT needs something to exclude from");
+    }
+    QueryNode* result = positive;
+    if (positive->child_count == 1) {
+        result = positive->children[0];
+        positive->child_count = 0;
+        QY_Free(positive);
+    }
+    if (negative->child_count == 0) {
+        QY_Free(negative);
+        return result;
+    }
+
+    // NOT: the positive side first, then the exclusions
+    QueryNode** children = malloc((negative->child_count + 1) * sizeof(QueryNode*));
+    if (!children) {
+        QY_Free(result);
+        QY_Free(negative);
+        return syntax_error(lx, "out of memory");
+    }
+    children[0] = result;
+    memcpy(children + 1, negative->children, negative->child_count * sizeof(QueryNode*));
+    free(negative->children);
+    negative->children = children;
+    negative->child_count++;
+    return negative;
+}
+
+static QueryNode* parse_or(Lexer* lx) {
+    QueryNode* left = parse_and(lx);
+    if (!left || lx->kind != TOKEN_OR) return left;
+
+    QueryNode* any = new_node(QUERY_OR);
+    if (!any || !add_child(any, left)) {
+        QY_Free(any);
+        QY_Free(left);
+        return syntax_error(lx, "out of memory");
+    }
+    while (lx->kind == TOKEN_OR) {
+        next_token(lx);
+        QueryNode* right = parse_and(lx);
+        if (!right || !add_child(any, right)) {
+            QY_Free(right);
+            QY_Free(any);
+            return right ? syntax_error(lx, "out of memory") : NULL;
+        }
+    }
+    return any;
+}
+
+BOOLEAN QY_IsBoolean(const char* text) {
+    if (!text) return FALSE;
+    Lexer lx = { 0 };
+    lx.p = text;
+    for (next_token(&lx); lx.kind != TOKEN_END; next_token(&lx)) {
+        if (lx.kind != TOKEN_WORD) return TRUE;
+    }
+    return FALSE;
+}
+
+BOOLEAN QY_IsWordList(const char* text) {
+    return text != NULL && strchr(text, '"') == NULL && !QY_IsBoolean(text);
+}
+
+QueryNode* QY_Parse(const char* text, int window, char* error, size_t error_size) {
+    if (error && error_size > 0) error[0] = '\0';
+    if (!text) return NULL;
+
+    Lexer lx = { 0 };
+    lx.p = text;
+    lx.window = window > 0 ? window : DEFAULT_WORD_WINDOW;
+    lx.error = error_size > 0 ? error : NULL;
+    lx.error_size = error_size;
+    next_token(&lx);
+
+    QueryNode* root = parse_or(&lx);
+    if (root && lx.kind != TOKEN_END) {
+        QY_Free(root);
+        return syntax_error(&lx, lx.kind == TOKEN_RPAREN ? "unexpected ')'" : "unexpected operator");
+    }
+    return root;
+}
+
+// ---------------------------------------------------------------- planner
+
+static int compare_cost(const void* a, const void* b) {
+    long ca = (*(QueryNode* const*)a)->cost;
+    long cb = (*(QueryNode* const*)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+static int compare_cost_desc(const void* a, const void* b) {
+    return compare_cost(b, a);
+}
+
+static QueryNode* make_empty(QueryNode* node) {
+    QY_Free(node);
+    return new_node(QUERY_EMPTY);
+}
+
+// Replace node->children[i] by its own children (same operator, same window)
+static BOOLEAN inline_child(QueryNode* node, int i) {
+    QueryNode* child = node->children[i];
+    int total = node->child_count - 1 + child->child_count;
+    QueryNode** merged = malloc(total * sizeof(QueryNode*));
+    if (!merged) return FALSE;
+
+    memcpy(merged, node->children, i * sizeof(QueryNode*));
+    memcpy(merged + i, child->children, child->child_count * sizeof(QueryNode*));
+    memcpy(merged + i + child->child_count, node->children + i + 1, (node->child_count - i - 1) * sizeof(QueryNode*));
+    free(node->children);
+    node->children = merged;
+    node->child_count = total;
+
+    child->child_count = 0;
+    QY_Free(child);
+    return TRUE;
+}
+
+static void remove_child(QueryNode* node, int i) {
+    memmove(node->children + i, node->children + i + 1, (node->child_count - i - 1) * sizeof(QueryNode*));
+    node->child_count--;
+}
+
+// Returns the planned node, or NULL when it only held ignored words
+static QueryNode* plan_node(const InvertedIndex* idx, QueryNode* node) {
+    if (node->kind == QUERY_TERM) {
+        if ((int)strlen(node->term) < WORD_MIN_LENGTH && !idx->index_short_words) {
+            QY_Free(node);
+            return NULL;
+        }
+        node->cost = II_TermCount(idx, node->term);
+        node->width = 0;
+        return node->cost == 0 ? make_empty(node) : node;
+    }
+
+    for (int i = 0; i < node->child_count; ++i) {
+        node->children[i] = plan_node(idx, node->children[i]);
+        if (!node->children[i]) {
+            if (i == 0 && node->kind == QUERY_NOT) {  // nothing left to exclude from
+                QY_Free(node);
+                return NULL;
+            }
+            remove_child(node, i--);
+        }
+    }
+
+    if (node->kind == QUERY_NOT) {
+        if (node->children[0]->kind == QUERY_EMPTY) return make_empty(node);
+
+        // NOT (a OR b) excludes a and b separately, so each one is a cheap term probe
+        for (int i = 1; i < node->child_count; ++i) {
+            if (node->children[i]->kind == QUERY_EMPTY) {
+                QY_Free(node->children[i]);
+                remove_child(node, i--);
+            } else if (node->children[i]->kind == QUERY_OR) {
+                if (!inline_child(node, i)) return make_empty(node);
+                i--;
+            }
+        }
+        if (node->child_count == 1) {
+            QueryNode* positive = node->children[0];
+            node->child_count = 0;
+            QY_Free(node);
+            return positive;
+        }
+        // probe the most frequent exclusions first, they are the likeliest to reject
+        qsort(node->children + 1, node->child_count - 1, sizeof(QueryNode*), compare_cost_desc);
+        node->cost = node->children[0]->cost;
+        node->width = node->children[0]->width;
+        return node;
+    }
+
+    if (node->child_count == 0) {
+        QY_Free(node);
+        return NULL;
+    }
+    if (node->child_count == 1) {
+        QueryNode* only = node->children[0];
+        node->child_count = 0;
+        QY_Free(node);
+        return only;
+    }
+
+    if (node->kind == QUERY_OR) {
+        for (int i = 0; i < node->child_count; ++i) {
+            QueryNode* child = node->children[i];
+            if (child->kind == QUERY_EMPTY) {
+                QY_Free(child);
+                remove_child(node, i--);
+            } else if (child->kind == QUERY_OR) {
+                if (!inline_child(node, i)) return make_empty(node);
+                i--;
+            }
+        }
+        if (node->child_count == 0) return make_empty(node);
+        if (node->child_count == 1) {
+            QueryNode* only = node->children[0];
+            node->child_count = 0;
+            QY_Free(node);
+            return only;
+        }
+        node->cost = 0;
+        node->width = 0;
+        for (int i = 0; i < node->child_count; ++i) {
+            node->cost += node->children[i]->cost;
+            if (node->children[i]->width > node->width) node->width = node->children[i]->width;
+        }
+        return node;
+    }
+
+    // AND / NEAR: one operand without matches empties the conjunction
+    for (int i = 0; i < node->child_count; ++i) {
+        QueryNode* child = node->children[i];
+        if (child->kind == QUERY_EMPTY) return make_empty(node);
+        if ((child->kind == QUERY_AND || child->kind == QUERY_NEAR) && child->window == node->window) {
+            if (!inline_child(node, i)) return make_empty(node);
+            i--;
+        }
+    }
+    qsort(node->children, node->child_count, sizeof(QueryNode*), compare_cost);
+    node->cost = node->children[0]->cost;
+    node->width = node->window;
+    return node;
+}
+
+QueryNode* QY_Plan(const InvertedIndex* idx, QueryNode* root) {
+    if (!idx || !root) return root;
+    QueryNode* plan = plan_node(idx, root);
+    return plan ? plan : new_node(QUERY_EMPTY);
+}
+
+void QY_Print(const QueryNode* node, FILE* out) {
+    if (!node) return;
+    switch (node->kind) {
+    case QUERY_TERM:
+        fprintf(out, "%s[%ld]", node->term, node->cost);
+        return;
+    case QUERY_EMPTY:
+        fprintf(out, "EMPTY");
+        return;
+    case QUERY_AND:  fprintf(out, "AND/%d", node->window); break;
+    case QUERY_NEAR: fprintf(out, "NEAR/%d", node->window); break;
+    case QUERY_OR:   fprintf(out, "OR"); break;
+    case QUERY_NOT:  fprintf(out, "NOT/%d", node->window); break;
+    }
+    fprintf(out, "[%ld](", node->cost);
+    for (int i = 0; i < node->child_count; ++i) {
+        if (i > 0) fprintf(out, " ");
+        QY_Print(node->children[i], out);
+    }
+    fprintf(out, ")");
+}
+
+int QY_Terms(const QueryNode* node, char* out[], int max_out) {
+    if (!node || max_out <= 0) return 0;
+    if (node->kind == QUERY_TERM) {
+        out[0] = node->term;
+        return 1;
+    }
+    int count = 0;
+    int children = node->kind == QUERY_NOT ? 1 : node->child_count;  // exclusions never show up
+    for (int i = 0; i < children && count < max_out; ++i) {
+        count += QY_Terms(node->children[i], out + count, max_out - count);
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------- evaluation
+
+/*
+ * Every node of the plan gets a Matcher producing its matches ordered by (doc, key).
+ * The only operation is seek: move to the first match with (doc, key) >= (doc, pos),
+ * never backwards, so a conjunction can jump its frequent operands straight to where
+ * the rare one matched (galloping searches inside the postings) instead of walking them.
+ * The key is the last token of the match, except for AND/NEAR where it is the end of
+ * the window that was checked: the words found may end before it.
+ */
+typedef struct _Matcher {
+    const QueryNode* node;
+    int doc;                       // current match, -1 once exhausted
+    long start;                    // first and last token matched
+    long end;
+    long key;                      // seek position of the match (>= end)
+    PostingCursor postings;        // QUERY_TERM
+    struct _Matcher* children;
+    int cached_doc;                // exclusion that isn't a term: its matches in cached_doc
+    ArrayList* cached;             // (start, end, key) triples of long, ordered by key
+} Matcher;
+
+struct _QueryCursor {
+    const InvertedIndex* idx;
+    Matcher root;
+    int doc;                       // where the next seek starts
+    long pos;
+    int last_doc;                  // last match returned, later overlapping ones are skipped
+    long last_end;
+    long skip;                     // a match after last_end can't have a key below last_end + 1 + skip
+};
+
+static BOOLEAN matcher_init(Matcher* m, const InvertedIndex* idx, const QueryNode* node) {
+    memset(m, 0, sizeof(Matcher));
+    m->node = node;
+    m->doc = 0;
+    m->start = m->end = m->key = -1;
+    m->cached_doc = -1;
+
+    if (node->kind == QUERY_TERM) {
+        OpenPostingCursor(&m->postings, II_Postings(idx, node->term));
+        return TRUE;
+    }
+    if (node->child_count == 0) return TRUE;
+
+    m->children = calloc(node->child_count, sizeof(Matcher));
+    if (!m->children) return FALSE;
+    for (int i = 0; i < node->child_count; ++i) {
+        if (!matcher_init(&m->children[i], idx, node->children[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+static void matcher_free(Matcher* m) {
+    if (m->children) {
+        for (int i = 0; i < m->node->child_count; ++i) matcher_free(&m->children[i]);
+        free(m->children);
+    }
+    arraylist_destroy(m->cached);
+}
+
+static BOOLEAN exhausted(Matcher* m) {
+    m->doc = -1;
+    return FALSE;
+}
+
+// (doc, key) of m is at or past (doc, pos)
+static BOOLEAN at_or_past(const Matcher* m, int doc, long pos) {
+    return m->doc > doc || (m->doc == doc && m->key >= pos);
+}
+
+static BOOLEAN matcher_seek(Matcher* m, int doc, long pos);
+
+static BOOLEAN seek_term(Matcher* m, int doc, long pos) {
+    int d = CursorSeekDocument(&m->postings, doc);
+    if (d < 0) return exhausted(m);
+    if (d == doc && !CursorSeekOrdinal(&m->postings, pos)) {
+        d = CursorSeekDocument(&m->postings, doc + 1);
+        if (d < 0) return exhausted(m);
+    }
+    m->doc = d;
+    m->start = m->end = m->key = CursorOrdinal(&m->postings);
+    return TRUE;
+}
+
+static BOOLEAN seek_any(Matcher* m, int doc, long pos) {
+    int best = -1;
+    for (int i = 0; i < m->node->child_count; ++i) {
+        Matcher* c = &m->children[i];
+        if (c->doc < 0) continue;
+        if (!at_or_past(c, doc, pos) && !matcher_seek(c, doc, pos)) continue;
+        if (best < 0 || c->doc < m->children[best].doc ||
+            (c->doc == m->children[best].doc && c->key < m->children[best].key)) {
+            best = i;
+        }
+    }
+    if (best < 0) return exhausted(m);
+    m->doc = m->children[best].doc;
+    m->start = m->children[best].start;
+    m->end = m->children[best].end;
+    m->key = m->children[best].key;
+    return TRUE;
+}
+
+// Leapfrog: the window must end at end_pos; an operand that can only match later moves
+// end_pos forward and every operand is checked again. Operands come rarest first
+static BOOLEAN seek_all(Matcher* m, int doc, long pos) {
+    long window = m->node->window;
+    long end_pos = pos;
+    int i = 0;
+
+    while (i < m->node->child_count) {
+        Matcher* c = &m->children[i];
+        long from = end_pos - window > 0 ? end_pos - window : 0;
+        if (!at_or_past(c, doc, from) && !matcher_seek(c, doc, from)) return exhausted(m);
+
+        if (c->doc > doc) {
+            doc = c->doc;
+            end_pos = c->end;
+            i = 0;
+        } else if (c->end > end_pos) {
+            end_pos = c->end;
+            i = 0;
+        } else if (c->start < end_pos - window) {
+            // this match is too wide to fit, try the operand's next one
+            if (!matcher_seek(c, doc, c->key + 1)) return exhausted(m);
+        } else {
+            i++;
+        }
+    }
+
+    m->doc = doc;
+    m->key = end_pos;
+    m->start = end_pos;
+    m->end = 0;
+    for (i = 0; i < m->node->child_count; ++i) {
+        if (m->children[i].start < m->start) m->start = m->children[i].start;
+        if (m->children[i].end > m->end) m->end = m->children[i].end;
+    }
+    return TRUE;
+}
+
+// Is there a match of exclusion x within radius tokens of [start, end] in doc?
+// Positive matches start at most widest tokens before their key, so seeking to
+// key - widest - radius stays monotonic while they advance
+static BOOLEAN excluded_by(Matcher* x, int doc, long start, long end, long key, long radius, long widest) {
+    if (x->node->kind == QUERY_TERM) {
+        long from = key - widest - radius > 0 ? key - widest - radius : 0;
+        if (x->doc < 0 || (!at_or_past(x, doc, from) && !seek_term(x, doc, from))) return FALSE;
+        if (x->doc != doc) return FALSE;
+
+        // probe on a copy so the exclusion cursor never passes what later matches need
+        PostingCursor probe = x->postings;
+        if (!CursorSeekOrdinal(&probe, start - radius)) return FALSE;
+        return CursorOrdinal(&probe) <= end + radius;
+    }
+
+    // anything else is collected once per document and binary searched
+    if (x->cached_doc != doc) {
+        if (!x->cached) x->cached = arraylist_create(16, 3 * sizeof(long));
+        if (!x->cached) return FALSE;
+        arraylist_clear(x->cached);
+        x->cached_doc = doc;
+        if (x->doc >= 0 && (at_or_past(x, doc, 0) || matcher_seek(x, doc, 0))) {
+            while (x->doc == doc) {
+                long span[3] = { x->start, x->end, x->key };
+                arraylist_add(x->cached, span);
+                if (!matcher_seek(x, doc, x->key + 1)) break;
+            }
+        }
+    }
+    const long* spans = (const long*)x->cached->data;
+    long low = 0, high = (long)arraylist_size(x->cached);
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (spans[3 * mid + 2] < start - radius) low = mid + 1;  // ends before it too
+        else high = mid;
+    }
+    for (long j = low; j < (long)arraylist_size(x->cached); ++j) {
+        if (spans[3 * j + 2] > end + radius + x->node->width) break;  // starts after it
+        if (spans[3 * j] <= end + radius && spans[3 * j + 1] >= start - radius) return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOLEAN seek_except(Matcher* m, int doc, long pos) {
+    Matcher* positive = &m->children[0];
+    while (1) {
+        if (!at_or_past(positive, doc, pos) && !matcher_seek(positive, doc, pos)) return exhausted(m);
+        if (positive->doc < 0) return exhausted(m);
+
+        BOOLEAN rejected = FALSE;
+        for (int i = 1; i < m->node->child_count && !rejected; ++i) {
+            rejected = excluded_by(&m->children[i], positive->doc, positive->start, positive->end,
+                                   positive->key, m->node->window, positive->node->width);
+        }
+        if (!rejected) break;
+        doc = positive->doc;
+        pos = positive->key + 1;
+    }
+    m->doc = positive->doc;
+    m->start = positive->start;
+    m->end = positive->end;
+    m->key = positive->key;
+    return TRUE;
+}
+
+static BOOLEAN matcher_seek(Matcher* m, int doc, long pos) {
+    if (m->doc < 0) return FALSE;
+    if (pos < 0) pos = 0;
+    switch (m->node->kind) {
+    case QUERY_TERM: return seek_term(m, doc, pos);
+    case QUERY_OR:   return seek_any(m, doc, pos);
+    case QUERY_AND:
+    case QUERY_NEAR: return seek_all(m, doc, pos);
+    case QUERY_NOT:  return seek_except(m, doc, pos);
+    default:         return exhausted(m);
+    }
+}
+
+// How far past the end of a match the next one that doesn't overlap it can be keyed:
+// a window whose operands all come after that end is also found window tokens later
+static long skip_after(const QueryNode* node) {
+    switch (node->kind) {
+    case QUERY_AND:
+    case QUERY_NEAR: return node->window;
+    case QUERY_NOT:  return skip_after(node->children[0]);
+    case QUERY_OR: {
+        long skip = skip_after(node->children[0]);
+        for (int i = 1; i < node->child_count; ++i) {
+            long s = skip_after(node->children[i]);
+            if (s < skip) skip = s;
+        }
+        return skip;
+    }
+    default:         return 0;
+    }
+}
+
+QueryCursor* QY_Open(const InvertedIndex* idx, const QueryNode* plan) {
+    if (!idx || !plan) return NULL;
+    QueryCursor* cursor = calloc(1, sizeof(QueryCursor));
+    if (!cursor) return NULL;
+    cursor->idx = idx;
+    cursor->last_doc = -1;
+    if (!matcher_init(&cursor->root, idx, plan)) {
+        QY_Close(cursor);
+        return NULL;
+    }
+    if (plan->kind == QUERY_EMPTY) cursor->root.doc = -1;  // nothing is read at all
+    cursor->skip = skip_after(plan);
+    return cursor;
+}
+
+BOOLEAN QY_Next(QueryCursor* cursor, printData* out) {
+    if (!cursor) return FALSE;
+    Matcher* root = &cursor->root;
+
+    while (matcher_seek(root, cursor->doc, cursor->pos)) {
+        cursor->doc = root->doc;
+        cursor->pos = root->key + 1;
+        // a window sharing tokens with the previous result adds nothing new
+        if (root->doc == cursor->last_doc && root->start <= cursor->last_end) continue;
+
+        cursor->last_doc = root->doc;
+        cursor->last_end = root->end;
+        if (cursor->pos < root->end + 1 + cursor->skip) cursor->pos = root->end + 1 + cursor->skip;
+        if (out) *out = II_ResolveLines(cursor->idx, root->doc, root->start, root->end);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void QY_Close(QueryCursor* cursor) {
+    if (!cursor) return;
+    matcher_free(&cursor->root);
+    free(cursor);
+}
+
+// ---------------------------------------------------------------- any syntax
+
+struct _QueryStream {
+    SearchCursor* search;          // "phrase" or comma list
+    QueryNode* plan;               // boolean query
+    QueryCursor* cursor;
+    char* words[MAX_QUERY_WORDS];  // positive words, into the caller's text or terms
+    int word_count;
+    char terms[MAX_QUERY_WORDS * (MAX_WORD_LENGTH + 1)];   // boolean: copies of the words
+};
+
+static QueryStream* stream_error(QueryStream* stream, const char* message, char* error, size_t error_size) {
+    if (error && error_size > 0 && message != error) snprintf(error, error_size, "%s", message);
+    QY_StreamClose(stream);
+    return NULL;
+}
+
+int QY_SplitWords(char* text, char* words[], int max_words, int* window) {
+    int count = 0;
+    char* save = NULL;
+    for (char* tok = strtok_r(text, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        while (*tok == ' ') tok++;
+        char* end = tok + strlen(tok);
+        while (end > tok && end[-1] == ' ') *--end = '\0';
+        if (*tok == '\0') continue;
+
+        // "~N" sets the window, as in the interactive loop
+        if (tok[0] == '~' && atoi(tok + 1) > 0) {
+            *window = atoi(tok + 1);
+            continue;
+        }
+        if (count == max_words) return -1;
+        words[count++] = tok;
+    }
+    return count;
+}
+
+QueryStream* QY_OpenText(const InvertedIndex* idx, char* text, char* error, size_t error_size) {
+    if (!idx || !text) return stream_error(NULL, "empty query", error, error_size);
+    QueryStream* stream = calloc(1, sizeof(QueryStream));
+    if (!stream) return stream_error(NULL, "out of memory", error, error_size);
+
+    if (text[0] == '"') {
+        char* phrase = text + 1;
+        phrase[strcspn(phrase, "\"")] = '\0';
+        stream->search = II_PhraseOpen(idx, phrase);
+        if (!stream->search) return stream_error(stream, "search failed", error, error_size);
+        // the words of the phrase, cut in place once the cursor has tokenized it
+        for (char* p = phrase; *p && stream->word_count < MAX_QUERY_WORDS; ) {
+            while (*p && !isalpha((unsigned char)*p)) *p++ = '\0';
+            if (*p) stream->words[stream->word_count++] = p;
+            while (isalpha((unsigned char)*p)) p++;
+        }
+        return stream;
+    }
+
+    if (QY_IsBoolean(text)) {
+        QueryNode* parsed = QY_Parse(text, DEFAULT_WORD_WINDOW, error, error_size);
+        if (!parsed) return stream_error(stream, error && error[0] ? error : "syntax error", error, error_size);
+        // words in the order of the text, before the planner reorders (or drops) them for this index
+        char* words[MAX_QUERY_WORDS];
+        int word_count = QY_Terms(parsed, words, MAX_QUERY_WORDS);
+        char* copy = stream->terms;
+        for (int i = 0; i < word_count; ++i) {
+            stream->words[stream->word_count++] = strcpy(copy, words[i]);
+            copy += strlen(copy) + 1;
+        }
+        stream->plan = QY_Plan(idx, parsed);
+        stream->cursor = QY_Open(idx, stream->plan);
+        if (!stream->cursor) return stream_error(stream, "search failed", error, error_size);
+        return stream;
+    }
+
+    int window = DEFAULT_WORD_WINDOW;
+    stream->word_count = QY_SplitWords(text, stream->words, MAX_QUERY_WORDS, &window);
+    if (stream->word_count < 0) return stream_error(stream, "too many words", error, error_size);
+    if (stream->word_count == 0) return stream_error(stream, "empty query", error, error_size);
+    stream->search = II_SearchOpen(idx, stream->words, stream->word_count, window);
+    if (!stream->search) return stream_error(stream, "search failed", error, error_size);
+    return stream;
+}
+
+BOOLEAN QY_StreamNext(QueryStream* stream, printData* out) {
+    if (!stream) return FALSE;
+    return stream->cursor ? QY_Next(stream->cursor, out) : II_SearchNext(stream->search, out);
+}
+
+int QY_StreamTerms(const QueryStream* stream, char* out[], int max_out) {
+    if (!stream || !out) return 0;
+    int count = stream->word_count < max_out ? stream->word_count : max_out;
+    for (int i = 0; i < count; ++i) out[i] = stream->words[i];
+    return count;
+}
+
+void QY_StreamClose(QueryStream* stream) {
+    if (!stream) return;
+    II_SearchClose(stream->search);
+    QY_Close(stream->cursor);
+    QY_Free(stream->plan);
+    free(stream);
+}
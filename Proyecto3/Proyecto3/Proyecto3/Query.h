@@ -0,0 +1,105 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdio.h>
+#include "InvertedIndex.h"
+
+/*
+ * Boolean query language:
+ *
+ *   sancho AND (rucio OR asno) NOT dulcinea
+ *   molinos NEAR/3 viento
+ *
+ *   or_expr   := and_expr { OR and_expr }
+ *   and_expr  := near_expr { [AND] [NOT] near_expr }    (juxtaposition is AND)
+ *   near_expr := primary { NEAR[/k] primary }
+ *   primary   := word | ( or_expr )
+ *
+ * Operators are uppercase; words are matched like the loader tokenizes them. A match is a
+ * span of tokens of one document: a word matches each of its occurrences, OR matches what
+ * any operand matches, AND (and NEAR/k) matches spans of at most window (resp. k) tokens
+ * holding one match of every operand, and NOT x drops the matches that have an x within
+ * window tokens of them. Results never overlap: each one is the match ending first after
+ * the previous result. Words shorter than WORD_MIN_LENGTH are ignored unless the index
+ * keeps them (II_SetIndexShortWords).
+ */
+
+#define QUERY_MAX_DEPTH 32       // nesting of parentheses accepted by the parser
+#define QUERY_ERROR_LENGTH 128   // size of the error buffer passed to QY_Parse
+
+typedef enum _QueryKind {
+    QUERY_TERM,    // term
+    QUERY_AND,     // every child within window tokens
+    QUERY_NEAR,    // same as AND with its own window
+    QUERY_OR,      // any child
+    QUERY_NOT,     // children[0] minus matches near any of children[1..]
+    QUERY_EMPTY    // planned away: nothing can match
+} QueryKind;
+
+typedef struct _QueryNode {
+    QueryKind kind;
+    char* term;                      // QUERY_TERM: lowercase word
+    int window;                      // AND/NEAR: max tokens from first to last; NOT: exclusion radius
+    struct _QueryNode** children;
+    int child_count;
+    long cost;                       // planner's estimate of the matches (postings of the rarest term)
+    long width;                      // widest span a match can have, in tokens
+} QueryNode;
+
+typedef struct _QueryCursor QueryCursor;
+
+// TRUE if the text uses the operators or parentheses of the boolean language
+BOOLEAN QY_IsBoolean(const char* text);
+
+// TRUE if the text is a proximity query: a comma list of words, no phrase quotes and no boolean syntax
+BOOLEAN QY_IsWordList(const char* text);
+
+// Parse a query; AND and NOT use window tokens. Returns NULL and fills error on a syntax error
+QueryNode* QY_Parse(const char* text, int window, char* error, size_t error_size);
+
+// Rewrite a parsed query for idx: drop ignored words, flatten nested operators, reorder
+// conjunctions from the rarest operand, turn negated ORs into separate exclusions and replace
+// what can't match with QUERY_EMPTY. Consumes root and returns the plan to use instead
+QueryNode* QY_Plan(const InvertedIndex* idx, QueryNode* root);
+
+// Free a query tree
+void QY_Free(QueryNode* node);
+
+// Print a (planned) tree on one line, with the cost of every node
+void QY_Print(const QueryNode* node, FILE* out);
+
+// Words of the positive (not excluded) terms, for highlighting. Returns how many were written
+int QY_Terms(const QueryNode* node, char* out[], int max_out);
+
+// Lazy evaluation of a plan, like II_SearchOpen; the plan must outlive the cursor.
+// Only reads the index (see the concurrency note in InvertedIndex.h)
+QueryCursor* QY_Open(const InvertedIndex* idx, const QueryNode* plan);
+
+// Produce the next match in document order, not overlapping the previous one; FALSE once there are no more
+BOOLEAN QY_Next(QueryCursor* cursor, printData* out);
+
+// Free a cursor returned by QY_Open
+void QY_Close(QueryCursor* cursor);
+
+// Split a comma list of words in place, trimming spaces; "~N" sets *window (left alone
+// otherwise). Returns the number of words, or -1 if there are more than max_words
+int QY_SplitWords(char* text, char* words[], int max_words, int* window);
+
+// A query in any syntax of the interactive loop: "exact phrase", boolean query, or comma
+// list of words with an optional ~N window
+typedef struct _QueryStream QueryStream;
+
+// Open a query; text is cut in place and must outlive the stream.
+// Returns NULL and fills error on a syntax error or an empty query
+QueryStream* QY_OpenText(const InvertedIndex* idx, char* text, char* error, size_t error_size);
+
+// Next match of the query, as II_SearchNext / QY_Next
+BOOLEAN QY_StreamNext(QueryStream* stream, printData* out);
+
+// Positive words of the query (valid until QY_StreamClose); returns how many were written
+int QY_StreamTerms(const QueryStream* stream, char* out[], int max_out);
+
+// Free a stream returned by QY_OpenText
+void QY_StreamClose(QueryStream* stream);
+
+#endif
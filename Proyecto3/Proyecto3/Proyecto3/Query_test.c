@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "Query.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+/* Plan impreso en un string, para comparar */
+static const char* plan_of(const InvertedIndex* idx, const char* text) {
+    static char buffer[1024];
+    char error[QUERY_ERROR_LENGTH];
+    QueryNode* plan = QY_Plan(idx, QY_Parse(text, DEFAULT_WORD_WINDOW, error, sizeof(error)));
+    assert(plan != NULL);
+    FILE* out = fmemopen(buffer, sizeof(buffer), "w");
+    QY_Print(plan, out);
+    fclose(out);
+    QY_Free(plan);
+    return buffer;
+}
+
+static int count_results(const InvertedIndex* idx, const char* text) {
+    char error[QUERY_ERROR_LENGTH];
+    QueryNode* plan = QY_Plan(idx, QY_Parse(text, DEFAULT_WORD_WINDOW, error, sizeof(error)));
+    QueryCursor* cursor = QY_Open(idx, plan);
+    printData result;
+    int count = 0;
+    while (QY_Next(cursor, &result)) count++;
+    QY_Close(cursor);
+    QY_Free(plan);
+    return count;
+}
+
+/* Ordinales de una palabra en el documento 0, copiados con un cursor (pueden estar congelados) */
+static const long* ordinals_of(const InvertedIndex* idx, const char* word, long* count) {
+    static long buffers[9][100000];  /* hasta 8 palabras y la excluida */
+    static int next = 0;
+    const OccurrenceList* list = II_Postings(idx, word);
+    assert(list != NULL && list->first->doc_id == 0);
+    long* ords = buffers[next++ % 9];
+    PostingCursor cursor;
+    OpenPostingCursor(&cursor, list);
+    *count = 0;
+    do {
+        assert(*count < 100000);
+        ords[(*count)++] = CursorOrdinal(&cursor);
+    } while (CursorNextOrdinal(&cursor));
+    return ords;
+}
+
+/* Primer ordinal >= from, o -1 */
+static long first_from(const long* ords, long n, long from) {
+    for (long i = 0; i < n; ++i) {
+        if (ords[i] >= from) return ords[i];
+    }
+    return -1;
+}
+
+/*
+ * Referencia por fuerza bruta de "w0 AND w1 ... [NOT x]" en el documento 0: para cada fin
+ * de ventana posible, en orden, se toma la primera aparicion de cada palabra desde
+ * fin - window; vale si todas caen antes de fin. Se descartan las que tienen x a menos de
+ * window tokens y las que se superponen con la anterior
+ */
+static int brute_force(const InvertedIndex* idx, const char* words[], int word_count, const char* excluded, long window) {
+    const long* ords[8];
+    long counts[8];
+    long last_token = 0;
+    for (int w = 0; w < word_count; ++w) {
+        ords[w] = ordinals_of(idx, words[w], &counts[w]);
+        if (ords[w][counts[w] - 1] > last_token) last_token = ords[w][counts[w] - 1];
+    }
+    long excluded_count = 0;
+    const long* excluded_ords = excluded ? ordinals_of(idx, excluded, &excluded_count) : NULL;
+
+    int results = 0;
+    long last_end = -1;
+    for (long end = 0; end <= last_token; ++end) {
+        long start = end, last = 0;
+        int w;
+        for (w = 0; w < word_count; ++w) {
+            long from = end - window > 0 ? end - window : 0;
+            long got = first_from(ords[w], counts[w], from);
+            if (got < 0 || got > end) break;
+            if (got < start) start = got;
+            if (got > last) last = got;
+        }
+        if (w < word_count) continue;
+
+        if (excluded_ords) {
+            long near = first_from(excluded_ords, excluded_count, start - window);
+            if (near >= 0 && near <= last + window) continue;
+        }
+        if (start <= last_end) continue;
+        last_end = last;
+        results++;
+    }
+    return results;
+}
+
+/* Mismos resultados, en el mismo orden, con y sin las postings congeladas */
+static void check_frozen(const InvertedIndex* frozen, const InvertedIndex* plain, const char* query) {
+    char text_a[256], text_b[256], error[QUERY_ERROR_LENGTH];
+    snprintf(text_a, sizeof(text_a), "%s", query);
+    snprintf(text_b, sizeof(text_b), "%s", query);
+    QueryStream* a = QY_OpenText(frozen, text_a, error, sizeof(error));
+    QueryStream* b = QY_OpenText(plain, text_b, error, sizeof(error));
+    assert(a != NULL && b != NULL);
+    printData ra, rb;
+    int count = 0;
+    BOOLEAN more;
+    while ((more = QY_StreamNext(a, &ra))) {
+        assert(QY_StreamNext(b, &rb));
+        assert(ra.doc_id == rb.doc_id && ra.first_occurrence_line == rb.first_occurrence_line);
+        assert(ra.last_occurrence_line == rb.last_occurrence_line);
+        count++;
+    }
+    assert(!QY_StreamNext(b, &rb) && count > 0);
+    QY_StreamClose(a);
+    QY_StreamClose(b);
+}
+
+/* Mismo indice cargado en un hilo y con el pipeline: tabla de tokens y postings de cada palabra */
+static void check_pipelined(const InvertedIndex* serial, const InvertedIndex* piped) {
+    assert(serial->last_file_index == piped->last_file_index);
+    for (int f = 0; f <= serial->last_file_index; ++f) {
+        const ArrayList* a = serial->token_offsets[f];
+        const ArrayList* b = piped->token_offsets[f];
+        assert(a->size == b->size && memcmp(a->data, b->data, a->size * sizeof(long)) == 0);
+    }
+    assert(HTSize(serial->table) == HTSize(piped->table));
+    for (TermId term = 0; term < serial->terms.count; ++term) {
+        const char* word = II_TermWord(serial, term);
+        if (!word) continue;
+        // los dos cargadores dan los ids en el orden del texto
+        assert(II_TermId(piped, word) == term);
+        const Occurrence* a = II_TermPostings(serial, term)->first;
+        const OccurrenceList* list = II_Postings(piped, word);
+        assert(list != NULL);
+        const Occurrence* b = list->first;
+        for (; a && b; a = a->next, b = b->next) {
+            assert(a->doc_id == b->doc_id && GetOrdinalCount(a) == GetOrdinalCount(b));
+            assert(memcmp(u32vec_cdata(&a->ordinals), u32vec_cdata(&b->ordinals),
+                          GetOrdinalCount(a) * sizeof(uint32_t)) == 0);
+        }
+        assert(a == NULL && b == NULL);
+    }
+}
+
+int main(void) {
+    char error[QUERY_ERROR_LENGTH];
+
+    // Parser: errores de sintaxis
+    assert(QY_Parse("(sancho", 16, error, sizeof(error)) == NULL && strstr(error, "')'"));
+    assert(QY_Parse("sancho)", 16, error, sizeof(error)) == NULL && strstr(error, "')'"));
+    assert(QY_Parse("sancho AND", 16, error, sizeof(error)) == NULL);
+    assert(QY_Parse("NOT sancho", 16, error, sizeof(error)) == NULL);
+    assert(QY_Parse("sancho OR NOT rucio", 16, error, sizeof(error)) == NULL);
+    assert(QY_Parse("OR", 16, error, sizeof(error)) == NULL);
+    assert(QY_IsBoolean("sancho AND rucio") && QY_IsBoolean("(sancho)") && QY_IsBoolean("a NEAR/3 b"));
+    assert(!QY_IsBoolean("sancho, rucio") && !QY_IsBoolean("oro, orden"));
+    assert(QY_IsWordList("sancho, rucio, ~3") && !QY_IsWordList("\"de la mancha\""));
+    assert(!QY_IsWordList("sancho AND rucio") && !QY_IsWordList("(sancho)"));
+
+    InvertedIndex* idx = II_Create();
+    assert(II_LoadFile(idx, "DonQuijote.txt") == 0);
+
+    // Planner: el operando mas raro primero, NOT (a OR b) como dos exclusiones, atajos a EMPTY
+    assert(strcmp(plan_of(idx, "sancho AND rucio"), "AND/16[119](rucio[119] sancho[2148])") == 0);
+    assert(strcmp(plan_of(idx, "sancho AND (rucio OR asno) NOT dulcinea"),
+                  "NOT/16[207](AND/16[207](OR[207](rucio[119] asno[88]) sancho[2148]) dulcinea[282])") == 0);
+    assert(strcmp(plan_of(idx, "quijote NOT (sancho OR rucio)"),
+                  "NOT/16[2180](quijote[2180] sancho[2148] rucio[119])") == 0);
+    assert(strcmp(plan_of(idx, "sancho AND palabrainexistente"), "EMPTY") == 0);
+    assert(strcmp(plan_of(idx, "sancho NOT palabrainexistente"), "sancho[2148]") == 0);
+    assert(strcmp(plan_of(idx, "rucio OR palabrainexistente"), "rucio[119]") == 0);
+    assert(strcmp(plan_of(idx, "la de que"), "EMPTY") == 0);                   // solo palabras cortas
+    assert(strcmp(plan_of(idx, "molinos NEAR/3 de NEAR/3 viento"), "NEAR/3[12](molinos[12] viento[45])") == 0);
+
+    // Una palabra: cada aparicion; OR: la suma (no comparten posiciones)
+    assert(count_results(idx, "sancho") == II_TermCount(idx, "sancho"));
+    assert(count_results(idx, "rucio OR asno") == II_TermCount(idx, "rucio") + II_TermCount(idx, "asno"));
+    assert(count_results(idx, "sancho AND palabrainexistente") == 0);
+
+    // Conjunciones y exclusiones contra la referencia por fuerza bruta
+    const char* pair[] = { "sancho", "rucio" };
+    const char* triple[] = { "quijote", "sancho", "caballero" };
+    const char* near[] = { "molinos", "viento" };
+    assert(count_results(idx, "rucio sancho") == brute_force(idx, pair, 2, NULL, 16));
+    assert(count_results(idx, "quijote AND sancho AND caballero") == brute_force(idx, triple, 3, NULL, 16));
+    assert(count_results(idx, "molinos NEAR/3 viento") == brute_force(idx, near, 2, NULL, 3));
+    assert(count_results(idx, "sancho AND rucio NOT asno") == brute_force(idx, pair, 2, "asno", 16));
+    assert(count_results(idx, "quijote sancho caballero NOT dulcinea") == brute_force(idx, triple, 3, "dulcinea", 16));
+
+    // explain: los mismos resultados que II_SearchWithin, con el costo de cada parte
+    char* explained[] = { "Sancho", "rucio" };
+    SearchExplain explain;
+    int plain_count, explain_count;
+    printData* plain_results = II_SearchWithin(idx, explained, 2, 8, &plain_count);
+    printData* explain_results = II_Explain(idx, explained, 2, 8, &explain_count, &explain);
+    assert(plain_count > 0 && explain_count == plain_count && explain.results == plain_count);
+    assert(memcmp(plain_results, explain_results, sizeof(printData) * plain_count) == 0);
+    assert(explain.term_count == 2 && strcmp(explain.terms[0].key, "sancho") == 0);
+    for (int i = 0; i < 2; ++i) {
+        assert(explain.terms[i].probes >= 1);
+        assert(explain.terms[i].postings == II_TermCount(idx, explained[i]));
+        assert(explain.terms[i].documents == II_Postings(idx, explained[i])->count);
+    }
+    assert(explain.candidates >= 1 && explain.candidates <= explain.terms[1].documents);
+    assert(explain.windows >= explain.results);
+    assert(explain.lookup_ns >= 0 && explain.merge_ns >= 0 && explain.window_ns > 0 && explain.lines_ns > 0);
+    free(plain_results);
+    free(explain_results);
+
+    // una palabra que no esta: ningun candidato, y la busqueda igual dice que costo
+    char* missing[] = { "sancho", "palabrainexistente" };
+    explain_results = II_Explain(idx, missing, 2, 8, &explain_count, &explain);
+    assert(explain_count == 0 && explain.candidates == 0 && explain.windows == 0);
+    assert(explain.terms[1].postings == 0 && explain.terms[1].documents == 0 && explain.terms[1].probes >= 1);
+    free(explain_results);
+
+    II_Destroy(idx);
+
+    // Postings congeladas (PostingSet) contra las listas, con palabras cortas y varios libros
+    InvertedIndex* frozen = II_Create();
+    InvertedIndex* plain = II_Create();
+    II_SetIndexShortWords(frozen, TRUE);
+    II_SetIndexShortWords(plain, TRUE);
+    II_SetHybridPostings(plain, FALSE);
+    const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "tesoro.txt" };
+    for (int b = 0; b < 3; ++b) {
+        assert(II_LoadFile(frozen, books[b]) == b && II_LoadFile(plain, books[b]) == b);
+    }
+    assert(II_PostingsMemory(frozen) < II_PostingsMemory(plain));
+    check_frozen(frozen, plain, "\"de la\"");
+    check_frozen(frozen, plain, "\"en un lugar de la mancha\"");
+    check_frozen(frozen, plain, "\"que no\"");
+    check_frozen(frozen, plain, "\"el tesoro\"");
+    check_frozen(frozen, plain, "para, como");
+    check_frozen(frozen, plain, "que AND para NOT sancho");
+    check_frozen(frozen, plain, "sancho OR tesoro");
+
+    // Carga con el pipeline (bloques repartidos entre 3 tokenizadores) igual a la de un hilo
+    InvertedIndex* piped = II_Create();
+    II_SetIndexShortWords(piped, TRUE);
+    II_SetHybridPostings(piped, FALSE);
+    II_SetLoadPipeline(piped, 3);
+    for (int b = 0; b < 3; ++b) {
+        assert(II_LoadFile(piped, books[b]) == b);
+        assert(piped->last_load.tokens == (long)arraylist_size(piped->token_offsets[b]));
+    }
+    assert(piped->last_load.tokenizers == 3 && piped->last_load.blocks > 1);
+    check_pipelined(plain, piped);
+    II_Destroy(piped);
+    II_Destroy(frozen);
+    II_Destroy(plain);
+
+    printf("Query tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,529 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include "Rank.h"
+#include "Stem.h"
+
+#define RANK_END LONG_MAX   // document of an exhausted cursor
+
+typedef struct _RankTerm {
+    long count;               // postings (document frequency)
+    uint32_t* docs;           // ascending
+    uint32_t* tfs;
+    long block_count;
+    uint32_t* block_last;     // last document of every block
+    float* block_max;         // best score of the term in every block, rounded up
+    double max_score;         // best score of the term in the whole list
+    double idf;
+} RankTerm;
+
+struct _RankedIndex {
+    long doc_count;
+    uint32_t* lengths;        // sum of the frequencies of every document
+    double* norms;            // k1 * (1 - b + b * length / average length) of every document
+    HashTable words;          // word -> position in terms + 1
+    RankTerm* terms;
+    long term_count;
+    long term_capacity;
+    BOOLEAN finished;
+
+    // RK_FromIndex: file f holds passages first_passage[f] .. first_passage[f + 1] - 1
+    int passage_tokens;
+    int file_count;
+    long first_passage[MAX_OPEN_FILES + 1];
+    BOOLEAN stemming;         // the words are stems, query words are stemmed too
+};
+
+// Cursor over the postings of one query word
+typedef struct _RankCursor {
+    const RankTerm* term;
+    long pos;                 // current posting
+    long doc;                 // its document, RANK_END once exhausted
+    long block;               // block checked last by block_bound
+} RankCursor;
+
+// Lowercase copy of a word into dest (MAX_WORD_LENGTH + 1 bytes), truncated like the loader does
+static void normalize_word(char* dest, const char* word) {
+    int len = 0;
+    while (word[len] && len < MAX_WORD_LENGTH) {
+        dest[len] = tolower((unsigned char)word[len]);
+        len++;
+    }
+    dest[len] = '\0';
+}
+
+RankedIndex* RK_Create(long doc_count) {
+    if (doc_count < 0 || doc_count > UINT32_MAX) return NULL;
+    RankedIndex* rank = calloc(1, sizeof(RankedIndex));
+    if (!rank) return NULL;
+    rank->doc_count = doc_count;
+    rank->lengths = calloc(doc_count > 0 ? doc_count : 1, sizeof(uint32_t));
+    rank->norms = calloc(doc_count > 0 ? doc_count : 1, sizeof(double));
+    rank->words = HTCreate();
+    if (!rank->lengths || !rank->norms || !rank->words) {
+        RK_Destroy(rank);
+        return NULL;
+    }
+    return rank;
+}
+
+BOOLEAN RK_AddTerm(RankedIndex* rank, const char* term, const long* docs, const int* tfs, long count) {
+    if (!rank || rank->finished || !term || count <= 0) return FALSE;
+    char key[MAX_WORD_LENGTH + 1];
+    normalize_word(key, term);
+    if (HTContains(rank->words, key)) return FALSE;
+    for (long i = 0; i < count; ++i) {
+        if (docs[i] < 0 || docs[i] >= rank->doc_count || tfs[i] <= 0) return FALSE;
+        if (i > 0 && docs[i] <= docs[i - 1]) return FALSE;
+    }
+
+    if (rank->term_count == rank->term_capacity) {
+        long grown = rank->term_capacity ? rank->term_capacity * 2 : 64;
+        RankTerm* terms = realloc(rank->terms, grown * sizeof(RankTerm));
+        if (!terms) return FALSE;
+        rank->terms = terms;
+        rank->term_capacity = grown;
+    }
+    RankTerm* t = &rank->terms[rank->term_count];
+    memset(t, 0, sizeof(RankTerm));
+    t->count = count;
+    t->block_count = (count + RANK_BLOCK_SIZE - 1) / RANK_BLOCK_SIZE;
+    t->docs = malloc(count * sizeof(uint32_t));
+    t->tfs = malloc(count * sizeof(uint32_t));
+    t->block_last = malloc(t->block_count * sizeof(uint32_t));
+    t->block_max = malloc(t->block_count * sizeof(float));
+    if (!t->docs || !t->tfs || !t->block_last || !t->block_max ||
+        !HTPut(rank->words, key, (void*)(intptr_t)(rank->term_count + 1))) {
+        free(t->docs);
+        free(t->tfs);
+        free(t->block_last);
+        free(t->block_max);
+        return FALSE;
+    }
+
+    for (long i = 0; i < count; ++i) {
+        t->docs[i] = (uint32_t)docs[i];
+        t->tfs[i] = (uint32_t)tfs[i];
+        rank->lengths[docs[i]] += (uint32_t)tfs[i];
+    }
+    for (long b = 0; b < t->block_count; ++b) {
+        long last = (b + 1) * RANK_BLOCK_SIZE < count ? (b + 1) * RANK_BLOCK_SIZE - 1 : count - 1;
+        t->block_last[b] = t->docs[last];
+    }
+    rank->term_count++;
+    return TRUE;
+}
+
+static double term_score(const RankedIndex* rank, const RankTerm* t, long pos) {
+    double tf = t->tfs[pos];
+    return t->idf * tf * (RANK_BM25_K1 + 1) / (tf + rank->norms[t->docs[pos]]);
+}
+
+void RK_Finish(RankedIndex* rank) {
+    if (!rank || rank->finished) return;
+
+    double total = 0;
+    for (long d = 0; d < rank->doc_count; ++d) total += rank->lengths[d];
+    double average = rank->doc_count > 0 && total > 0 ? total / rank->doc_count : 1;
+    for (long d = 0; d < rank->doc_count; ++d) {
+        rank->norms[d] = RANK_BM25_K1 * (1 - RANK_BM25_B + RANK_BM25_B * rank->lengths[d] / average);
+    }
+
+    for (long i = 0; i < rank->term_count; ++i) {
+        RankTerm* t = &rank->terms[i];
+        t->idf = log(1.0 + (rank->doc_count - t->count + 0.5) / (t->count + 0.5));
+        t->max_score = 0;
+        for (long b = 0; b < t->block_count; ++b) {
+            double best = 0;
+            long end = (b + 1) * RANK_BLOCK_SIZE < t->count ? (b + 1) * RANK_BLOCK_SIZE : t->count;
+            for (long pos = b * RANK_BLOCK_SIZE; pos < end; ++pos) {
+                double score = term_score(rank, t, pos);
+                if (score > best) best = score;
+            }
+            // rounded up, a bound must never fall below the score it stands for
+            float bound = (float)best;
+            if ((double)bound < best) bound = nextafterf(bound, INFINITY);
+            t->block_max[b] = bound;
+            if (bound > t->max_score) t->max_score = bound;
+        }
+    }
+    rank->finished = TRUE;
+}
+
+RankedIndex* RK_FromIndex(const InvertedIndex* idx, int passage_tokens) {
+    if (!idx || passage_tokens <= 0) return NULL;
+
+    long passages = 0;
+    long first_passage[MAX_OPEN_FILES + 1];
+    for (int f = 0; f <= idx->last_file_index; ++f) {
+        first_passage[f] = passages;
+        passages += ((long)arraylist_size(idx->token_offsets[f]) + passage_tokens - 1) / passage_tokens;
+    }
+    first_passage[idx->last_file_index + 1] = passages;
+
+    RankedIndex* rank = RK_Create(passages);
+    if (!rank) return NULL;
+    rank->passage_tokens = passage_tokens;
+    rank->file_count = idx->last_file_index + 1;
+    memcpy(rank->first_passage, first_passage, sizeof(long) * (rank->file_count + 1));
+
+    // every word's ordinals become (passage, frequency) postings; documents and ordinals
+    // come in ascending order, so the passages do too
+    long capacity = 1024;
+    long* docs = malloc(capacity * sizeof(long));
+    int* tfs = malloc(capacity * sizeof(int));
+    for (TermId term = 0; docs && tfs && term < idx->terms.count; ++term) {
+        const OccurrenceList* postings = II_TermPostings(idx, term);
+        if (!postings) continue;
+        PostingCursor cursor;
+        long count = 0;
+        OpenPostingCursor(&cursor, postings);
+        for (int doc = CursorDocument(&cursor); doc >= 0;
+             doc = CursorSeekDocument(&cursor, doc + 1) ? CursorDocument(&cursor) : -1) {
+            do {
+                long passage = first_passage[doc] + CursorOrdinal(&cursor) / passage_tokens;
+                if (count > 0 && docs[count - 1] == passage) {
+                    tfs[count - 1]++;
+                    continue;
+                }
+                if (count == capacity) {
+                    capacity *= 2;
+                    long* grown_docs = realloc(docs, capacity * sizeof(long));
+                    if (grown_docs) docs = grown_docs;
+                    int* grown_tfs = realloc(tfs, capacity * sizeof(int));
+                    if (grown_tfs) tfs = grown_tfs;
+                    if (!grown_docs || !grown_tfs) {
+                        count = -1;
+                        break;
+                    }
+                }
+                docs[count] = passage;
+                tfs[count++] = 1;
+            } while (CursorNextOrdinal(&cursor));
+            if (count < 0) break;
+        }
+        if (count < 0 || (count > 0 && !RK_AddTerm(rank, II_TermWord(idx, term), docs, tfs, count))) {
+            free(docs);
+            docs = NULL;
+        }
+    }
+    if (!docs || !tfs) {
+        free(docs);
+        free(tfs);
+        RK_Destroy(rank);
+        return NULL;
+    }
+    free(docs);
+    free(tfs);
+    RK_Finish(rank);
+    rank->stemming = idx->stemming;
+    return rank;
+}
+
+long RK_DocumentCount(const RankedIndex* rank) {
+    return rank ? rank->doc_count : 0;
+}
+
+// ---------------------------------------------------------------- cursors
+
+static void cursor_open(RankCursor* c, const RankTerm* term) {
+    c->term = term;
+    c->pos = 0;
+    c->block = 0;
+    c->doc = term->count > 0 ? term->docs[0] : RANK_END;
+}
+
+// First block from `from` whose last document is >= target (block_count if none)
+static long first_block(const RankTerm* t, long from, long target) {
+    long step = 1, low = from, high;
+    if (low >= t->block_count || t->block_last[low] >= target) return low;
+    high = low + step;
+    while (high < t->block_count && t->block_last[high] < target) {
+        low = high;
+        step *= 2;
+        high = low + step;
+    }
+    if (high > t->block_count) high = t->block_count;
+    // block_last[low] < target, block_last[high] >= target (or high == block_count)
+    while (high - low > 1) {
+        long mid = low + (high - low) / 2;
+        if (t->block_last[mid] < target) low = mid;
+        else high = mid;
+    }
+    return high;
+}
+
+// Move to the first posting with document >= target: whole blocks first, then inside one
+static void cursor_seek(RankCursor* c, long target) {
+    if (c->doc >= target) return;
+    const RankTerm* t = c->term;
+    long block = first_block(t, c->pos / RANK_BLOCK_SIZE, target);
+    if (block == t->block_count) {
+        c->pos = t->count;
+        c->doc = RANK_END;
+        return;
+    }
+    long low = block * RANK_BLOCK_SIZE > c->pos ? block * RANK_BLOCK_SIZE : c->pos;
+    long high = (block + 1) * RANK_BLOCK_SIZE < t->count ? (block + 1) * RANK_BLOCK_SIZE - 1 : t->count - 1;
+    while (low < high) {   // docs[high] >= target
+        long mid = low + (high - low) / 2;
+        if (t->docs[mid] < target) low = mid + 1;
+        else high = mid;
+    }
+    c->pos = low;
+    c->doc = t->docs[low];
+}
+
+static void cursor_next(RankCursor* c) {
+    if (c->doc == RANK_END) return;
+    c->pos++;
+    c->doc = c->pos < c->term->count ? c->term->docs[c->pos] : RANK_END;
+}
+
+// Best score the term can have in target, from the block that would hold it; moves only
+// the block pointer (targets never decrease), not the cursor
+static double block_bound(RankCursor* c, long target) {
+    c->block = first_block(c->term, c->block, target);
+    return c->block < c->term->block_count ? c->term->block_max[c->block] : 0;
+}
+
+// First document after the block block_bound checked last
+static long block_end(const RankCursor* c) {
+    return c->block < c->term->block_count ? (long)c->term->block_last[c->block] + 1 : RANK_END;
+}
+
+// ---------------------------------------------------------------- top k
+
+// Min-heap of the best k so far; documents arrive in ascending order, so a later document
+// only enters with a strictly higher score and ties keep the lowest document
+typedef struct _RankHeap {
+    RankHit* hits;
+    int size;
+    int k;
+} RankHeap;
+
+static double heap_threshold(const RankHeap* heap) {
+    return heap->size == heap->k ? heap->hits[0].score : -1.0;
+}
+
+// Order of the heap: lower score first, and among equal scores the later document
+static BOOLEAN worse(const RankHit* a, const RankHit* b) {
+    return a->score < b->score || (a->score == b->score && a->doc > b->doc);
+}
+
+static void heap_offer(RankHeap* heap, long doc, double score) {
+    RankHit* h = heap->hits;
+    RankHit hit = { doc, score };
+    int i;
+    if (heap->size < heap->k) {
+        i = heap->size++;
+        while (i > 0 && worse(&hit, &h[(i - 1) / 2])) {
+            h[i] = h[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        h[i] = hit;
+        return;
+    }
+    if (score <= h[0].score) return;
+    i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && worse(&h[child + 1], &h[child])) child++;
+        if (!worse(&h[child], &hit)) break;
+        h[i] = h[child];
+        i = child;
+    }
+    h[i] = hit;
+}
+
+static int by_score(const void* a, const void* b) {
+    const RankHit* x = a;
+    const RankHit* y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return (x->doc > y->doc) - (x->doc < y->doc);
+}
+
+// Score of doc summed in query order, so every strategy adds up the same numbers
+static double score_document(const RankedIndex* rank, const RankCursor* cursors, int n, long doc) {
+    double score = 0;
+    for (int i = 0; i < n; ++i) {
+        if (cursors[i].doc == doc) score += term_score(rank, cursors[i].term, cursors[i].pos);
+    }
+    return score;
+}
+
+static void top_or(const RankedIndex* rank, RankCursor* cursors, int n, RankStrategy strategy,
+                   RankHeap* heap, RankStats* stats) {
+    int order[RANK_MAX_TERMS];
+    for (int i = 0; i < n; ++i) order[i] = i;
+
+    while (1) {
+        // cursors by document (insertion sort: they are nearly sorted already)
+        for (int i = 1; i < n; ++i) {
+            int o = order[i], j = i;
+            while (j > 0 && cursors[order[j - 1]].doc > cursors[o].doc) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = o;
+        }
+        if (cursors[order[0]].doc == RANK_END) break;
+
+        // pivot: the first document where the maxima of the cursors up to it beat the threshold
+        double threshold = heap_threshold(heap);
+        int last = 0;   // every cursor on or before the pivot ends up in order[0..last]
+        if (strategy != RANK_EXHAUSTIVE) {
+            double bound = 0;
+            while (last < n && cursors[order[last]].doc != RANK_END) {
+                bound += cursors[order[last]].term->max_score;
+                if (bound > threshold) break;
+                last++;
+            }
+            if (last == n || cursors[order[last]].doc == RANK_END) break;
+        }
+        long pivot = cursors[order[last]].doc;
+        while (last + 1 < n && cursors[order[last + 1]].doc == pivot) last++;
+        stats->candidates++;
+
+        if (strategy == RANK_BLOCK_MAX_WAND) {
+            double bound = 0;
+            long next = last + 1 < n ? cursors[order[last + 1]].doc : RANK_END;
+            for (int i = 0; i <= last; ++i) {
+                bound += block_bound(&cursors[order[i]], pivot);
+                if (block_end(&cursors[order[i]]) < next) next = block_end(&cursors[order[i]]);
+            }
+            if (bound <= threshold) {
+                // nothing before the end of the first of those blocks can beat the threshold
+                for (int i = 0; i <= last; ++i) cursor_seek(&cursors[order[i]], next);
+                stats->skipped_blocks++;
+                continue;
+            }
+        }
+
+        if (cursors[order[0]].doc == pivot) {
+            heap_offer(heap, pivot, score_document(rank, cursors, n, pivot));
+            stats->scored++;
+            for (int i = 0; i <= last; ++i) cursor_next(&cursors[order[i]]);
+        } else {
+            for (int i = 0; cursors[order[i]].doc < pivot; ++i) cursor_seek(&cursors[order[i]], pivot);
+        }
+    }
+}
+
+static void top_and(const RankedIndex* rank, RankCursor* cursors, int n, RankStrategy strategy,
+                    RankHeap* heap, RankStats* stats) {
+    // the rarest list leads, the others are only asked about its documents
+    int lead = 0;
+    double max_total = 0;
+    for (int i = 0; i < n; ++i) {
+        if (cursors[i].term->count < cursors[lead].term->count) lead = i;
+        max_total += cursors[i].term->max_score;
+    }
+
+    while (cursors[lead].doc != RANK_END) {
+        long doc = cursors[lead].doc;
+        double threshold = heap_threshold(heap);
+        stats->candidates++;
+
+        if (strategy != RANK_EXHAUSTIVE && max_total <= threshold) break;
+        if (strategy == RANK_BLOCK_MAX_WAND) {
+            // the lead's block with the others at their best spans the most documents
+            double bound = block_bound(&cursors[lead], doc) + max_total - cursors[lead].term->max_score;
+            if (bound <= threshold) {
+                cursor_seek(&cursors[lead], block_end(&cursors[lead]));
+                stats->skipped_blocks++;
+                continue;
+            }
+            bound = 0;
+            long next = RANK_END;
+            for (int i = 0; i < n; ++i) {
+                bound += block_bound(&cursors[i], doc);
+                if (block_end(&cursors[i]) < next) next = block_end(&cursors[i]);
+            }
+            if (bound <= threshold) {
+                cursor_seek(&cursors[lead], next);
+                stats->skipped_blocks++;
+                continue;
+            }
+        }
+
+        long behind = doc;
+        for (int i = 0; i < n && behind == doc; ++i) {
+            cursor_seek(&cursors[i], doc);
+            if (cursors[i].doc > doc) behind = cursors[i].doc;
+        }
+        if (behind != doc) {
+            cursor_seek(&cursors[lead], behind);
+            continue;
+        }
+        heap_offer(heap, doc, score_document(rank, cursors, n, doc));
+        stats->scored++;
+        cursor_next(&cursors[lead]);
+    }
+}
+
+int RK_TopK(const RankedIndex* rank, char* words[], int word_count, RankMode mode, RankStrategy strategy,
+            int k, RankHit* out, RankStats* stats) {
+    RankStats ignored;
+    if (!stats) stats = &ignored;
+    memset(stats, 0, sizeof(RankStats));
+    if (!rank || !rank->finished || !words || !out || k <= 0) return 0;
+
+    // one cursor per different word; unknown words leave OR queries and empty AND ones
+    RankCursor cursors[RANK_MAX_TERMS];
+    int n = 0;
+    for (int w = 0; w < word_count && n < RANK_MAX_TERMS; ++w) {
+        char key[MAX_WORD_LENGTH + 1];
+        void* value;
+        normalize_word(key, words[w]);
+        if (rank->stemming) ST_Stem(key);
+        if (!HTGet(rank->words, key, &value)) {
+            if (mode == RANK_AND) return 0;
+            continue;
+        }
+        const RankTerm* term = &rank->terms[(intptr_t)value - 1];
+        BOOLEAN repeated = FALSE;
+        for (int i = 0; i < n; ++i) repeated |= cursors[i].term == term;
+        if (!repeated) cursor_open(&cursors[n++], term);
+    }
+    if (n == 0) return 0;
+
+    RankHeap heap = { out, 0, k };
+    if (mode == RANK_AND) top_and(rank, cursors, n, strategy, &heap, stats);
+    else top_or(rank, cursors, n, strategy, &heap, stats);
+
+    qsort(out, heap.size, sizeof(RankHit), by_score);
+    return heap.size;
+}
+
+printData RK_PassageLines(const RankedIndex* rank, const InvertedIndex* idx, long doc) {
+    printData none = { -1, 0, 0 };
+    if (!rank || !idx || rank->passage_tokens <= 0 || doc < 0 || doc >= rank->doc_count) return none;
+    int f = 0;
+    while (f + 1 < rank->file_count && rank->first_passage[f + 1] <= doc) f++;
+    long first = (doc - rank->first_passage[f]) * rank->passage_tokens;
+    long last = first + rank->passage_tokens - 1;
+    long tokens = (long)arraylist_size(idx->token_offsets[f]);
+    if (last >= tokens) last = tokens - 1;
+    return II_ResolveLines(idx, f, first, last);
+}
+
+void RK_Destroy(RankedIndex* rank) {
+    if (!rank) return;
+    for (long i = 0; i < rank->term_count; ++i) {
+        free(rank->terms[i].docs);
+        free(rank->terms[i].tfs);
+        free(rank->terms[i].block_last);
+        free(rank->terms[i].block_max);
+    }
+    free(rank->terms);
+    if (rank->words) HTDestroy(rank->words);
+    free(rank->lengths);
+    free(rank->norms);
+    free(rank);
+}
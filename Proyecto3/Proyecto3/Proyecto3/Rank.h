@@ -0,0 +1,85 @@
+#ifndef RANK_H
+#define RANK_H
+
+#include "InvertedIndex.h"
+
+#define RANK_BLOCK_SIZE 64          // postings per block, each block keeps the best score in it
+#define RANK_PASSAGE_TOKENS 100     // RK_FromIndex ranks passages of this many tokens
+#define RANK_MAX_TERMS 16
+#define RANK_DEFAULT_K 10
+#define RANK_BM25_K1 1.2
+#define RANK_BM25_B 0.75
+
+/*
+ * Top-k ranking with BM25 over document-at-a-time posting lists. Every posting list
+ * (documents ascending, with their term frequency) is cut in blocks of RANK_BLOCK_SIZE
+ * postings that remember their last document and the highest score of the term in them,
+ * and the whole list remembers its highest score.
+ *
+ * RANK_WAND keeps the cursors sorted by document and only scores a document once the
+ * list maxima of the cursors at or before it add up to more than the k-th best score so
+ * far (the threshold); every document before that pivot is skipped. RANK_BLOCK_MAX_WAND
+ * also checks the maxima of the blocks holding the pivot, and when they can't beat the
+ * threshold jumps past the first of those blocks to end. AND queries use the same bounds
+ * on the documents every list agrees on. All strategies return the same top k as
+ * RANK_EXHAUSTIVE, which scores every candidate: ties keep the lowest document.
+ *
+ * An index is built from posting lists (RK_Create, RK_AddTerm, RK_Finish), or from the
+ * passages of the files of an InvertedIndex (RK_FromIndex). Once finished it is read-only
+ * and can be queried from several threads.
+ */
+
+typedef enum _RankMode {
+    RANK_OR,     // documents with any of the words
+    RANK_AND     // documents with every word
+} RankMode;
+
+typedef enum _RankStrategy {
+    RANK_EXHAUSTIVE,
+    RANK_WAND,
+    RANK_BLOCK_MAX_WAND
+} RankStrategy;
+
+typedef struct _RankHit {
+    long doc;
+    double score;
+} RankHit;
+
+// Work done by one RK_TopK
+typedef struct _RankStats {
+    long candidates;        // documents a cursor stopped on
+    long scored;            // documents whose full score was computed
+    long skipped_blocks;    // jumps over blocks whose maxima could not beat the threshold
+} RankStats;
+
+typedef struct _RankedIndex RankedIndex;
+
+// Empty index over documents 0..doc_count-1
+RankedIndex* RK_Create(long doc_count);
+
+// Posting list of a term: count documents in ascending order and their frequencies (> 0).
+// A document's length is the sum of the frequencies added for it. Returns FALSE if the
+// list is out of order, the term was already added or the index is finished
+BOOLEAN RK_AddTerm(RankedIndex* rank, const char* term, const long* docs, const int* tfs, long count);
+
+// Compute the scores of the blocks once every list is in; no terms can be added afterwards
+void RK_Finish(RankedIndex* rank);
+
+// Finished index whose documents are the passages of passage_tokens tokens of every loaded
+// file, with the words the InvertedIndex has postings for (stemmed if it is, and then the
+// query words of RK_TopK are stemmed too)
+RankedIndex* RK_FromIndex(const InvertedIndex* idx, int passage_tokens);
+
+long RK_DocumentCount(const RankedIndex* rank);
+
+// Best k documents for the words (lowercased and truncated like the loader does), highest
+// score first, written to out. Returns how many were written; stats may be NULL
+int RK_TopK(const RankedIndex* rank, char* words[], int word_count, RankMode mode, RankStrategy strategy,
+            int k, RankHit* out, RankStats* stats);
+
+// Lines of a passage of an index built by RK_FromIndex (doc_id -1 if doc is out of range)
+printData RK_PassageLines(const RankedIndex* rank, const InvertedIndex* idx, long doc);
+
+void RK_Destroy(RankedIndex* rank);
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Rank.h"
+
+/*
+ * Top-k con BM25 sobre un corpus sintetico grande (frecuencias de documento con ley de
+ * Zipf): documentos puntuados y latencia de la evaluacion exhaustiva, WAND y block-max
+ * WAND, con consultas de 2 y 3 palabras: OR mezcla terminos frecuentes y raros, AND usa
+ * terminos frecuentes (si no, la lista mas rara ya deja pocos candidatos).
+ *
+ *   Rank_bench [documentos] [k]     (por defecto 1000000 documentos y k = 10)
+ */
+
+#define VOCABULARY 20000
+#define QUERIES 200
+#define MAX_DF_FRACTION 0.5    // el termino mas frecuente esta en la mitad de los documentos
+#define ZIPF_EXPONENT 0.8
+#define TOPIC_FRACTION 0.02
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static unsigned long seed = 12345;
+
+static unsigned long next_random(void) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return seed >> 33;
+}
+
+static double now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+/* El termino de rango r (desde 1) aparece en documents * MAX_DF_FRACTION / r^ZIPF_EXPONENT documentos,
+   repartidos al azar. Como en una coleccion ordenada por sitio o por tema, cada termino tiene
+   una zona (TOPIC_FRACTION de los documentos) donde suele repetirse; fuera de ella la
+   frecuencia es 1 casi siempre */
+static RankedIndex* build(long documents, long* postings) {
+    RankedIndex* rank = RK_Create(documents);
+    long* docs = malloc(sizeof(long) * documents);
+    int* tfs = malloc(sizeof(int) * documents);
+    *postings = 0;
+    for (int r = 1; r <= VOCABULARY; ++r) {
+        long df = (long)(documents * MAX_DF_FRACTION / pow(r, ZIPF_EXPONENT));
+        if (df < 2) df = 2;
+        long gap = 2 * documents / df, count = 0;
+        long topic = (long)(next_random() % documents), width = (long)(documents * TOPIC_FRACTION);
+        for (long d = (long)(next_random() % gap); d < documents; d += 1 + (long)(next_random() % gap)) {
+            docs[count] = d;
+            unsigned long roll = next_random() % 100;
+            if (d >= topic && d < topic + width) tfs[count++] = roll < 50 ? 1 : 2 + (int)(roll % 10);
+            else tfs[count++] = roll < 75 ? 1 : roll < 97 ? 2 : 3;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "w%d", r);
+        if (count > 0) RK_AddTerm(rank, name, docs, tfs, count);
+        *postings += count;
+    }
+    free(docs);
+    free(tfs);
+    RK_Finish(rank);
+    return rank;
+}
+
+int main(int argc, char** argv) {
+    long documents = argc > 1 ? atol(argv[1]) : 1000000;
+    int k = argc > 2 ? atoi(argv[2]) : RANK_DEFAULT_K;
+    if (documents <= 0 || k <= 0 || k > 1000) {
+        printf("Usage: %s [documentos] [k (1..1000)]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    long postings;
+    double start = now_us();
+    RankedIndex* rank = build(documents, &postings);
+    printf("%ld documentos, %d terminos, %ld postings, armado en %.0f ms\n\n",
+           documents, VOCABULARY, postings, (now_us() - start) / 1e3);
+
+    // OR: un termino frecuente (rango 1..50) y uno o dos de frecuencia media o baja;
+    // AND: terminos de rango 1..100
+    static char names[2][QUERIES][3][16];
+    char* words[2][QUERIES][3];
+    int sizes[QUERIES];
+    for (int q = 0; q < QUERIES; ++q) {
+        sizes[q] = 2 + q % 2;
+        int ranks[2][3] = { { 1 + (int)(next_random() % 50), 20 + (int)(next_random() % 500), 200 + (int)(next_random() % 5000) },
+                            { 1 + (int)(next_random() % 100), 1 + (int)(next_random() % 100), 1 + (int)(next_random() % 100) } };
+        for (int m = 0; m < 2; ++m) {
+            for (int w = 0; w < sizes[q]; ++w) {
+                snprintf(names[m][q][w], sizeof(names[m][q][w]), "w%d", ranks[m][w]);
+                words[m][q][w] = names[m][q][w];
+            }
+        }
+    }
+
+    const char* strategies[] = { "exhaustiva", "WAND", "block-max WAND" };
+    const char* modes[] = { "OR", "AND" };
+    RankHit* hits[3];
+    for (int s = 0; s < 3; ++s) hits[s] = malloc(sizeof(RankHit) * k);
+
+    printf("%-4s %-16s %14s %14s %12s %12s\n", "", "estrategia", "puntuados/cons", "candidatos", "media us", "p99 us");
+    for (int m = 0; m < 2; ++m) {
+        for (int s = 0; s < 3; ++s) {
+            double latencies[QUERIES];
+            long scored = 0, candidates = 0;
+            for (int q = 0; q < QUERIES; ++q) {
+                RankStats stats;
+                start = now_us();
+                int count = RK_TopK(rank, words[m][q], sizes[q], (RankMode)m, (RankStrategy)s, k, hits[s], &stats);
+                latencies[q] = now_us() - start;
+                scored += stats.scored;
+                candidates += stats.candidates;
+
+                // mismo top k que la evaluacion exhaustiva
+                if (s > 0) {
+                    int expected = RK_TopK(rank, words[m][q], sizes[q], (RankMode)m, RANK_EXHAUSTIVE, k, hits[0], NULL);
+                    for (int i = 0; i < count && count == expected; ++i) {
+                        if (hits[s][i].doc != hits[0][i].doc) count = -1;
+                    }
+                    if (count != expected) {
+                        fprintf(stderr, "%s %s: distinto top k en la consulta %d\n", modes[m], strategies[s], q);
+                        return EXIT_FAILURE;
+                    }
+                }
+            }
+            double total = 0;
+            for (int i = 0; i < QUERIES; ++i) total += latencies[i];
+            for (int i = 1; i < QUERIES; ++i) {
+                double v = latencies[i];
+                int j = i;
+                while (j > 0 && latencies[j - 1] > v) {
+                    latencies[j] = latencies[j - 1];
+                    j--;
+                }
+                latencies[j] = v;
+            }
+            printf("%-4s %-16s %14.0f %14.0f %12.1f %12.1f\n", modes[m], strategies[s], (double)scored / QUERIES,
+                   (double)candidates / QUERIES, total / QUERIES, latencies[QUERIES * 99 / 100]);
+        }
+    }
+
+    for (int s = 0; s < 3; ++s) free(hits[s]);
+    RK_Destroy(rank);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "Rank.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+#define DOCS 3000
+#define TERMS 60
+
+static unsigned long seed = 7;
+
+static unsigned long next_random(void) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return seed >> 33;
+}
+
+/* Corpus chico: el termino t aparece en un documento con probabilidad 1/(t+2) */
+static int tf_of[TERMS][DOCS];
+
+static RankedIndex* synthetic(void) {
+    static long docs[DOCS];
+    static int tfs[DOCS];
+    RankedIndex* rank = RK_Create(DOCS);
+    for (int t = 0; t < TERMS; ++t) {
+        char name[16];
+        long count = 0;
+        for (int d = 0; d < DOCS; ++d) {
+            tf_of[t][d] = next_random() % (t + 2) == 0 ? 1 + (int)(next_random() % 7) : 0;
+            if (tf_of[t][d] == 0) continue;
+            docs[count] = d;
+            tfs[count++] = tf_of[t][d];
+        }
+        snprintf(name, sizeof(name), "t%d", t);
+        assert(RK_AddTerm(rank, name, docs, tfs, count));
+    }
+    RK_Finish(rank);
+    return rank;
+}
+
+/* BM25 calculado de cero sobre tf_of, como referencia */
+static int brute_force(const int* terms, int n, RankMode mode, int k, RankHit* out) {
+    double length[DOCS] = { 0 }, total = 0;
+    for (int d = 0; d < DOCS; ++d) {
+        for (int t = 0; t < TERMS; ++t) length[d] += tf_of[t][d];
+        total += length[d];
+    }
+    int count = 0;
+    for (int d = 0; d < DOCS; ++d) {
+        double score = 0;
+        int present = 0;
+        for (int i = 0; i < n; ++i) {
+            int df = 0;
+            for (int e = 0; e < DOCS; ++e) df += tf_of[terms[i]][e] > 0;
+            double tf = tf_of[terms[i]][d];
+            double norm = RANK_BM25_K1 * (1 - RANK_BM25_B + RANK_BM25_B * length[d] / (total / DOCS));
+            if (tf == 0) continue;
+            present++;
+            score += log(1.0 + (DOCS - df + 0.5) / (df + 0.5)) * tf * (RANK_BM25_K1 + 1) / (tf + norm);
+        }
+        if (present == 0 || (mode == RANK_AND && present < n)) continue;
+        out[count++] = (RankHit){ d, score };
+    }
+    /* seleccion de los k mejores, empates al documento menor */
+    for (int i = 0; i < k && i < count; ++i) {
+        int best = i;
+        for (int j = i + 1; j < count; ++j) {
+            if (out[j].score > out[best].score || (out[j].score == out[best].score && out[j].doc < out[best].doc)) best = j;
+        }
+        RankHit tmp = out[i];
+        out[i] = out[best];
+        out[best] = tmp;
+    }
+    return count < k ? count : k;
+}
+
+/* Las tres estrategias devuelven lo mismo; las podas puntuan menos documentos */
+static void check_query(const RankedIndex* rank, char* words[], int n, RankMode mode, int k, const RankHit* expected, int expected_count) {
+    RankHit hits[3][64];
+    RankStats stats[3];
+    for (int s = 0; s < 3; ++s) {
+        int count = RK_TopK(rank, words, n, mode, (RankStrategy)s, k, hits[s], &stats[s]);
+        assert(count == (expected ? expected_count : RK_TopK(rank, words, n, mode, RANK_EXHAUSTIVE, k, hits[0], NULL)));
+        for (int i = 0; i < count; ++i) {
+            const RankHit* want = expected ? &expected[i] : &hits[0][i];
+            assert(hits[s][i].doc == want->doc && fabs(hits[s][i].score - want->score) < 1e-9);
+        }
+    }
+    assert(stats[RANK_WAND].scored <= stats[RANK_EXHAUSTIVE].scored);
+    assert(stats[RANK_BLOCK_MAX_WAND].scored <= stats[RANK_WAND].scored);
+}
+
+int main(void) {
+    RankedIndex* rank = synthetic();
+    assert(RK_DocumentCount(rank) == DOCS);
+
+    // Errores de construccion
+    long bad_docs[] = { 3, 2 };
+    int bad_tfs[] = { 1, 1 };
+    assert(!RK_AddTerm(rank, "otro", bad_docs, bad_tfs, 2));     // ya esta terminado
+    RankedIndex* empty = RK_Create(10);
+    assert(!RK_AddTerm(empty, "t", bad_docs, bad_tfs, 2));       // desordenado
+    assert(RK_AddTerm(empty, "T", bad_docs + 1, bad_tfs, 1));
+    assert(!RK_AddTerm(empty, "t", bad_docs, bad_tfs, 1));       // repetido (en minusculas)
+    RK_Destroy(empty);
+
+    // Contra la referencia: consultas al azar de 1 a 4 terminos, OR y AND, varios k
+    RankHit expected[DOCS];
+    for (int q = 0; q < 300; ++q) {
+        int n = 1 + (int)(next_random() % 4), terms[4];
+        char names[4][16];
+        char* words[4];
+        for (int i = 0; i < n; ++i) {
+            do {
+                terms[i] = (int)(next_random() % TERMS);
+            } while (i > 0 && terms[i] == terms[i - 1]);
+            snprintf(names[i], sizeof(names[i]), "T%d", terms[i]);
+            words[i] = names[i];
+        }
+        if (n > 2 && terms[2] == terms[0]) n = 2;
+        if (n > 3 && (terms[3] == terms[0] || terms[3] == terms[1])) n = 3;
+        RankMode mode = q % 2 ? RANK_AND : RANK_OR;
+        int k = q % 3 == 0 ? 1 : q % 3 == 1 ? 10 : 50;
+        int count = brute_force(terms, n, mode, k, expected);
+        check_query(rank, words, n, mode, k, expected, count);
+    }
+
+    // Palabras desconocidas: OR las ignora, AND no encuentra nada
+    char known[] = "t0", unknown[] = "nada";
+    char* mixed[] = { known, unknown };
+    RankHit hits[10];
+    assert(RK_TopK(rank, mixed, 2, RANK_OR, RANK_BLOCK_MAX_WAND, 10, hits, NULL) == 10);
+    assert(RK_TopK(rank, mixed, 2, RANK_AND, RANK_BLOCK_MAX_WAND, 10, hits, NULL) == 0);
+    RK_Destroy(rank);
+
+    // Pasajes de un libro: iguales entre estrategias, y las lineas contienen las palabras
+    InvertedIndex* idx = II_Create();
+    assert(II_LoadFile(idx, "DonQuijote.txt") == 0 && II_LoadFile(idx, "tesoro.txt") == 1);
+    rank = RK_FromIndex(idx, RANK_PASSAGE_TOKENS);
+    assert(rank != NULL && RK_DocumentCount(rank) > 3000);
+    const char* queries[][3] = { { "sancho", "rucio", "asno" }, { "quijote", "dulcinea", "toboso" },
+                                 { "tesoro", "isla", "mapa" }, { "caballero", "andante", "armas" } };
+    for (int q = 0; q < 4; ++q) {
+        char* words[3] = { (char*)queries[q][0], (char*)queries[q][1], (char*)queries[q][2] };
+        check_query(rank, words, 3, RANK_OR, RANK_DEFAULT_K, NULL, 0);
+        check_query(rank, words, 2, RANK_AND, RANK_DEFAULT_K, NULL, 0);
+    }
+    char sancho[] = "Sancho";
+    char* one[] = { sancho };
+    int count = RK_TopK(rank, one, 1, RANK_OR, RANK_BLOCK_MAX_WAND, 10, hits, NULL);
+    assert(count == 10);
+    for (int i = 0; i < count; ++i) {
+        printData lines = RK_PassageLines(rank, idx, hits[i].doc);
+        assert(lines.doc_id == 0 && lines.first_occurrence_line <= lines.last_occurrence_line);
+    }
+    RK_Destroy(rank);
+    II_Destroy(idx);
+
+    printf("Rank tests passed.\n");
+    return EXIT_SUCCESS;
+}
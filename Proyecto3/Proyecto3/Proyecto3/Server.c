@@ -0,0 +1,522 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Server.h"
+#include "Query.h"
+
+// A connection; owned by the poller while idle and by one worker while a request is answered
+typedef struct _Client {
+    int fd;
+    char buffer[SERVER_LINE_MAX];
+    size_t length;               // bytes of unanswered input in buffer
+    struct timespec ready_at;    // when the poller queued it, latency is measured from here
+} Client;
+
+// Bounded FIFO of ready clients between the poller and the workers
+typedef struct _RequestQueue {
+    Client** slots;
+    int capacity;
+    int head;
+    int count;
+    BOOLEAN closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} RequestQueue;
+
+typedef struct _Server {
+    const InvertedIndex* idx;
+    IndexHandle* handle;         // instead of idx: every query runs on the snapshot it pins
+    RequestQueue queue;
+    int return_pipe[2];          // workers hand clients back to the poller through here
+    struct timespec started;
+    atomic_long requests;
+    atomic_long errors;
+    atomic_long latency_total_ns;
+    atomic_long latency_max_ns;
+    atomic_long histogram[SERVER_LATENCY_BUCKETS];
+} Server;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static long elapsed_ns(const struct timespec* from, const struct timespec* to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+// ---------------------------------------------------------------- request queue
+
+static BOOLEAN queue_init(RequestQueue* queue, int capacity) {
+    queue->slots = malloc(capacity * sizeof(Client*));
+    if (!queue->slots) return FALSE;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = FALSE;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return TRUE;
+}
+
+static void queue_destroy(RequestQueue* queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->slots);
+}
+
+// Blocks while the queue is full, so a slow pool pushes back on the poller instead of growing
+static void queue_push(RequestQueue* queue, Client* client) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity) pthread_cond_wait(&queue->not_full, &queue->lock);
+    queue->slots[(queue->head + queue->count) % queue->capacity] = client;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Returns NULL once the queue is closed and drained
+static Client* queue_pop(RequestQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) pthread_cond_wait(&queue->not_empty, &queue->lock);
+    Client* client = NULL;
+    if (queue->count > 0) {
+        client = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return client;
+}
+
+static void queue_close(RequestQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = TRUE;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// ---------------------------------------------------------------- sockets
+
+static BOOLEAN is_port(const char* address) {
+    if (!*address) return FALSE;
+    for (const char* p = address; *p; ++p) {
+        if (!isdigit((unsigned char)*p)) return FALSE;
+    }
+    return TRUE;
+}
+
+// Fills addr for a port on 127.0.0.1 or a Unix socket path; returns the socket family or -1
+static int resolve_address(const char* address, struct sockaddr_storage* addr, socklen_t* len) {
+    memset(addr, 0, sizeof(*addr));
+    if (is_port(address)) {
+        struct sockaddr_in* in = (struct sockaddr_in*)addr;
+        int port = atoi(address);
+        if (port <= 0 || port > 65535) return -1;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((unsigned short)port);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        *len = sizeof(*in);
+        return AF_INET;
+    }
+    struct sockaddr_un* un = (struct sockaddr_un*)addr;
+    if (strlen(address) >= sizeof(un->sun_path)) return -1;
+    un->sun_family = AF_UNIX;
+    strcpy(un->sun_path, address);
+    *len = sizeof(*un);
+    return AF_UNIX;
+}
+
+static int open_listener(const char* address) {
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int family = resolve_address(address, &addr, &len);
+    if (family < 0) return -1;
+
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (family == AF_INET) {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    } else {
+        unlink(address);  // a socket file left behind by a previous run
+    }
+    if (bind(fd, (struct sockaddr*)&addr, len) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int SV_Connect(const char* address) {
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int family = resolve_address(address, &addr, &len);
+    if (family < 0) return -1;
+
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, len) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static BOOLEAN send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return FALSE;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------- requests
+
+static void record_latency(Server* server, long ns) {
+    atomic_fetch_add(&server->requests, 1);
+    atomic_fetch_add(&server->latency_total_ns, ns);
+
+    long max = atomic_load(&server->latency_max_ns);
+    while (ns > max && !atomic_compare_exchange_weak(&server->latency_max_ns, &max, ns)) {
+    }
+
+    long us = ns / 1000;
+    int bucket = 0;
+    while (bucket < SERVER_LATENCY_BUCKETS - 1 && (1L << bucket) <= us) bucket++;
+    atomic_fetch_add(&server->histogram[bucket], 1);
+}
+
+// Upper bound (in microseconds) of the bucket holding the given fraction of the requests
+static double histogram_percentile(Server* server, long total, double fraction) {
+    long seen = 0;
+    for (int b = 0; b < SERVER_LATENCY_BUCKETS; ++b) {
+        seen += atomic_load(&server->histogram[b]);
+        if (seen > 0 && seen >= fraction * total) return (double)(1L << b);
+    }
+    return 0;
+}
+
+static void collect_stats(Server* server, ServerStats* stats) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long total = atomic_load(&server->requests);
+    stats->requests = total;
+    stats->errors = atomic_load(&server->errors);
+    stats->elapsed_seconds = elapsed_ns(&server->started, &now) / 1e9;
+    stats->mean_latency_us = total > 0 ? atomic_load(&server->latency_total_ns) / 1e3 / total : 0;
+    stats->p50_latency_us = histogram_percentile(server, total, 0.50);
+    stats->p99_latency_us = histogram_percentile(server, total, 0.99);
+    stats->max_latency_us = atomic_load(&server->latency_max_ns) / 1e3;
+}
+
+// Run one query line, writing the answer (matches + END) to out; returns FALSE on a bad request
+static BOOLEAN run_query(const InvertedIndex* idx, char* line, char* out, size_t out_size) {
+    char error[QUERY_ERROR_LENGTH] = "";
+    QueryStream* stream = QY_OpenText(idx, line, error, sizeof(error));
+    if (!stream) {
+        snprintf(out, out_size, "ERR %s\n", error);
+        return FALSE;
+    }
+
+    printData result;
+    size_t used = 0;
+    int sent = 0;
+    while (sent < SERVER_MAX_RESULTS && QY_StreamNext(stream, &result)) {
+        used += snprintf(out + used, out_size - used, "%d %d %d\n",
+                         result.doc_id, result.first_occurrence_line, result.last_occurrence_line);
+        sent++;
+    }
+    snprintf(out + used, out_size - used, "END %d\n", sent);
+    QY_StreamClose(stream);
+    return TRUE;
+}
+
+// "explain: words": a proximity search answered with its cost before the matches
+static BOOLEAN run_explain(const InvertedIndex* idx, char* line, char* out, size_t out_size) {
+    // II_Explain runs the proximity search; a phrase or boolean plan would be explained wrong
+    if (!QY_IsWordList(line)) {
+        snprintf(out, out_size, "ERR explain supports proximity queries only\n");
+        return FALSE;
+    }
+    char* words[MAX_QUERY_WORDS];
+    int window = DEFAULT_WORD_WINDOW;
+    int word_count = QY_SplitWords(line, words, MAX_QUERY_WORDS, &window);
+    if (word_count <= 0) {
+        snprintf(out, out_size, "ERR %s\n", word_count < 0 ? "too many words" : "empty query");
+        return FALSE;
+    }
+
+    SearchExplain explain;
+    int count = 0;
+    printData* results = II_Explain(idx, words, word_count, window, &count, &explain);
+    size_t used = 0;
+    for (int i = 0; i < explain.term_count; ++i) {
+        const TermExplain* term = &explain.terms[i];
+        used += snprintf(out + used, out_size - used, "TERM %s probes=%d postings=%ld documents=%d\n",
+                         term->key, term->probes, term->postings, term->documents);
+    }
+    used += snprintf(out + used, out_size - used,
+                     "PHASES candidates=%ld windows=%ld results=%ld lookup_ns=%ld merge_ns=%ld window_ns=%ld lines_ns=%ld\n",
+                     explain.candidates, explain.windows, explain.results,
+                     explain.lookup_ns, explain.merge_ns, explain.window_ns, explain.lines_ns);
+    int sent = 0;
+    for (; sent < SERVER_MAX_RESULTS && sent < count; ++sent) {
+        used += snprintf(out + used, out_size - used, "%d %d %d\n", results[sent].doc_id,
+                         results[sent].first_occurrence_line, results[sent].last_occurrence_line);
+    }
+    snprintf(out + used, out_size - used, "END %d\n", sent);
+    free(results);
+    return TRUE;
+}
+
+// Answer every complete line in the client's buffer; returns FALSE if the connection should close
+static BOOLEAN serve_client(Server* server, SnapshotReader* reader, Client* client) {
+    char out[SERVER_MAX_RESULTS * 40 + MAX_QUERY_WORDS * (MAX_WORD_LENGTH + 64) + 256];
+
+    ssize_t got = recv(client->fd, client->buffer + client->length,
+                       sizeof(client->buffer) - client->length, 0);
+    if (got <= 0) return got < 0 && (errno == EINTR || errno == EAGAIN);
+    client->length += (size_t)got;
+
+    while (1) {
+        char* newline = memchr(client->buffer, '\n', client->length);
+        if (!newline) {
+            // a line that can't fit is rejected and dropped
+            if (client->length == sizeof(client->buffer)) {
+                atomic_fetch_add(&server->errors, 1);
+                client->length = 0;
+                return send_all(client->fd, "ERR line too long\n", 18);
+            }
+            return TRUE;
+        }
+
+        *newline = '\0';
+        if (newline > client->buffer && newline[-1] == '\r') newline[-1] = '\0';
+        size_t consumed = (size_t)(newline - client->buffer) + 1;
+
+        char* line = client->buffer;
+        if (strcmp(line, "STATS") == 0) {
+            ServerStats stats;
+            collect_stats(server, &stats);
+            snprintf(out, sizeof(out),
+                     "requests=%ld errors=%ld qps=%.1f mean_us=%.1f p50_us<=%.0f p99_us<=%.0f max_us=%.1f\nEND 0\n",
+                     stats.requests, stats.errors,
+                     stats.elapsed_seconds > 0 ? stats.requests / stats.elapsed_seconds : 0,
+                     stats.mean_latency_us, stats.p50_latency_us, stats.p99_latency_us, stats.max_latency_us);
+            if (server->handle) {
+                SnapshotStats snapshot;
+                SN_GetStats(server->handle, &snapshot);
+                size_t used = strlen(out) - strlen("\nEND 0\n");
+                snprintf(out + used, sizeof(out) - used, " version=%ld rebuilding=%d pending=%ld\nEND 0\n",
+                         snapshot.version, snapshot.rebuilding ? 1 : 0, snapshot.pending);
+            }
+        } else if (strcmp(line, "RELOAD") == 0) {
+            // the new index is built in the background, queries keep running on the current one
+            if (server->handle && SN_Rebuild(server->handle) == 0) {
+                snprintf(out, sizeof(out), "END 0\n");
+            } else {
+                atomic_fetch_add(&server->errors, 1);
+                snprintf(out, sizeof(out), "ERR %s\n", server->handle ? "rebuild already running" : "no rebuild available");
+            }
+        } else if (strcmp(line, "SHUTDOWN") == 0) {
+            // a NULL client on the return pipe tells the poller to stop
+            Client* stop = NULL;
+            snprintf(out, sizeof(out), "END 0\n");
+            if (write(server->return_pipe[1], &stop, sizeof(stop)) < 0) atomic_fetch_add(&server->errors, 1);
+        } else {
+            const InvertedIndex* idx = reader ? SN_Enter(reader) : server->idx;
+            BOOLEAN ok = strncmp(line, "explain:", 8) == 0 ? run_explain(idx, line + 8, out, sizeof(out))
+                                                            : run_query(idx, line, out, sizeof(out));
+            if (!ok) atomic_fetch_add(&server->errors, 1);
+            if (reader) SN_Leave(reader);
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            record_latency(server, elapsed_ns(&client->ready_at, &now));
+        }
+
+        memmove(client->buffer, client->buffer + consumed, client->length - consumed);
+        client->length -= consumed;
+        if (!send_all(client->fd, out, strlen(out))) return FALSE;
+    }
+}
+
+static void* worker_main(void* arg) {
+    Server* server = arg;
+    SnapshotReader* reader = server->handle ? SN_Register(server->handle) : NULL;
+    Client* client;
+    if (server->handle && !reader) return NULL;
+    while ((client = queue_pop(&server->queue)) != NULL) {
+        if (serve_client(server, reader, client)) {
+            if (write(server->return_pipe[1], &client, sizeof(client)) == sizeof(client)) continue;
+        }
+        close(client->fd);
+        free(client);
+    }
+    SN_Unregister(reader);
+    return NULL;
+}
+
+// ---------------------------------------------------------------- poller
+
+static int run_server(const InvertedIndex* idx, IndexHandle* handle, const ServerConfig* config, ServerStats* stats) {
+    if ((!idx && !handle) || !config || !config->address) return -1;
+    int worker_count = config->workers > 0 ? config->workers : SERVER_DEFAULT_WORKERS;
+    if (handle && worker_count > SNAPSHOT_MAX_READERS) {
+        // every worker holds a reader slot of the handle
+        fprintf(stderr, "AVISO: se pidieron %d workers, se usan %d (SNAPSHOT_MAX_READERS)\n",
+                worker_count, SNAPSHOT_MAX_READERS);
+        worker_count = SNAPSHOT_MAX_READERS;
+    }
+    int capacity = config->queue_capacity > 0 ? config->queue_capacity : SERVER_DEFAULT_QUEUE;
+
+    Server* server = calloc(1, sizeof(Server));
+    pthread_t* workers = malloc(worker_count * sizeof(pthread_t));
+    struct pollfd* fds = malloc((SERVER_MAX_CLIENTS + 2) * sizeof(struct pollfd));
+    Client** clients = malloc((SERVER_MAX_CLIENTS + 2) * sizeof(Client*));
+    if (!server || !workers || !fds || !clients || !queue_init(&server->queue, capacity)) {
+        free(server); free(workers); free(fds); free(clients);
+        return -1;
+    }
+    server->idx = idx;
+    server->handle = handle;
+
+    int listener = open_listener(config->address);
+    if (listener < 0 || pipe(server->return_pipe) < 0) {
+        if (listener >= 0) close(listener);
+        queue_destroy(&server->queue);
+        free(server); free(workers); free(fds); free(clients);
+        return -1;
+    }
+    fcntl(server->return_pipe[0], F_SETFL, fcntl(server->return_pipe[0], F_GETFL) | O_NONBLOCK);
+
+    // no SA_RESTART: the signal has to interrupt poll
+    struct sigaction action, old_int, old_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+    stop_requested = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &server->started);
+    int started = 0;
+    while (started < worker_count && pthread_create(&workers[started], NULL, worker_main, server) == 0) started++;
+
+    // fds[0] is the listener, fds[1] the return pipe, the rest are idle clients
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    fds[1].fd = server->return_pipe[0];
+    fds[1].events = POLLIN;
+    int nfds = 2;
+
+    while (started > 0 && !stop_requested) {
+        int ready = poll(fds, nfds, 500);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) continue;
+
+        // idle clients with input go to the workers; while one is queued nobody else reads it
+        for (int i = nfds - 1; i >= 2; --i) {
+            if (!fds[i].revents) continue;
+            Client* client = clients[i];
+            clock_gettime(CLOCK_MONOTONIC, &client->ready_at);
+            fds[i] = fds[nfds - 1];
+            clients[i] = clients[nfds - 1];
+            nfds--;
+            queue_push(&server->queue, client);
+        }
+
+        if (fds[1].revents & POLLIN) {
+            Client* client;
+            while (read(server->return_pipe[0], &client, sizeof(client)) == sizeof(client)) {
+                if (!client) {  // SHUTDOWN
+                    stop_requested = 1;
+                    continue;
+                }
+                fds[nfds].fd = client->fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                clients[nfds++] = client;
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                Client* client = nfds < SERVER_MAX_CLIENTS + 2 ? calloc(1, sizeof(Client)) : NULL;
+                if (!client) {
+                    close(fd);
+                    continue;
+                }
+                client->fd = fd;
+                fds[nfds].fd = fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                clients[nfds++] = client;
+            }
+        }
+    }
+
+    // workers finish whatever is queued, then the remaining clients are closed
+    queue_close(&server->queue);
+    for (int i = 0; i < started; ++i) pthread_join(workers[i], NULL);
+    Client* client;
+    while (read(server->return_pipe[0], &client, sizeof(client)) == sizeof(client)) {
+        if (client) clients[nfds++] = client;
+    }
+    for (int i = 2; i < nfds; ++i) {
+        close(clients[i]->fd);
+        free(clients[i]);
+    }
+
+    if (stats) collect_stats(server, stats);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    close(listener);
+    if (!is_port(config->address)) unlink(config->address);
+    close(server->return_pipe[0]);
+    close(server->return_pipe[1]);
+    queue_destroy(&server->queue);
+    free(server);
+    free(workers);
+    free(fds);
+    free(clients);
+    return started > 0 ? 0 : -1;
+}
+
+int SV_Run(const InvertedIndex* idx, const ServerConfig* config, ServerStats* stats) {
+    return run_server(idx, NULL, config, stats);
+}
+
+int SV_RunHandle(IndexHandle* handle, const ServerConfig* config, ServerStats* stats) {
+    return run_server(NULL, handle, config, stats);
+}
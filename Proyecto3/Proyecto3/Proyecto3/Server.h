@@ -0,0 +1,59 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "InvertedIndex.h"
+#include "Snapshot.h"
+
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_DEFAULT_QUEUE 64     // requests waiting for a worker before the acceptor blocks
+#define SERVER_MAX_CLIENTS 1024     // connections open at the same time
+#define SERVER_MAX_RESULTS 100      // matches sent back per query
+#define SERVER_LINE_MAX 1024        // longest request line
+#define SERVER_LATENCY_BUCKETS 40   // latency histogram: bucket b counts requests under 2^b microseconds
+
+/*
+ * Line protocol (one request per line, answers end with a line "END <n>"):
+ *   quijote, sancho, ~5        proximity search, same syntax as the interactive loop
+ *   "en un lugar"              exact phrase
+ *   explain: quijote, sancho   proximity search answered first with its cost: a line
+ *                              "TERM <word> probes= postings= documents=" per word and a line
+ *                              "PHASES candidates= windows= results= lookup_ns= ... lines_ns="
+ *   sancho AND (rucio OR asno) boolean query (see Query.h)
+ *   STATS                      throughput and latency since start (and the snapshot version)
+ *   RELOAD                     rebuild the index in the background (SV_RunHandle only)
+ *   SHUTDOWN                   stop the server
+ * Each match is answered as "<doc_id> <first_line> <last_line>", errors as "ERR <reason>".
+ */
+
+// Server settings
+typedef struct _ServerConfig {
+    const char* address;   // Unix socket path, or a port number to listen on 127.0.0.1
+    int workers;           // fixed number of worker threads
+    int queue_capacity;    // bound of the request queue
+} ServerConfig;
+
+// Counters kept while serving (latency includes the time waiting in the queue)
+typedef struct _ServerStats {
+    long requests;
+    long errors;
+    double elapsed_seconds;
+    double mean_latency_us;
+    double p50_latency_us;
+    double p99_latency_us;
+    double max_latency_us;
+} ServerStats;
+
+// Serve queries on an already loaded index until SIGINT/SIGTERM or a SHUTDOWN request.
+// Only the read-only query path of the index is used, from every worker at once.
+// Fills stats (if not NULL) on exit; returns 0 on a clean shutdown, -1 if it could not start
+int SV_Run(const InvertedIndex* idx, const ServerConfig* config, ServerStats* stats);
+
+// Same as SV_Run, but every query runs on the snapshot of the handle it starts on, so new
+// indexes (SN_Publish, SN_Rebuild or a RELOAD request) are served without stopping.
+// At most SNAPSHOT_MAX_READERS workers
+int SV_RunHandle(IndexHandle* handle, const ServerConfig* config, ServerStats* stats);
+
+// Connect to a server started with SV_Run; returns the socket or -1
+int SV_Connect(const char* address);
+
+#endif
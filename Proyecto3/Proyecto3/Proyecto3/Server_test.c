@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "Server.h"
+#include "Query.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+typedef struct {
+    const InvertedIndex* idx;
+    ServerConfig config;
+    ServerStats stats;
+    int result;
+} Running;
+
+static void* run_server(void* arg) {
+    Running* running = arg;
+    running->result = SV_Run(running->idx, &running->config, &running->stats);
+    return NULL;
+}
+
+/* Manda una linea y lee la respuesta completa: termina en una linea "END n" o "ERR ..." */
+static void ask(int fd, const char* request, char* reply, size_t size) {
+    size_t length = strlen(request);
+    assert(send(fd, request, length, 0) == (ssize_t)length && send(fd, "\n", 1, 0) == 1);
+    size_t used = 0;
+    while (1) {
+        ssize_t got = recv(fd, reply + used, size - used - 1, 0);
+        assert(got > 0);
+        used += (size_t)got;
+        reply[used] = '\0';
+        if (reply[used - 1] != '\n') continue;
+        // comienzo de la ultima linea
+        char* last = reply + used - 1;
+        while (last > reply && last[-1] != '\n') last--;
+        if (strncmp(last, "END ", 4) == 0 || strncmp(last, "ERR ", 4) == 0) return;
+    }
+}
+
+/* Lineas de la respuesta que empiezan con prefix */
+static int count_lines(const char* reply, const char* prefix) {
+    int count = 0;
+    for (const char* line = reply; *line; line = strchr(line, '\n') + 1) {
+        if (strncmp(line, prefix, strlen(prefix)) == 0) count++;
+    }
+    return count;
+}
+
+/* Resultados que devuelve el camino de consultas del indice, con el tope del servidor */
+static int expected_matches(const InvertedIndex* idx, const char* query) {
+    char text[SERVER_LINE_MAX];
+    char error[QUERY_ERROR_LENGTH];
+    strcpy(text, query);
+    QueryStream* stream = QY_OpenText(idx, text, error, sizeof(error));
+    assert(stream != NULL);
+    printData result;
+    int count = 0;
+    while (count < SERVER_MAX_RESULTS && QY_StreamNext(stream, &result)) count++;
+    QY_StreamClose(stream);
+    return count;
+}
+
+int main(void) {
+    InvertedIndex* idx = II_Create();
+    assert(II_LoadFile(idx, "lobo.txt") == 0);
+
+    char address[64];
+    snprintf(address, sizeof(address), "/tmp/server_test_%d.sock", (int)getpid());
+    Running running = { idx, { address, 2, 8 }, { 0 }, -1 };
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, run_server, &running) == 0);
+
+    // el servidor tarda un poco en escuchar
+    int fd = -1;
+    for (int attempt = 0; attempt < 200 && fd < 0; ++attempt) {
+        fd = SV_Connect(address);
+        if (fd < 0) usleep(10000);
+    }
+    assert(fd >= 0);
+
+    static char reply[64 * 1024];
+    int found;
+
+    // Una consulta por cercania: una linea "doc primera ultima" por resultado y "END n"
+    int expected = expected_matches(idx, "lobos, romance");
+    assert(expected > 0);
+    ask(fd, "lobos, romance", reply, sizeof(reply));
+    assert(sscanf(strstr(reply, "END "), "END %d", &found) == 1 && found == expected);
+    assert(count_lines(reply, "0 ") == expected);
+
+    // Una consulta mal formada se contesta con un error y la conexion sigue abierta
+    ask(fd, "lobos AND (romance", reply, sizeof(reply));
+    assert(strncmp(reply, "ERR ", 4) == 0 && count_lines(reply, "END ") == 0);
+
+    // explain: una linea por palabra, las etapas y el mejor resultado de cada documento (II_Explain)
+    char* words[] = { "lobos", "romance" };
+    int documents;
+    free(II_Search(idx, words, 2, &documents));
+    assert(documents == 1);
+    ask(fd, "explain: lobos, romance", reply, sizeof(reply));
+    assert(count_lines(reply, "TERM ") == 2 && count_lines(reply, "PHASES ") == 1);
+    assert(strstr(reply, "TERM lobos probes=") != NULL && strstr(reply, " results=1 ") != NULL);
+    assert(sscanf(strstr(reply, "END "), "END %d", &found) == 1 && found == documents);
+
+    // explain: solo explica busquedas por cercania
+    ask(fd, "explain: \"romance de lobos\"", reply, sizeof(reply));
+    assert(strcmp(reply, "ERR explain supports proximity queries only\n") == 0);
+    ask(fd, "explain: lobos AND romance", reply, sizeof(reply));
+    assert(strcmp(reply, "ERR explain supports proximity queries only\n") == 0);
+
+    // STATS cuenta las consultas y los errores de arriba
+    long requests, errors;
+    ask(fd, "STATS", reply, sizeof(reply));
+    assert(sscanf(reply, "requests=%ld errors=%ld", &requests, &errors) == 2);
+    assert(requests == 5 && errors == 3);
+    assert(strstr(reply, "version=") == NULL);  // sin handle no hay snapshots
+    assert(strcmp(strrchr(reply, 'E'), "END 0\n") == 0);
+
+    // SV_Run sin handle no puede recargar
+    ask(fd, "RELOAD", reply, sizeof(reply));
+    assert(strcmp(reply, "ERR no rebuild available\n") == 0);
+
+    ask(fd, "SHUTDOWN", reply, sizeof(reply));
+    assert(strcmp(reply, "END 0\n") == 0);
+    close(fd);
+    assert(pthread_join(thread, NULL) == 0);
+    assert(running.result == 0);
+    assert(running.stats.requests == 5 && running.stats.errors == 4);
+    unlink(address);
+
+    II_Destroy(idx);
+    printf("Server tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "Shard.h"
+#include "Query.h"
+
+#define SHARD_BUFFER_SIZE (4 * SHARD_LINE_MAX)
+#define SHARD_STOP_GRACE_MS 500   // time a shard gets to exit on its own before SIGKILL
+
+typedef struct _Shard {
+    pid_t pid;
+    int fd;                            // coordinator's end of the socketpair, -1 once down
+    char buffer[SHARD_BUFFER_SIZE];    // bytes received and not consumed yet
+    size_t length;
+    size_t consumed;
+} Shard;
+
+struct _ShardSet {
+    int shard_count;
+    unsigned long seq;                 // of the last query scattered
+    Shard shards[SHARD_MAX_SHARDS];
+};
+
+// Collection statistics of one shard for the current query
+typedef struct _ShardStats {
+    long documents;
+    long tokens;
+    int term_count;
+    long df[MAX_QUERY_WORDS];
+} ShardStats;
+
+// A document gathered from a shard, before ranking
+typedef struct _Gathered {
+    int file;
+    long tokens;
+    int matches;
+    int first_line;
+    int last_line;
+    long tf[MAX_QUERY_WORDS];
+} Gathered;
+
+static double elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1e3 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+static BOOLEAN write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return FALSE;
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return TRUE;
+}
+
+// Read what the peer sent; FALSE once it closed the connection (or a line doesn't fit)
+static BOOLEAN fill(Shard* sh) {
+    if (sh->length == sizeof(sh->buffer)) return FALSE;
+    ssize_t got = read(sh->fd, sh->buffer + sh->length, sizeof(sh->buffer) - sh->length);
+    if (got < 0 && (errno == EINTR || errno == EAGAIN)) return TRUE;
+    if (got <= 0) return FALSE;
+    sh->length += (size_t)got;
+    return TRUE;
+}
+
+// Next complete line in the buffer, without its '\n'; NULL (after compacting) if there is none yet
+static char* next_line(Shard* sh) {
+    char* begin = sh->buffer + sh->consumed;
+    char* newline = memchr(begin, '\n', sh->length - sh->consumed);
+    if (!newline) {
+        memmove(sh->buffer, begin, sh->length - sh->consumed);
+        sh->length -= sh->consumed;
+        sh->consumed = 0;
+        return NULL;
+    }
+    *newline = '\0';
+    sh->consumed = (size_t)(newline + 1 - sh->buffer);
+    return begin;
+}
+
+// ---------------------------------------------------------------- shard process
+
+static long term_count_in(const OccurrenceList* list, int doc) {
+    const Occurrence* occurrence = list ? FindOccurrenceByDocId(list, doc) : NULL;
+    return occurrence ? (long)GetOrdinalCount(occurrence) : 0;
+}
+
+static void write_document(FILE* out, unsigned long seq, const InvertedIndex* idx, const printData* first,
+                           int matches, const OccurrenceList* postings[], int term_count) {
+    fprintf(out, "%lu DOC %d %zu %d %d %d", seq, first->doc_id, arraylist_size(idx->token_offsets[first->doc_id]),
+            matches, first->first_occurrence_line, first->last_occurrence_line);
+    for (int t = 0; t < term_count; ++t) fprintf(out, " %ld", term_count_in(postings[t], first->doc_id));
+    fputc('\n', out);
+}
+
+// Answer "<seq> <query>": collection statistics, then every matching document
+static void answer(const InvertedIndex* idx, char* line, FILE* out) {
+    char* text;
+    unsigned long seq = strtoul(line, &text, 10);
+    while (*text == ' ') text++;
+
+    char error[QUERY_ERROR_LENGTH] = "";
+    QueryStream* stream = QY_OpenText(idx, text, error, sizeof(error));
+    if (!stream) {
+        fprintf(out, "%lu ERR %s\n", seq, error);
+        return;
+    }
+
+    char* words[MAX_QUERY_WORDS];
+    const OccurrenceList* postings[MAX_QUERY_WORDS];
+    int term_count = QY_StreamTerms(stream, words, MAX_QUERY_WORDS);
+    long tokens = 0;
+    for (int d = 0; d <= idx->last_file_index; ++d) tokens += (long)arraylist_size(idx->token_offsets[d]);
+    fprintf(out, "%lu STATS %d %ld %d", seq, idx->last_file_index + 1, tokens, term_count);
+    for (int t = 0; t < term_count; ++t) {
+        postings[t] = II_Postings(idx, words[t]);
+        fprintf(out, " %d", postings[t] ? postings[t]->count : 0);
+    }
+    fputc('\n', out);
+
+    // matches come in document order: one DOC line per run of the same document
+    printData result, first = { -1, 0, 0 };
+    int matches = 0;
+    while (QY_StreamNext(stream, &result)) {
+        if (result.doc_id != first.doc_id) {
+            if (matches > 0) write_document(out, seq, idx, &first, matches, postings, term_count);
+            first = result;
+            matches = 0;
+        }
+        matches++;
+    }
+    if (matches > 0) write_document(out, seq, idx, &first, matches, postings, term_count);
+    fprintf(out, "%lu END\n", seq);
+    QY_StreamClose(stream);
+}
+
+static void shard_main(int fd, const char* files[], int file_count, int shard, int shard_count, BOOLEAN short_words) {
+    char line[SHARD_LINE_MAX];
+    InvertedIndex* idx = II_Create();
+    if (idx) II_SetIndexShortWords(idx, short_words);
+    for (int f = shard; idx && f < file_count; f += shard_count) {
+        if (II_LoadFile(idx, files[f]) < 0) {
+            int length = snprintf(line, sizeof(line), "FAIL %s\n", files[f]);
+            write_all(fd, line, (size_t)length);
+            _exit(EXIT_FAILURE);
+        }
+    }
+    fflush(stdout);
+    int length = snprintf(line, sizeof(line), "READY %d\n", idx ? idx->last_file_index + 1 : -1);
+    if (!idx || !write_all(fd, line, (size_t)length)) _exit(EXIT_FAILURE);
+
+    // one request per line until the coordinator closes its end
+    Shard in = { 0 };
+    in.fd = fd;
+    while (fill(&in)) {
+        char* request;
+        while ((request = next_line(&in)) != NULL) {
+            char* reply = NULL;
+            size_t reply_size = 0;
+            FILE* out = open_memstream(&reply, &reply_size);
+            if (!out) _exit(EXIT_FAILURE);
+            answer(idx, request, out);
+            fclose(out);
+            BOOLEAN sent = write_all(fd, reply, reply_size);
+            free(reply);
+            if (!sent) _exit(EXIT_FAILURE);
+        }
+    }
+    II_Destroy(idx);
+    _exit(EXIT_SUCCESS);
+}
+
+// ---------------------------------------------------------------- coordinator
+
+static void shard_down(Shard* sh) {
+    if (sh->fd >= 0) close(sh->fd);
+    sh->fd = -1;
+}
+
+// Wait up to timeout_ms for the READY line of a shard that is loading
+static BOOLEAN wait_ready(Shard* sh, int timeout_ms) {
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    while (1) {
+        char* line = next_line(sh);
+        if (line) return strncmp(line, "READY ", 6) == 0;
+
+        int remaining = timeout_ms - (int)elapsed_ms(&started);
+        if (remaining <= 0) return FALSE;
+        struct pollfd pfd = { sh->fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, remaining);
+        if (ready < 0 && errno != EINTR) return FALSE;
+        if (ready > 0 && !fill(sh)) return FALSE;
+    }
+}
+
+ShardSet* SH_Start(const char* files[], int file_count, int shard_count, BOOLEAN short_words) {
+    if (!files || file_count < 1 || shard_count < 1 || shard_count > SHARD_MAX_SHARDS) return NULL;
+    if (shard_count > file_count) shard_count = file_count;   // a shard without files would only add latency
+    if (file_count > shard_count * MAX_OPEN_FILES) return NULL;
+
+    ShardSet* set = calloc(1, sizeof(ShardSet));
+    if (!set) return NULL;
+    for (int s = 0; s < SHARD_MAX_SHARDS; ++s) set->shards[s].fd = -1;
+
+    fflush(stdout);   // or the children would flush the parent's buffered output again
+    fflush(stderr);
+    for (int s = 0; s < shard_count; ++s) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) break;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(pair[0]);
+            close(pair[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(pair[0]);
+            for (int o = 0; o < s; ++o) close(set->shards[o].fd);
+            shard_main(pair[1], files, file_count, s, shard_count, short_words);
+        }
+        close(pair[1]);
+        set->shards[s].pid = pid;
+        set->shards[s].fd = pair[0];
+        set->shard_count = s + 1;
+    }
+
+    BOOLEAN ready = set->shard_count == shard_count;
+    for (int s = 0; ready && s < shard_count; ++s) ready = wait_ready(&set->shards[s], SHARD_LOAD_TIMEOUT_MS);
+    if (!ready) {
+        SH_Stop(set);
+        return NULL;
+    }
+    return set;
+}
+
+// Handle one line of the answer of shard s to query seq; FALSE once that answer is complete
+static BOOLEAN take_line(char* line, unsigned long seq, int s, ShardStats* stats, ArrayList* docs,
+                         int shard_count, ShardReport* report) {
+    char* rest;
+    if (strtoul(line, &rest, 10) != seq) return TRUE;   // late answer to an earlier query
+    while (*rest == ' ') rest++;
+
+    if (strncmp(rest, "STATS ", 6) == 0) {
+        char* p = rest + 6;
+        stats->documents = strtol(p, &p, 10);
+        stats->tokens = strtol(p, &p, 10);
+        stats->term_count = (int)strtol(p, &p, 10);
+        if (stats->term_count > MAX_QUERY_WORDS) stats->term_count = MAX_QUERY_WORDS;
+        for (int t = 0; t < stats->term_count; ++t) stats->df[t] = strtol(p, &p, 10);
+    } else if (strncmp(rest, "DOC ", 4) == 0) {
+        Gathered doc;
+        char* p = rest + 4;
+        doc.file = s + (int)strtol(p, &p, 10) * shard_count;   // files were dealt round-robin
+        doc.tokens = strtol(p, &p, 10);
+        doc.matches = (int)strtol(p, &p, 10);
+        doc.first_line = (int)strtol(p, &p, 10);
+        doc.last_line = (int)strtol(p, &p, 10);
+        for (int t = 0; t < stats->term_count; ++t) doc.tf[t] = strtol(p, &p, 10);
+        arraylist_add(docs, &doc);
+    } else if (strcmp(rest, "END") == 0) {
+        report->status[s] = SHARD_OK;
+        report->answered++;
+        return FALSE;
+    } else {
+        report->status[s] = SHARD_ERROR;
+        if (report->error[0] == '\0') {
+            snprintf(report->error, sizeof(report->error), "%s", strncmp(rest, "ERR ", 4) == 0 ? rest + 4 : rest);
+        }
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int by_score(const void* a, const void* b) {
+    const ShardHit* x = a;
+    const ShardHit* y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return x->file - y->file;
+}
+
+// BM25 of every gathered document of the shards that answered, with their summed statistics
+static int rank(const ShardStats stats[], ArrayList* const docs[], const ShardReport* report,
+                ShardHit* out, int max_out, long* documents) {
+    long total_docs = 0, total_tokens = 0, df[MAX_QUERY_WORDS] = { 0 };
+    int term_count = 0;
+    size_t candidates = 0;
+    for (int s = 0; s < report->shard_count; ++s) {
+        if (report->status[s] != SHARD_OK) continue;
+        total_docs += stats[s].documents;
+        total_tokens += stats[s].tokens;
+        term_count = stats[s].term_count;
+        for (int t = 0; t < stats[s].term_count; ++t) df[t] += stats[s].df[t];
+        candidates += arraylist_size(docs[s]);
+    }
+    *documents = (long)candidates;
+    if (candidates == 0) return 0;
+
+    double idf[MAX_QUERY_WORDS];
+    for (int t = 0; t < term_count; ++t) idf[t] = log(1.0 + (total_docs - df[t] + 0.5) / (df[t] + 0.5));
+    double average_length = total_docs > 0 ? (double)total_tokens / total_docs : 1.0;
+
+    ShardHit* hits = malloc(candidates * sizeof(ShardHit));
+    if (!hits) return 0;
+    int count = 0;
+    for (int s = 0; s < report->shard_count; ++s) {
+        if (report->status[s] != SHARD_OK) continue;
+        for (size_t i = 0; i < arraylist_size(docs[s]); ++i) {
+            const Gathered* doc = arraylist_get(docs[s], i);
+            double norm = SHARD_BM25_K1 * (1 - SHARD_BM25_B + SHARD_BM25_B * doc->tokens / average_length);
+            double score = 0;
+            for (int t = 0; t < term_count; ++t) {
+                if (doc->tf[t] > 0) score += idf[t] * doc->tf[t] * (SHARD_BM25_K1 + 1) / (doc->tf[t] + norm);
+            }
+            hits[count++] = (ShardHit){ doc->file, s, score, doc->matches, doc->first_line, doc->last_line };
+        }
+    }
+    qsort(hits, count, sizeof(ShardHit), by_score);
+    if (count > max_out) count = max_out;
+    memcpy(out, hits, count * sizeof(ShardHit));
+    free(hits);
+    return count;
+}
+
+int SH_Search(ShardSet* set, const char* query, int timeout_ms, ShardHit* out, int max_out, ShardReport* report) {
+    ShardReport ignored;
+    if (!report) report = &ignored;
+    memset(report, 0, sizeof(ShardReport));
+    if (!set || !query || !out || max_out < 0 || strchr(query, '\n')) {
+        snprintf(report->error, sizeof(report->error), "invalid query");
+        return -1;
+    }
+    report->shard_count = set->shard_count;
+
+    char request[SHARD_LINE_MAX];
+    unsigned long seq = ++set->seq;
+    int length = snprintf(request, sizeof(request), "%lu %s\n", seq, query);
+    if (length >= (int)sizeof(request)) {
+        snprintf(report->error, sizeof(report->error), "query too long");
+        return -1;
+    }
+
+    // scatter: a shard still busy with a query that timed out just gets this one queued
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    ShardStats stats[SHARD_MAX_SHARDS];
+    ArrayList* docs[SHARD_MAX_SHARDS] = { NULL };
+    BOOLEAN pending[SHARD_MAX_SHARDS];
+    int pending_count = 0;
+    for (int s = 0; s < set->shard_count; ++s) {
+        Shard* sh = &set->shards[s];
+        memset(&stats[s], 0, sizeof(ShardStats));
+        pending[s] = FALSE;
+        report->status[s] = SHARD_TIMEOUT;
+        if (sh->fd >= 0 && !write_all(sh->fd, request, (size_t)length)) shard_down(sh);
+        if (sh->fd < 0) {
+            report->status[s] = SHARD_DOWN;
+            continue;
+        }
+        docs[s] = arraylist_create(16, sizeof(Gathered));
+        pending[s] = docs[s] != NULL;
+        pending_count += pending[s];
+    }
+
+    // gather until every shard has answered or the time is up
+    while (pending_count > 0) {
+        int remaining = timeout_ms - (int)elapsed_ms(&started);
+        if (remaining <= 0) break;
+
+        struct pollfd pfds[SHARD_MAX_SHARDS];
+        int shard_of[SHARD_MAX_SHARDS];
+        int nfds = 0;
+        for (int s = 0; s < set->shard_count; ++s) {
+            if (!pending[s]) continue;
+            pfds[nfds] = (struct pollfd){ set->shards[s].fd, POLLIN, 0 };
+            shard_of[nfds++] = s;
+        }
+        int ready = poll(pfds, nfds, remaining);
+        if (ready < 0 && errno != EINTR) break;
+
+        for (int i = 0; ready > 0 && i < nfds; ++i) {
+            if (pfds[i].revents == 0) continue;
+            int s = shard_of[i];
+            Shard* sh = &set->shards[s];
+            if (!fill(sh)) {
+                shard_down(sh);
+                report->status[s] = SHARD_DOWN;
+                pending[s] = FALSE;
+                pending_count--;
+                continue;
+            }
+            char* line;
+            while (pending[s] && (line = next_line(sh)) != NULL) {
+                if (!take_line(line, seq, s, &stats[s], docs[s], set->shard_count, report)) {
+                    pending[s] = FALSE;
+                    pending_count--;
+                    report->latency_us[s] = elapsed_ms(&started) * 1e3;
+                }
+            }
+        }
+    }
+    for (int s = 0; s < set->shard_count; ++s) {
+        if (pending[s]) report->latency_us[s] = elapsed_ms(&started) * 1e3;
+    }
+
+    int count = rank(stats, docs, report, out, max_out, &report->documents);
+    for (int s = 0; s < set->shard_count; ++s) arraylist_destroy(docs[s]);
+    if (report->answered == 0) {
+        if (report->error[0] == '\0') snprintf(report->error, sizeof(report->error), "no shard answered");
+        return -1;
+    }
+    return count;
+}
+
+int SH_ShardCount(const ShardSet* set) {
+    return set ? set->shard_count : 0;
+}
+
+pid_t SH_ShardPid(const ShardSet* set, int shard) {
+    return set && shard >= 0 && shard < set->shard_count ? set->shards[shard].pid : -1;
+}
+
+void SH_Stop(ShardSet* set) {
+    if (!set) return;
+    // closing their end makes the shards leave their loop; stuck ones are killed after a grace period
+    for (int s = 0; s < set->shard_count; ++s) shard_down(&set->shards[s]);
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    for (int s = 0; s < set->shard_count; ++s) {
+        pid_t pid = set->shards[s].pid;
+        while (waitpid(pid, NULL, WNOHANG) == 0) {
+            if (elapsed_ms(&started) > SHARD_STOP_GRACE_MS) {
+                kill(pid, SIGKILL);
+                waitpid(pid, NULL, 0);
+                break;
+            }
+            usleep(1000);
+        }
+    }
+    free(set);
+}
@@ -0,0 +1,76 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <sys/types.h>
+#include "InvertedIndex.h"
+
+#define SHARD_MAX_SHARDS 16
+#define SHARD_MAX_FILES (SHARD_MAX_SHARDS * MAX_OPEN_FILES)   // each shard holds up to MAX_OPEN_FILES
+#define SHARD_DEFAULT_TIMEOUT_MS 1000   // how long a query waits for the slowest shard
+#define SHARD_LOAD_TIMEOUT_MS 120000    // how long SH_Start waits for the shards to load their files
+#define SHARD_LINE_MAX 4096             // longest line exchanged with a shard
+#define SHARD_ERROR_LENGTH 128
+#define SHARD_BM25_K1 1.2
+#define SHARD_BM25_B 0.75
+
+/*
+ * Sharding: the files are dealt round-robin to N child processes (file f goes to shard
+ * f % N), each loading its own InvertedIndex, so the corpus is no longer bound by one
+ * heap nor by MAX_OPEN_FILES. The coordinator talks to every shard over a socketpair:
+ *
+ *   -> <seq> <query>                        any syntax of QY_OpenText
+ *   <- <seq> STATS <docs> <tokens> <k> <df_1> ... <df_k>
+ *   <- <seq> DOC <doc> <tokens> <matches> <first_line> <last_line> <tf_1> ... <tf_k>
+ *   <- <seq> END                            or <seq> ERR <reason>
+ *
+ * SH_Search scatters the query to every shard, gathers what arrives before the timeout
+ * and ranks the documents with BM25 over the positive words of the query, using document
+ * frequencies summed over the shards that answered (the same scores one index holding
+ * those documents would give). A late answer is recognized by its seq and dropped.
+ */
+
+typedef enum _ShardStatus {
+    SHARD_OK,        // answered in time
+    SHARD_TIMEOUT,   // no complete answer before the timeout
+    SHARD_ERROR,     // rejected the query (ERR)
+    SHARD_DOWN       // the process is gone
+} ShardStatus;
+
+// One ranked document
+typedef struct _ShardHit {
+    int file;               // position of the file in the list given to SH_Start
+    int shard;
+    double score;           // BM25 of the query words in the document
+    int matches;            // matches of the query in the document
+    int first_line;         // lines of the first match
+    int last_line;
+} ShardHit;
+
+// What happened with each shard during the last SH_Search
+typedef struct _ShardReport {
+    int shard_count;
+    ShardStatus status[SHARD_MAX_SHARDS];
+    double latency_us[SHARD_MAX_SHARDS];   // until the shard's END (or the timeout)
+    int answered;                           // shards with status SHARD_OK
+    long documents;                         // matching documents before truncating to max_out
+    char error[SHARD_ERROR_LENGTH];         // first ERR reason, if any
+} ShardReport;
+
+typedef struct _ShardSet ShardSet;
+
+// Fork shard_count (1..SHARD_MAX_SHARDS) shards and wait until they have loaded their files.
+// short_words is passed to II_SetIndexShortWords. Returns NULL if a shard fails to load
+ShardSet* SH_Start(const char* files[], int file_count, int shard_count, BOOLEAN short_words);
+
+// Run a query on every shard and write the best documents, highest score first, to out.
+// Returns how many were written, or -1 if no shard answered (report says why)
+int SH_Search(ShardSet* set, const char* query, int timeout_ms, ShardHit* out, int max_out, ShardReport* report);
+
+// Number of shards, and the process of one of them
+int SH_ShardCount(const ShardSet* set);
+pid_t SH_ShardPid(const ShardSet* set, int shard);
+
+// Stop the shards and free the set
+void SH_Stop(ShardSet* set);
+
+#endif
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <signal.h>
+#include "Shard.h"
+#include "Query.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+#define BOOKS 4
+
+/* Coincidencias y primera coincidencia por documento con un solo indice */
+static int matches_in(const InvertedIndex* idx, const char* query, int doc, printData* first) {
+    char text[256], error[QUERY_ERROR_LENGTH];
+    snprintf(text, sizeof(text), "%s", query);
+    QueryStream* stream = QY_OpenText(idx, text, error, sizeof(error));
+    assert(stream != NULL);
+    printData result;
+    int count = 0;
+    while (QY_StreamNext(stream, &result)) {
+        if (result.doc_id != doc) continue;
+        if (count++ == 0) *first = result;
+    }
+    QY_StreamClose(stream);
+    return count;
+}
+
+/* BM25 de un documento calculado sobre un solo indice, como referencia */
+static double bm25(const InvertedIndex* idx, const char* query, int doc) {
+    char text[256], error[QUERY_ERROR_LENGTH];
+    char* words[MAX_QUERY_WORDS];
+    snprintf(text, sizeof(text), "%s", query);
+    QueryStream* stream = QY_OpenText(idx, text, error, sizeof(error));
+    int word_count = QY_StreamTerms(stream, words, MAX_QUERY_WORDS);
+
+    long tokens = 0;
+    for (int d = 0; d <= idx->last_file_index; ++d) tokens += (long)arraylist_size(idx->token_offsets[d]);
+    int documents = idx->last_file_index + 1;
+    double length = (double)arraylist_size(idx->token_offsets[doc]);
+    double norm = SHARD_BM25_K1 * (1 - SHARD_BM25_B + SHARD_BM25_B * length / ((double)tokens / documents));
+
+    double score = 0;
+    for (int w = 0; w < word_count; ++w) {
+        const OccurrenceList* list = II_Postings(idx, words[w]);
+        const Occurrence* occurrence = list ? FindOccurrenceByDocId(list, doc) : NULL;
+        if (!occurrence) continue;
+        double tf = (double)GetOrdinalCount(occurrence);
+        double idf = log(1.0 + (documents - list->count + 0.5) / (list->count + 0.5));
+        score += idf * tf * (SHARD_BM25_K1 + 1) / (tf + norm);
+    }
+    QY_StreamClose(stream);
+    return score;
+}
+
+/* Los shards deben dar lo mismo que un indice con todos los libros */
+static void check_against(const InvertedIndex* idx, ShardSet* set, const char* query) {
+    ShardHit hits[BOOKS];
+    ShardReport report;
+    int count = SH_Search(set, query, SHARD_DEFAULT_TIMEOUT_MS, hits, BOOKS, &report);
+    assert(count >= 0 && report.answered == SH_ShardCount(set));
+
+    int expected = 0;
+    for (int doc = 0; doc < BOOKS; ++doc) {
+        printData first = { 0 };
+        int matches = matches_in(idx, query, doc, &first);
+        if (matches == 0) continue;
+        expected++;
+        int h = 0;
+        while (h < count && hits[h].file != doc) h++;
+        assert(h < count);
+        assert(hits[h].shard == doc % SH_ShardCount(set));
+        assert(hits[h].matches == matches);
+        assert(hits[h].first_line == first.first_occurrence_line && hits[h].last_line == first.last_occurrence_line);
+        assert(fabs(hits[h].score - bm25(idx, query, doc)) < 1e-9);
+    }
+    assert(count == expected && report.documents == expected);
+    for (int h = 1; h < count; ++h) assert(hits[h - 1].score >= hits[h].score);
+}
+
+int main(void) {
+    InvertedIndex* idx = II_Create();
+    for (int b = 0; b < BOOKS; ++b) assert(II_LoadFile(idx, books[b]) == b);
+
+    ShardSet* set = SH_Start(books, BOOKS, 2, FALSE);
+    assert(set != NULL && SH_ShardCount(set) == 2);
+
+    // Scatter-gather: mismos documentos, coincidencias y puntajes que un solo indice
+    check_against(idx, set, "tesoro");
+    check_against(idx, set, "isla, tesoro");
+    check_against(idx, set, "sancho AND (rucio OR asno) NOT dulcinea");
+    check_against(idx, set, "\"en un lugar de la mancha\"");
+    check_against(idx, set, "palabrainexistente");
+
+    // Errores de sintaxis: todos los shards lo rechazan
+    ShardHit hits[BOOKS];
+    ShardReport report;
+    assert(SH_Search(set, "sancho AND (", 500, hits, BOOKS, &report) == -1);
+    assert(report.status[0] == SHARD_ERROR && report.status[1] == SHARD_ERROR && strstr(report.error, "expected"));
+
+    // Timeout: un shard detenido no frena la consulta, solo faltan sus documentos
+    int full = SH_Search(set, "tesoro", 500, hits, BOOKS, &report);
+    kill(SH_ShardPid(set, 1), SIGSTOP);
+    int partial = SH_Search(set, "tesoro", 200, hits, BOOKS, &report);
+    assert(report.status[0] == SHARD_OK && report.status[1] == SHARD_TIMEOUT && report.answered == 1);
+    assert(partial > 0 && partial < full && report.latency_us[1] >= 200e3);
+    for (int h = 0; h < partial; ++h) assert(hits[h].file % 2 == 0);
+
+    // al continuar, la respuesta atrasada se descarta y la siguiente consulta es completa
+    kill(SH_ShardPid(set, 1), SIGCONT);
+    check_against(idx, set, "tesoro");
+
+    // Un shard caido: resultados parciales
+    kill(SH_ShardPid(set, 1), SIGKILL);
+    assert(SH_Search(set, "tesoro", 500, hits, BOOKS, &report) == partial);
+    assert(report.status[1] == SHARD_DOWN && report.answered == 1);
+    SH_Stop(set);
+
+    // Mas archivos que MAX_OPEN_FILES: cada libro tres veces en tres shards
+    const char* many[3 * BOOKS];
+    for (int i = 0; i < 3 * BOOKS; ++i) many[i] = books[i % BOOKS];
+    assert(SH_Start(many, 3 * BOOKS, 2, FALSE) == NULL);   // seis por shard no entran
+    set = SH_Start(many, 3 * BOOKS, 3, FALSE);
+    assert(set != NULL);
+    ShardHit all[3 * BOOKS];
+    int count = SH_Search(set, "sancho", SHARD_DEFAULT_TIMEOUT_MS, all, 3 * BOOKS, &report);
+    assert(count == 3 && report.answered == 3);
+    for (int h = 0; h < count; ++h) {
+        assert(all[h].file % BOOKS == 0 && all[h].matches == II_TermCount(idx, "sancho"));
+    }
+    SH_Stop(set);
+
+    II_Destroy(idx);
+    printf("Shard tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Snapshot.h"
+
+// One published index
+typedef struct _Snapshot {
+    InvertedIndex* idx;
+    long version;
+    unsigned long retired_epoch;   // epoch that started when it was replaced
+    struct _Snapshot* next;        // retired list
+} Snapshot;
+
+struct _SnapshotReader {
+    _Alignas(64) atomic_ulong epoch;   // epoch it entered in, 0 while outside
+    atomic_int used;
+    IndexHandle* handle;
+};
+
+struct _IndexHandle {
+    _Atomic(Snapshot*) current;
+    atomic_ulong epoch;
+    atomic_long pending;           // length of retired, read by SN_Leave without the lock
+    SnapshotReader readers[SNAPSHOT_MAX_READERS];
+    pthread_mutex_t lock;          // publishing, the retired list, the rebuild and the counters
+    Snapshot* retired;
+    SN_Builder builder;
+    void* context;
+    pthread_t rebuild_thread;
+    BOOLEAN rebuilding;
+    BOOLEAN joinable;              // rebuild_thread hasn't been joined
+    BOOLEAN rebuild_published;     // outcome of the last rebuild
+    long published;
+    long freed;
+    long rebuilds;
+    long failed_rebuilds;
+    double last_rebuild_ms;
+};
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+// Unlink the retired snapshots no reader can hold (lock held); they are freed by the caller
+// after unlocking, so readers leaving meanwhile don't wait for II_Destroy
+static Snapshot* take_reclaimable(IndexHandle* handle) {
+    unsigned long oldest = ULONG_MAX;
+    for (int r = 0; r < SNAPSHOT_MAX_READERS; ++r) {
+        unsigned long epoch = atomic_load(&handle->readers[r].epoch);
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+
+    Snapshot* reclaimable = NULL;
+    Snapshot** link = &handle->retired;
+    while (*link) {
+        Snapshot* snapshot = *link;
+        if (snapshot->retired_epoch <= oldest) {
+            *link = snapshot->next;
+            snapshot->next = reclaimable;
+            reclaimable = snapshot;
+            handle->freed++;
+            atomic_fetch_sub(&handle->pending, 1);
+        } else {
+            link = &snapshot->next;
+        }
+    }
+    return reclaimable;
+}
+
+static int free_snapshots(Snapshot* snapshot) {
+    int count = 0;
+    while (snapshot) {
+        Snapshot* next = snapshot->next;
+        II_Destroy(snapshot->idx);
+        free(snapshot);
+        snapshot = next;
+        count++;
+    }
+    return count;
+}
+
+IndexHandle* SN_Create(InvertedIndex* initial, SN_Builder builder, void* context) {
+    if (!initial) return NULL;
+    size_t size = (sizeof(IndexHandle) + 63) / 64 * 64;
+    IndexHandle* handle = aligned_alloc(64, size);
+    Snapshot* first = malloc(sizeof(Snapshot));
+    if (!handle || !first) {
+        free(handle);
+        free(first);
+        return NULL;
+    }
+    memset(handle, 0, size);
+    first->idx = initial;
+    first->version = 1;
+    first->retired_epoch = 0;
+    first->next = NULL;
+
+    atomic_init(&handle->current, first);
+    atomic_init(&handle->epoch, 1);
+    atomic_init(&handle->pending, 0);
+    for (int r = 0; r < SNAPSHOT_MAX_READERS; ++r) {
+        atomic_init(&handle->readers[r].epoch, 0);
+        atomic_init(&handle->readers[r].used, 0);
+        handle->readers[r].handle = handle;
+    }
+    pthread_mutex_init(&handle->lock, NULL);
+    handle->builder = builder;
+    handle->context = context;
+    return handle;
+}
+
+void SN_Destroy(IndexHandle* handle) {
+    if (!handle) return;
+    SN_WaitRebuild(handle);
+    free_snapshots(handle->retired);
+    free_snapshots(atomic_load(&handle->current));
+    pthread_mutex_destroy(&handle->lock);
+    free(handle);
+}
+
+SnapshotReader* SN_Register(IndexHandle* handle) {
+    if (!handle) return NULL;
+    for (int r = 0; r < SNAPSHOT_MAX_READERS; ++r) {
+        int unused = 0;
+        if (atomic_compare_exchange_strong(&handle->readers[r].used, &unused, 1)) return &handle->readers[r];
+    }
+    return NULL;
+}
+
+void SN_Unregister(SnapshotReader* reader) {
+    if (!reader) return;
+    atomic_store(&reader->epoch, 0);
+    atomic_store(&reader->used, 0);
+}
+
+const InvertedIndex* SN_Enter(SnapshotReader* reader) {
+    IndexHandle* handle = reader->handle;
+    // the epoch is visible before the pointer is read: a publisher that doesn't see it yet
+    // has already swapped, so this reader can only get the new snapshot
+    atomic_store(&reader->epoch, atomic_load(&handle->epoch));
+    return atomic_load(&handle->current)->idx;
+}
+
+void SN_Leave(SnapshotReader* reader) {
+    IndexHandle* handle = reader->handle;
+    atomic_store(&reader->epoch, 0);
+    if (atomic_load(&handle->pending) == 0) return;
+
+    pthread_mutex_lock(&handle->lock);
+    Snapshot* reclaimable = take_reclaimable(handle);
+    pthread_mutex_unlock(&handle->lock);
+    free_snapshots(reclaimable);
+}
+
+long SN_Publish(IndexHandle* handle, InvertedIndex* idx) {
+    if (!handle || !idx) return -1;
+    Snapshot* snapshot = malloc(sizeof(Snapshot));
+    if (!snapshot) return -1;
+    snapshot->idx = idx;
+    snapshot->retired_epoch = 0;
+    snapshot->next = NULL;
+
+    pthread_mutex_lock(&handle->lock);
+    long version = atomic_load(&handle->current)->version + 1;
+    snapshot->version = version;
+    Snapshot* old = atomic_exchange(&handle->current, snapshot);
+    old->retired_epoch = atomic_fetch_add(&handle->epoch, 1) + 1;
+    old->next = handle->retired;
+    handle->retired = old;
+    atomic_fetch_add(&handle->pending, 1);
+    handle->published++;
+    Snapshot* reclaimable = take_reclaimable(handle);
+    pthread_mutex_unlock(&handle->lock);
+
+    // snapshot itself may already be retired and freed by a later publish
+    free_snapshots(reclaimable);
+    return version;
+}
+
+static void* rebuild_main(void* arg) {
+    IndexHandle* handle = arg;
+    double start = now_ms();
+    InvertedIndex* idx = handle->builder(handle->context);
+    double elapsed = now_ms() - start;
+    BOOLEAN published = idx != NULL && SN_Publish(handle, idx) >= 0;
+    if (idx && !published) II_Destroy(idx);
+
+    pthread_mutex_lock(&handle->lock);
+    handle->rebuilds++;
+    if (!published) handle->failed_rebuilds++;
+    handle->last_rebuild_ms = elapsed;
+    handle->rebuild_published = published;
+    handle->rebuilding = FALSE;
+    pthread_mutex_unlock(&handle->lock);
+    return NULL;
+}
+
+int SN_Rebuild(IndexHandle* handle) {
+    if (!handle || !handle->builder) return -1;
+    pthread_mutex_lock(&handle->lock);
+    if (handle->rebuilding) {
+        pthread_mutex_unlock(&handle->lock);
+        return -1;
+    }
+    // the previous rebuild is over (it released the lock for the last time)
+    if (handle->joinable) pthread_join(handle->rebuild_thread, NULL);
+    handle->joinable = FALSE;
+    int result = pthread_create(&handle->rebuild_thread, NULL, rebuild_main, handle) == 0 ? 0 : -1;
+    if (result == 0) handle->rebuilding = handle->joinable = TRUE;
+    pthread_mutex_unlock(&handle->lock);
+    return result;
+}
+
+BOOLEAN SN_WaitRebuild(IndexHandle* handle) {
+    if (!handle) return FALSE;
+    pthread_mutex_lock(&handle->lock);
+    BOOLEAN joinable = handle->joinable;
+    pthread_t thread = handle->rebuild_thread;
+    handle->joinable = FALSE;
+    pthread_mutex_unlock(&handle->lock);
+    if (!joinable) return FALSE;
+
+    pthread_join(thread, NULL);
+    pthread_mutex_lock(&handle->lock);
+    BOOLEAN published = handle->rebuild_published;
+    pthread_mutex_unlock(&handle->lock);
+    return published;
+}
+
+int SN_Reclaim(IndexHandle* handle) {
+    if (!handle) return 0;
+    pthread_mutex_lock(&handle->lock);
+    Snapshot* reclaimable = take_reclaimable(handle);
+    pthread_mutex_unlock(&handle->lock);
+    return free_snapshots(reclaimable);
+}
+
+void SN_GetStats(IndexHandle* handle, SnapshotStats* stats) {
+    if (!handle || !stats) return;
+    pthread_mutex_lock(&handle->lock);
+    stats->version = atomic_load(&handle->current)->version;
+    stats->published = handle->published;
+    stats->freed = handle->freed;
+    stats->pending = atomic_load(&handle->pending);
+    stats->rebuilds = handle->rebuilds;
+    stats->failed_rebuilds = handle->failed_rebuilds;
+    stats->last_rebuild_ms = handle->last_rebuild_ms;
+    stats->rebuilding = handle->rebuilding;
+    pthread_mutex_unlock(&handle->lock);
+}
@@ -0,0 +1,73 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "InvertedIndex.h"
+
+#define SNAPSHOT_MAX_READERS 64   // threads registered on a handle at the same time
+
+/*
+ * Zero-downtime rebuilds: an IndexHandle owns the current index (a snapshot) and readers
+ * pin it only while a query runs:
+ *
+ *   reader:    idx = SN_Enter(reader); ...query idx...; SN_Leave(reader);
+ *   publisher: SN_Publish(handle, new_idx)   or SN_Rebuild in a background thread
+ *
+ * Publishing is one atomic pointer swap: queries that entered before it finish on the old
+ * snapshot, queries entering after it see the new one, and nobody waits. Reclamation is
+ * epoch based: entering stores the current epoch in the reader's slot (0 is idle) and
+ * each swap advances the epoch, so a snapshot retired at epoch E can be freed once no slot
+ * holds an epoch below E. The last reader to leave frees it (SN_Leave), as does the next
+ * publish. Entering and leaving are a few atomic loads and stores, without locks.
+ *
+ * A reader (SN_Register) belongs to one thread and can't enter twice without leaving.
+ */
+
+// Builds a complete new index for SN_Rebuild, or returns NULL on failure
+typedef InvertedIndex* (*SN_Builder)(void* context);
+
+typedef struct _SnapshotStats {
+    long version;              // of the current snapshot, the first one is 1
+    long published;
+    long freed;                // retired snapshots freed
+    long pending;              // retired snapshots still pinned by a reader
+    long rebuilds;             // finished by SN_Rebuild (failed ones included)
+    long failed_rebuilds;
+    double last_rebuild_ms;    // building the last rebuilt index
+    BOOLEAN rebuilding;
+} SnapshotStats;
+
+typedef struct _IndexHandle IndexHandle;
+typedef struct _SnapshotReader SnapshotReader;
+
+// Take ownership of a loaded index as the first snapshot. builder (may be NULL) is what
+// SN_Rebuild runs. Returns NULL if allocation fails
+IndexHandle* SN_Create(InvertedIndex* initial, SN_Builder builder, void* context);
+
+// Wait for a running rebuild and free every snapshot; no reader may be inside
+void SN_Destroy(IndexHandle* handle);
+
+// Claim a reader slot for the calling thread, NULL if SNAPSHOT_MAX_READERS are taken
+SnapshotReader* SN_Register(IndexHandle* handle);
+void SN_Unregister(SnapshotReader* reader);
+
+// Pin the current snapshot until SN_Leave; the index stays valid (and unchanged) until then
+const InvertedIndex* SN_Enter(SnapshotReader* reader);
+void SN_Leave(SnapshotReader* reader);
+
+// Make idx (owned by the handle from now on) the current snapshot and retire the previous
+// one. Returns the new version, or -1 if idx is NULL or allocation fails (idx stays the caller's)
+long SN_Publish(IndexHandle* handle, InvertedIndex* idx);
+
+// Start building a new index with the handle's builder in a background thread and publish
+// it when complete. Returns 0, or -1 without a builder or while a rebuild is running
+int SN_Rebuild(IndexHandle* handle);
+
+// Wait for the running rebuild, if any. Returns TRUE if it published a new snapshot
+BOOLEAN SN_WaitRebuild(IndexHandle* handle);
+
+// Free the retired snapshots no reader holds; returns how many
+int SN_Reclaim(IndexHandle* handle);
+
+void SN_GetStats(IndexHandle* handle, SnapshotStats* stats);
+
+#endif
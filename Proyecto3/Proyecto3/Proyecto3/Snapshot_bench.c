@@ -0,0 +1,205 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Snapshot.h"
+
+/*
+ * Latencia de las consultas mientras se reconstruye el indice, con hilos que consultan
+ * sin pausa durante REBUILDS recargas de los libros:
+ *   - sin recargas, como referencia
+ *   - con SN_Rebuild: el indice nuevo se arma en otro hilo y se publica con un swap
+ *   - destruyendo y recargando bajo un rwlock, que es lo que habia que hacer antes
+ * Se informan p50, p99 y maximo exactos (ordenando todas las latencias).
+ *
+ *   Snapshot_bench [hilos]     (por defecto 2)
+ */
+
+#define REBUILDS 5
+#define MAX_THREADS 16
+#define MAX_SAMPLES 2000000
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+#define BOOKS 4
+
+static const char* queries[] = {
+    "quijote,sancho", "Dulcinea,Toboso", "caballero,andante", "escudero,sancho,rucio",
+    "\"en un lugar de la Mancha\"", "isla,tesoro", "capitan,barco", "lobos,monte",
+    "gobernador,insula", "\"dijo Sancho\"", "libros,caballerias", "mar,playa,arena"
+};
+static const int query_count = sizeof(queries) / sizeof(queries[0]);
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+typedef enum { STEADY, SWAP, STOP_THE_WORLD } Mode;
+
+typedef struct {
+    Mode mode;
+    IndexHandle* handle;
+    InvertedIndex* idx;          /* STOP_THE_WORLD: el indice, protegido por lock */
+    pthread_rwlock_t lock;
+    atomic_int stop;
+    double* samples;             /* latencias en us de todos los hilos */
+    atomic_long sample_count;
+} Bench;
+
+static double now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+static InvertedIndex* load_books(void* context) {
+    (void)context;
+    InvertedIndex* idx = II_Create();
+    for (int b = 0; b < BOOKS; ++b) {
+        if (II_LoadFile(idx, books[b]) < 0) {
+            II_Destroy(idx);
+            return NULL;
+        }
+    }
+    return idx;
+}
+
+/* Todos los matches de una consulta de proximidad o frase */
+static long run_query(const InvertedIndex* idx, const char* text) {
+    char buffer[256];
+    char* words[MAX_QUERY_WORDS];
+    int word_count = 0;
+    SearchCursor* cursor;
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    if (buffer[0] == '"') {
+        char* phrase = buffer + 1;
+        phrase[strcspn(phrase, "\"")] = '\0';
+        cursor = II_PhraseOpen(idx, phrase);
+    } else {
+        char* save = NULL;
+        for (char* tok = strtok_r(buffer, ",", &save); tok && word_count < MAX_QUERY_WORDS; tok = strtok_r(NULL, ",", &save)) {
+            words[word_count++] = tok;
+        }
+        cursor = II_SearchOpen(idx, words, word_count, DEFAULT_WORD_WINDOW);
+    }
+    long found = 0;
+    printData result;
+    while (II_SearchNext(cursor, &result)) found++;
+    II_SearchClose(cursor);
+    return found;
+}
+
+static void* query_main(void* arg) {
+    Bench* bench = arg;
+    SnapshotReader* reader = bench->handle ? SN_Register(bench->handle) : NULL;
+    for (long q = 0; !atomic_load(&bench->stop); ++q) {
+        const char* text = queries[q % query_count];
+        double start = now_us();
+        if (bench->mode == STOP_THE_WORLD) {
+            pthread_rwlock_rdlock(&bench->lock);
+            run_query(bench->idx, text);
+            pthread_rwlock_unlock(&bench->lock);
+        } else {
+            run_query(SN_Enter(reader), text);
+            SN_Leave(reader);
+        }
+        long slot = atomic_fetch_add(&bench->sample_count, 1);
+        if (slot < MAX_SAMPLES) bench->samples[slot] = now_us() - start;
+    }
+    SN_Unregister(reader);
+    return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Consultas con threads hilos mientras se hacen las recargas del modo dado */
+static void run(Mode mode, const char* name, int threads, Bench* bench, double steady_ms) {
+    bench->mode = mode;
+    atomic_store(&bench->stop, 0);
+    atomic_store(&bench->sample_count, 0);
+    pthread_t workers[MAX_THREADS];
+    for (int t = 0; t < threads; ++t) pthread_create(&workers[t], NULL, query_main, bench);
+
+    double start = now_us();
+    if (mode == STEADY) {
+        struct timespec pause = { (time_t)(steady_ms / 1000), (long)(steady_ms * 1e6) % 1000000000L };
+        nanosleep(&pause, NULL);
+    }
+    for (int r = 0; mode != STEADY && r < REBUILDS; ++r) {
+        if (mode == SWAP) {
+            SN_Rebuild(bench->handle);
+            SN_WaitRebuild(bench->handle);
+        } else {
+            pthread_rwlock_wrlock(&bench->lock);
+            II_Destroy(bench->idx);
+            bench->idx = load_books(NULL);
+            pthread_rwlock_unlock(&bench->lock);
+        }
+    }
+    double elapsed_ms = (now_us() - start) / 1e3;
+    atomic_store(&bench->stop, 1);
+    for (int t = 0; t < threads; ++t) pthread_join(workers[t], NULL);
+
+    long count = atomic_load(&bench->sample_count);
+    if (count > MAX_SAMPLES) count = MAX_SAMPLES;
+    qsort(bench->samples, count, sizeof(double), compare_doubles);
+    printf("%-22s %9.0f %8ld %10.1f %10.1f %10.1f %12.1f\n", name, elapsed_ms, count,
+           count ? bench->samples[count / 2] : 0, count ? bench->samples[(long)(count * 0.99)] : 0,
+           count ? bench->samples[count - 1] : 0, elapsed_ms > 0 ? count / elapsed_ms * 1e3 : 0);
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 2;
+    if (threads < 1 || threads > MAX_THREADS) {
+        printf("Usage: %s [hilos (1..%d)]\n", argv[0], MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+    Bench bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.samples = malloc(sizeof(double) * MAX_SAMPLES);
+    // con preferencia de escritura, si no las consultas nuevas demoran la recarga indefinidamente
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&bench.lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    bench.handle = SN_Create(load_books(NULL), load_books, NULL);
+    bench.idx = load_books(NULL);
+    if (!bench.samples || !bench.handle || !bench.idx) return EXIT_FAILURE;
+
+    // cuanto tarda una recarga, para que la referencia dure lo mismo
+    double start = now_us();
+    II_Destroy(load_books(NULL));
+    double reload_ms = (now_us() - start) / 1e3;
+
+    printf("\n%d hilos consultando, %d recargas de %d libros (%.0f ms cada una sin consultas)\n",
+           threads, REBUILDS, BOOKS, reload_ms);
+    printf("%-22s %9s %8s %10s %10s %10s %12s\n", "", "ms", "consultas", "p50 us", "p99 us", "max us", "consultas/s");
+    run(STEADY, "sin recargas", threads, &bench, reload_ms * REBUILDS);
+    run(SWAP, "swap de snapshot", threads, &bench, 0);
+    run(STOP_THE_WORLD, "destruir y recargar", threads, &bench, 0);
+
+    SnapshotStats stats;
+    SN_GetStats(bench.handle, &stats);
+    printf("\nsnapshots publicados %ld, liberados %ld, ultimo rebuild %.1f ms\n", stats.published, stats.freed,
+           stats.last_rebuild_ms);
+    SN_Destroy(bench.handle);
+    II_Destroy(bench.idx);
+    pthread_rwlock_destroy(&bench.lock);
+    free(bench.samples);
+    return EXIT_SUCCESS;
+}
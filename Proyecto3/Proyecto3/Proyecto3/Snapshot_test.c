@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Snapshot.h"
+
+#define STRESS_THREADS 4
+#define STRESS_PUBLISHES 12
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static InvertedIndex* load_book(const char* name) {
+    InvertedIndex* idx = II_Create();
+    if (II_LoadFile(idx, name) < 0) {
+        II_Destroy(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+/* Builder de SN_Rebuild: carga el libro que diga el contexto */
+static InvertedIndex* build_book(void* context) {
+    return load_book(*(const char**)context);
+}
+
+static SnapshotStats stats_of(IndexHandle* handle) {
+    SnapshotStats stats;
+    SN_GetStats(handle, &stats);
+    return stats;
+}
+
+typedef struct {
+    IndexHandle* handle;
+    long expected[2];     /* apariciones de "como" en cada uno de los dos libros publicados */
+    atomic_int stop;
+    atomic_long queries;
+} Stress;
+
+/* Consultas sin pausa; cada una ve un indice completo, de uno u otro libro */
+static void* stress_reader(void* arg) {
+    Stress* stress = arg;
+    SnapshotReader* reader = SN_Register(stress->handle);
+    assert(reader != NULL);
+    char* words[] = { "como", "para" };
+    while (!atomic_load(&stress->stop)) {
+        const InvertedIndex* idx = SN_Enter(reader);
+        long count = II_TermCount(idx, "como");
+        assert(count == stress->expected[0] || count == stress->expected[1]);
+        int found = 0;
+        free(II_Search(idx, words, 2, &found));
+        assert(II_TermCount(idx, "como") == count);   /* el indice no cambia mientras se lo usa */
+        SN_Leave(reader);
+        atomic_fetch_add(&stress->queries, 1);
+    }
+    SN_Unregister(reader);
+    return NULL;
+}
+
+int main(void) {
+    const char* book = "lobo.txt";
+    InvertedIndex* first = load_book("tesoro.txt");
+    InvertedIndex* second = load_book("DonQuijote.txt");
+    assert(first && second);
+    long sancho = II_TermCount(second, "sancho");
+    assert(II_TermCount(first, "sancho") != sancho);
+
+    IndexHandle* handle = SN_Create(first, build_book, &book);
+    assert(handle != NULL && stats_of(handle).version == 1);
+
+    // Una consulta que entro antes del swap sigue sobre el indice viejo; las nuevas ven el nuevo
+    SnapshotReader* old_reader = SN_Register(handle);
+    SnapshotReader* new_reader = SN_Register(handle);
+    assert(old_reader && new_reader && old_reader != new_reader);
+    const InvertedIndex* pinned = SN_Enter(old_reader);
+    assert(pinned == first);
+    assert(SN_Publish(handle, second) == 2);
+    assert(SN_Enter(new_reader) == second);
+    SN_Leave(new_reader);
+    assert(stats_of(handle).pending == 1 && stats_of(handle).freed == 0);
+    assert(SN_Reclaim(handle) == 0);
+    assert(II_TermCount(pinned, "sancho") == II_TermCount(first, "sancho"));
+    // el ultimo lector en salir libera el indice viejo
+    SN_Leave(old_reader);
+    SnapshotStats stats = stats_of(handle);
+    assert(stats.pending == 0 && stats.freed == 1 && stats.published == 1);
+    assert(SN_Publish(handle, NULL) == -1);
+
+    // Rebuild en otro hilo: publica al terminar; uno que falla deja el indice como estaba
+    assert(SN_Rebuild(handle) == 0);
+    assert(SN_WaitRebuild(handle) == TRUE);
+    stats = stats_of(handle);
+    assert(stats.version == 3 && stats.rebuilds == 1 && !stats.rebuilding && stats.freed == 2);
+    const InvertedIndex* rebuilt = SN_Enter(new_reader);
+    assert(II_TermCount(rebuilt, "sancho") != sancho);
+    SN_Leave(new_reader);
+    book = "no_existe.txt";
+    assert(SN_Rebuild(handle) == 0);
+    assert(SN_WaitRebuild(handle) == FALSE);
+    stats = stats_of(handle);
+    assert(stats.version == 3 && stats.failed_rebuilds == 1);
+    assert(SN_WaitRebuild(handle) == FALSE);   // nada corriendo
+
+    // Los lugares para lectores son limitados y se reutilizan
+    SnapshotReader* readers[SNAPSHOT_MAX_READERS];
+    int registered = 0;
+    while (registered < SNAPSHOT_MAX_READERS && (readers[registered] = SN_Register(handle)) != NULL) registered++;
+    assert(registered == SNAPSHOT_MAX_READERS - 2);
+    assert(SN_Register(handle) == NULL);
+    SN_Unregister(readers[0]);
+    assert(SN_Register(handle) == readers[0]);
+    for (int r = 0; r < registered; ++r) SN_Unregister(readers[r]);
+    SN_Unregister(old_reader);
+    SN_Unregister(new_reader);
+
+    // Lectores continuos mientras se publican indices nuevos
+    Stress stress = { handle, { 0, 0 }, 0, 0 };
+    InvertedIndex* probe = load_book("tesoro.txt");
+    stress.expected[0] = II_TermCount(probe, "como");
+    II_Destroy(probe);
+    probe = load_book("lobo.txt");
+    stress.expected[1] = II_TermCount(probe, "como");
+    assert(SN_Publish(handle, probe) == 4);
+    pthread_t threads[STRESS_THREADS];
+    for (int t = 0; t < STRESS_THREADS; ++t) assert(pthread_create(&threads[t], NULL, stress_reader, &stress) == 0);
+    for (int p = 0; p < STRESS_PUBLISHES; ++p) {
+        book = p % 2 ? "lobo.txt" : "tesoro.txt";
+        assert(SN_Rebuild(handle) == 0);
+        assert(SN_WaitRebuild(handle) == TRUE);
+    }
+    atomic_store(&stress.stop, 1);
+    for (int t = 0; t < STRESS_THREADS; ++t) pthread_join(threads[t], NULL);
+    SN_Reclaim(handle);
+    stats = stats_of(handle);
+    assert(stats.version == 4 + STRESS_PUBLISHES && stats.pending == 0 && stats.freed == stats.published);
+    assert(atomic_load(&stress.queries) > 0);
+
+    SN_Destroy(handle);
+    printf("Snapshot tests passed.\n");
+    return EXIT_SUCCESS;
+}
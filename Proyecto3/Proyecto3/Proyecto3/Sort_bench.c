@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ArrayList/arraylist.h"
+
+/*
+ * Ordenamiento de claves enteras: el mergesort de arraylist_sort (void* con Comparator)
+ * contra qsort y arraylist_sort_u64 con un hilo y en paralelo, el mejor de RUNS.
+ * Las claves tienen la forma de las entradas de una busqueda por proximidad
+ * (ordinal << 6 | palabra, con ordinales de un libro largo) y, aparte, 64 bits al azar,
+ * donde el radix sort no se ahorra ninguna pasada.
+ *
+ *   Sort_bench [hilos]     (por defecto ARRAYLIST_SORT_MAX_THREADS)
+ */
+
+#define RUNS 5
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static unsigned long seed = 99;
+
+static uint64_t next_random(void) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return seed >> 11;
+}
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int compare_boxed(const void* a, const void* b) {
+    uintptr_t pa = (uintptr_t)a, pb = (uintptr_t)b;
+    return (pa < pb) ? -1 : (pa > pb);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t pa = *(const uint64_t*)a, pb = *(const uint64_t*)b;
+    return (pa < pb) ? -1 : (pa > pb);
+}
+
+typedef enum { MERGESORT, QSORT, RADIX_SERIAL, RADIX_PARALLEL } Method;
+
+/* Mejor tiempo de una forma de ordenar sobre una copia de keys; deja el resultado en out */
+static double run(Method method, const uint64_t* keys, size_t count, uint64_t* out, int threads) {
+    ArrayList* list = arraylist_create(count, sizeof(void*));
+    uint64_t* scratch = malloc(sizeof(uint64_t) * count);
+    double best = -1;
+    for (int r = 0; r < RUNS; ++r) {
+        double start, elapsed;
+        if (method == MERGESORT) {
+            arraylist_clear(list);
+            for (size_t i = 0; i < count; ++i) {
+                void* boxed = (void*)(uintptr_t)keys[i];
+                arraylist_add(list, &boxed);
+            }
+            start = now_ms();
+            arraylist_sort(list, compare_boxed);
+            elapsed = now_ms() - start;
+            memcpy(out, list->data, sizeof(uint64_t) * count);
+        } else {
+            memcpy(out, keys, sizeof(uint64_t) * count);
+            start = now_ms();
+            if (method == QSORT) qsort(out, count, sizeof(uint64_t), compare_u64);
+            else arraylist_sort_u64(out, count, scratch, method == RADIX_SERIAL ? 1 : threads);
+            elapsed = now_ms() - start;
+        }
+        if (best < 0 || elapsed < best) best = elapsed;
+    }
+    arraylist_destroy(list);
+    free(scratch);
+    return best;
+}
+
+static void bench(const char* shape, size_t count, int threads, int full_width) {
+    uint64_t* keys = malloc(sizeof(uint64_t) * count);
+    uint64_t* expected = malloc(sizeof(uint64_t) * count);
+    uint64_t* out = malloc(sizeof(uint64_t) * count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = full_width ? next_random() << 11 ^ next_random() : (next_random() % 400000) << 6 | (next_random() % 4);
+    }
+
+    double times[4];
+    times[MERGESORT] = run(MERGESORT, keys, count, expected, threads);
+    for (int m = QSORT; m <= RADIX_PARALLEL; ++m) {
+        times[m] = run((Method)m, keys, count, out, threads);
+        if (memcmp(out, expected, sizeof(uint64_t) * count) != 0) {
+            fprintf(stderr, "%s, %zu claves: el metodo %d no coincide con el mergesort\n", shape, count, m);
+            exit(EXIT_FAILURE);
+        }
+    }
+    printf("%-12s %9zu %10.2f %10.2f %10.2f %10.2f %8.1fx\n", shape, count, times[MERGESORT], times[QSORT],
+           times[RADIX_SERIAL], times[RADIX_PARALLEL], times[MERGESORT] / times[RADIX_SERIAL]);
+    free(keys);
+    free(expected);
+    free(out);
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : ARRAYLIST_SORT_MAX_THREADS;
+    if (threads < 1 || threads > ARRAYLIST_SORT_MAX_THREADS) {
+        printf("Usage: %s [hilos (1..%d)]\n", argv[0], ARRAYLIST_SORT_MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    size_t sizes[] = { 1000, 50000, 1000000, 4000000 };
+    printf("tiempos en ms, paralelo con %d hilos\n", threads);
+    printf("%-12s %9s %10s %10s %10s %10s %9s\n", "claves", "cantidad", "mergesort", "qsort", "radix", "paralelo", "vs merge");
+    for (int s = 0; s < 4; ++s) bench("proximidad", sizes[s], threads, 0);
+    for (int s = 0; s < 4; ++s) bench("64 bits", sizes[s], threads, 1);
+    return EXIT_SUCCESS;
+}
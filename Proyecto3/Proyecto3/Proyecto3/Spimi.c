@@ -0,0 +1,823 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Spimi.h"
+#include "HashTable.h"
+#include "FileManager.h"  // provides open_file
+
+#define VARINT_MAX 10
+#define INITIAL_POSTING_BYTES 8
+#define MALLOC_OVERHEAD 16    // bookkeeping of every allocation, counted against the budget
+// A new term costs its PostingBuffer, its hash cell and key, and its share of the buckets
+// (up to 4 pointers while an incremental resize keeps both arrays)
+#define TERM_OVERHEAD (sizeof(PostingBuffer) + sizeof(Celda) + 3 * MALLOC_OVERHEAD + 4 * sizeof(Celda*))
+
+// Posting stream of one term, while it is built, read from a run or merged
+typedef struct _PostingBuffer {
+    uint8_t* bytes;
+    size_t length;
+    size_t capacity;
+    long last_doc;          // -1 while empty
+    long last_ordinal;
+    long documents;
+    long count;
+} PostingBuffer;
+
+struct _SpimiBuilder {
+    char* temp_dir;
+    size_t budget;
+    BOOLEAN index_short_words;
+    BOOLEAN failed;         // a read or a spill failed, SP_Finish can't write a complete index
+    BOOLEAN finished;
+    HashTable dictionary;   // term -> PostingBuffer*
+    size_t memory;          // accounted bytes of the dictionary and its postings
+    char** runs;            // paths of the runs, in the order they were written
+    int run_count;
+    int run_capacity;
+    char** names;           // of the documents, by id
+    long* tokens;
+    int document_count;
+    int document_capacity;
+    char* block;            // read buffer, also used to copy files
+    SpimiStats stats;
+};
+
+struct _DiskIndex {
+    const uint8_t* data;
+    size_t size;
+    const SpimiHeader* header;
+    const DiskTerm* terms;
+    const char* strings;
+    const uint64_t* tokens;
+    const char** names;
+};
+
+// One run being merged: its current record
+typedef struct _RunReader {
+    FILE* file;
+    char* buffer;
+    int run;                        // position among the runs merged, breaks ties between equal terms
+    char term[MAX_WORD_LENGTH + 1];
+    PostingBuffer postings;
+} RunReader;
+
+// Where merged terms go: a run, or the postings and dictionary parts of the index
+typedef struct _MergeOutput {
+    FILE* run;
+    FILE* postings;
+    FILE* dictionary;
+    FILE* strings;
+    uint64_t postings_offset;
+    uint64_t strings_offset;
+    long terms;
+} MergeOutput;
+
+typedef struct _TermEntry {
+    const char* term;
+    PostingBuffer* postings;
+} TermEntry;
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int put_varint(uint8_t* out, uint64_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// Returns the bytes read, 0 if the varint doesn't end before end
+static int get_varint(const uint8_t* in, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    int shift = 0;
+    for (const uint8_t* p = in; p < end && shift < 64; ++p, shift += 7) {
+        result |= (uint64_t)(*p & 0x7F) << shift;
+        if (!(*p & 0x80)) {
+            *value = result;
+            return (int)(p - in + 1);
+        }
+    }
+    return 0;
+}
+
+static int write_varint(FILE* out, uint64_t value) {
+    uint8_t bytes[VARINT_MAX];
+    int n = put_varint(bytes, value);
+    return fwrite(bytes, 1, (size_t)n, out) == (size_t)n;
+}
+
+// Returns 1, 0 at EOF before the first byte, -1 if the varint is cut
+static int read_varint(FILE* in, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(in);
+        if (c == EOF) return shift == 0 ? 0 : -1;
+        result |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+static void reset_postings(PostingBuffer* buffer) {
+    buffer->length = 0;
+    buffer->last_doc = -1;
+    buffer->last_ordinal = 0;
+    buffer->documents = 0;
+    buffer->count = 0;
+}
+
+// Make room for extra more bytes; returns the bytes added to the capacity, or -1
+static long reserve_bytes(PostingBuffer* buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) return 0;
+    size_t capacity = buffer->capacity ? buffer->capacity : INITIAL_POSTING_BYTES;
+    while (capacity < buffer->length + extra) capacity *= 2;
+    uint8_t* bytes = realloc(buffer->bytes, capacity);
+    if (!bytes) return -1;
+    long grown = (long)(capacity - buffer->capacity);
+    buffer->bytes = bytes;
+    buffer->capacity = capacity;
+    return grown;
+}
+
+// Append an entry after the last one (a later document, or a later ordinal of the same one).
+// Returns the bytes added to the capacity, or -1
+static long append_entry(PostingBuffer* buffer, long doc, long ordinal) {
+    uint8_t entry[2 * VARINT_MAX];
+    int n;
+    if (doc == buffer->last_doc) {
+        n = put_varint(entry, (uint64_t)(ordinal - buffer->last_ordinal - 1) << 1);
+    } else {
+        n = put_varint(entry, (uint64_t)(doc - buffer->last_doc - 1) << 1 | 1);
+        n += put_varint(entry + n, (uint64_t)ordinal);
+    }
+    long grown = reserve_bytes(buffer, (size_t)n);
+    if (grown < 0) return -1;
+    memcpy(buffer->bytes + buffer->length, entry, (size_t)n);
+    buffer->length += (size_t)n;
+    if (doc != buffer->last_doc) buffer->documents++;
+    buffer->last_doc = doc;
+    buffer->last_ordinal = ordinal;
+    buffer->count++;
+    return grown;
+}
+
+// Append the stream of a run record. Only its first entry, written after document -1, is
+// encoded again; the rest is copied as is
+static int append_chunk(PostingBuffer* buffer, const PostingBuffer* chunk) {
+    const uint8_t* end = chunk->bytes + chunk->length;
+    uint64_t tag, ordinal;
+    int n = get_varint(chunk->bytes, end, &tag);
+    int m = n ? get_varint(chunk->bytes + n, end, &ordinal) : 0;
+    if (!m || !(tag & 1)) return 0;
+    long doc = (long)(tag >> 1);
+    if (doc < buffer->last_doc || (doc == buffer->last_doc && (long)ordinal <= buffer->last_ordinal)) return 0;
+
+    if (append_entry(buffer, doc, (long)ordinal) < 0) return 0;
+    size_t rest = chunk->length - (size_t)(n + m);
+    if (reserve_bytes(buffer, rest) < 0) return 0;
+    memcpy(buffer->bytes + buffer->length, chunk->bytes + n + m, rest);
+    buffer->length += rest;
+    // append_entry counted the first entry, and its document unless it continues the last one
+    buffer->documents += chunk->documents - 1;
+    buffer->count += chunk->count - 1;
+    buffer->last_doc = chunk->last_doc;
+    buffer->last_ordinal = chunk->last_ordinal;
+    return 1;
+}
+
+static int write_record(FILE* run, const char* term, const PostingBuffer* postings) {
+    size_t length = strlen(term);
+    return write_varint(run, length) && fwrite(term, 1, length, run) == length &&
+           write_varint(run, (uint64_t)postings->documents) && write_varint(run, (uint64_t)postings->count) &&
+           write_varint(run, (uint64_t)postings->last_doc) && write_varint(run, (uint64_t)postings->last_ordinal) &&
+           write_varint(run, postings->length) &&
+           fwrite(postings->bytes, 1, postings->length, run) == postings->length;
+}
+
+// Returns 1, 0 at the end of the run, -1 if the run is cut or corrupt
+static int read_record(RunReader* reader) {
+    uint64_t term_length, documents, count, last_doc, last_ordinal, length;
+    int got = read_varint(reader->file, &term_length);
+    if (got <= 0) return got;
+    if (term_length == 0 || term_length > MAX_WORD_LENGTH ||
+        fread(reader->term, 1, term_length, reader->file) != term_length) return -1;
+    reader->term[term_length] = '\0';
+    if (read_varint(reader->file, &documents) <= 0 || read_varint(reader->file, &count) <= 0 ||
+        read_varint(reader->file, &last_doc) <= 0 || read_varint(reader->file, &last_ordinal) <= 0 ||
+        read_varint(reader->file, &length) <= 0 || documents == 0 || count < documents) return -1;
+
+    PostingBuffer* postings = &reader->postings;
+    postings->length = 0;
+    if (reserve_bytes(postings, length) < 0 || fread(postings->bytes, 1, length, reader->file) != length) return -1;
+    postings->length = length;
+    postings->documents = (long)documents;
+    postings->count = (long)count;
+    postings->last_doc = (long)last_doc;
+    postings->last_ordinal = (long)last_ordinal;
+    return 1;
+}
+
+// Create a new file in the temp directory, its path is left in *path
+static FILE* create_temp(const SpimiBuilder* builder, char** path) {
+    size_t size = strlen(builder->temp_dir) + sizeof("/spimi-XXXXXX");
+    char* name = malloc(size);
+    if (!name) return NULL;
+    snprintf(name, size, "%s/spimi-XXXXXX", builder->temp_dir);
+    int fd = mkstemp(name);
+    FILE* file = fd >= 0 ? fdopen(fd, "w+b") : NULL;
+    if (!file) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(name);
+        }
+        free(name);
+        return NULL;
+    }
+    *path = name;
+    return file;
+}
+
+static void remove_runs(SpimiBuilder* builder) {
+    for (int r = 0; r < builder->run_count; ++r) {
+        if (builder->runs[r]) unlink(builder->runs[r]);
+        free(builder->runs[r]);
+    }
+    builder->run_count = 0;
+}
+
+static int add_run(SpimiBuilder* builder, char* path) {
+    if (builder->run_count == builder->run_capacity) {
+        int capacity = builder->run_capacity ? builder->run_capacity * 2 : 16;
+        char** runs = realloc(builder->runs, sizeof(char*) * capacity);
+        if (!runs) return 0;
+        builder->runs = runs;
+        builder->run_capacity = capacity;
+    }
+    builder->runs[builder->run_count++] = path;
+    return 1;
+}
+
+static int compare_terms(const void* a, const void* b) {
+    return strcmp(((const TermEntry*)a)->term, ((const TermEntry*)b)->term);
+}
+
+// Write the dictionary as a run sorted by term and start an empty one
+static int spill(SpimiBuilder* builder) {
+    int term_count = HTSize(builder->dictionary);
+    if (term_count == 0) return 0;
+
+    TermEntry* entries = malloc(sizeof(TermEntry) * term_count);
+    int ok = entries != NULL, n = 0, pos = 0;
+    char* key;
+    void* value;
+    while (ok && HTNext(builder->dictionary, &pos, &key, &value)) entries[n++] = (TermEntry){ key, value };
+    if (ok) qsort(entries, n, sizeof(TermEntry), compare_terms);
+
+    char* path = NULL;
+    FILE* run = ok ? create_temp(builder, &path) : NULL;
+    if (run && !add_run(builder, path)) {
+        unlink(path);
+        free(path);
+        ok = 0;
+    }
+    if (run && ok) setvbuf(run, NULL, _IOFBF, SPIMI_RUN_BUFFER);
+    ok = ok && run != NULL;
+    for (int i = 0; ok && i < n; ++i) ok = write_record(run, entries[i].term, entries[i].postings);
+    if (run) {
+        if (ok) builder->stats.run_bytes += ftell(run);
+        if (fclose(run) != 0) ok = 0;
+    }
+    free(entries);
+
+    pos = 0;
+    while (HTNext(builder->dictionary, &pos, NULL, &value)) {
+        free(((PostingBuffer*)value)->bytes);
+        free(value);
+    }
+    HTDestroy(builder->dictionary);
+    builder->dictionary = HTCreate();
+    builder->memory = 0;
+    if (builder->dictionary == NULL) ok = 0;
+    return ok ? 0 : -1;
+}
+
+static void index_word(SpimiBuilder* builder, const char* word, int doc, long ordinal) {
+    void* value = NULL;
+    PostingBuffer* postings;
+    if (HTGet(builder->dictionary, (char*)word, &value)) {
+        postings = value;
+    } else {
+        postings = calloc(1, sizeof(PostingBuffer));
+        if (!postings || !HTPut(builder->dictionary, (char*)word, postings)) {
+            free(postings);
+            builder->failed = TRUE;
+            return;
+        }
+        postings->last_doc = -1;
+        builder->memory += TERM_OVERHEAD + strlen(word) + 1;
+    }
+
+    long grown = append_entry(postings, doc, ordinal);
+    if (grown < 0) {
+        builder->failed = TRUE;
+        return;
+    }
+    builder->memory += (size_t)grown;
+    builder->stats.postings++;
+    if (builder->memory > builder->stats.peak_memory) builder->stats.peak_memory = builder->memory;
+    if (builder->memory >= builder->budget && spill(builder) < 0) builder->failed = TRUE;
+}
+
+SpimiBuilder* SP_Create(const char* temp_dir, size_t memory_budget) {
+    if (!temp_dir) temp_dir = getenv("TMPDIR");
+    if (!temp_dir || !*temp_dir) temp_dir = "/tmp";
+    if (memory_budget == 0) memory_budget = SPIMI_DEFAULT_BUDGET;
+    if (memory_budget < SPIMI_MIN_BUDGET) memory_budget = SPIMI_MIN_BUDGET;
+
+    SpimiBuilder* builder = calloc(1, sizeof(SpimiBuilder));
+    if (!builder) return NULL;
+    builder->temp_dir = strdup(temp_dir);
+    builder->budget = memory_budget;
+    builder->dictionary = HTCreate();
+    builder->block = malloc(SPIMI_READ_BLOCK);
+    if (!builder->temp_dir || !builder->dictionary || !builder->block) {
+        SP_Destroy(builder);
+        return NULL;
+    }
+    return builder;
+}
+
+void SP_SetIndexShortWords(SpimiBuilder* builder, BOOLEAN enabled) {
+    if (builder) builder->index_short_words = enabled;
+}
+
+static int add_document(SpimiBuilder* builder, const char* fileName) {
+    if (builder->document_count == builder->document_capacity) {
+        int capacity = builder->document_capacity ? builder->document_capacity * 2 : 8;
+        char** names = realloc(builder->names, sizeof(char*) * capacity);
+        if (names) builder->names = names;
+        long* tokens = realloc(builder->tokens, sizeof(long) * capacity);
+        if (tokens) builder->tokens = tokens;
+        if (!names || !tokens) return -1;
+        builder->document_capacity = capacity;
+    }
+    char* name = strdup(fileName);
+    if (!name) return -1;
+    builder->names[builder->document_count] = name;
+    builder->tokens[builder->document_count] = 0;
+    return builder->document_count++;
+}
+
+// End of a token: index its word and count it
+static void end_token(SpimiBuilder* builder, char* word, int len, long length, int doc, long* ordinal) {
+    word[len] = '\0';
+    if (length >= WORD_MIN_LENGTH || builder->index_short_words) index_word(builder, word, doc, *ordinal);
+    ++*ordinal;
+}
+
+int SP_AddFile(SpimiBuilder* builder, const char* fileName) {
+    if (!builder || !fileName || builder->finished || builder->document_count == INT_MAX) return -1;
+
+    FILE* f = open_file(fileName);
+    if (!f) return -1;
+    int doc = add_document(builder, fileName);
+    if (doc < 0) {
+        fclose(f);
+        return -1;
+    }
+    double start = now_ms();
+    posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // tokens are split like in II_LoadFile; one may straddle two blocks
+    char word[MAX_WORD_LENGTH + 1];
+    int len = 0;
+    long length = 0;    // letters of the current token, 0 between tokens
+    long ordinal = 0;
+    size_t n;
+    while ((n = fread(builder->block, 1, SPIMI_READ_BLOCK, f)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            int ch = (unsigned char)builder->block[i];
+            if (isalpha(ch)) {
+                if (len < MAX_WORD_LENGTH) word[len++] = tolower(ch);
+                length++;
+            } else if (length > 0) {
+                end_token(builder, word, len, length, doc, &ordinal);
+                len = 0;
+                length = 0;
+            }
+        }
+    }
+    // EOF closes the last word
+    if (length > 0) end_token(builder, word, len, length, doc, &ordinal);
+    if (ferror(f)) builder->failed = TRUE;
+    fclose(f);
+
+    builder->tokens[doc] = ordinal;
+    builder->stats.documents = builder->document_count;
+    builder->stats.tokens += ordinal;
+    builder->stats.index_ms += now_ms() - start;
+    return builder->failed ? -1 : doc;
+}
+
+// Min-heap of readers by (term, run)
+static int reader_before(const RunReader* a, const RunReader* b) {
+    int order = strcmp(a->term, b->term);
+    return order < 0 || (order == 0 && a->run < b->run);
+}
+
+static void sift_down(RunReader** heap, int size, int i) {
+    while (1) {
+        int smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && reader_before(heap[left], heap[smallest])) smallest = left;
+        if (right < size && reader_before(heap[right], heap[smallest])) smallest = right;
+        if (smallest == i) return;
+        RunReader* swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+static int emit_term(MergeOutput* out, const char* term, const PostingBuffer* postings) {
+    out->terms++;
+    if (out->run) return write_record(out->run, term, postings);
+
+    size_t term_length = strlen(term) + 1;
+    DiskTerm entry = { out->postings_offset, postings->length, out->strings_offset,
+                       (uint64_t)postings->count, (uint64_t)postings->documents };
+    if (fwrite(postings->bytes, 1, postings->length, out->postings) != postings->length ||
+        fwrite(&entry, sizeof(DiskTerm), 1, out->dictionary) != 1 ||
+        fwrite(term, 1, term_length, out->strings) != term_length) return 0;
+    out->postings_offset += postings->length;
+    out->strings_offset += term_length;
+    return 1;
+}
+
+// k-way merge of runs (given in the order they were written) into out
+static int merge_runs(char* const* runs, int run_count, MergeOutput* out) {
+    RunReader* readers = calloc(run_count > 0 ? run_count : 1, sizeof(RunReader));
+    RunReader** heap = malloc(sizeof(RunReader*) * (run_count > 0 ? run_count : 1));
+    PostingBuffer merged = { 0 };
+    int ok = readers && heap, size = 0;
+
+    for (int r = 0; ok && r < run_count; ++r) {
+        RunReader* reader = &readers[r];
+        reader->run = r;
+        reader->file = fopen(runs[r], "rb");
+        reader->buffer = malloc(SPIMI_RUN_BUFFER);
+        if (!reader->file || !reader->buffer) {
+            ok = 0;
+            break;
+        }
+        setvbuf(reader->file, reader->buffer, _IOFBF, SPIMI_RUN_BUFFER);
+        int got = read_record(reader);
+        if (got < 0) ok = 0;
+        if (got > 0) heap[size++] = reader;
+    }
+    for (int i = size / 2 - 1; ok && i >= 0; --i) sift_down(heap, size, i);
+
+    char term[MAX_WORD_LENGTH + 1];
+    while (ok && size > 0) {
+        // the records of a term come out in run order: append them
+        strcpy(term, heap[0]->term);
+        reset_postings(&merged);
+        while (ok && size > 0 && strcmp(heap[0]->term, term) == 0) {
+            RunReader* top = heap[0];
+            if (!append_chunk(&merged, &top->postings)) ok = 0;
+            int got = read_record(top);
+            if (got < 0) ok = 0;
+            if (got == 0) heap[0] = heap[--size];
+            sift_down(heap, size, 0);
+        }
+        if (ok) ok = emit_term(out, term, &merged);
+    }
+
+    for (int r = 0; readers && r < run_count; ++r) {
+        if (readers[r].file) fclose(readers[r].file);
+        free(readers[r].buffer);
+        free(readers[r].postings.bytes);
+    }
+    free(readers);
+    free(heap);
+    free(merged.bytes);
+    return ok;
+}
+
+// Merge the runs SPIMI_MERGE_FANIN at a time into fewer, longer runs
+static int merge_pass(SpimiBuilder* builder) {
+    int groups = (builder->run_count + SPIMI_MERGE_FANIN - 1) / SPIMI_MERGE_FANIN;
+    char** merged = calloc(groups, sizeof(char*));
+    if (!merged) return 0;
+
+    int ok = 1;
+    for (int g = 0; g < groups; ++g) {
+        int first = g * SPIMI_MERGE_FANIN;
+        int count = builder->run_count - first < SPIMI_MERGE_FANIN ? builder->run_count - first : SPIMI_MERGE_FANIN;
+        if (count == 1) {
+            merged[g] = builder->runs[first];
+            builder->runs[first] = NULL;
+            continue;
+        }
+        FILE* run = ok ? create_temp(builder, &merged[g]) : NULL;
+        if (run) {
+            setvbuf(run, NULL, _IOFBF, SPIMI_RUN_BUFFER);
+            MergeOutput out = { run, NULL, NULL, NULL, 0, 0, 0 };
+            ok = merge_runs(builder->runs + first, count, &out);
+            if (ok) builder->stats.run_bytes += ftell(run);
+            if (fclose(run) != 0) ok = 0;
+        } else {
+            ok = 0;
+        }
+        for (int r = first; r < first + count; ++r) {
+            unlink(builder->runs[r]);
+            free(builder->runs[r]);
+            builder->runs[r] = NULL;
+        }
+    }
+    free(builder->runs);
+    builder->runs = merged;
+    builder->run_count = groups;
+    builder->run_capacity = groups;
+    return ok;
+}
+
+static int write_padding(FILE* file, uint64_t* offset) {
+    static const char zeros[8];
+    size_t pad = (size_t)((8 - *offset % 8) % 8);
+    *offset += pad;
+    return fwrite(zeros, 1, pad, file) == pad;
+}
+
+// Append a whole temp file to out
+static int copy_file(SpimiBuilder* builder, FILE* from, FILE* out) {
+    if (fflush(from) != 0 || fseek(from, 0, SEEK_SET) != 0) return 0;
+    size_t n;
+    while ((n = fread(builder->block, 1, SPIMI_READ_BLOCK, from)) > 0) {
+        if (fwrite(builder->block, 1, n, out) != n) return 0;
+    }
+    return !ferror(from);
+}
+
+// Final merge: postings straight into the index, dictionary and terms into temp files
+// appended once every term is known
+static int write_index(SpimiBuilder* builder, const char* index_path) {
+    char* dictionary_path = NULL;
+    char* strings_path = NULL;
+    FILE* file = fopen(index_path, "wb");
+    FILE* dictionary = create_temp(builder, &dictionary_path);
+    FILE* strings = create_temp(builder, &strings_path);
+    SpimiHeader header = { SPIMI_MAGIC, (uint64_t)builder->document_count, 0, 0, 0, 0 };
+    int ok = file && dictionary && strings;
+    if (ok) setvbuf(file, NULL, _IOFBF, SPIMI_RUN_BUFFER);
+    ok = ok && fwrite(&header, sizeof(SpimiHeader), 1, file) == 1;
+
+    MergeOutput out = { NULL, file, dictionary, strings, sizeof(SpimiHeader), 0, 0 };
+    ok = ok && merge_runs(builder->runs, builder->run_count, &out);
+
+    uint64_t offset = out.postings_offset;
+    ok = ok && write_padding(file, &offset);
+    header.terms = (uint64_t)out.terms;
+    header.dictionary = offset;
+    header.strings = header.dictionary + header.terms * sizeof(DiskTerm);
+    ok = ok && copy_file(builder, dictionary, file) && copy_file(builder, strings, file);
+    offset = header.strings + out.strings_offset;
+    ok = ok && write_padding(file, &offset);
+    header.document_table = offset;
+    for (int d = 0; ok && d < builder->document_count; ++d) {
+        uint64_t tokens = (uint64_t)builder->tokens[d];
+        ok = fwrite(&tokens, sizeof(tokens), 1, file) == 1;
+    }
+    for (int d = 0; ok && d < builder->document_count; ++d) {
+        size_t length = strlen(builder->names[d]) + 1;
+        ok = fwrite(builder->names[d], 1, length, file) == length;
+    }
+    if (ok) builder->stats.index_bytes = ftell(file);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(SpimiHeader), 1, file) == 1;
+    builder->stats.terms = out.terms;
+
+    if (file && fclose(file) != 0) ok = 0;
+    if (dictionary) {
+        fclose(dictionary);
+        unlink(dictionary_path);
+    }
+    if (strings) {
+        fclose(strings);
+        unlink(strings_path);
+    }
+    free(dictionary_path);
+    free(strings_path);
+    return ok;
+}
+
+int SP_Finish(SpimiBuilder* builder, const char* index_path, SpimiStats* stats) {
+    if (!builder || !index_path || builder->finished) return -1;
+    builder->finished = TRUE;
+
+    double start = now_ms();
+    if (!builder->failed && spill(builder) < 0) builder->failed = TRUE;
+    builder->stats.runs = builder->run_count;
+    builder->stats.index_ms += now_ms() - start;
+
+    start = now_ms();
+    int ok = !builder->failed;
+    while (ok && builder->run_count > SPIMI_MERGE_FANIN) {
+        ok = merge_pass(builder);
+        builder->stats.merge_passes++;
+    }
+    if (ok) {
+        ok = write_index(builder, index_path);
+        builder->stats.merge_passes++;
+        if (!ok) unlink(index_path);
+    }
+    remove_runs(builder);
+    builder->stats.merge_ms = now_ms() - start;
+
+    if (stats) *stats = builder->stats;
+    return ok ? 0 : -1;
+}
+
+void SP_Destroy(SpimiBuilder* builder) {
+    if (!builder) return;
+    remove_runs(builder);
+    free(builder->runs);
+    if (builder->dictionary) {
+        int pos = 0;
+        void* value;
+        while (HTNext(builder->dictionary, &pos, NULL, &value)) {
+            free(((PostingBuffer*)value)->bytes);
+            free(value);
+        }
+        HTDestroy(builder->dictionary);
+    }
+    for (int d = 0; d < builder->document_count; ++d) free(builder->names[d]);
+    free(builder->names);
+    free(builder->tokens);
+    free(builder->block);
+    free(builder->temp_dir);
+    free(builder);
+}
+
+// Check that every section of the mapping is where the header says
+static int validate(DiskIndex* index) {
+    const SpimiHeader* header = index->header;
+    size_t size = index->size;
+    if (memcmp(header->magic, SPIMI_MAGIC, sizeof(header->magic)) != 0) return 0;
+    if (header->documents > INT_MAX || header->dictionary % 8 || header->document_table % 8) return 0;
+    if (header->dictionary < sizeof(SpimiHeader) || header->dictionary > size ||
+        header->terms > (size - header->dictionary) / sizeof(DiskTerm)) return 0;
+    if (header->strings != header->dictionary + header->terms * sizeof(DiskTerm) ||
+        header->document_table < header->strings || header->document_table > size ||
+        header->documents > (size - header->document_table) / sizeof(uint64_t)) return 0;
+    // terms end with a NUL (or the zero padding) before the document table
+    if (header->terms > 0 && (header->document_table == header->strings || index->data[header->document_table - 1] != '\0')) return 0;
+
+    index->terms = (const DiskTerm*)(index->data + header->dictionary);
+    index->strings = (const char*)(index->data + header->strings);
+    index->tokens = (const uint64_t*)(index->data + header->document_table);
+    for (uint64_t t = 0; t < header->terms; ++t) {
+        const DiskTerm* term = &index->terms[t];
+        if (term->postings < sizeof(SpimiHeader) || term->postings > header->dictionary ||
+            term->length > header->dictionary - term->postings ||
+            term->term >= header->document_table - header->strings) return 0;
+    }
+
+    index->names = malloc(sizeof(char*) * (header->documents ? header->documents : 1));
+    if (!index->names) return 0;
+    const char* name = (const char*)(index->tokens + header->documents);
+    const char* end = (const char*)index->data + size;
+    for (uint64_t d = 0; d < header->documents; ++d) {
+        const char* nul = memchr(name, '\0', (size_t)(end - name));
+        if (!nul) return 0;
+        index->names[d] = name;
+        name = nul + 1;
+    }
+    return 1;
+}
+
+DiskIndex* SP_Open(const char* index_path) {
+    if (!index_path) return NULL;
+    int fd = open(index_path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SpimiHeader)) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    DiskIndex* index = calloc(1, sizeof(DiskIndex));
+    if (index) {
+        index->data = data;
+        index->size = (size_t)st.st_size;
+        index->header = data;
+    }
+    if (!index || !validate(index)) {
+        if (index) free(index->names);
+        free(index);
+        munmap(data, (size_t)st.st_size);
+        return NULL;
+    }
+    return index;
+}
+
+void SP_Close(DiskIndex* index) {
+    if (!index) return;
+    munmap((void*)index->data, index->size);
+    free(index->names);
+    free(index);
+}
+
+int SP_DocumentCount(const DiskIndex* index) {
+    return index ? (int)index->header->documents : 0;
+}
+
+const char* SP_DocumentName(const DiskIndex* index, int doc) {
+    if (!index || doc < 0 || (uint64_t)doc >= index->header->documents) return NULL;
+    return index->names[doc];
+}
+
+long SP_DocumentTokens(const DiskIndex* index, int doc) {
+    if (!index || doc < 0 || (uint64_t)doc >= index->header->documents) return 0;
+    return (long)index->tokens[doc];
+}
+
+long SP_Terms(const DiskIndex* index) {
+    return index ? (long)index->header->terms : 0;
+}
+
+// Binary search of the dictionary for a query word, normalized like the loader does
+static const DiskTerm* find_term(const DiskIndex* index, const char* word) {
+    if (!index || !word) return NULL;
+    char key[MAX_WORD_LENGTH + 1];
+    int len = 0;
+    while (word[len] && len < MAX_WORD_LENGTH) {
+        key[len] = tolower((unsigned char)word[len]);
+        len++;
+    }
+    key[len] = '\0';
+
+    size_t low = 0, high = (size_t)index->header->terms;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int order = strcmp(key, index->strings + index->terms[mid].term);
+        if (order == 0) return &index->terms[mid];
+        if (order < 0) high = mid;
+        else low = mid + 1;
+    }
+    return NULL;
+}
+
+long SP_TermCount(const DiskIndex* index, const char* word) {
+    const DiskTerm* term = find_term(index, word);
+    return term ? (long)term->count : 0;
+}
+
+OccurrenceList* SP_Postings(const DiskIndex* index, const char* word) {
+    const DiskTerm* term = find_term(index, word);
+    if (!term) return NULL;
+    OccurrenceList* list = CreateEmptyOccurrenceList();
+    if (!list) return NULL;
+
+    const uint8_t* p = index->data + term->postings;
+    const uint8_t* end = p + term->length;
+    long doc = -1, ordinal = 0;
+    while (p < end) {
+        uint64_t tag, value;
+        int n = get_varint(p, end, &tag);
+        if (!n) break;
+        p += n;
+        if (tag & 1) {
+            doc += (long)(tag >> 1) + 1;
+            n = get_varint(p, end, &value);
+            if (!n) break;
+            p += n;
+            ordinal = (long)value;
+        } else {
+            ordinal += (long)(tag >> 1) + 1;
+        }
+        if (doc > INT_MAX || !AddTokenToDocument(list, (int)doc, ordinal)) break;
+    }
+    if (p < end) {
+        FreeOccurrenceList(list);
+        return NULL;
+    }
+    return list;
+}
@@ -0,0 +1,116 @@
+#ifndef SPIMI_H
+#define SPIMI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "InvertedIndex.h"
+
+#define SPIMI_DEFAULT_BUDGET ((size_t)64 << 20)   // dictionary + postings held before a spill
+#define SPIMI_MIN_BUDGET ((size_t)64 << 10)
+#define SPIMI_READ_BLOCK (256 * 1024)             // bytes per fread of a document
+#define SPIMI_RUN_BUFFER (64 * 1024)              // stdio buffer of every run written or merged
+#define SPIMI_MERGE_FANIN 16                      // runs merged at once; more take several passes
+
+/*
+ * Single-pass in-memory indexing (SPIMI) for corpora that don't fit in memory:
+ *
+ *   SP_AddFile   tokens -> dictionary (HashTable term -> growing posting buffer)
+ *                when the dictionary reaches the budget it is written, sorted by term,
+ *                as a run in the temp directory and emptied
+ *   SP_Finish    the runs are merged SPIMI_MERGE_FANIN at a time (intermediate runs when
+ *                there are more) into the final index file, and removed
+ *
+ * Documents are tokenized like II_LoadFile (same ordinals, same truncation, short words
+ * only with SP_SetIndexShortWords) and numbered in the order they are added, so a run
+ * holds postings of later documents (or later ordinals) than every run before it and
+ * merging a term is appending its runs in order. Memory stays bounded by the budget while
+ * indexing, and by SPIMI_MERGE_FANIN run buffers plus the longest posting list of one
+ * run while merging.
+ *
+ * Postings of a term are a stream of varints over (document, ordinal) entries sorted by
+ * document then ordinal: a new document is (doc_gap << 1 | 1, ordinal), the next ordinal
+ * of the same document is (ordinal_gap << 1). Runs and the index use the same encoding.
+ *
+ * Run: records sorted by term until EOF
+ *     term_length term documents count last_doc last_ordinal byte_length bytes
+ *     (all varints but the term and the bytes)
+ * Index file (opened with SP_Open, read through a read-only mapping):
+ *     SpimiHeader | postings of every term | padding to 8 | DiskTerm[terms] sorted by term
+ *     | terms, NUL-terminated | uint64_t tokens[documents] | names, NUL-terminated
+ */
+
+#define SPIMI_MAGIC "SPIMIX01"
+
+typedef struct _SpimiHeader {
+    char magic[8];
+    uint64_t documents;
+    uint64_t terms;
+    uint64_t dictionary;    // file offset of the DiskTerm array
+    uint64_t strings;       // file offset of the terms
+    uint64_t document_table;   // file offset of the token counts, names follow
+} SpimiHeader;
+
+typedef struct _DiskTerm {
+    uint64_t postings;      // file offset of the posting stream
+    uint64_t length;        // bytes of the posting stream
+    uint64_t term;          // offset of the term from SpimiHeader.strings
+    uint64_t count;         // occurrences in all documents
+    uint64_t documents;     // documents holding the term
+} DiskTerm;
+
+typedef struct _SpimiStats {
+    int documents;
+    long tokens;            // every token read, indexed or not
+    long postings;          // (document, ordinal) entries indexed
+    long terms;             // distinct terms of the index
+    int runs;               // spilled while indexing
+    int merge_passes;       // including the final merge
+    size_t peak_memory;     // largest dictionary + postings held at once
+    long run_bytes;         // written to runs, intermediate ones included
+    long index_bytes;
+    double index_ms;        // tokenizing and spilling
+    double merge_ms;
+} SpimiStats;
+
+typedef struct _SpimiBuilder SpimiBuilder;
+typedef struct _DiskIndex DiskIndex;
+
+// Start an index that keeps at most memory_budget bytes (at least SPIMI_MIN_BUDGET, 0 for
+// SPIMI_DEFAULT_BUDGET) of dictionary and postings in memory and spills runs to temp_dir
+// (NULL: $TMPDIR or /tmp). Returns NULL if allocation fails
+SpimiBuilder* SP_Create(const char* temp_dir, size_t memory_budget);
+
+// Index words shorter than WORD_MIN_LENGTH in files added from now on
+void SP_SetIndexShortWords(SpimiBuilder* builder, BOOLEAN enabled);
+
+// Tokenize libros/<fileName> into the index; returns its document id or -1 if it can't be
+// opened. A failed read or spill also returns -1 and makes SP_Finish fail
+int SP_AddFile(SpimiBuilder* builder, const char* fileName);
+
+// Spill what is left, merge every run into index_path and remove the runs.
+// Returns 0 or -1 (nothing valid is left at index_path). stats may be NULL
+int SP_Finish(SpimiBuilder* builder, const char* index_path, SpimiStats* stats);
+
+// Free the builder and remove the runs that weren't merged
+void SP_Destroy(SpimiBuilder* builder);
+
+// Map an index written by SP_Finish; NULL if it can't be read or isn't one
+DiskIndex* SP_Open(const char* index_path);
+void SP_Close(DiskIndex* index);
+
+int SP_DocumentCount(const DiskIndex* index);
+// Name the document was added with, NULL out of range
+const char* SP_DocumentName(const DiskIndex* index, int doc);
+// Tokens of the document, indexed or not
+long SP_DocumentTokens(const DiskIndex* index, int doc);
+// Distinct terms
+long SP_Terms(const DiskIndex* index);
+
+// Occurrences of a query word (lowercased and truncated like the loader does)
+long SP_TermCount(const DiskIndex* index, const char* word);
+
+// Postings of a query word decoded into a new list (free it with FreeOccurrenceList), so
+// cursors and searches can run on them; NULL if the word never occurs or allocation fails
+OccurrenceList* SP_Postings(const DiskIndex* index, const char* word);
+
+#endif
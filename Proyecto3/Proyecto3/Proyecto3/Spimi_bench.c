@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "Spimi.h"
+
+/*
+ * Indice en disco con SPIMI (Spimi.h) para distintos presupuestos de memoria, sobre los
+ * cuatro libros agregados COPIES veces (como si fueran documentos distintos), contra el
+ * indice en memoria de una sola copia. Cada configuracion corre en su propio proceso para
+ * medir su RSS maximo.
+ *
+ *   Spimi_bench [copias]     (por defecto 4)
+ */
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+#define BOOKS 4
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static long max_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/* Corre en un proceso hijo: arma el indice con el presupuesto dado e imprime una linea */
+static void build(size_t budget, int copies, const char* dir, const char* path) {
+    SpimiBuilder* builder = SP_Create(dir, budget);
+    if (!builder) exit(EXIT_FAILURE);
+    SP_SetIndexShortWords(builder, TRUE);
+    for (int c = 0; c < copies; ++c) {
+        for (int b = 0; b < BOOKS; ++b) {
+            if (SP_AddFile(builder, books[b]) < 0) {
+                fprintf(stderr, "No se pudo indexar '%s'\n", books[b]);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    SpimiStats stats;
+    if (SP_Finish(builder, path, &stats) < 0) {
+        fprintf(stderr, "No se pudo escribir '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    SP_Destroy(builder);
+
+    // una busqueda en el indice terminado, para ver que se puede usar
+    DiskIndex* disk = SP_Open(path);
+    long sancho = SP_TermCount(disk, "sancho");
+    SP_Close(disk);
+    printf("%7zu KB %8.1f %8.1f %6d %6d %9zu %9.1f %9.1f %8ld %8ld\n", budget >> 10, stats.index_ms, stats.merge_ms,
+           stats.runs, stats.merge_passes, stats.peak_memory >> 10, stats.run_bytes / 1048576.0,
+           stats.index_bytes / 1048576.0, max_rss_kb(), sancho);
+    exit(EXIT_SUCCESS);
+}
+
+/* Referencia: los libros una vez con II_LoadFile */
+static void load_in_memory(void) {
+    InvertedIndex* idx = II_Create();
+    II_SetIndexShortWords(idx, TRUE);
+    double start = now_ms();
+    for (int b = 0; b < BOOKS; ++b) {
+        if (II_LoadFile(idx, books[b]) < 0) exit(EXIT_FAILURE);
+    }
+    double elapsed = now_ms() - start;
+    printf("en memoria, una copia: %.1f ms, %zu KB de postings, RSS maximo %ld KB\n", elapsed,
+           II_PostingsMemory(idx) >> 10, max_rss_kb());
+    II_Destroy(idx);
+    exit(EXIT_SUCCESS);
+}
+
+static void run_child(void (*child)(size_t, int, const char*, const char*), size_t budget, int copies,
+                      const char* dir, const char* path) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (child) child(budget, copies, dir, path);
+        load_in_memory();
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Fallo una configuracion\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char** argv) {
+    int copies = argc > 1 ? atoi(argv[1]) : 4;
+    if (copies < 1) {
+        printf("Usage: %s [copias]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    char dir[] = "/tmp/spimi_benchXXXXXX";
+    if (!mkdtemp(dir)) return EXIT_FAILURE;
+    char path[64];
+    snprintf(path, sizeof(path), "%s.index", dir);
+
+    // los "Cargando archivo" de II_LoadFile no interesan aca
+    run_child(NULL, 0, 0, dir, path);
+    printf("\n%d documentos (%d copias de los libros), tiempos en ms\n", copies * BOOKS, copies);
+    printf("%10s %8s %8s %6s %6s %9s %9s %9s %8s %8s\n", "memoria", "indexar", "merge", "runs", "pasadas",
+           "pico KB", "runs MB", "indice MB", "RSS KB", "sancho");
+    size_t budgets[] = { (size_t)256 << 10, (size_t)1 << 20, (size_t)4 << 20, (size_t)16 << 20, SPIMI_DEFAULT_BUDGET };
+    for (int b = 0; b < 5; ++b) run_child(build, budgets[b], copies, dir, path);
+
+    unlink(path);
+    rmdir(dir);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "Spimi.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "tesoro.txt" };
+#define BOOKS 3
+
+/* Archivos que quedan en un directorio */
+static int files_in(const char* dir) {
+    DIR* d = opendir(dir);
+    assert(d != NULL);
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) count++;
+    }
+    closedir(d);
+    return count;
+}
+
+static SpimiStats build(const char* dir, size_t budget, const char* path) {
+    SpimiBuilder* builder = SP_Create(dir, budget);
+    assert(builder != NULL);
+    SP_SetIndexShortWords(builder, TRUE);
+    for (int b = 0; b < BOOKS; ++b) assert(SP_AddFile(builder, books[b]) == b);
+    assert(SP_AddFile(builder, "no_existe.txt") == -1);
+    SpimiStats stats;
+    assert(SP_Finish(builder, path, &stats) == 0);
+    SP_Destroy(builder);
+    assert(files_in(dir) == 0);   // las corridas se borran al terminar
+    return stats;
+}
+
+/* Los mismos documentos y ordinales, recorridos con cursores */
+static void check_postings(const OccurrenceList* expected, const OccurrenceList* got) {
+    PostingCursor a, b;
+    OpenPostingCursor(&a, expected);
+    OpenPostingCursor(&b, got);
+    while (CursorDocument(&a) >= 0) {
+        int doc = CursorDocument(&a);
+        assert(CursorDocument(&b) == doc);
+        int more;
+        do {
+            assert(CursorOrdinal(&a) == CursorOrdinal(&b));
+            more = CursorNextOrdinal(&a);
+            assert(CursorNextOrdinal(&b) == more);
+        } while (more);
+        CursorSeekDocument(&a, doc + 1);
+        CursorSeekDocument(&b, doc + 1);
+    }
+    assert(CursorDocument(&b) == -1);
+}
+
+static int same_file(const char* a, const char* b) {
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    assert(fa && fb);
+    int ca, cb;
+    do {
+        ca = getc(fa);
+        cb = getc(fb);
+    } while (ca == cb && ca != EOF);
+    fclose(fa);
+    fclose(fb);
+    return ca == cb;
+}
+
+int main(void) {
+    char dir[] = "/tmp/spimi_testXXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    char small_path[64], large_path[64];
+    snprintf(small_path, sizeof(small_path), "%s.small", dir);
+    snprintf(large_path, sizeof(large_path), "%s.large", dir);
+
+    // Con el presupuesto minimo hay mas corridas que SPIMI_MERGE_FANIN: varias pasadas de merge
+    SpimiStats small = build(dir, SPIMI_MIN_BUDGET, small_path);
+    assert(small.runs > SPIMI_MERGE_FANIN && small.merge_passes > 1);
+    assert(small.peak_memory < 2 * SPIMI_MIN_BUDGET);   // el ultimo buffer que crecio puede pasarse
+    // Todo entra en memoria: una corrida, un merge, y el mismo indice byte a byte
+    SpimiStats large = build(dir, SPIMI_DEFAULT_BUDGET, large_path);
+    assert(large.runs == 1 && large.merge_passes == 1);
+    assert(small.terms == large.terms && small.postings == large.postings && small.tokens == large.tokens);
+    assert(same_file(small_path, large_path));
+
+    // Contra el indice en memoria de los mismos libros
+    InvertedIndex* idx = II_Create();
+    II_SetIndexShortWords(idx, TRUE);
+    II_SetHybridPostings(idx, FALSE);
+    for (int b = 0; b < BOOKS; ++b) assert(II_LoadFile(idx, books[b]) == b);
+
+    DiskIndex* disk = SP_Open(small_path);
+    assert(disk != NULL);
+    assert(SP_DocumentCount(disk) == BOOKS);
+    for (int b = 0; b < BOOKS; ++b) {
+        assert(strcmp(SP_DocumentName(disk, b), books[b]) == 0);
+        assert(SP_DocumentTokens(disk, b) == (long)arraylist_size(idx->token_offsets[b]));
+    }
+    assert(SP_DocumentName(disk, BOOKS) == NULL);
+    assert(SP_Terms(disk) == HTSize(idx->table) && small.terms == SP_Terms(disk));
+
+    long postings = 0;
+    for (TermId id = 0; id < idx->terms.count; ++id) {
+        const char* term = II_TermWord(idx, id);
+        OccurrenceList* list = SP_Postings(disk, term);
+        assert(list != NULL);
+        check_postings(II_TermPostings(idx, id), list);
+        assert(SP_TermCount(disk, term) == II_TermCount(idx, term));
+        postings += SP_TermCount(disk, term);
+        FreeOccurrenceList(list);
+    }
+    assert(postings == small.postings);
+    assert(SP_TermCount(disk, "SANCHO") == II_TermCount(idx, "sancho"));
+    assert(SP_Postings(disk, "palabrainexistente") == NULL && SP_TermCount(disk, "palabrainexistente") == 0);
+    SP_Close(disk);
+    II_Destroy(idx);
+
+    // Un archivo que no es un indice (ni completo) no se abre
+    FILE* broken = fopen(large_path, "r+b");
+    assert(broken != NULL && fputc('X', broken) != EOF);
+    fclose(broken);
+    assert(SP_Open(large_path) == NULL);
+    assert(truncate(small_path, 100) == 0);
+    assert(SP_Open(small_path) == NULL);
+
+    unlink(small_path);
+    unlink(large_path);
+    rmdir(dir);
+    printf("SPIMI tests passed.\n");
+    return EXIT_SUCCESS;
+}
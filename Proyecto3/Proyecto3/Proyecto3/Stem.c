@@ -0,0 +1,260 @@
+#include <string.h>
+#include <pthread.h>
+#include "Stem.h"
+#include "boolean.h"
+
+// What step 1 does with a suffix found in the word
+typedef enum _SuffixRule {
+    RULE_DELETE,      // in R2
+    RULE_IC,          // in R2, then a preceding "ic" in R2
+    RULE_UCION,       // in R2, replaced by "u"
+    RULE_ENCIA,       // in R2, replaced by "ente"
+    RULE_AMENTE,      // in R1, then a preceding "iv" ("ativ"), "os", "ic" or "ad" in R2
+    RULE_MENTE,       // in R2, then a preceding "ante", "able" or "ible" in R2
+    RULE_IDAD,        // in R2, then a preceding "abil", "ic" or "iv" in R2
+    RULE_IVA          // in R2, then a preceding "at" in R2
+} SuffixRule;
+
+typedef struct _Suffix {
+    const char* text;
+    int length;
+    SuffixRule rule;      // step 1 only
+} Suffix;
+
+#define S(text) { text, sizeof(text) - 1, RULE_DELETE }
+#define R(text, rule) { text, sizeof(text) - 1, rule }
+#define COUNT(list) ((int)(sizeof(list) / sizeof(list[0])))
+
+static const Suffix standard_suffixes[] = {
+    R("anza", RULE_DELETE), R("anzas", RULE_DELETE), R("ico", RULE_DELETE), R("ica", RULE_DELETE),
+    R("icos", RULE_DELETE), R("icas", RULE_DELETE), R("ismo", RULE_DELETE), R("ismos", RULE_DELETE),
+    R("able", RULE_DELETE), R("ables", RULE_DELETE), R("ible", RULE_DELETE), R("ibles", RULE_DELETE),
+    R("ista", RULE_DELETE), R("istas", RULE_DELETE), R("oso", RULE_DELETE), R("osa", RULE_DELETE),
+    R("osos", RULE_DELETE), R("osas", RULE_DELETE), R("amiento", RULE_DELETE), R("amientos", RULE_DELETE),
+    R("imiento", RULE_DELETE), R("imientos", RULE_DELETE),
+    R("adora", RULE_IC), R("ador", RULE_IC), R("adoras", RULE_IC), R("adores", RULE_IC),
+    R("aciones", RULE_IC), R("ante", RULE_IC), R("antes", RULE_IC), R("ancia", RULE_IC),
+    R("ancias", RULE_IC),
+    R("uciones", RULE_UCION),
+    R("encia", RULE_ENCIA), R("encias", RULE_ENCIA),
+    R("amente", RULE_AMENTE),
+    R("mente", RULE_MENTE),
+    R("idad", RULE_IDAD), R("idades", RULE_IDAD),
+    R("iva", RULE_IVA), R("ivo", RULE_IVA), R("ivas", RULE_IVA), R("ivos", RULE_IVA)
+};
+
+static const Suffix pronouns[] = {
+    S("me"), S("se"), S("sela"), S("selo"), S("selas"), S("selos"), S("la"), S("le"), S("lo"), S("las"), S("les"), S("los"), S("nos")
+};
+
+// endings a pronoun can be attached to ("yendo" only after a "u": "construyendolo")
+static const Suffix pronoun_bases[] = { S("ando"), S("iendo"), S("ar"), S("er"), S("ir"), S("yendo") };
+
+static const Suffix y_verb_suffixes[] = {
+    S("ya"), S("ye"), S("yan"), S("yen"), S("yeron"), S("yendo"), S("yo"), S("yas"), S("yes"), S("yais"), S("yamos")
+};
+
+// the first three drop a "u" after a "g" too: "averiguen" -> "averig"
+static const Suffix verb_suffixes[] = {
+    S("en"), S("es"), S("emos"),
+    S("aremos"), S("eremos"), S("iremos"), S("aba"), S("ada"), S("ida"), S("ara"), S("iera"), S("ad"), S("ed"), S("id"), S("ase"),
+    S("iese"), S("aste"), S("iste"), S("an"), S("aban"), S("aran"), S("ieran"), S("asen"), S("iesen"), S("aron"), S("ieron"),
+    S("ado"), S("ido"), S("ando"), S("iendo"), S("ar"), S("er"), S("ir"), S("as"), S("abas"), S("adas"), S("idas"), S("aras"),
+    S("ieras"), S("ases"), S("ieses"), S("abais"), S("arais"), S("ierais"), S("aseis"), S("ieseis"), S("asteis"),
+    S("isteis"), S("ados"), S("idos"), S("amos"), S("imos")
+};
+#define GU_VERB_SUFFIXES 3
+
+#define MAX_BUCKET 32   // suffixes of a table ending in the same letter
+
+// A suffix list with its entries grouped by last letter, so a word is only compared with
+// the suffixes that end like it does
+typedef struct _SuffixTable {
+    const Suffix* suffixes;
+    int count;
+    unsigned char bucket_size[26];
+    unsigned char bucket[26][MAX_BUCKET];
+} SuffixTable;
+
+#define TABLE(list) { list, COUNT(list), { 0 }, { { 0 } } }
+static SuffixTable standard_table = TABLE(standard_suffixes);
+static SuffixTable pronoun_table = TABLE(pronouns);
+static SuffixTable pronoun_base_table = TABLE(pronoun_bases);
+static SuffixTable y_verb_table = TABLE(y_verb_suffixes);
+static SuffixTable verb_table = TABLE(verb_suffixes);
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void fill_buckets(SuffixTable* table) {
+    for (int s = 0; s < table->count; ++s) {
+        int letter = table->suffixes[s].text[table->suffixes[s].length - 1] - 'a';
+        table->bucket[letter][table->bucket_size[letter]++] = (unsigned char)s;
+    }
+}
+
+static void build_tables(void) {
+    fill_buckets(&standard_table);
+    fill_buckets(&pronoun_table);
+    fill_buckets(&pronoun_base_table);
+    fill_buckets(&y_verb_table);
+    fill_buckets(&verb_table);
+}
+
+// The word being stemmed and its regions (start offsets, length when empty)
+typedef struct _StemWord {
+    char* text;
+    int length;
+    int rv, r1, r2;
+} StemWord;
+
+static BOOLEAN is_vowel(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+}
+
+static BOOLEAN ends_with(const StemWord* w, int end, const char* suffix, int suffix_length) {
+    return suffix_length <= end && memcmp(w->text + end - suffix_length, suffix, suffix_length) == 0;
+}
+
+// Longest suffix of the table that ends the word at end and starts at limit or later, -1 if none
+static int longest_suffix(const StemWord* w, int end, const SuffixTable* table, int limit) {
+    if (end <= 0 || w->text[end - 1] < 'a' || w->text[end - 1] > 'z') return -1;
+    int letter = w->text[end - 1] - 'a';
+    int best = -1, best_length = 0;
+    for (int b = 0; b < table->bucket_size[letter]; ++b) {
+        int s = table->bucket[letter][b];
+        int length = table->suffixes[s].length;
+        if (length > best_length && end - length >= limit && ends_with(w, end, table->suffixes[s].text, length)) {
+            best = s;
+            best_length = length;
+        }
+    }
+    return best;
+}
+
+static void truncate_to(StemWord* w, int length) {
+    w->length = length;
+    w->text[length] = '\0';
+}
+
+// Remove suffix if the word ends with it and it starts at limit or later
+static BOOLEAN remove_in(StemWord* w, const char* suffix, int limit) {
+    int length = (int)strlen(suffix);
+    if (w->length - length < limit || !ends_with(w, w->length, suffix, length)) return FALSE;
+    truncate_to(w, w->length - length);
+    return TRUE;
+}
+
+// Region after the first consonant that follows a vowel, looking from start on
+static int region_after(const char* text, int length, int start) {
+    for (int i = start + 1; i < length; ++i) {
+        if (!is_vowel(text[i]) && is_vowel(text[i - 1])) return i + 1;
+    }
+    return length;
+}
+
+static void mark_regions(StemWord* w) {
+    const char* t = w->text;
+    int i = 2;
+    w->rv = w->length;
+    if (w->length >= 2 && !is_vowel(t[1])) {
+        // after the next vowel
+        while (i < w->length && !is_vowel(t[i])) i++;
+        if (i < w->length) w->rv = i + 1;
+    } else if (w->length >= 2 && is_vowel(t[0])) {
+        // two vowels: after the next consonant
+        while (i < w->length && is_vowel(t[i])) i++;
+        if (i < w->length) w->rv = i + 1;
+    } else if (w->length >= 3) {
+        w->rv = 3;
+    }
+    w->r1 = region_after(t, w->length, 0);
+    w->r2 = region_after(t, w->length, w->r1);
+}
+
+// Step 0: "mirandolo" -> "mirando", the ending stays for step 2
+static void attached_pronoun(StemWord* w) {
+    int p = longest_suffix(w, w->length, &pronoun_table, 0);
+    if (p < 0) return;
+    int end = w->length - pronouns[p].length;
+    int b = longest_suffix(w, end, &pronoun_base_table, 0);
+    if (b < 0 || end - pronoun_bases[b].length < w->rv) return;
+    if (strcmp(pronoun_bases[b].text, "yendo") == 0 && !ends_with(w, end - 5, "u", 1)) return;
+    truncate_to(w, end);
+}
+
+// Step 1; FALSE if no suffix was removed
+static BOOLEAN standard_suffix(StemWord* w) {
+    int best = longest_suffix(w, w->length, &standard_table, 0);
+    if (best < 0) return FALSE;
+
+    // the longest suffix decides, a shorter one is not tried when it is outside its region
+    int start = w->length - standard_suffixes[best].length;
+    SuffixRule rule = standard_suffixes[best].rule;
+    if (start < (rule == RULE_AMENTE ? w->r1 : w->r2)) return FALSE;
+    truncate_to(w, start);
+
+    switch (rule) {
+    case RULE_DELETE:
+        break;
+    case RULE_IC:
+        remove_in(w, "ic", w->r2);
+        break;
+    case RULE_UCION:
+        strcpy(w->text + start, "u");
+        w->length = start + 1;
+        break;
+    case RULE_ENCIA:
+        strcpy(w->text + start, "ente");
+        w->length = start + 4;
+        break;
+    case RULE_AMENTE:
+        if (remove_in(w, "iv", w->r2)) remove_in(w, "at", w->r2);
+        else if (!remove_in(w, "os", w->r2) && !remove_in(w, "ic", w->r2)) remove_in(w, "ad", w->r2);
+        break;
+    case RULE_MENTE:
+        if (!remove_in(w, "ante", w->r2) && !remove_in(w, "able", w->r2)) remove_in(w, "ible", w->r2);
+        break;
+    case RULE_IDAD:
+        if (!remove_in(w, "abil", w->r2) && !remove_in(w, "ic", w->r2)) remove_in(w, "iv", w->r2);
+        break;
+    case RULE_IVA:
+        remove_in(w, "at", w->r2);
+        break;
+    }
+    return TRUE;
+}
+
+// Step 2a: verb endings starting with "y", after a "u" ("construyendo" -> "constru")
+static BOOLEAN y_verb_suffix(StemWord* w) {
+    int s = longest_suffix(w, w->length, &y_verb_table, w->rv);
+    if (s < 0) return FALSE;
+    int start = w->length - y_verb_suffixes[s].length;
+    if (!ends_with(w, start, "u", 1)) return FALSE;
+    truncate_to(w, start);
+    return TRUE;
+}
+
+// Step 2b
+static void verb_suffix(StemWord* w) {
+    int s = longest_suffix(w, w->length, &verb_table, w->rv);
+    if (s < 0) return;
+    truncate_to(w, w->length - verb_suffixes[s].length);
+    if (s < GU_VERB_SUFFIXES && ends_with(w, w->length, "gu", 2)) truncate_to(w, w->length - 1);
+}
+
+// Step 3
+static void residual_suffix(StemWord* w) {
+    if (remove_in(w, "os", w->rv) || remove_in(w, "a", w->rv) || remove_in(w, "o", w->rv)) return;
+    if (remove_in(w, "e", w->rv) && w->length - 1 >= w->rv && ends_with(w, w->length, "gu", 2)) {
+        truncate_to(w, w->length - 1);
+    }
+}
+
+int ST_Stem(char* word) {
+    pthread_once(&tables_once, build_tables);
+    StemWord w = { word, (int)strlen(word), 0, 0, 0 };
+    mark_regions(&w);
+    attached_pronoun(&w);
+    if (!standard_suffix(&w) && !y_verb_suffix(&w)) verb_suffix(&w);
+    residual_suffix(&w);
+    return w.length;
+}
@@ -0,0 +1,24 @@
+#ifndef STEM_H
+#define STEM_H
+
+/*
+ * Spanish stemmer after the Snowball algorithm
+ * (snowballstem.org/algorithms/spanish/stemmer.html): inflected forms share one stem,
+ * "caballero", "caballeros" -> "caballer", "andaba", "andaban" -> "andab".
+ *
+ * The word is split in regions (RV, R1, R2, from the positions of its vowels) and then
+ *   step 0   attached pronouns after a gerund or infinitive ("mirandolo" -> "mirando")
+ *   step 1   derivational suffixes (-amiento, -ista, -mente, -idad, ...) in R2
+ *   step 2   if step 1 removed nothing, verb endings in RV (-aban, -ieron, -yendo, ...)
+ *   step 3   a residual vowel (-os, -a, -o, -e) in RV
+ *
+ * Words are lowercase ASCII, as the tokenizer produces them: accented letters are not
+ * letters for the loader ("caballería" is "caballer" + "a"), so the suffixes of the
+ * algorithm that need one (-ación, -logía, -ían) never apply and are left out. Other
+ * bytes count as consonants.
+ */
+
+// Stem word in place (lowercase, NUL-terminated); returns its new length
+int ST_Stem(char* word);
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+
+/*
+ * Carga los libros con y sin stemming y compara el tamanho del vocabulario, la memoria
+ * del diccionario y de los postings, el tiempo de carga, y cuantas apariciones encuentra
+ * cada consulta (recall): con stemming "caballero" tambien trae "caballeros".
+ *
+ *   Stem_bench [file...]     (por defecto los cuatro libros de libros/)
+ */
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static const char* words[] = {
+    "caballero", "escudero", "aventura", "andaba", "gobernador", "hermosa", "encantado",
+    "batalla", "dijo", "isla", "tesoro", "capitan", "barco", "lobo", "perro"
+};
+#define WORDS ((int)(sizeof(words) / sizeof(words[0])))
+
+static const char* phrases[] = { "caballero andante", "vuestra merced", "buen hombre", "dijo el capitan" };
+#define PHRASES ((int)(sizeof(phrases) / sizeof(phrases[0])))
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static InvertedIndex* load(BOOLEAN stemming, const char* files[], int file_count, double* elapsed) {
+    InvertedIndex* idx = II_Create();
+    II_SetStemming(idx, stemming);
+    double start = now_ms();
+    for (int f = 0; f < file_count; ++f) {
+        if (II_LoadFile(idx, files[f]) < 0) {
+            fprintf(stderr, "No se pudo cargar '%s'\n", files[f]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    *elapsed = now_ms() - start;
+    return idx;
+}
+
+static int count_matches(const InvertedIndex* idx, const char* phrase) {
+    SearchCursor* cursor = II_PhraseOpen(idx, phrase);
+    printData result;
+    int count = 0;
+    while (II_SearchNext(cursor, &result)) count++;
+    II_SearchClose(cursor);
+    return count;
+}
+
+int main(int argc, char** argv) {
+    const char* defaults[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+    const char** files = argc > 1 ? (const char**)argv + 1 : defaults;
+    int file_count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    if (file_count > MAX_OPEN_FILES) file_count = MAX_OPEN_FILES;
+
+    double plain_ms, stemmed_ms;
+    InvertedIndex* plain = load(FALSE, files, file_count, &plain_ms);
+    InvertedIndex* stemmed = load(TRUE, files, file_count, &stemmed_ms);
+
+    printf("\n%-28s %14s %14s\n", "", "sin stemming", "con stemming");
+    printf("%-28s %14d %14d\n", "vocabulario", HTSize(plain->table), HTSize(stemmed->table));
+    printf("%-28s %11zu KB %11zu KB\n", "diccionario", II_DictionaryMemory(plain) >> 10, II_DictionaryMemory(stemmed) >> 10);
+    printf("%-28s %11zu KB %11zu KB\n", "postings", II_PostingsMemory(plain) >> 10, II_PostingsMemory(stemmed) >> 10);
+    printf("%-28s %14zu %14zu\n", "palabras para sugerencias", bktree_size(plain->terms_tree), bktree_size(stemmed->terms_tree));
+    printf("%-28s %11.1f ms %11.1f ms\n", "carga", plain_ms, stemmed_ms);
+
+    printf("\n%-28s %14s %14s\n", "apariciones de", "sin stemming", "con stemming");
+    long plain_total = 0, stemmed_total = 0;
+    for (int w = 0; w < WORDS; ++w) {
+        long a = II_TermCount(plain, words[w]), b = II_TermCount(stemmed, words[w]);
+        printf("%-28s %14ld %14ld\n", words[w], a, b);
+        plain_total += a;
+        stemmed_total += b;
+    }
+    for (int p = 0; p < PHRASES; ++p) {
+        int a = count_matches(plain, phrases[p]), b = count_matches(stemmed, phrases[p]);
+        char label[64];
+        snprintf(label, sizeof(label), "\"%s\"", phrases[p]);
+        printf("%-28s %14d %14d\n", label, a, b);
+        plain_total += a;
+        stemmed_total += b;
+    }
+    printf("%-28s %14ld %14ld (%.2fx)\n", "total", plain_total, stemmed_total,
+           plain_total > 0 ? (double)stemmed_total / plain_total : 0.0);
+
+    II_Destroy(plain);
+    II_Destroy(stemmed);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <assert.h>
+#include "InvertedIndex.h"
+#include "Rank.h"
+#include "Stem.h"
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+/* Raices que da el algoritmo de referencia (snowballstem.org) */
+static const char* expected[][2] = {
+    { "caballero", "caballer" }, { "caballeros", "caballer" }, { "caballerosamente", "caballer" },
+    { "andaba", "andab" }, { "andaban", "andab" }, { "andar", "andar" }, { "andantes", "andant" },
+    { "mirandolo", "mir" }, { "diciendole", "dic" }, { "construyendo", "constru" }, { "huyendo", "huyend" },
+    { "averiguen", "averig" }, { "averiguemos", "averig" }, { "actividades", "activ" },
+    { "posibilidad", "posibil" }, { "rapidamente", "rapid" }, { "naturalmente", "natural" },
+    { "abundancia", "abund" }, { "gobernadores", "gobern" }, { "hermosas", "herm" },
+    { "preocupaciones", "preocup" }, { "contribuciones", "contribu" }, { "diferencias", "diferent" },
+    { "creativas", "creativ" }, { "interesantes", "interes" }, { "islas", "islas" },
+    { "de", "de" }, { "a", "a" }, { "", "" }
+};
+
+static void assert_stem(const char* word, const char* stem) {
+    char buffer[MAX_WORD_LENGTH + 1];
+    strcpy(buffer, word);
+    assert(ST_Stem(buffer) == (int)strlen(stem));
+    assert(strcmp(buffer, stem) == 0);
+}
+
+/* Apariciones de una clave tal cual esta en el diccionario (II_TermCount la volveria a reducir) */
+static long key_count(const InvertedIndex* idx, const char* key) {
+    void* id;
+    if (!HTGet(idx->table, (char*)key, &id)) return -1;
+    long total = 0;
+    for (const Occurrence* cur = II_TermPostings(idx, (TermId)((intptr_t)id - 1))->first; cur; cur = cur->next) total += (long)GetOrdinalCount(cur);
+    return total;
+}
+
+static int count_matches(const InvertedIndex* idx, const char* phrase) {
+    SearchCursor* cursor = II_PhraseOpen(idx, phrase);
+    printData result;
+    int count = 0;
+    while (II_SearchNext(cursor, &result)) count++;
+    II_SearchClose(cursor);
+    return count;
+}
+
+static InvertedIndex* load(const char* book, BOOLEAN stemming) {
+    InvertedIndex* idx = II_Create();
+    II_SetStemming(idx, stemming);
+    assert(II_LoadFile(idx, book) == 0);
+    return idx;
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) assert_stem(expected[i][0], expected[i][1]);
+
+    // Cada raiz junta las apariciones de todas las palabras que la dan
+    InvertedIndex* plain = load("DonQuijote.txt", FALSE);
+    InvertedIndex* stemmed = load("DonQuijote.txt", TRUE);
+    assert(HTSize(stemmed->table) < HTSize(plain->table) * 2 / 3);
+    HashTable sums = HTCreate();
+    int pos = 0;
+    char* word;
+    while (HTNext(plain->table, &pos, &word, NULL)) {
+        char stem[MAX_WORD_LENGTH + 1];
+        strcpy(stem, word);
+        ST_Stem(stem);
+        void* sum = NULL;
+        HTGet(sums, stem, &sum);
+        HTPut(sums, stem, (void*)((intptr_t)sum + II_TermCount(plain, word)));
+    }
+    assert(HTSize(sums) == HTSize(stemmed->table));
+    pos = 0;
+    void* sum;
+    while (HTNext(sums, &pos, &word, &sum)) assert(key_count(stemmed, word) == (intptr_t)sum);
+    HTDestroy(sums);
+
+    // Cualquier forma de la consulta encuentra todas las formas del texto
+    long caballeros = II_TermCount(stemmed, "caballeros");
+    assert(caballeros == II_TermCount(stemmed, "Caballero"));
+    assert(caballeros > II_TermCount(plain, "caballero") + II_TermCount(plain, "caballeros"));
+    int phrases = count_matches(stemmed, "caballeros andantes");
+    assert(phrases == count_matches(stemmed, "caballero andante"));
+    assert(phrases > count_matches(plain, "caballeros andantes"));
+    assert(phrases >= count_matches(plain, "caballeros andantes") + count_matches(plain, "caballero andante"));
+
+    // La forma original sale de la posicion; el resaltado cubre la palabra entera
+    const OccurrenceList* postings = II_Postings(stemmed, "caballero");
+    PostingCursor cursor;
+    OpenPostingCursor(&cursor, postings);
+    BOOLEAN singular = FALSE, plural = FALSE;
+    char surface[MAX_WORD_LENGTH + 1];
+    do {
+        int length = II_SurfaceForm(stemmed, 0, CursorOrdinal(&cursor), surface, sizeof(surface));
+        assert(length == (int)strlen(surface));
+        char stem[MAX_WORD_LENGTH + 1];
+        for (int c = 0; c <= length; ++c) stem[c] = (char)tolower((unsigned char)surface[c]);
+        ST_Stem(stem);
+        assert(strcmp(stem, "caballer") == 0);
+        singular |= strcmp(surface, "caballero") == 0;
+        plural |= strcmp(surface, "caballeros") == 0;
+    } while (CursorNextOrdinal(&cursor));
+    assert(singular && plural);
+    assert(II_SurfaceForm(stemmed, 0, -1, surface, sizeof(surface)) == -1);
+    assert(II_SurfaceForm(stemmed, 1, 0, surface, sizeof(surface)) == -1);
+    assert(II_SurfaceForm(stemmed, 0, 1, surface, 3) > 2 && strlen(surface) == 2);
+
+    printData result;
+    char* words[] = { "caballeros", "andantes" };
+    SearchCursor* search = II_PhraseOpen(stemmed, "caballeros andantes");
+    assert(II_SearchNext(search, &result));
+    II_SearchClose(search);
+    TextSpan spans[16];
+    int span_count = II_MatchSpans(stemmed, &result, words, 2, spans, 16);
+    assert(span_count >= 2);
+    for (int s = 0; s < span_count; ++s) {
+        const char* text = stemmed->documents[0]->data + spans[s].offset;
+        assert(strncasecmp(text, "caballer", 8) == 0 || strncasecmp(text, "andant", 6) == 0);
+        assert(!isalpha((unsigned char)text[spans[s].length]) && spans[s].length >= 6);
+    }
+
+    // Las sugerencias son palabras y no raices
+    termCandidate candidates[FUZZY_MAX_CANDIDATES];
+    int n = II_FuzzyLookup(stemmed, "cabalero", 2, candidates, FUZZY_MAX_CANDIDATES);
+    assert(n > 0 && strcmp(candidates[0].term, "caballero") == 0 && candidates[0].frequency == caballeros);
+    char* misspelled[] = { "cabalero" };
+    char* corrected[1];
+    assert(II_CorrectWords(stemmed, misspelled, 1, 2, corrected) == 1);
+    assert(II_TermCount(stemmed, corrected[0]) == caballeros);
+
+    // El ranking busca con la misma raiz
+    RankedIndex* rank = RK_FromIndex(stemmed, RANK_PASSAGE_TOKENS);
+    RankHit hits[5];
+    char* ranked[] = { "caballeros" };
+    char* singular_word[] = { "caballero" };
+    RankHit other[5];
+    int hit_count = RK_TopK(rank, ranked, 1, RANK_OR, RANK_BLOCK_MAX_WAND, 5, hits, NULL);
+    assert(hit_count == 5);
+    assert(RK_TopK(rank, singular_word, 1, RANK_OR, RANK_BLOCK_MAX_WAND, 5, other, NULL) == 5);
+    assert(memcmp(hits, other, sizeof(hits)) == 0);
+    RK_Destroy(rank);
+
+    II_Destroy(plain);
+    II_Destroy(stemmed);
+    printf("Stem tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -59,6 +59,7 @@ int main(void) {
         assert(found == TRUE);
         int retrieved = (int)(intptr_t)vp;
         assert(retrieved == values[i]);
+        assert(HTProbes(ht, keys[i]) >= 1 && HTProbes(ht, keys[i]) <= ht->cap + ht->old_cap);
     }
 
     // Test updating existing keys
@@ -76,6 +77,8 @@ int main(void) {
         BOOLEAN ok = HTRemove(ht, keys[i]);
         assert(ok == TRUE);
         assert(HTContains(ht, keys[i]) == FALSE);
+        // the removed key's cell is a tombstone: the search goes past it
+        assert(HTProbes(ht, keys[i]) >= 2);
     }
     // New size should be NUM_TESTS/2
     assert(HTSize(ht) == NUM_TESTS - NUM_TESTS/2);
@@ -87,6 +90,67 @@ int main(void) {
         assert(HTGet(ht, keys[i], &vp) == TRUE);
     }
 
+    // Iteration sees every remaining key once, in both arrays while a resize is in progress
+    int pos = 0, seen = 0;
+    char *clave;
+    void *vp;
+    while (HTNext(ht, &pos, &clave, &vp)) {
+        assert(HTGet(ht, clave, &vp) == TRUE);
+        seen++;
+    }
+    assert(seen == NUM_TESTS - NUM_TESTS/2);
+
+    // With incremental resize off, the old array is gone as soon as HTPut returns
+    HashTable eager = HTCreate();
+    assert(eager != NULL);
+    HTSetIncrementalResize(eager, FALSE);
+    for (int i = 0; i < NUM_TESTS; i++) {
+        assert(HTPut(eager, keys[i], (void*)(intptr_t)values[i]) == TRUE);
+        assert(eager->old_arr == NULL);
+    }
+    for (int i = 0; i < NUM_TESTS; i++) {
+        assert(HTGet(eager, keys[i], &vp) == TRUE);
+        assert((int)(intptr_t)vp == values[i]);
+    }
+    assert(HTDestroy(eager) == TRUE);
+
+    // Updating a key with the put that starts a resize doesn't leave it in both arrays
+    HashTable full = HTCreate();
+    assert(full != NULL);
+    int fill = 0;
+    while ((double)(HTSize(full) + 1) / full->cap <= REHASH_THRESHOLD) {
+        assert(HTPut(full, keys[fill], (void*)(intptr_t)values[fill]) == TRUE);
+        fill++;
+    }
+    assert(HTPut(full, keys[0], (void*)(intptr_t)-1) == TRUE);
+    assert(HTSize(full) == fill);
+    assert(HTGet(full, keys[0], &vp) == TRUE && (int)(intptr_t)vp == -1);
+    pos = 0;
+    seen = 0;
+    while (HTNext(full, &pos, NULL, NULL)) seen++;
+    assert(seen == fill);
+    // the resize that put started is finished on demand, and no key is lost
+    assert(full->old_arr != NULL);
+    HTFinishResize(full);
+    assert(full->old_arr == NULL && HTSize(full) == fill);
+    for (int i = 0; i < fill; i++) assert(HTContains(full, keys[i]) == TRUE);
+    HTFinishResize(full);
+    assert(HTDestroy(full) == TRUE);
+
+    // A reserved table takes NUM_TESTS keys without growing
+    HashTable sized = HTCreateWithCapacity(1031);
+    assert(sized != NULL && sized->cap == 1031);
+    assert(HTReserve(sized, NUM_TESTS) == TRUE);
+    assert(sized->cap >= NUM_TESTS / REHASH_THRESHOLD);
+    for (int i = 0; i < NUM_TESTS; i++) {
+        assert(HTPut(sized, keys[i], (void*)(intptr_t)values[i]) == TRUE);
+    }
+    assert(sized->resizes == 0);
+    for (int i = 0; i < NUM_TESTS; i++) {
+        assert(HTGet(sized, keys[i], &vp) == TRUE && (int)(intptr_t)vp == values[i]);
+    }
+    assert(HTDestroy(sized) == TRUE);
+
     // Clear table
     BOOLEAN destroyed = HTDestroy(ht);
     assert(destroyed == TRUE);
@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Trigram.h"
+#include "boolean.h"
+#include "ArrayList/arraylist.h"
+#include "Allocator/allocator.h"
+
+static inline unsigned char fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static inline uint32_t trigram_at(const unsigned char* text) {
+    return (uint32_t)fold(text[0]) << 16 | (uint32_t)fold(text[1]) << 8 | fold(text[2]);
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// (trigram << 32 | block) for every distinct trigram of every block; returns how many
+static size_t collect_pairs(const unsigned char* text, size_t size, long block_count, uint64_t* pairs) {
+    uint32_t block[TRIGRAM_BLOCK + TRIGRAM_OVERLAP];
+    size_t starts = size - 2;   // positions where a trigram starts
+    size_t count = 0;
+    for (long b = 0; b < block_count; ++b) {
+        size_t first = (size_t)b * TRIGRAM_BLOCK;
+        size_t end = first + TRIGRAM_BLOCK + TRIGRAM_OVERLAP;
+        if (end > starts) end = starts;
+        if (first >= end) break;
+
+        size_t n = 0;
+        for (size_t p = first; p < end; ++p) block[n++] = trigram_at(text + p);
+        qsort(block, n, sizeof(uint32_t), compare_u32);
+        for (size_t i = 0; i < n; ++i) {
+            if (i == 0 || block[i] != block[i - 1]) pairs[count++] = (uint64_t)block[i] << 32 | (uint64_t)b;
+        }
+    }
+    return count;
+}
+
+// A list of count blocks (out of block_count) is stored as a bitmap when that is smaller
+static inline BOOLEAN is_bitmap(uint32_t count, long block_count) {
+    return (long)count * 8 > block_count;
+}
+
+static size_t varint_size(uint32_t value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+static unsigned char* put_varint(unsigned char* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+    return out;
+}
+
+static const unsigned char* get_varint(const unsigned char* in, uint32_t* value) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        result |= (uint32_t)(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    *value = result | (uint32_t)*in++ << shift;
+    return in;
+}
+
+// Bytes of the list of pairs[first..first+count) (one trigram, blocks ascending)
+static size_t list_size(const uint64_t* pairs, size_t first, uint32_t count, long block_count) {
+    if (is_bitmap(count, block_count)) return (size_t)(block_count + 7) / 8;
+    size_t bytes = 0;
+    uint32_t previous = 0;
+    for (size_t i = first; i < first + count; ++i) {
+        uint32_t block = (uint32_t)pairs[i];
+        bytes += varint_size(block - previous);
+        previous = block;
+    }
+    return bytes;
+}
+
+static void write_list(const uint64_t* pairs, size_t first, uint32_t count, long block_count, unsigned char* out) {
+    if (is_bitmap(count, block_count)) {
+        memset(out, 0, (size_t)(block_count + 7) / 8);
+        for (size_t i = first; i < first + count; ++i) {
+            uint32_t block = (uint32_t)pairs[i];
+            out[block >> 3] |= (unsigned char)(1u << (block & 7));
+        }
+        return;
+    }
+    uint32_t previous = 0;
+    for (size_t i = first; i < first + count; ++i) {
+        uint32_t block = (uint32_t)pairs[i];
+        out = put_varint(out, block - previous);
+        previous = block;
+    }
+}
+
+// bytes of the lists buffer (at least one, so an index without lists still gets a block)
+static size_t data_size(const TrigramIndex* index) {
+    size_t bytes = index->starts ? index->starts[index->count] : 0;
+    return bytes > 0 ? bytes : 1;
+}
+
+TrigramIndex* TG_Build(const char* data, size_t size) {
+    TrigramIndex* index = mem_calloc(MEM_TRIGRAMS, 1, sizeof(TrigramIndex));
+    if (!index) return NULL;
+    index->text_size = size;
+    index->block_count = (long)((size + TRIGRAM_BLOCK - 1) / TRIGRAM_BLOCK);
+    index->starts = mem_calloc(MEM_TRIGRAMS, 1, sizeof(size_t));
+    if (!index->starts) {
+        TG_Destroy(index);
+        return NULL;
+    }
+    if (size < 3) return index;
+
+    // sorted by trigram then block, the pairs of a trigram are its block list in order
+    size_t capacity = (size - 2) + (size_t)index->block_count * TRIGRAM_OVERLAP;
+    uint64_t* pairs = malloc(capacity * sizeof(uint64_t));
+    if (!pairs) {
+        TG_Destroy(index);
+        return NULL;
+    }
+    size_t pair_count = collect_pairs((const unsigned char*)data, size, index->block_count, pairs);
+    arraylist_sort_u64(pairs, pair_count, NULL, 0);
+
+    size_t distinct = 0;
+    for (size_t i = 0; i < pair_count; ++i) {
+        if (i == 0 || pairs[i] >> 32 != pairs[i - 1] >> 32) distinct++;
+    }
+    uint32_t* trigrams = mem_malloc(MEM_TRIGRAMS, distinct * sizeof(uint32_t));
+    uint32_t* counts = mem_malloc(MEM_TRIGRAMS, distinct * sizeof(uint32_t));
+    size_t* starts = mem_malloc(MEM_TRIGRAMS, (distinct + 1) * sizeof(size_t));
+    if (!trigrams || !counts || !starts) {
+        mem_free(MEM_TRIGRAMS, trigrams, distinct * sizeof(uint32_t));
+        mem_free(MEM_TRIGRAMS, counts, distinct * sizeof(uint32_t));
+        mem_free(MEM_TRIGRAMS, starts, (distinct + 1) * sizeof(size_t));
+        free(pairs);
+        TG_Destroy(index);
+        return NULL;
+    }
+    mem_free(MEM_TRIGRAMS, index->starts, sizeof(size_t));
+    index->trigrams = trigrams;
+    index->counts = counts;
+    index->starts = starts;
+    index->count = distinct;
+
+    // first pass sizes every list, the second one writes them into one buffer
+    size_t bytes = 0;
+    size_t t = 0;
+    for (size_t i = 0; i < pair_count; ++t) {
+        size_t first = i;
+        while (i < pair_count && pairs[i] >> 32 == pairs[first] >> 32) i++;
+        index->trigrams[t] = (uint32_t)(pairs[first] >> 32);
+        index->counts[t] = (uint32_t)(i - first);
+        index->starts[t] = bytes;
+        bytes += list_size(pairs, first, (uint32_t)(i - first), index->block_count);
+    }
+    index->starts[index->count] = bytes;
+    index->data = mem_malloc(MEM_TRIGRAMS, data_size(index));
+    if (!index->data) {
+        free(pairs);
+        TG_Destroy(index);
+        return NULL;
+    }
+    size_t first = 0;
+    for (t = 0; t < index->count; ++t) {
+        write_list(pairs, first, index->counts[t], index->block_count, index->data + index->starts[t]);
+        first += index->counts[t];
+    }
+    free(pairs);
+    return index;
+}
+
+void TG_Destroy(TrigramIndex* index) {
+    if (!index) return;
+    mem_free(MEM_TRIGRAMS, index->data, data_size(index));
+    mem_free(MEM_TRIGRAMS, index->trigrams, index->count * sizeof(uint32_t));
+    mem_free(MEM_TRIGRAMS, index->counts, index->count * sizeof(uint32_t));
+    mem_free(MEM_TRIGRAMS, index->starts, (index->count + 1) * sizeof(size_t));
+    mem_free(MEM_TRIGRAMS, index, sizeof(TrigramIndex));
+}
+
+size_t TG_Memory(const TrigramIndex* index) {
+    if (!index) return 0;
+    return sizeof(TrigramIndex) + index->count * 2 * sizeof(uint32_t) + (index->count + 1) * sizeof(size_t) +
+           (index->data ? data_size(index) : 0);
+}
+
+// Position of trigram in the index, -1 if the document doesn't have it
+static long find_trigram(const TrigramIndex* index, uint32_t trigram) {
+    size_t low = 0, high = index->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (index->trigrams[mid] < trigram) low = mid + 1;
+        else high = mid;
+    }
+    return low < index->count && index->trigrams[low] == trigram ? (long)low : -1;
+}
+
+// Blocks of list t into out (counts[t] entries)
+static void decode_list(const TrigramIndex* index, size_t t, uint32_t* out) {
+    const unsigned char* list = index->data + index->starts[t];
+    size_t n = 0;
+    if (is_bitmap(index->counts[t], index->block_count)) {
+        for (long block = 0; block < index->block_count; ++block) {
+            if (list[block >> 3] & (1u << (block & 7))) out[n++] = (uint32_t)block;
+        }
+        return;
+    }
+    uint32_t block = 0;
+    for (uint32_t i = 0; i < index->counts[t]; ++i) {
+        uint32_t gap;
+        list = get_varint(list, &gap);
+        block += gap;
+        out[n++] = block;
+    }
+}
+
+// Keep the candidates that list t holds; returns how many are left
+static size_t intersect_list(const TrigramIndex* index, size_t t, uint32_t* candidates, size_t n) {
+    const unsigned char* list = index->data + index->starts[t];
+    size_t kept = 0;
+    if (is_bitmap(index->counts[t], index->block_count)) {
+        for (size_t c = 0; c < n; ++c) {
+            if (list[candidates[c] >> 3] & (1u << (candidates[c] & 7))) candidates[kept++] = candidates[c];
+        }
+        return kept;
+    }
+    // merge with the varint stream, which is read only up to the last candidate
+    uint32_t block = 0, remaining = index->counts[t];
+    BOOLEAN started = FALSE;
+    for (size_t c = 0; c < n; ++c) {
+        while (remaining > 0 && (!started || block < candidates[c])) {
+            uint32_t gap;
+            list = get_varint(list, &gap);
+            block += gap;
+            remaining--;
+            started = TRUE;
+        }
+        if (!started || block < candidates[c]) break;
+        if (block == candidates[c]) candidates[kept++] = candidates[c];
+    }
+    return kept;
+}
+
+static inline BOOLEAN matches_at(const unsigned char* text, const unsigned char* folded, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        if (fold(text[i]) != folded[i]) return FALSE;
+    }
+    return TRUE;
+}
+
+// Compare folded at every start in [first, end); found counts all, out keeps max_out
+static long verify(const unsigned char* text, size_t first, size_t end, const unsigned char* folded, size_t length,
+                   long found, long* out, long max_out) {
+    for (size_t s = first; s < end; ++s) {
+        if (fold(text[s]) != folded[0] || !matches_at(text + s, folded, length)) continue;
+        if (found < max_out) out[found] = (long)s;
+        found++;
+    }
+    return found;
+}
+
+// Folded copy of pattern; its length, or 0 if it is empty or too long
+static size_t fold_pattern(const char* pattern, unsigned char* folded) {
+    size_t length = pattern ? strlen(pattern) : 0;
+    if (length > TRIGRAM_MAX_PATTERN) return 0;
+    for (size_t i = 0; i < length; ++i) folded[i] = fold((unsigned char)pattern[i]);
+    return length;
+}
+
+long TG_Scan(const char* data, size_t size, const char* pattern, long* out, long max_out) {
+    unsigned char folded[TRIGRAM_MAX_PATTERN];
+    size_t length = fold_pattern(pattern, folded);
+    if (length == 0) return -1;
+    if (!data || length > size) return 0;
+    return verify((const unsigned char*)data, 0, size - length + 1, folded, length, 0, out, max_out);
+}
+
+long TG_Search(const TrigramIndex* index, const char* data, size_t size, const char* pattern,
+               long* out, long max_out, TrigramStats* stats) {
+    if (stats) memset(stats, 0, sizeof(TrigramStats));
+    unsigned char folded[TRIGRAM_MAX_PATTERN];
+    size_t length = fold_pattern(pattern, folded);
+    if (length == 0) return -1;
+    if (!data || length > size) return 0;
+    // nothing to filter with (or an index of another text): compare everywhere
+    if (!index || length < 3 || index->text_size != size) {
+        if (stats) stats->verified_bytes = (long)(size - length + 1);
+        return TG_Scan(data, size, pattern, out, max_out);
+    }
+
+    // the block of a match holds every trigram of its first TRIGRAM_OVERLAP + 2 bytes
+    size_t prefix = length < TRIGRAM_OVERLAP + 2 ? length : TRIGRAM_OVERLAP + 2;
+    size_t lists[TRIGRAM_OVERLAP];
+    int list_count = 0;
+    for (size_t i = 0; i + 3 <= prefix; ++i) {
+        long t = find_trigram(index, trigram_at(folded + i));
+        if (t < 0) return 0;
+        int l = 0;
+        while (l < list_count && lists[l] != (size_t)t) l++;
+        if (l < list_count) continue;
+        // insertion by size, the rarest trigram drives the intersection
+        for (l = list_count++; l > 0 && index->counts[lists[l - 1]] > index->counts[t]; --l) lists[l] = lists[l - 1];
+        lists[l] = (size_t)t;
+    }
+
+    uint32_t* candidates = malloc(index->counts[lists[0]] * sizeof(uint32_t));
+    if (!candidates) return TG_Scan(data, size, pattern, out, max_out);
+    decode_list(index, lists[0], candidates);
+    size_t candidate_count = index->counts[lists[0]];
+    for (int l = 1; l < list_count && candidate_count > 0; ++l) {
+        candidate_count = intersect_list(index, lists[l], candidates, candidate_count);
+    }
+
+    const unsigned char* text = (const unsigned char*)data;
+    size_t last_start = size - length + 1;
+    long found = 0;
+    for (size_t c = 0; c < candidate_count; ++c) {
+        size_t first = (size_t)candidates[c] * TRIGRAM_BLOCK;
+        size_t end = first + TRIGRAM_BLOCK < last_start ? first + TRIGRAM_BLOCK : last_start;
+        if (first >= end) continue;
+        found = verify(text, first, end, folded, length, found, out, max_out);
+        if (stats) stats->verified_bytes += (long)(end - first);
+    }
+    free(candidates);
+    if (stats) {
+        stats->trigrams = list_count;
+        stats->candidate_blocks = (long)candidate_count;
+    }
+    return found;
+}
@@ -0,0 +1,62 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRIGRAM_BLOCK 256           // bytes of text per block, the lists say which blocks hold a trigram
+#define TRIGRAM_OVERLAP 32         // a block also indexes the trigrams starting this far into the next one
+#define TRIGRAM_MAX_PATTERN 256    // longest substring accepted by TG_Search / TG_Scan
+
+/*
+ * Substring search inside one document. The text is cut in blocks of TRIGRAM_BLOCK bytes
+ * and every distinct trigram (3 consecutive bytes, ASCII letters lowercased) keeps the
+ * list of blocks it appears in. Lists are packed one after the other in a single buffer:
+ * gaps between block numbers as varints (a byte each for most lists), or, for trigrams in
+ * more than one block out of 8 ("de ", " qu"), a bitmap of the document's blocks.
+ *
+ * A block indexes the trigrams that start in it and in the first TRIGRAM_OVERLAP bytes of
+ * the next block, so every trigram of a match's first TRIGRAM_OVERLAP + 2 bytes is in the
+ * block where the match starts. Intersecting their lists (rarest first) gives the candidate
+ * blocks, and only those are compared against the text, from the start of the block to
+ * the last start position inside it, so each match is found once. Longer patterns are
+ * filtered by their first TRIGRAM_OVERLAP + 2 bytes and verified in full; patterns shorter
+ * than a trigram fall back to the linear scan.
+ *
+ * Matching is case-insensitive for ASCII letters only (UTF-8 accented letters must match
+ * exactly) and overlapping occurrences are all reported.
+ */
+
+typedef struct _TrigramIndex {
+    uint32_t* trigrams;       // distinct trigrams, sorted (3 folded bytes, first one highest)
+    uint32_t* counts;         // blocks holding each trigram
+    size_t* starts;           // where each list begins in data, starts[count] is the end
+    unsigned char* data;      // the lists: varint gaps, or a bitmap when counts[t] * 8 > block_count
+    size_t count;
+    long block_count;
+    size_t text_size;         // bytes of the document it was built for
+} TrigramIndex;
+
+typedef struct _TrigramStats {
+    int trigrams;             // trigrams of the pattern intersected
+    long candidate_blocks;    // blocks holding all of them
+    long verified_bytes;      // start positions compared against the text
+} TrigramStats;
+
+// Index a document (ASCII letters folded to lowercase). Returns NULL if allocation fails
+TrigramIndex* TG_Build(const char* data, size_t size);
+void TG_Destroy(TrigramIndex* index);
+
+// Bytes allocated by the index
+size_t TG_Memory(const TrigramIndex* index);
+
+// Every occurrence of pattern in data (the text index was built from), in offset order.
+// Writes the first max_out offsets to out and returns the total, or -1 if pattern is empty
+// or longer than TRIGRAM_MAX_PATTERN. stats may be NULL
+long TG_Search(const TrigramIndex* index, const char* data, size_t size, const char* pattern,
+               long* out, long max_out, TrigramStats* stats);
+
+// Same result as TG_Search comparing at every position of data, without an index
+long TG_Scan(const char* data, size_t size, const char* pattern, long* out, long max_out);
+
+#endif
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "InvertedIndex.h"
+
+/*
+ * Busqueda de subcadenas ("sub: texto") en los cuatro libros:
+ *   - con el indice de trigramas: se intersectan los bloques candidatos y solo esos se
+ *     comparan contra el mapeo
+ *   - recorriendo todo el mapeo (II_SubstringSearch sin trigramas)
+ *   - leyendo cada libro con fgetc, la unica alternativa sin mapeo ni indice
+ * Cada consulta se repite REPEAT veces; se informa el tiempo medio y los bloques revisados.
+ *
+ *   Trigram_bench [repeticiones]     (por defecto 20)
+ */
+
+#define MAX_HITS 1000
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+#define BOOKS 4
+
+static const char* queries[] = {
+    "Dulcinea del Toboso", "quijote", "ote", "gobernador", "aventura", "ción", "caballeros andantes",
+    "isla del tesoro", "capit", "que", "xyzzy", "en un lugar de la Mancha, de cuyo nombre"
+};
+static const int query_count = sizeof(queries) / sizeof(queries[0]);
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int fold(int c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/* Sin indice ni mapeo: cada libro con fgetc, comparando los ultimos bytes leidos */
+static long fgetc_scan(const char* text) {
+    size_t length = strlen(text);
+    unsigned char window[TRIGRAM_MAX_PATTERN];
+    long found = 0;
+    for (int b = 0; b < BOOKS; ++b) {
+        FILE* f = open_file(books[b]);
+        size_t seen = 0;
+        int c;
+        while ((c = fgetc(f)) != EOF) {
+            window[seen++ % length] = (unsigned char)fold(c);
+            if (seen < length) continue;
+            size_t i = 0;
+            while (i < length && window[(seen + i) % length] == fold((unsigned char)text[i])) i++;
+            if (i == length) found++;
+        }
+        fclose(f);
+    }
+    return found;
+}
+
+int main(int argc, char** argv) {
+    int repeat = argc > 1 ? atoi(argv[1]) : 20;
+    if (repeat < 1) {
+        printf("Usage: %s [repeticiones]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    InvertedIndex* plain = II_Create();
+    InvertedIndex* indexed = II_Create();
+    II_SetTrigramIndex(indexed, TRUE);
+    size_t text_bytes = 0, trigram_bytes = 0, trigrams = 0;
+    double plain_ms = 0, indexed_ms = 0;
+    for (int b = 0; b < BOOKS; ++b) {
+        double start = now_ms();
+        if (II_LoadFile(plain, books[b]) < 0) return EXIT_FAILURE;
+        plain_ms += now_ms() - start;
+        start = now_ms();
+        if (II_LoadFile(indexed, books[b]) < 0) return EXIT_FAILURE;
+        indexed_ms += now_ms() - start;
+        text_bytes += indexed->documents[b]->size;
+        trigram_bytes += TG_Memory(indexed->trigrams[b]);
+        trigrams += indexed->trigrams[b]->count;
+    }
+    printf("\n%zu KB de texto, bloques de %d bytes: %zu trigramas distintos, indice de %zu KB (%.2f bytes por byte de texto)\n",
+           text_bytes >> 10, TRIGRAM_BLOCK, trigrams, trigram_bytes >> 10, (double)trigram_bytes / text_bytes);
+    printf("carga %.1f ms sin trigramas, %.1f ms con trigramas\n\n", plain_ms, indexed_ms);
+
+    printf("%-42s %8s %10s %10s %10s %9s %9s\n", "consulta", "hits", "trigr. us", "mapeo us", "fgetc us", "bloques", "x mapeo");
+    static SubstringHit hits[MAX_HITS];
+    double total_indexed = 0, total_scan = 0;
+    for (int q = 0; q < query_count; ++q) {
+        long found = 0;
+        double start = now_ms();
+        for (int r = 0; r < repeat; ++r) found = II_SubstringSearch(indexed, queries[q], hits, MAX_HITS);
+        double with_index = (now_ms() - start) * 1e3 / repeat;
+        start = now_ms();
+        for (int r = 0; r < repeat; ++r) {
+            if (II_SubstringSearch(plain, queries[q], hits, MAX_HITS) != found) return EXIT_FAILURE;
+        }
+        double scan = (now_ms() - start) * 1e3 / repeat;
+        start = now_ms();
+        if (fgetc_scan(queries[q]) != found) return EXIT_FAILURE;
+        double by_fgetc = (now_ms() - start) * 1e3;
+
+        long blocks = 0;
+        for (int b = 0; b < BOOKS; ++b) {
+            TrigramStats stats;
+            TG_Search(indexed->trigrams[b], indexed->documents[b]->data, indexed->documents[b]->size, queries[q], NULL, 0, &stats);
+            blocks += stats.candidate_blocks;
+        }
+        total_indexed += with_index;
+        total_scan += scan;
+        printf("%-42s %8ld %10.1f %10.1f %10.0f %9ld %9.1f\n", queries[q], found, with_index, scan, by_fgetc, blocks,
+               with_index > 0 ? scan / with_index : 0);
+    }
+    printf("\ntotal: %.1f us con trigramas, %.1f us recorriendo el mapeo (%.1fx)\n", total_indexed, total_scan,
+           total_indexed > 0 ? total_scan / total_indexed : 0);
+
+    II_Destroy(plain);
+    II_Destroy(indexed);
+    return EXIT_SUCCESS;
+}
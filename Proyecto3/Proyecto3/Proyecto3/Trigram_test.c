@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include "InvertedIndex.h"
+#include "Trigram.h"
+
+#define RANDOM_PATTERNS 1200
+#define MAX_HITS 200000
+
+static const char* books[] = { "DonQuijote.txt", "la_isla_del_tesoro.txt", "lobo.txt", "tesoro.txt" };
+#define BOOKS 4
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static long with_index[MAX_HITS];
+static long scanned[MAX_HITS];
+
+/* El indice da exactamente las mismas posiciones que recorrer todo el texto */
+static long assert_same_as_scan(const TrigramIndex* index, const MappedFile* doc, const char* pattern) {
+    TrigramStats stats;
+    long found = TG_Search(index, doc->data, doc->size, pattern, with_index, MAX_HITS, &stats);
+    long expected = TG_Scan(doc->data, doc->size, pattern, scanned, MAX_HITS);
+    assert(found == expected);
+    long stored = found < MAX_HITS ? found : MAX_HITS;
+    assert(memcmp(with_index, scanned, stored * sizeof(long)) == 0);
+    assert(stats.candidate_blocks <= index->block_count);
+    return found;
+}
+
+/* Copia de largo length del texto desde offset, sin '\0' en el medio */
+static BOOLEAN substring_at(const MappedFile* doc, size_t offset, size_t length, char* out) {
+    if (offset + length > doc->size) return FALSE;
+    memcpy(out, doc->data + offset, length);
+    out[length] = '\0';
+    return strlen(out) == length;
+}
+
+int main(void) {
+    srand(45);
+    MappedFile* docs[BOOKS];
+    TrigramIndex* indexes[BOOKS];
+    for (int b = 0; b < BOOKS; ++b) {
+        docs[b] = map_file(books[b]);
+        assert(docs[b] != NULL);
+        indexes[b] = TG_Build(docs[b]->data, docs[b]->size);
+        assert(indexes[b] != NULL && indexes[b]->count > 0);
+        assert(indexes[b]->block_count == (long)((docs[b]->size + TRIGRAM_BLOCK - 1) / TRIGRAM_BLOCK));
+    }
+
+    // Subcadenas tomadas del texto (de 1 a 60 bytes), en cualquier lugar y en los bordes de bloque
+    char pattern[TRIGRAM_MAX_PATTERN + 2];
+    for (int p = 0; p < RANDOM_PATTERNS; ++p) {
+        int b = p % BOOKS;
+        size_t length = 1 + (size_t)rand() % 60;
+        size_t offset = (size_t)rand() % docs[b]->size;
+        if (p % 3 == 0) {
+            // cruzando el final de un bloque
+            long block = rand() % indexes[b]->block_count;
+            offset = (size_t)block * TRIGRAM_BLOCK + TRIGRAM_BLOCK - 1 - (size_t)rand() % (length + 1);
+        }
+        if (!substring_at(docs[b], offset, length, pattern)) continue;
+        if (p % 5 == 0) {
+            for (char* c = pattern; *c; ++c) *c = (char)toupper((unsigned char)*c);
+        }
+        assert(assert_same_as_scan(indexes[b], docs[b], pattern) >= 1);
+    }
+
+    // Dentro de palabras y sin importar mayusculas; lo que no esta da 0
+    long ote = assert_same_as_scan(indexes[0], docs[0], "ote");
+    assert(ote > assert_same_as_scan(indexes[0], docs[0], "Quijote"));
+    assert(assert_same_as_scan(indexes[0], docs[0], "QUIJOTE") == assert_same_as_scan(indexes[0], docs[0], "quijote"));
+    assert(assert_same_as_scan(indexes[0], docs[0], "en un lugar de la Mancha") >= 1);
+    assert(assert_same_as_scan(indexes[0], docs[0], "qqzxwq") == 0);
+    assert(assert_same_as_scan(indexes[0], docs[0], "a") > ote);
+    assert(assert_same_as_scan(indexes[0], docs[0], "aaaa") == TG_Scan(docs[0]->data, docs[0]->size, "aaaa", NULL, 0));
+
+    // Un patron mas largo que lo filtrado por trigramas se verifica completo
+    assert(substring_at(docs[0], 100000, 120, pattern));
+    assert(assert_same_as_scan(indexes[0], docs[0], pattern) == 1);
+    pattern[119] = pattern[119] == 'x' ? 'y' : 'x';
+    assert(assert_same_as_scan(indexes[0], docs[0], pattern) == 0);
+
+    // Un patron raro solo revisa unos pocos bloques
+    TrigramStats stats;
+    assert(TG_Search(indexes[0], docs[0]->data, docs[0]->size, "Dulcinea del Toboso", NULL, 0, &stats) > 0);
+    assert(stats.candidate_blocks < indexes[0]->block_count / 10);
+    assert(stats.verified_bytes <= stats.candidate_blocks * TRIGRAM_BLOCK);
+
+    // Patrones invalidos y textos muy cortos
+    memset(pattern, 'a', TRIGRAM_MAX_PATTERN + 1);
+    pattern[TRIGRAM_MAX_PATTERN + 1] = '\0';
+    assert(TG_Search(indexes[0], docs[0]->data, docs[0]->size, pattern, NULL, 0, NULL) == -1);
+    assert(TG_Search(indexes[0], docs[0]->data, docs[0]->size, "", NULL, 0, NULL) == -1);
+    assert(TG_Scan(docs[0]->data, docs[0]->size, NULL, NULL, 0) == -1);
+    TrigramIndex* tiny = TG_Build("ab", 2);
+    assert(tiny != NULL && tiny->count == 0);
+    assert(TG_Search(tiny, "ab", 2, "AB", scanned, 1, NULL) == 1 && scanned[0] == 0);
+    assert(TG_Search(tiny, "ab", 2, "abc", NULL, 0, NULL) == 0);
+    TG_Destroy(tiny);
+    TrigramIndex* small = TG_Build("abcabc", 6);
+    assert(small != NULL && small->count == 3);
+    assert(TG_Search(small, "abcabc", 6, "bca", scanned, 2, NULL) == 1 && scanned[0] == 1);
+    TG_Destroy(small);
+
+    // II_SubstringSearch: con o sin trigramas, todos los documentos en orden
+    InvertedIndex* plain = II_Create();
+    InvertedIndex* indexed = II_Create();
+    II_SetTrigramIndex(indexed, TRUE);
+    for (int b = 0; b < BOOKS; ++b) {
+        assert(II_LoadFile(plain, books[b]) == b);
+        assert(II_LoadFile(indexed, books[b]) == b);
+        assert(plain->trigrams[b] == NULL && indexed->trigrams[b] != NULL);
+    }
+    static SubstringHit a[MAX_HITS], c[MAX_HITS];
+    const char* queries[] = { "ote", "isla", "capit", "lobo", "tesoro", "ción", "ñ", "xyzzy" };
+    for (int q = 0; q < 8; ++q) {
+        long total = II_SubstringSearch(indexed, queries[q], a, MAX_HITS);
+        assert(total == II_SubstringSearch(plain, queries[q], c, MAX_HITS));
+        long expected = 0;
+        for (int b = 0; b < BOOKS; ++b) expected += TG_Scan(docs[b]->data, docs[b]->size, queries[q], NULL, 0);
+        assert(total == expected);
+        assert(memcmp(a, c, (total < MAX_HITS ? total : MAX_HITS) * sizeof(SubstringHit)) == 0);
+        for (long i = 1; i < total && i < MAX_HITS; ++i) {
+            assert(a[i - 1].doc_id < a[i].doc_id || (a[i - 1].doc_id == a[i].doc_id && a[i - 1].offset < a[i].offset));
+        }
+    }
+    // con poco lugar se cuentan todas y se escriben las primeras
+    long all = II_SubstringSearch(indexed, "ote", a, MAX_HITS);
+    assert(II_SubstringSearch(indexed, "ote", c, 10) == all);
+    assert(memcmp(a, c, 10 * sizeof(SubstringHit)) == 0);
+    assert(II_SubstringSearch(indexed, "", a, 1) == -1);
+
+    // Un archivo recargado tiene el indice de su contenido nuevo
+    FILE* f = fopen(BOOKS_PATH "zz_trigram.txt", "w");
+    fputs("contenido viejo\n", f);
+    fclose(f);
+    InvertedIndex* reloaded = II_Create();
+    II_SetTrigramIndex(reloaded, TRUE);
+    assert(II_LoadFile(reloaded, "zz_trigram.txt") == 0);
+    assert(II_SubstringSearch(reloaded, "tenido vie", a, 1) == 1);
+    f = fopen(BOOKS_PATH "zz_trigram.txt", "w");
+    fputs("otro texto, contenido nuevo\n", f);
+    fclose(f);
+    assert(II_ReloadFile(reloaded, "zz_trigram.txt") == 0);
+    assert(II_SubstringSearch(reloaded, "tenido vie", a, 1) == 0);
+    assert(II_SubstringSearch(reloaded, "tenido nue", a, 1) == 1 && a[0].offset == 15);
+    II_Destroy(reloaded);
+    remove(BOOKS_PATH "zz_trigram.txt");
+
+    II_Destroy(plain);
+    II_Destroy(indexed);
+    for (int b = 0; b < BOOKS; ++b) {
+        TG_Destroy(indexes[b]);
+        unmap_file(docs[b]);
+    }
+    printf("Trigram tests passed.\n");
+    return EXIT_SUCCESS;
+}
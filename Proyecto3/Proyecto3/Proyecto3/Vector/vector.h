@@ -0,0 +1,162 @@
+/**
+ * @file vector.h
+ * @brief Typed growable vectors with inline storage for small sizes
+ *
+ * VECTOR_DEFINE(Name, prefix, type, inline_count, tag) generates a vector of `type` that
+ * keeps its first inline_count elements inside the struct and moves them to the heap
+ * (doubling, allocated with the MemTag tag) only when it grows past them. Elements are read and written as values,
+ * with no boxing or memcpy: prefix_data gives a plain `type*` over all of them.
+ *
+ * A zeroed struct is an empty vector, so vectors can be embedded in calloc'd or
+ * stack structures; prefix_init does the same for malloc'd ones.
+ */
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../Allocator/allocator.h"
+
+/**
+ * @brief Identifier of an indexed term
+ */
+typedef uint32_t TermId;
+
+#define VECTOR_DEFINE(Name, prefix, type, inline_count, tag)                                 \
+                                                                                              \
+/* capacity is 0 while the items are inline */                                               \
+typedef struct {                                                                              \
+    uint32_t size;                                                                            \
+    uint32_t capacity;                                                                        \
+    union {                                                                                   \
+        type items[inline_count];                                                             \
+        type* heap;                                                                           \
+    } store;                                                                                  \
+} Name;                                                                                       \
+                                                                                              \
+static inline void prefix##_init(Name* vector) {                                              \
+    vector->size = 0;                                                                         \
+    vector->capacity = 0;                                                                     \
+}                                                                                             \
+                                                                                              \
+static inline size_t prefix##_size(const Name* vector) {                                      \
+    return vector->size;                                                                      \
+}                                                                                             \
+                                                                                              \
+static inline type* prefix##_data(Name* vector) {                                             \
+    return vector->capacity ? vector->store.heap : vector->store.items;                       \
+}                                                                                             \
+                                                                                              \
+static inline const type* prefix##_cdata(const Name* vector) {                                \
+    return vector->capacity ? vector->store.heap : vector->store.items;                       \
+}                                                                                             \
+                                                                                              \
+static inline type prefix##_get(const Name* vector, size_t index) {                           \
+    return prefix##_cdata(vector)[index];                                                     \
+}                                                                                             \
+                                                                                              \
+/* Room for at least count elements; returns 0 if out of memory (vector unchanged) */         \
+static inline int prefix##_reserve(Name* vector, size_t count) {                              \
+    size_t capacity = vector->capacity ? vector->capacity : (inline_count);                   \
+    type* heap;                                                                               \
+    if (count <= capacity) {                                                                  \
+        return 1;                                                                             \
+    }                                                                                         \
+    if (count > UINT32_MAX) {                                                                 \
+        return 0;                                                                             \
+    }                                                                                         \
+    while (capacity < count) {                                                                \
+        capacity *= 2;                                                                        \
+    }                                                                                         \
+    if (capacity > UINT32_MAX) {                                                              \
+        capacity = UINT32_MAX;                                                                \
+    }                                                                                         \
+    if (vector->capacity) {                                                                   \
+        heap = (type*)mem_realloc((tag), vector->store.heap, vector->capacity * sizeof(type), \
+                                  capacity * sizeof(type));                                   \
+        if (heap == NULL) {                                                                   \
+            return 0;                                                                         \
+        }                                                                                     \
+    } else {                                                                                  \
+        heap = (type*)mem_malloc((tag), capacity * sizeof(type));                             \
+        if (heap == NULL) {                                                                   \
+            return 0;                                                                         \
+        }                                                                                     \
+        memcpy(heap, vector->store.items, vector->size * sizeof(type));                       \
+    }                                                                                         \
+    vector->store.heap = heap;                                                                \
+    vector->capacity = (uint32_t)capacity;                                                    \
+    return 1;                                                                                 \
+}                                                                                             \
+                                                                                              \
+/* Appends value; returns 0 if out of memory */                                               \
+static inline int prefix##_push(Name* vector, type value) {                                   \
+    if (vector->size == (vector->capacity ? vector->capacity : (inline_count)) &&             \
+        !prefix##_reserve(vector, (size_t)vector->size + 1)) {                                \
+        return 0;                                                                             \
+    }                                                                                         \
+    prefix##_data(vector)[vector->size++] = value;                                            \
+    return 1;                                                                                 \
+}                                                                                             \
+                                                                                              \
+/* Empties the vector, keeping its buffer */                                                  \
+static inline void prefix##_clear(Name* vector) {                                             \
+    vector->size = 0;                                                                         \
+}                                                                                             \
+                                                                                              \
+/* Frees the heap buffer, leaving an empty vector */                                          \
+static inline void prefix##_free(Name* vector) {                                              \
+    if (vector->capacity) {                                                                   \
+        mem_free((tag), vector->store.heap, vector->capacity * sizeof(type));                 \
+    }                                                                                         \
+    prefix##_init(vector);                                                                    \
+}                                                                                             \
+                                                                                              \
+/* Gives back the unused part of the heap buffer, moving the items inline when they fit;      \
+   returns the bytes released (0 if out of memory, vector unchanged) */                       \
+static inline size_t prefix##_shrink(Name* vector) {                                          \
+    size_t released = (size_t)(vector->capacity - vector->size) * sizeof(type);               \
+    type* heap = vector->store.heap;                                                          \
+    if (vector->capacity == 0 || released == 0) {                                             \
+        return 0;                                                                             \
+    }                                                                                         \
+    if (vector->size <= (inline_count)) {                                                     \
+        memcpy(vector->store.items, heap, vector->size * sizeof(type));                       \
+        mem_free((tag), heap, vector->capacity * sizeof(type));                               \
+        released = vector->capacity * sizeof(type);                                           \
+        vector->capacity = 0;                                                                 \
+        return released;                                                                      \
+    }                                                                                         \
+    heap = (type*)mem_realloc((tag), heap, vector->capacity * sizeof(type),                   \
+                              vector->size * sizeof(type));                                   \
+    if (heap == NULL) {                                                                       \
+        return 0;                                                                             \
+    }                                                                                         \
+    vector->store.heap = heap;                                                                \
+    vector->capacity = vector->size;                                                          \
+    return released;                                                                          \
+}                                                                                             \
+                                                                                              \
+/* Bytes allocated outside the struct */                                                      \
+static inline size_t prefix##_heap_bytes(const Name* vector) {                                \
+    return (size_t)vector->capacity * sizeof(type);                                           \
+}
+
+/**
+ * @brief Token ordinals of a term in a document (most terms have fewer than 4 per document)
+ */
+VECTOR_DEFINE(U32Vector, u32vec, uint32_t, 4, MEM_ORDINALS)
+
+/**
+ * @brief Byte offsets of a term in a document, and other 64-bit values
+ */
+VECTOR_DEFINE(U64Vector, u64vec, uint64_t, 4, MEM_SCRATCH)
+
+/**
+ * @brief Term identifiers, e.g. the terms of a query
+ */
+VECTOR_DEFINE(TermIdVector, termvec, TermId, 8, MEM_TERMS)
+
+#endif /* VECTOR_H */
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "InvertedIndex.h"
+#include "Vector/vector.h"
+
+/*
+ * Postings de cada (palabra, documento) como se guardaban antes (offsets y ordinales en dos
+ * ArrayLists de long de capacidad inicial 5, leidos con arraylist_get + memcpy) contra el
+ * U32Vector de ordinales de Occurrence, con los primeros 4 dentro de la estructura. Se usan
+ * las cantidades reales de un libro (indice sin congelar, con palabras cortas): memoria,
+ * tiempo de carga y de lectura (el mejor de RUNS). Al final, el armado y orden de las
+ * entradas (ordinal, palabra) de una busqueda por proximidad: punteros en un ArrayList
+ * con arraylist_sort contra un U64Vector con arraylist_sort_u64.
+ *
+ *   Vector_bench [file]     (por defecto DonQuijote.txt)
+ */
+
+#define RUNS 5
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+/* Una (palabra, documento) de cada forma */
+typedef struct {
+    ArrayList* offsets;
+    ArrayList* ordinals;
+} Boxed;
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static size_t list_memory(const ArrayList* list) {
+    return sizeof(ArrayList) + list->capacity * list->element_size;
+}
+
+static int compare_boxed(const void* a, const void* b) {
+    uintptr_t pa = (uintptr_t)a, pb = (uintptr_t)b;
+    return (pa < pb) ? -1 : (pa > pb);
+}
+
+int main(int argc, char** argv) {
+    const char* file = argc > 1 ? argv[1] : "DonQuijote.txt";
+    InvertedIndex* idx = II_Create();
+    II_SetIndexShortWords(idx, TRUE);
+    II_SetHybridPostings(idx, FALSE);
+    if (II_LoadFile(idx, file) < 0) {
+        fprintf(stderr, "No se pudo cargar '%s'\n", file);
+        return EXIT_FAILURE;
+    }
+
+    // Cantidad de ordinales de cada (palabra, documento)
+    size_t slots = 0, inline_slots = 0, values = 0;
+    for (TermId term = 0; term < idx->terms.count; ++term) {
+        for (const Occurrence* cur = idx->terms.postings[term].first; cur; cur = cur->next) slots++;
+    }
+    const Occurrence** occurrences = malloc(sizeof(Occurrence*) * slots);
+    slots = 0;
+    for (TermId term = 0; term < idx->terms.count; ++term) {
+        for (const Occurrence* cur = idx->terms.postings[term].first; cur; cur = cur->next) {
+            occurrences[slots++] = cur;
+            inline_slots += GetOrdinalCount(cur) <= 4;
+            values += GetOrdinalCount(cur);
+        }
+    }
+    printf("%s: %zu (palabra, documento), %zu ordinales, %.1f%% con 4 o menos\n\n",
+           file, slots, values, 100.0 * inline_slots / slots);
+
+    Boxed* boxed = malloc(sizeof(Boxed) * slots);
+    U32Vector* typed = malloc(sizeof(U32Vector) * slots);
+    const long* offsets = (const long*)idx->token_offsets[0]->data;
+    double best[2][2] = { { -1, -1 }, { -1, -1 } };
+    size_t memory[2] = { 0, 0 };
+    unsigned long sums[2] = { 0, 0 };
+    for (int r = 0; r < RUNS; ++r) {
+        // carga: antes se guardaban offset y ordinal de cada token, ahora solo el ordinal
+        double start = now_ms();
+        for (size_t s = 0; s < slots; ++s) {
+            const Occurrence* cur = occurrences[s];
+            boxed[s].offsets = arraylist_create(5, sizeof(long));
+            boxed[s].ordinals = arraylist_create(5, sizeof(long));
+            for (size_t i = 0; i < GetOrdinalCount(cur); ++i) {
+                long ordinal = (long)u32vec_get(&cur->ordinals, i);
+                long offset = offsets[ordinal];
+                arraylist_add(boxed[s].offsets, &offset);
+                arraylist_add(boxed[s].ordinals, &ordinal);
+            }
+        }
+        double elapsed = now_ms() - start;
+        if (best[0][0] < 0 || elapsed < best[0][0]) best[0][0] = elapsed;
+
+        start = now_ms();
+        for (size_t s = 0; s < slots; ++s) {
+            const Occurrence* cur = occurrences[s];
+            u32vec_init(&typed[s]);
+            for (size_t i = 0; i < GetOrdinalCount(cur); ++i) u32vec_push(&typed[s], u32vec_get(&cur->ordinals, i));
+        }
+        elapsed = now_ms() - start;
+        if (best[1][0] < 0 || elapsed < best[1][0]) best[1][0] = elapsed;
+
+        // lectura: todos los ordinales
+        sums[0] = sums[1] = 0;
+        start = now_ms();
+        for (size_t s = 0; s < slots; ++s) {
+            for (size_t i = 0; i < arraylist_size(boxed[s].ordinals); ++i) {
+                long ordinal;
+                memcpy(&ordinal, arraylist_get(boxed[s].ordinals, i), sizeof(long));
+                sums[0] += (unsigned long)ordinal;
+            }
+        }
+        elapsed = now_ms() - start;
+        if (best[0][1] < 0 || elapsed < best[0][1]) best[0][1] = elapsed;
+
+        start = now_ms();
+        for (size_t s = 0; s < slots; ++s) {
+            for (size_t i = 0; i < u32vec_size(&typed[s]); ++i) sums[1] += u32vec_get(&typed[s], i);
+        }
+        elapsed = now_ms() - start;
+        if (best[1][1] < 0 || elapsed < best[1][1]) best[1][1] = elapsed;
+        if (sums[0] != sums[1]) {
+            fprintf(stderr, "Las sumas no coinciden: %lu contra %lu\n", sums[0], sums[1]);
+            return EXIT_FAILURE;
+        }
+
+        memory[0] = memory[1] = 0;
+        for (size_t s = 0; s < slots; ++s) {
+            memory[0] += sizeof(Boxed) + list_memory(boxed[s].offsets) + list_memory(boxed[s].ordinals);
+            memory[1] += sizeof(U32Vector) + u32vec_heap_bytes(&typed[s]);
+            arraylist_destroy(boxed[s].offsets);
+            arraylist_destroy(boxed[s].ordinals);
+            u32vec_free(&typed[s]);
+        }
+    }
+
+    printf("%-22s %12s %10s %10s\n", "postings", "memoria", "carga", "lectura");
+    printf("%-22s %9.1f KB %7.2f ms %7.2f ms\n", "ArrayList + memcpy", memory[0] / 1024.0, best[0][0], best[0][1]);
+    printf("%-22s %9.1f KB %7.2f ms %7.2f ms\n", "U32Vector en linea", memory[1] / 1024.0, best[1][0], best[1][1]);
+    printf("postings del indice: %.1f KB (%zu bytes por Occurrence)\n\n",
+           II_PostingsMemory(idx) / 1024.0, sizeof(Occurrence));
+
+    // Proximidad: entradas (ordinal << 6 | palabra) de varias palabras del documento 0
+    const char* words[] = { "de", "la", "que", "sancho" };
+    int word_count = (int)(sizeof(words) / sizeof(words[0]));
+    ArrayList* all_boxed = arraylist_create(11, sizeof(void*));
+    U64Vector all_typed;
+    u64vec_init(&all_typed);
+    double gather[2] = { -1, -1 };
+    for (int r = 0; r < RUNS; ++r) {
+        double start = now_ms();
+        arraylist_clear(all_boxed);
+        for (int w = 0; w < word_count; ++w) {
+            PostingCursor cursor;
+            OpenPostingCursor(&cursor, II_Postings(idx, words[w]));
+            do {
+                void* tmp = (void*)(((uintptr_t)CursorOrdinal(&cursor) << QUERY_WORD_BITS) | (uintptr_t)w);
+                arraylist_add(all_boxed, &tmp);
+            } while (CursorNextOrdinal(&cursor));
+        }
+        arraylist_sort(all_boxed, compare_boxed);
+        double elapsed = now_ms() - start;
+        if (gather[0] < 0 || elapsed < gather[0]) gather[0] = elapsed;
+
+        start = now_ms();
+        u64vec_clear(&all_typed);
+        for (int w = 0; w < word_count; ++w) {
+            PostingCursor cursor;
+            OpenPostingCursor(&cursor, II_Postings(idx, words[w]));
+            do {
+                u64vec_push(&all_typed, ((uint64_t)CursorOrdinal(&cursor) << QUERY_WORD_BITS) | (uint64_t)w);
+            } while (CursorNextOrdinal(&cursor));
+        }
+        arraylist_sort_u64(u64vec_data(&all_typed), u64vec_size(&all_typed), NULL, 0);
+        elapsed = now_ms() - start;
+        if (gather[1] < 0 || elapsed < gather[1]) gather[1] = elapsed;
+    }
+    for (size_t i = 0; i < u64vec_size(&all_typed); ++i) {
+        if ((uint64_t)(uintptr_t)((void**)all_boxed->data)[i] != u64vec_get(&all_typed, i)) {
+            fprintf(stderr, "Los ordenes no coinciden en la entrada %zu\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("proximidad (%zu entradas): ArrayList de punteros %.2f ms, U64Vector %.2f ms\n",
+           u64vec_size(&all_typed), gather[0], gather[1]);
+
+    arraylist_destroy(all_boxed);
+    u64vec_free(&all_typed);
+    free(boxed);
+    free(typed);
+    free(occurrences);
+    II_Destroy(idx);
+    return EXIT_SUCCESS;
+}
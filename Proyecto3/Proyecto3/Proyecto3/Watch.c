@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include "Watch.h"
+
+#define WATCH_MASK (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)
+#define WATCH_READ_BUFFER 4096
+
+// A file waiting for its debounce
+typedef struct _PendingFile {
+    char name[WATCH_NAME_LENGTH];
+    WatchEvent event;          // last kind of change seen
+    double deadline;           // ms (CLOCK_MONOTONIC) at which it is reported
+} PendingFile;
+
+struct _Watcher {
+    int inotify_fd;
+    int stop_pipe[2];          // WT_Stop wakes the thread through here
+    int debounce_ms;
+    WT_Handler handler;
+    void* context;
+    pthread_t thread;
+    PendingFile pending[WATCH_MAX_PENDING];   // only touched by the thread
+    int pending_count;
+    pthread_mutex_t lock;      // stats
+    WatchStats stats;
+};
+
+static double now_ms(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+// Hidden files and editor backups (".libro.txt.swp", "libro.txt~")
+static BOOLEAN ignored_name(const char* name) {
+    size_t length = strlen(name);
+    return length == 0 || name[0] == '.' || name[length - 1] == '~' || length >= WATCH_NAME_LENGTH;
+}
+
+static void report(Watcher* watcher, const PendingFile* file) {
+    pthread_mutex_lock(&watcher->lock);
+    if (file->event == WATCH_CHANGED) watcher->stats.changed++;
+    else watcher->stats.removed++;
+    pthread_mutex_unlock(&watcher->lock);
+    watcher->handler(file->name, file->event, watcher->context);
+}
+
+// Take pending[i] out (order doesn't matter) and report it
+static void report_pending(Watcher* watcher, int i) {
+    PendingFile file = watcher->pending[i];
+    watcher->pending[i] = watcher->pending[--watcher->pending_count];
+    report(watcher, &file);
+}
+
+static void record_event(Watcher* watcher, const struct inotify_event* event) {
+    pthread_mutex_lock(&watcher->lock);
+    watcher->stats.events++;
+    if (event->mask & IN_Q_OVERFLOW) watcher->stats.overflows++;
+    pthread_mutex_unlock(&watcher->lock);
+    if (!(event->mask & WATCH_MASK) || (event->mask & IN_ISDIR) || event->len == 0 || ignored_name(event->name)) return;
+
+    int i = 0;
+    while (i < watcher->pending_count && strcmp(watcher->pending[i].name, event->name) != 0) i++;
+    if (i == watcher->pending_count) {
+        // no room: the file closest to its deadline is reported now
+        if (watcher->pending_count == WATCH_MAX_PENDING) {
+            int first = 0;
+            for (int p = 1; p < watcher->pending_count; ++p) {
+                if (watcher->pending[p].deadline < watcher->pending[first].deadline) first = p;
+            }
+            report_pending(watcher, first);
+            i = watcher->pending_count;
+        }
+        strcpy(watcher->pending[i].name, event->name);
+        watcher->pending_count++;
+    }
+    watcher->pending[i].event = (event->mask & (IN_DELETE | IN_MOVED_FROM)) ? WATCH_REMOVED : WATCH_CHANGED;
+    watcher->pending[i].deadline = now_ms() + watcher->debounce_ms;
+}
+
+// Report the files that have been quiet for the debounce; returns ms until the next deadline, -1 if none
+static int report_settled(Watcher* watcher) {
+    double now = now_ms();
+    int i = 0;
+    while (i < watcher->pending_count) {
+        if (watcher->pending[i].deadline <= now) report_pending(watcher, i);
+        else i++;
+    }
+    if (watcher->pending_count == 0) return -1;
+
+    // the handler may have taken a while, wait from the current time
+    now = now_ms();
+    double next = watcher->pending[0].deadline;
+    for (int p = 1; p < watcher->pending_count; ++p) {
+        if (watcher->pending[p].deadline < next) next = watcher->pending[p].deadline;
+    }
+    return next <= now ? 0 : (int)(next - now) + 1;
+}
+
+static void* watch_main(void* arg) {
+    Watcher* watcher = arg;
+    _Alignas(struct inotify_event) char buffer[WATCH_READ_BUFFER];
+    struct pollfd fds[2] = { { watcher->inotify_fd, POLLIN, 0 }, { watcher->stop_pipe[0], POLLIN, 0 } };
+    int timeout = -1;
+    while (1) {
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready > 0 && fds[1].revents) break;
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            ssize_t length;
+            while ((length = read(watcher->inotify_fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length;) {
+                    const struct inotify_event* event = (const struct inotify_event*)p;
+                    record_event(watcher, event);
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        }
+        timeout = report_settled(watcher);
+    }
+    return NULL;
+}
+
+Watcher* WT_Start(const char* directory, int debounce_ms, WT_Handler handler, void* context) {
+    if (!directory || !handler) return NULL;
+    Watcher* watcher = calloc(1, sizeof(Watcher));
+    if (!watcher) return NULL;
+    watcher->debounce_ms = debounce_ms > 0 ? debounce_ms : WATCH_DEBOUNCE_MS;
+    watcher->handler = handler;
+    watcher->context = context;
+    watcher->stop_pipe[0] = watcher->stop_pipe[1] = -1;
+    pthread_mutex_init(&watcher->lock, NULL);
+
+    watcher->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->inotify_fd < 0 || inotify_add_watch(watcher->inotify_fd, directory, WATCH_MASK | IN_ONLYDIR) < 0 ||
+        pipe(watcher->stop_pipe) < 0 || pthread_create(&watcher->thread, NULL, watch_main, watcher) != 0) {
+        if (watcher->inotify_fd >= 0) close(watcher->inotify_fd);
+        if (watcher->stop_pipe[0] >= 0) {
+            close(watcher->stop_pipe[0]);
+            close(watcher->stop_pipe[1]);
+        }
+        pthread_mutex_destroy(&watcher->lock);
+        free(watcher);
+        return NULL;
+    }
+    return watcher;
+}
+
+void WT_Stop(Watcher* watcher) {
+    if (!watcher) return;
+    char stop = 1;
+    while (write(watcher->stop_pipe[1], &stop, 1) < 0 && errno == EINTR) {}
+    pthread_join(watcher->thread, NULL);
+    close(watcher->inotify_fd);
+    close(watcher->stop_pipe[0]);
+    close(watcher->stop_pipe[1]);
+    pthread_mutex_destroy(&watcher->lock);
+    free(watcher);
+}
+
+void WT_GetStats(Watcher* watcher, WatchStats* stats) {
+    if (!watcher || !stats) return;
+    pthread_mutex_lock(&watcher->lock);
+    *stats = watcher->stats;
+    pthread_mutex_unlock(&watcher->lock);
+}
@@ -0,0 +1,50 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "boolean.h"
+
+#define WATCH_DEBOUNCE_MS 300     // quiet time after the last event of a file before it is reported
+#define WATCH_MAX_PENDING 64      // files waiting for their debounce at the same time
+#define WATCH_NAME_LENGTH 256     // longest file name reported (NAME_MAX + 1)
+
+/*
+ * Watch mode: a background thread follows a directory with inotify and reports which
+ * files were written, created, moved in, deleted or moved out.
+ *
+ *   inotify events --> pending (one entry per file) --debounce--> handler(name, event)
+ *
+ * A copy or an editor save is a burst of events on the same file (create, many modify,
+ * close); every event pushes the file's deadline debounce_ms forward and the handler runs
+ * once, when the file has been quiet that long, with the last kind of change. Files
+ * starting with '.' or ending in '~' (editor temporaries) and subdirectories are ignored.
+ * The handler runs on the watcher thread, one file at a time, so it can do slow work
+ * (reindex the file) while new events wait in the kernel queue.
+ */
+
+typedef enum _WatchEvent {
+    WATCH_CHANGED,    // written, created or moved into the directory
+    WATCH_REMOVED     // deleted or moved out of the directory
+} WatchEvent;
+
+// Reports one settled file, name relative to the watched directory
+typedef void (*WT_Handler)(const char* name, WatchEvent event, void* context);
+
+typedef struct _WatchStats {
+    long events;          // inotify events read (ignored names included)
+    long changed;         // handler calls with WATCH_CHANGED
+    long removed;         // handler calls with WATCH_REMOVED
+    long overflows;       // the kernel queue overflowed and events were lost
+} WatchStats;
+
+typedef struct _Watcher Watcher;
+
+// Start watching directory (debounce_ms <= 0 uses WATCH_DEBOUNCE_MS). Returns NULL if the
+// directory can't be watched or the thread can't start
+Watcher* WT_Start(const char* directory, int debounce_ms, WT_Handler handler, void* context);
+
+// Stop the thread (after the handler call in progress, pending files are dropped) and free it
+void WT_Stop(Watcher* watcher);
+
+void WT_GetStats(Watcher* watcher, WatchStats* stats);
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "InvertedIndex.h"
+#include "Watch.h"
+
+#define DEBOUNCE_MS 100
+#define MAX_REPORTS 16
+
+/* Implementado una vez por programa para establecer como manejar errores */
+extern void GlobalReportarError(char* pszFile, int  iLine) {
+
+	/* Siempre imprime el error */
+	fprintf(
+		stderr,
+		"\nERROR NO ESPERADO: en el archivo %s linea %u",
+		pszFile,
+		iLine
+	);
+
+}
+
+static void sleep_ms(long ms) {
+    struct timespec pause = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&pause, NULL);
+}
+
+static void write_book(const char* dir, const char* name, const char* text) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s%s", dir, name);
+    FILE* f = fopen(path, "w");
+    assert(f != NULL);
+    fputs(text, f);
+    fclose(f);
+}
+
+static void remove_book(const char* dir, const char* name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s%s", dir, name);
+    unlink(path);
+}
+
+static InvertedIndex* load_books(const char* names[], int count) {
+    InvertedIndex* idx = II_Create();
+    for (int b = 0; b < count; ++b) assert(II_LoadFile(idx, names[b]) == b);
+    return idx;
+}
+
+/* Mismos terminos con los mismos (documento, ordinal), en orden de documento */
+static void assert_same_postings(const InvertedIndex* a, const InvertedIndex* b) {
+    assert(HTSize(a->table) == HTSize(b->table));
+    int pos = 0;
+    char* term;
+    while (HTNext(a->table, &pos, &term, NULL)) {
+        assert(II_Postings(b, term) != NULL);
+        PostingCursor x, y;
+        OpenPostingCursor(&x, II_Postings(a, term));
+        OpenPostingCursor(&y, II_Postings(b, term));
+        while (CursorDocument(&x) >= 0) {
+            int doc = CursorDocument(&x);
+            assert(CursorDocument(&y) == doc);
+            int more;
+            do {
+                assert(CursorOrdinal(&x) == CursorOrdinal(&y));
+                more = CursorNextOrdinal(&x);
+                assert(CursorNextOrdinal(&y) == more);
+            } while (more);
+            CursorSeekDocument(&x, doc + 1);
+            CursorSeekDocument(&y, doc + 1);
+        }
+        assert(CursorDocument(&y) < 0);
+    }
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    char names[MAX_REPORTS][WATCH_NAME_LENGTH];
+    WatchEvent events[MAX_REPORTS];
+    int count;
+} Reports;
+
+static void record(const char* name, WatchEvent event, void* context) {
+    Reports* reports = context;
+    pthread_mutex_lock(&reports->lock);
+    if (reports->count < MAX_REPORTS) {
+        snprintf(reports->names[reports->count], WATCH_NAME_LENGTH, "%s", name);
+        reports->events[reports->count] = event;
+    }
+    reports->count++;
+    pthread_mutex_unlock(&reports->lock);
+}
+
+static int reports_of(Reports* reports, const char* name, WatchEvent event) {
+    int found = 0;
+    pthread_mutex_lock(&reports->lock);
+    for (int r = 0; r < reports->count && r < MAX_REPORTS; ++r) {
+        if (strcmp(reports->names[r], name) == 0 && reports->events[r] == event) found++;
+    }
+    pthread_mutex_unlock(&reports->lock);
+    return found;
+}
+
+static int report_count(Reports* reports) {
+    pthread_mutex_lock(&reports->lock);
+    int count = reports->count;
+    pthread_mutex_unlock(&reports->lock);
+    return count;
+}
+
+/* Recarga en el mismo indice: watch mode lo usa desde el hilo del watcher */
+typedef struct {
+    InvertedIndex* idx;
+    pthread_mutex_t lock;
+    int reloads;
+} Reloader;
+
+static void reload(const char* name, WatchEvent event, void* context) {
+    Reloader* reloader = context;
+    if (event != WATCH_CHANGED || strncmp(name, "zz_watch", 8) != 0) return;
+    pthread_mutex_lock(&reloader->lock);
+    assert(II_ReloadFile(reloader->idx, name) >= 0);
+    reloader->reloads++;
+    pthread_mutex_unlock(&reloader->lock);
+}
+
+int main(void) {
+    const char* first[] = { "tesoro.txt", "zz_watch_a.txt", "lobo.txt" };
+
+    // Reindexar un archivo del medio deja el mismo indice que cargarlo de cero con el contenido nuevo
+    write_book(BOOKS_PATH, "zz_watch_a.txt", "alpha beta gamma\nbeta zzonlyold sancho\n");
+    InvertedIndex* idx = load_books(first, 3);
+    assert(II_TermCount(idx, "zzonlyold") == 1);
+    write_book(BOOKS_PATH, "zz_watch_a.txt", "delta alpha\nalpha zzonlynew caballo lobo\nmucho texto nuevo aqui\n");
+    assert(II_FindFile(idx, "zz_watch_a.txt") == 1);
+    assert(II_FindFile(idx, "no_existe.txt") == -1);
+    assert(II_ReloadFile(idx, "zz_watch_a.txt") == 1);
+    assert(idx->last_file_index == 2);
+    assert(II_TermCount(idx, "zzonlyold") == 0 && II_Postings(idx, "zzonlyold") == NULL);
+    assert(II_TermCount(idx, "zzonlynew") == 1 && II_TermCount(idx, "alpha") == 2);
+    InvertedIndex* fresh = load_books(first, 3);
+    assert_same_postings(idx, fresh);
+    assert_same_postings(fresh, idx);
+    assert(arraylist_size(idx->token_offsets[1]) == arraylist_size(fresh->token_offsets[1]));
+    assert(idx->documents[1]->size == fresh->documents[1]->size);
+
+    // Una frase que cruza el texto nuevo se encuentra una sola vez
+    int count = 0;
+    printData* results = II_SearchPhrase(idx, "alpha zzonlynew caballo", &count);
+    assert(count == 1 && results[0].doc_id == 1 && results[0].first_occurrence_line == 2);
+    free(results);
+
+    // Los terminos que quedaron sin postings no salen en las sugerencias
+    termCandidate candidates[FUZZY_MAX_CANDIDATES];
+    int n = II_FuzzyLookup(idx, "zzonlyolx", 2, candidates, FUZZY_MAX_CANDIDATES);
+    for (int c = 0; c < n; ++c) assert(strcmp(candidates[c].term, "zzonlyold") != 0);
+
+    // Sin el archivo se conserva lo indexado; uno que no estaba se agrega al final
+    remove_book(BOOKS_PATH, "zz_watch_a.txt");
+    assert(II_ReloadFile(idx, "zz_watch_a.txt") == -1);
+    assert(II_TermCount(idx, "zzonlynew") == 1);
+    write_book(BOOKS_PATH, "zz_watch_b.txt", "epsilon zzonlynew\n");
+    assert(II_ReloadFile(idx, "zz_watch_b.txt") == 3);
+    assert(II_TermCount(idx, "zzonlynew") == 2);
+    II_Destroy(fresh);
+    II_Destroy(idx);
+    remove_book(BOOKS_PATH, "zz_watch_b.txt");
+
+    // Los ids de los terminos son densos, en orden de aparicion; los que una recarga deja
+    // sin postings se vuelven a usar en vez de agrandar la tabla
+    write_book(BOOKS_PATH, "zz_watch_ids.txt", "zzuno zzdos zztres zzdos\n");
+    const char* ids_book[] = { "zz_watch_ids.txt" };
+    idx = load_books(ids_book, 1);
+    assert(idx->terms.count == 3 && II_TermId(idx, "zzuno") == 0 && II_TermId(idx, "ZZDOS") == 1);
+    assert(strcmp(II_TermWord(idx, 2), "zztres") == 0 && II_TermPostings(idx, 1) == II_Postings(idx, "zzdos"));
+    assert(II_TermId(idx, "zzcuatro") == TERM_NONE && II_TermPostings(idx, 3) == NULL && II_TermWord(idx, 3) == NULL);
+    write_book(BOOKS_PATH, "zz_watch_ids.txt", "zzdos zzcuatro\n");
+    assert(II_ReloadFile(idx, "zz_watch_ids.txt") == 0);
+    assert(idx->terms.count == 3 && HTSize(idx->table) == 2);
+    assert(II_TermId(idx, "zzuno") == TERM_NONE && II_TermId(idx, "zztres") == TERM_NONE);
+    int free_ids = 0;
+    for (TermId t = 0; t < idx->terms.count; ++t) {
+        if (II_TermWord(idx, t) == NULL) free_ids += II_TermPostings(idx, t) == NULL;
+        else assert(II_TermId(idx, II_TermWord(idx, t)) == t);
+    }
+    assert(free_ids == 1 && II_TermCount(idx, "zzcuatro") == 1 && II_TermCount(idx, "zzdos") == 1);
+    write_book(BOOKS_PATH, "zz_watch_ids.txt", "zzseis zzdos zzsiete zzocho zzseis\n");
+    assert(II_ReloadFile(idx, "zz_watch_ids.txt") == 0);
+    assert(idx->terms.count == 4 && HTSize(idx->table) == 4);
+    for (TermId t = 0; t < idx->terms.count; ++t) assert(II_TermId(idx, II_TermWord(idx, t)) == t);
+    assert(II_TermCount(idx, "zzseis") == 2 && II_TermCount(idx, "zzcuatro") == 0);
+    II_Destroy(idx);
+    remove_book(BOOKS_PATH, "zz_watch_ids.txt");
+
+    // Watcher: una rafaga de escrituras se informa una vez, despues del debounce
+    char dir[] = "/tmp/watch_testXXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%s/", dir);
+    Reports reports;
+    memset(&reports, 0, sizeof(reports));
+    pthread_mutex_init(&reports.lock, NULL);
+    assert(WT_Start("/no/existe", DEBOUNCE_MS, record, &reports) == NULL);
+    Watcher* watcher = WT_Start(dir, DEBOUNCE_MS, record, &reports);
+    assert(watcher != NULL);
+
+    char path[128];
+    snprintf(path, sizeof(path), "%slibro.txt", prefix);
+    FILE* f = fopen(path, "w");
+    for (int chunk = 0; chunk < 5; ++chunk) {
+        fprintf(f, "parte %d del libro\n", chunk);
+        fflush(f);
+        sleep_ms(DEBOUNCE_MS / 4);
+    }
+    fclose(f);
+    write_book(prefix, ".libro.txt.swp", "temporal");
+    write_book(prefix, "libro.txt~", "copia");
+    write_book(prefix, "otro.txt", "otro libro");
+    assert(report_count(&reports) == 0);   // todavia dentro del debounce
+    sleep_ms(DEBOUNCE_MS * 4);
+    assert(reports_of(&reports, "libro.txt", WATCH_CHANGED) == 1);
+    assert(reports_of(&reports, "otro.txt", WATCH_CHANGED) == 1);
+    assert(report_count(&reports) == 2);
+
+    // Renombrar hacia el directorio es un cambio; borrar o sacar el archivo, una baja
+    char moved[128];
+    snprintf(moved, sizeof(moved), "%s.nuevo.tmp", prefix);
+    write_book(prefix, ".nuevo.tmp", "escrito aparte");
+    char target[128];
+    snprintf(target, sizeof(target), "%snuevo.txt", prefix);
+    assert(rename(moved, target) == 0);
+    remove_book(prefix, "otro.txt");
+    sleep_ms(DEBOUNCE_MS * 4);
+    assert(reports_of(&reports, "nuevo.txt", WATCH_CHANGED) == 1);
+    assert(reports_of(&reports, "otro.txt", WATCH_REMOVED) == 1);
+    WatchStats stats;
+    WT_GetStats(watcher, &stats);
+    assert(stats.changed == 3 && stats.removed == 1 && stats.overflows == 0 && stats.events > 5);
+    WT_Stop(watcher);
+    remove_book(prefix, "libro.txt");
+    remove_book(prefix, "libro.txt~");
+    remove_book(prefix, ".libro.txt.swp");
+    remove_book(prefix, "nuevo.txt");
+    rmdir(dir);
+
+    // De punta a punta: el watcher sobre libros/ reindexa el archivo modificado
+    const char* books[] = { "zz_watch_c.txt", "lobo.txt" };
+    write_book(BOOKS_PATH, "zz_watch_c.txt", "zzversion zzprimera\n");
+    Reloader reloader = { load_books(books, 2), PTHREAD_MUTEX_INITIALIZER, 0 };
+    watcher = WT_Start(BOOKS_PATH, DEBOUNCE_MS, reload, &reloader);
+    assert(watcher != NULL);
+    write_book(BOOKS_PATH, "zz_watch_c.txt", "zzversion zzsegunda, mas larga\n");
+    sleep_ms(DEBOUNCE_MS * 4);
+    pthread_mutex_lock(&reloader.lock);
+    assert(reloader.reloads == 1);
+    assert(II_TermCount(reloader.idx, "zzprimera") == 0 && II_TermCount(reloader.idx, "zzsegunda") == 1);
+    assert(II_TermCount(reloader.idx, "zzversion") == 1);
+    pthread_mutex_unlock(&reloader.lock);
+    WT_Stop(watcher);
+    II_Destroy(reloader.idx);
+    remove_book(BOOKS_PATH, "zz_watch_c.txt");
+
+    printf("Watch tests passed.\n");
+    return EXIT_SUCCESS;
+}
@@ -1,14 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "InvertedIndex.h"
 
 void ask_words(char* words);
 void show_footer();
+int ask_next_page();
 void show_title();
 void show_occurrences(char** lines);
+void show_correction(const char* typed, const char* used);
+void show_suggestions(const char* word, const termCandidate* candidates, int count);
 
 void ask_words(char* words){
-    printf("\n\e[4;33mIngrese la/s palabra/s a buscar (separadas por comas):\033[0m ");
+    printf("\n\e[4;33mIngrese la/s palabra/s a buscar (separadas por comas, o \"frase exacta\"):\033[0m ");
     fgets(words, 100, stdin);
     words[strcspn(words, "\n")] = 0; // Remove newline character
 
@@ -25,14 +29,35 @@ void show_footer(){
     printf("\n-------------------- Salir -> ESC   ----------\033[0m\n");
 }
 
+/* Muestra el pie de pagina y espera: ENTER sigue, ESC (o q) deja de paginar.
+   Devuelve 1 para mostrar la siguiente pagina, 0 para terminar */
+int ask_next_page() {
+    char answer[16];
+    show_footer();
+    if (!fgets(answer, sizeof(answer), stdin)) return 0;
+    return answer[0] != 27 && answer[0] != 'q' && answer[0] != 'Q';
+}
+
 void show_title(){
     printf("\e[4;31m==================== Word/s Search Engine ======================\033[0m\n");
 }
 
 void show_occurrences(char** lines) {
     int i = 0;
-    while (lines[i][0] != '\0') {
+    while (lines[i] != NULL) {
         printf("%s\n", lines[i]);
         i++;
     }
 }
+
+void show_correction(const char* typed, const char* used) {
+    printf("\e[0;36mBuscando '%s' en lugar de '%s'\033[0m\n", used, typed);
+}
+
+void show_suggestions(const char* word, const termCandidate* candidates, int count) {
+    printf("\e[0;36m¿Quiso decir? (%s):\033[0m", word);
+    for (int i = 0; i < count; ++i) {
+        printf(" %s (%d)", candidates[i].term, candidates[i].distance);
+    }
+    printf("\n");
+}